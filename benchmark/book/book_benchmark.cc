@@ -1,4 +1,8 @@
+#include <unordered_map>
+
 #include "benchmark/benchmark.h"
+#include "orderbook/book/book_registry.h"
+#include "orderbook/feed/market_by_order.h"
 #include "utils.h"
 
 // constexpr auto kMaxBookSize = 1048576;
@@ -138,8 +142,202 @@ static void BM_OrderBook(benchmark::State& state) {
                                                    benchmark::Counter::kInvert);
 }
 
+/**
+ * Compile-time event sink, performs the same accounting as the eventpp
+ * listeners registered in BM_OrderBook.
+ */
+struct CountingEventSink {
+  BookEventCounter* counter;
+
+  auto OnExecutionReport(const EventType& event_type,
+                         const ExecutionView& execution_report) -> void {
+    const bool is_buy = execution_report.GetSide() == SideCode::kBuy;
+    counter->total_events += 1;
+
+    switch (event_type) {
+      case EventType::kOrderPendingNew:
+        counter->order_pending_new += 1;
+        is_buy ? counter->buy_order_pending_new += 1
+               : counter->sell_order_pending_new += 1;
+        break;
+      case EventType::kOrderNew:
+        counter->order_new += 1;
+        is_buy ? counter->buy_order_qty += execution_report.GetOrderQuantity()
+               : counter->sell_order_qty += execution_report.GetOrderQuantity();
+        break;
+      case EventType::kOrderPartiallyFilled:
+        counter->order_partially_filled += 1;
+        is_buy ? counter->buy_order_executed_qty +=
+                 execution_report.GetLastQuantity()
+               : counter->sell_order_executed_qty +=
+                 execution_report.GetLastQuantity();
+        break;
+      case EventType::kOrderFilled:
+        counter->order_filled += 1;
+        is_buy ? counter->buy_order_executed_qty +=
+                 execution_report.GetLastQuantity()
+               : counter->sell_order_executed_qty +=
+                 execution_report.GetLastQuantity();
+        break;
+      case EventType::kOrderCancelled:
+        counter->order_cancelled += 1;
+        break;
+      case EventType::kOrderRejected:
+        counter->order_rejected += 1;
+        break;
+      case EventType::kOrderModified:
+        counter->order_modified += 1;
+        break;
+      default:
+        break;
+    }
+  }
+
+  auto OnCancelReject(const EventType& /*unused*/,
+                      const OrderCancelReject& /*unused*/) -> void {
+    counter->order_cancel_rejected += 1;
+    counter->total_events += 1;
+  }
+};
+
+template <typename OrderBookTraits>
+static void BM_StaticSinkOrderBook(benchmark::State& state) {
+  using BookType =
+      typename OrderBookTraits::template StaticBookType<CountingEventSink>;
+
+  BookEventCounter counter;
+  BookType book = BookType(CountingEventSink{&counter});
+
+  for (auto _ : state) {
+    auto nos = MakeNewOrderSingle(NextSide());
+    book.Add(nos);
+  }
+
+  state.counters["total_events"] = counter.total_events;
+  state.counters["total_events_rate"] =
+      benchmark::Counter(counter.total_events, benchmark::Counter::kIsRate);
+  state.counters["total_events_rate_inv"] =
+      benchmark::Counter(counter.total_events, benchmark::Counter::kIsRate |
+                                                   benchmark::Counter::kInvert);
+}
+
+/**
+ * Discards published market data, the feed itself does all of the work.
+ */
+struct NullFeedTransport {
+  std::size_t bytes{0};
+
+  auto Publish(std::string_view /*unused*/, const void* /*unused*/,
+               const std::size_t& size) -> void {
+    bytes += size;
+  }
+};
+
+using MarketByOrderFeed = orderbook::feed::MarketByOrder<NullFeedTransport>;
+
+/**
+ * Counts events like CountingEventSink and also turns them into the L3
+ * feed, the way the publisher thread does with its event records.
+ */
+struct MarketByOrderEventSink {
+  CountingEventSink counting;
+  MarketByOrderFeed* feed;
+
+  auto OnExecutionReport(const EventType& event_type,
+                         const ExecutionView& execution_report) -> void {
+    counting.OnExecutionReport(event_type, execution_report);
+    feed->OnRecord(EventRecord(event_type, execution_report));
+  }
+
+  auto OnCancelReject(const EventType& event_type,
+                      const OrderCancelReject& order_cancel_reject) -> void {
+    counting.OnCancelReject(event_type, order_cancel_reject);
+  }
+};
+
+template <typename OrderBookTraits>
+static void BM_MarketByOrderOrderBook(benchmark::State& state) {
+  using BookType =
+      typename OrderBookTraits::template StaticBookType<MarketByOrderEventSink>;
+
+  BookEventCounter counter;
+  NullFeedTransport transport;
+  MarketByOrderFeed feed{transport};
+  BookType book = BookType(
+      MarketByOrderEventSink{CountingEventSink{&counter}, &feed});
+
+  for (auto _ : state) {
+    auto nos = MakeNewOrderSingle(NextSide());
+    book.Add(nos);
+    feed.OnBatchEnd();
+  }
+
+  state.counters["total_events"] = counter.total_events;
+  state.counters["total_events_rate"] =
+      benchmark::Counter(counter.total_events, benchmark::Counter::kIsRate);
+  state.counters["feed_bytes_rate"] =
+      benchmark::Counter(transport.bytes, benchmark::Counter::kIsRate);
+}
+
+/**
+ * Find the book of each request among kListedBooks listed instruments, as
+ * the matching shard does, through the BookRegistry or an unordered_map.
+ */
+constexpr std::size_t kListedBooks = 100000;
+constexpr std::size_t kLookupRequests = 4096;
+
+struct LookupBook {
+  InstrumentId instrument_id;
+  std::uint64_t requests{0};
+};
+
+auto MakeLookupRequests() -> std::vector<InstrumentId> {
+  std::vector<InstrumentId> requests(kLookupRequests);
+  for (auto& id : requests) {
+    id = static_cast<InstrumentId>(NextRandom(kListedBooks, 1));
+  }
+  return requests;
+}
+
+static void BM_BookRegistryLookup(benchmark::State& state) {
+  orderbook::book::BookRegistry<LookupBook> books(
+      [](const InstrumentId& instrument_id) {
+        return std::make_unique<LookupBook>(LookupBook{instrument_id});
+      });
+  for (InstrumentId id = 1; id <= kListedBooks; ++id) {
+    books.Add(id);
+  }
+
+  const auto requests = MakeLookupRequests();
+  std::size_t i{0};
+  for (auto _ : state) {
+    ++books.Find(requests[i++ % kLookupRequests])->requests;
+  }
+}
+
+static void BM_BookMapLookup(benchmark::State& state) {
+  std::unordered_map<InstrumentId, LookupBook> books;
+  for (InstrumentId id = 1; id <= kListedBooks; ++id) {
+    books.emplace(id, LookupBook{id});
+  }
+
+  const auto requests = MakeLookupRequests();
+  std::size_t i{0};
+  for (auto _ : state) {
+    ++books.at(requests[i++ % kLookupRequests]).requests;
+  }
+}
+
 BENCHMARK(BM_OrderBook<MapListTraits>);
 BENCHMARK(BM_OrderBook<IntrusivePtrTraits>);
 BENCHMARK(BM_OrderBook<IntrusiveListTraits>);
+BENCHMARK(BM_StaticSinkOrderBook<MapListTraits>);
+BENCHMARK(BM_StaticSinkOrderBook<IntrusivePtrTraits>);
+BENCHMARK(BM_StaticSinkOrderBook<IntrusiveListTraits>);
+BENCHMARK(BM_MarketByOrderOrderBook<MapListTraits>);
+BENCHMARK(BM_MarketByOrderOrderBook<IntrusivePtrTraits>);
+BENCHMARK(BM_MarketByOrderOrderBook<IntrusiveListTraits>);
+BENCHMARK(BM_BookRegistryLookup);
+BENCHMARK(BM_BookMapLookup);
 
 BENCHMARK_MAIN();  // NOLINT
@@ -0,0 +1,137 @@
+#include "benchmark/benchmark.h"
+#include "orderbook/data/fixed_codec.h"
+#include "orderbook/data/request_view.h"
+#include "orderbook/gateway/fix_parser.h"
+#include "utils.h"
+
+using namespace orderbook::data;
+
+namespace fixed = orderbook::serialize::fixed;
+using EventTypeCode = orderbook::serialize::EventTypeCode;
+
+constexpr std::size_t kBatchSize = 16;
+constexpr auto kNew = EventTypeCode::OrderPendingNew;
+
+/**
+ * Encode a request as the client does, reports the encoded bytes per
+ * request.
+ */
+template <Codec C>
+static void BM_EncodeNewOrderSingle(benchmark::State& state) {
+  const auto nos = MakeNewOrderSingle(SideCode::kBuy);
+
+  flatbuffers::FlatBufferBuilder builder;
+  FixedFrameWriter writer;
+  std::size_t bytes{0};
+
+  for (auto _ : state) {
+    if constexpr (C == Codec::kFixed) {
+      writer.Clear();
+      writer.Append<fixed::NewOrderSingle>(kNew, 1, 2).Encode(nos);
+      writer.Finish(1, 2);
+      bytes = writer.Size();
+      benchmark::DoNotOptimize(writer.Data());
+    } else {
+      using namespace orderbook::serialize;
+      builder.Clear();
+      builder.Finish(CreateMessage(
+          builder, CreateHeader(builder, 2, 1, kNew),
+          Body::NewOrderSingle, nos.SerializeTo(builder).Union()));
+      bytes = builder.GetSize();
+      benchmark::DoNotOptimize(builder.GetBufferPointer());
+    }
+  }
+
+  state.counters["bytes"] = static_cast<double>(bytes);
+}
+
+/**
+ * Decode a batch of requests as the orderbook does: find the messages,
+ * then read every field the book reads through a RequestView.
+ */
+template <Codec C>
+static void BM_DecodeNewOrderSingleBatch(benchmark::State& state) {
+  using Traits = CodecTraits<C>;
+
+  flatbuffers::FlatBufferBuilder builder;
+  FixedFrameWriter writer;
+  std::vector<flatbuffers::Offset<orderbook::serialize::Message>> messages;
+
+  for (std::size_t i = 0; i < kBatchSize; ++i) {
+    const auto nos = MakeNewOrderSingle(NextSide());
+    if constexpr (C == Codec::kFixed) {
+      writer.Append<fixed::NewOrderSingle>(kNew, 1, 2).Encode(nos);
+    } else {
+      using namespace orderbook::serialize;
+      messages.push_back(CreateMessage(
+          builder, CreateHeader(builder, 2, 1, kNew),
+          Body::NewOrderSingle, nos.SerializeTo(builder).Union()));
+    }
+  }
+
+  std::vector<std::uint8_t> frame;
+  if constexpr (C == Codec::kFixed) {
+    writer.Finish(1, 2);
+    frame.assign(writer.Data(), writer.Data() + writer.Size());
+  } else {
+    using namespace orderbook::serialize;
+    builder.Finish(CreateMultiMessage(
+        builder, CreateHeader(builder, 2, 1, EventTypeCode::MultiMessage),
+        builder.CreateVector(messages)));
+    frame.assign(builder.GetBufferPointer(),
+                 builder.GetBufferPointer() + builder.GetSize());
+  }
+
+  for (auto _ : state) {
+    if constexpr (C == Codec::kFixed) {
+      if (!VerifyFixedFrame(frame.data(), frame.size())) {
+        state.SkipWithError("malformed frame");
+        break;
+      }
+    }
+
+    const auto* multi_msg =
+        Traits::template GetRoot<typename Traits::MultiMessage>(frame.data());
+    for (const auto* message : Traits::Messages(multi_msg)) {
+      const auto view = RequestView(message->body_as_NewOrderSingle(), 0);
+      benchmark::DoNotOptimize(view.GetOrderPrice());
+      benchmark::DoNotOptimize(view.GetOrderQuantity());
+      benchmark::DoNotOptimize(view.GetInstrumentId());
+      benchmark::DoNotOptimize(view.GetSide());
+      benchmark::DoNotOptimize(view.GetClientOrderId());
+    }
+  }
+
+  state.counters["bytes"] = static_cast<double>(frame.size());
+  state.SetItemsProcessed(state.iterations() * kBatchSize);
+}
+
+/**
+ * Parse a FIX 4.2 NewOrderSingle, as received by the gateway, into the
+ * request it forwards.
+ */
+static void BM_ParseFixNewOrderSingle(benchmark::State& state) {
+  const std::string raw =
+      "8=FIX.4.2\x01" "9=154\x01" "35=D\x01" "34=2\x01" "49=CLIENT\x01"
+      "52=20240102-09:30:00.000\x01" "56=GATEWAY\x01" "1=1001\x01"
+      "11=clordid-0001\x01" "21=1\x01" "38=100\x01" "40=2\x01"
+      "44=123.456\x01" "48=7\x01" "54=1\x01" "55=AAPL\x01"
+      "60=20240102-09:30:00.000\x01" "10=123\x01";
+
+  orderbook::gateway::FixParser parser;
+  for (auto _ : state) {
+    NewOrderSingle nos;
+    benchmark::DoNotOptimize(parser.Parse(raw) && parser.Fill(nos));
+    benchmark::DoNotOptimize(nos);
+  }
+}
+
+BENCHMARK(BM_EncodeNewOrderSingle<Codec::kFlatBuffers>);
+BENCHMARK(BM_EncodeNewOrderSingle<Codec::kFixed>);
+
+BENCHMARK(BM_DecodeNewOrderSingleBatch<Codec::kFlatBuffers>);
+BENCHMARK(BM_DecodeNewOrderSingleBatch<Codec::kFixed>);
+
+BENCHMARK(BM_ParseFixNewOrderSingle);
+
+BENCHMARK_MAIN();  // NOLINT
@@ -0,0 +1,74 @@
+#include <sstream>
+
+#include "benchmark/benchmark.h"
+#include "orderbook/gateway/risk_engine.h"
+#include "orderbook/gateway/throttle.h"
+#include "utils.h"
+
+using namespace orderbook::data;
+
+using RiskConfig = orderbook::gateway::RiskConfig;
+using RiskEngine = orderbook::gateway::RiskEngine;
+
+static auto MakeRiskEngine() -> RiskEngine {
+  std::istringstream input("*,1000000,1000000000,1000000000000,1000000000\n");
+  return RiskEngine(RiskConfig::Parse(input));
+}
+
+/**
+ * The pre-trade check of a new order, which reserves its notional and an
+ * open order slot, as run by the gateway before forwarding it.
+ */
+static void BM_RiskCheckNewOrder(benchmark::State& state) {
+  static auto risk_engine = MakeRiskEngine();
+
+  NewOrderSingle order;
+  order.SetAccountId(kAccountId + state.thread_index())
+      .SetSide(Side::kBuy)
+      .SetOrderPrice(kPriceScale)
+      .SetOrderQuantity(1);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(risk_engine.Check(order));
+  }
+}
+
+/**
+ * The pre-trade check of a replace, which only reads the counters.
+ */
+static void BM_RiskCheckReplace(benchmark::State& state) {
+  static auto risk_engine = MakeRiskEngine();
+
+  OrderCancelReplaceRequest modify;
+  modify.SetAccountId(kAccountId)
+      .SetSide(Side::kSell)
+      .SetOrderPrice(kPriceScale)
+      .SetOrderQuantity(1);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(risk_engine.Check(modify));
+  }
+}
+
+/**
+ * The session and account throttles of one message, clock read included.
+ */
+static void BM_ThrottleAcquire(benchmark::State& state) {
+  using orderbook::gateway::ThrottleLimits;
+  using orderbook::util::TimeUtil;
+
+  // never empties, every message takes both buckets' full path
+  orderbook::gateway::Throttle throttle(ThrottleLimits{1000000000, 0});
+  throttle.AddSession(kSessionId, ThrottleLimits{1000000000, 0});
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(throttle.TryAcquire(
+        kSessionId, kAccountId, TimeUtil::MonotonicNanos()));
+  }
+}
+
+BENCHMARK(BM_RiskCheckNewOrder)->Threads(1)->Threads(4);
+BENCHMARK(BM_RiskCheckReplace);
+BENCHMARK(BM_ThrottleAcquire);
+
+BENCHMARK_MAIN();  // NOLINT
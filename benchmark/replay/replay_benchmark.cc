@@ -0,0 +1,520 @@
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "orderbook/book/book_registry.h"
+#include "orderbook/book/order_id_sequence.h"
+#include "orderbook/data/fixed_codec.h"
+#include "orderbook/data/request_view.h"
+#include "orderbook/util/journal.h"
+#include "orderbook/util/time_util.h"
+#include "utils.h"
+
+/**
+ * Replays a recorded inbound message flow, a journal written by the
+ * orderbook, through a book of each traits type and reports the message
+ * rate and per-message latency percentiles. Messages are decoded and
+ * applied as a matching shard does.
+ *
+ * usage: replay_benchmark [benchmark flags] [JOURNAL_DIR]
+ *
+ * Without a journal a synthetic flow is recorded to a temporary journal
+ * first and replayed from there.
+ */
+
+constexpr auto kMaxBookSize = 131072;
+
+using MapListTraits = typename orderbook::MapListOrderBookTraits;
+using IntrusivePtrTraits =
+    typename orderbook::IntrusivePtrOrderBookTraits<kMaxBookSize>;
+using IntrusiveListTraits =
+    typename orderbook::IntrusiveListOrderBookTraits<kMaxBookSize>;
+
+using EventTypeCode = orderbook::serialize::EventTypeCode;
+using JournalReader = orderbook::util::JournalReader;
+using JournalWriter = orderbook::util::JournalWriter;
+using OrderIdSequence = orderbook::book::OrderIdSequence;
+using TimeUtil = orderbook::util::TimeUtil;
+
+namespace fixed = orderbook::serialize::fixed;
+
+/**
+ * Hand each request of an inbound message, a single one or every one of a
+ * MultiMessage, to fn.
+ */
+template <Codec C, typename Fn>
+auto ForEachRequest(const std::uint8_t* data, Fn&& fn) -> void {
+  using Traits = CodecTraits<C>;
+
+  const auto* flatc_msg =
+      Traits::template GetRoot<typename Traits::Message>(data);
+  if (flatc_msg->header()->event_type() == EventTypeCode::MultiMessage) {
+    const auto* multi_msg =
+        Traits::template GetRoot<typename Traits::MultiMessage>(data);
+    for (const auto* message : Traits::Messages(multi_msg)) {
+      fn(message);
+    }
+  } else {
+    fn(flatc_msg);
+  }
+}
+
+/**
+ * Returns false, and applies nothing, for a malformed fixed layout frame.
+ */
+template <typename Fn>
+auto ForEachRequest(const std::uint8_t* data, const std::size_t& size,
+                    Fn&& fn) -> bool {
+  if (!IsFixedFrame(data, size)) {
+    ForEachRequest<Codec::kFlatBuffers>(data, fn);
+  } else if (VerifyFixedFrame(data, size)) {
+    ForEachRequest<Codec::kFixed>(data, fn);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+template <typename Message>
+auto InstrumentOf(const Message* message) -> InstrumentId {
+  switch (message->header()->event_type()) {
+    case EventTypeCode::OrderPendingNew:
+      return message->body_as_NewOrderSingle()->instrument_id();
+    case EventTypeCode::OrderPendingModify:
+      return message->body_as_OrderCancelReplaceRequest()->instrument_id();
+    case EventTypeCode::OrderPendingCancel:
+      return message->body_as_OrderCancelRequest()->instrument_id();
+    default:
+      return 0;
+  }
+}
+
+/**
+ * The inbound messages of a journal, copied into one buffer with every
+ * message 8 byte aligned, as it was in its journal segment.
+ */
+class Recording {
+ public:
+  struct Entry {
+    std::size_t offset;
+    std::size_t size;
+    RoutingId routing_id;
+  };
+
+  static auto Load(const std::string& dir) -> Recording {
+    Recording recording;
+    JournalReader::ForEach(dir, [&](const std::uint32_t& routing_id,
+                                    const std::uint8_t* data,
+                                    const std::size_t& size) {
+      recording.Append(routing_id, data, size);
+    });
+
+    spdlog::info(
+        "loaded {} messages from {}: {} new, {} modify, {} cancel, "
+        "{} instruments, {} malformed",
+        recording.entries_.size(), dir, recording.adds_,
+        recording.modifies_, recording.cancels_,
+        recording.instruments_.size(), recording.malformed_);
+    return recording;
+  }
+
+  auto Data(const Entry& entry) const -> const std::uint8_t* {
+    return reinterpret_cast<const std::uint8_t*>(words_.data()) +
+           entry.offset;
+  }
+
+  auto Entries() const -> const std::vector<Entry>& { return entries_; }
+  auto Instruments() const -> const std::vector<InstrumentId>& {
+    return instruments_;
+  }
+  auto Requests() const -> std::size_t { return adds_ + modifies_ + cancels_; }
+
+ private:
+  auto Append(const RoutingId& routing_id, const std::uint8_t* data,
+              const std::size_t& size) -> void {
+    const auto offset = words_.size() * sizeof(std::uint64_t);
+    words_.resize(words_.size() +
+                  (size + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+    std::memcpy(words_.data() + offset / sizeof(std::uint64_t), data, size);
+    const auto* copy =
+        reinterpret_cast<const std::uint8_t*>(words_.data()) + offset;
+
+    const bool valid = ForEachRequest(copy, size, [&](const auto* message) {
+      const auto event_type = message->header()->event_type();
+      adds_ += event_type == EventTypeCode::OrderPendingNew ? 1 : 0;
+      modifies_ += event_type == EventTypeCode::OrderPendingModify ? 1 : 0;
+      cancels_ += event_type == EventTypeCode::OrderPendingCancel ? 1 : 0;
+      if (const auto instrument_id = InstrumentOf(message);
+          instrument_id != 0 && listed_.insert(instrument_id).second) {
+        instruments_.push_back(instrument_id);
+      }
+    });
+
+    // dropped by the shard as well, there is nothing to replay
+    if (!valid) {
+      words_.resize(offset / sizeof(std::uint64_t));
+      ++malformed_;
+      return;
+    }
+    entries_.push_back({offset, size, routing_id});
+  }
+
+  std::vector<std::uint64_t> words_;
+  std::vector<Entry> entries_;
+  std::vector<InstrumentId> instruments_;
+  std::set<InstrumentId> listed_;
+  std::size_t adds_{0};
+  std::size_t modifies_{0};
+  std::size_t cancels_{0};
+  std::size_t malformed_{0};
+};
+
+/**
+ * Per message latencies in one nanosecond buckets, anything slower than
+ * the last bucket is counted in it.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr std::size_t kBuckets = 1 << 16;
+
+  auto Record(const Timestamp& nanos) -> void {
+    const auto bucket = static_cast<std::size_t>(std::max<Timestamp>(nanos, 0));
+    ++buckets_[std::min(bucket, kBuckets - 1)];
+    ++count_;
+  }
+
+  auto Percentile(const double& p) const -> double {
+    const auto rank = static_cast<std::uint64_t>(std::ceil(p * count_));
+    std::uint64_t seen{0};
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+      seen += buckets_[i];
+      if (seen >= std::max<std::uint64_t>(rank, 1)) {
+        return static_cast<double>(i);
+      }
+    }
+    return static_cast<double>(kBuckets - 1);
+  }
+
+ private:
+  std::vector<std::uint64_t> buckets_ = std::vector<std::uint64_t>(kBuckets);
+  std::uint64_t count_{0};
+};
+
+/**
+ * Counts the events of the replayed books, which are otherwise dropped.
+ */
+struct ReplayEventSink {
+  std::size_t* events;
+
+  auto OnExecutionReport(const EventType& /*unused*/,
+                         const ExecutionView& /*unused*/) -> void {
+    *events += 1;
+  }
+
+  auto OnCancelReject(const EventType& /*unused*/,
+                      const OrderCancelReject& /*unused*/) -> void {
+    *events += 1;
+  }
+};
+
+/**
+ * Apply a single request to its book, as MatchingShard::Process does.
+ */
+template <typename Registry, typename Message>
+auto Apply(Registry& books, const Message* message,
+           const RoutingId& routing_id) -> void {
+  switch (message->header()->event_type()) {
+    case EventTypeCode::OrderPendingNew: {
+      const auto order =
+          RequestView(message->body_as_NewOrderSingle(), routing_id);
+      if (auto* book = books.Find(order.GetInstrumentId()); book != nullptr) {
+        book->Add(order);
+      }
+      break;
+    }
+    case EventTypeCode::OrderPendingModify: {
+      const auto modify =
+          RequestView(message->body_as_OrderCancelReplaceRequest(), routing_id);
+      if (auto* book = books.Find(modify.GetInstrumentId()); book != nullptr) {
+        book->Modify(modify);
+      }
+      break;
+    }
+    case EventTypeCode::OrderPendingCancel: {
+      const auto cancel =
+          RequestView(message->body_as_OrderCancelRequest(), routing_id);
+      if (auto* book = books.Find(cancel.GetInstrumentId()); book != nullptr) {
+        book->Cancel(cancel);
+      }
+      break;
+    }
+    case EventTypeCode::CancelOnDisconnect: {
+      const auto session_id =
+          message->body_as_OrderCancelRequest()->session_id();
+      books.ForEach([&](auto& book) { book.CancelAll(session_id); });
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+/**
+ * Each iteration replays the whole recording into fresh books. Latency is
+ * taken around every message, decode included, so the message rate carries
+ * the cost of two clock reads per message.
+ */
+template <typename OrderBookTraits>
+static void BM_Replay(benchmark::State& state, const Recording& recording) {
+  using BookType =
+      typename OrderBookTraits::template StaticBookType<ReplayEventSink>;
+  using Registry = orderbook::book::BookRegistry<BookType>;
+
+  std::size_t events{0};
+  LatencyHistogram latency;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    Registry books([&](const InstrumentId& instrument_id) {
+      return std::make_unique<BookType>(ReplayEventSink{&events},
+                                        instrument_id);
+    });
+    for (const auto& instrument_id : recording.Instruments()) {
+      books.Add(instrument_id);
+    }
+    state.ResumeTiming();
+
+    for (const auto& entry : recording.Entries()) {
+      const auto start = TimeUtil::MonotonicNanos();
+      ForEachRequest(recording.Data(entry), entry.size,
+                     [&](const auto* message) {
+                       Apply(books, message, entry.routing_id);
+                     });
+      latency.Record(TimeUtil::MonotonicNanos() - start);
+    }
+
+    // return pooled orders before the books go
+    state.PauseTiming();
+    books.ForEach([](auto& book) { book.Reset(); });
+    state.ResumeTiming();
+  }
+
+  const auto messages =
+      static_cast<double>(state.iterations() * recording.Entries().size());
+  state.counters["messages"] =
+      static_cast<double>(recording.Entries().size());
+  state.counters["requests"] = static_cast<double>(recording.Requests());
+  state.counters["messages_rate"] =
+      benchmark::Counter(messages, benchmark::Counter::kIsRate);
+  state.counters["events_rate"] = benchmark::Counter(
+      static_cast<double>(events), benchmark::Counter::kIsRate);
+  state.counters["p50_ns"] = latency.Percentile(0.50);
+  state.counters["p90_ns"] = latency.Percentile(0.90);
+  state.counters["p99_ns"] = latency.Percentile(0.99);
+  state.counters["p99.9_ns"] = latency.Percentile(0.999);
+}
+
+/**
+ * A synthetic flow for runs without a recorded journal. Orders rest a few
+ * ticks either side of a mid price which drifts, some cross it, and most
+ * are modified or cancelled again, recent ones more often than old ones.
+ * The flow is run through a reference book as it is generated, so filled
+ * orders are never modified or cancelled.
+ */
+constexpr std::size_t kSyntheticMessages = 200000;
+constexpr std::size_t kSyntheticInstruments = 8;
+constexpr int kAddPercent = 45;
+constexpr int kModifyPercent = 20;
+constexpr int kCrossPercent = 5;
+constexpr Price kTick = kPriceScale / 100;
+constexpr Price kStartPrice = 100 * kPriceScale;
+
+/**
+ * Collects the order ids of the reference book's fills.
+ */
+struct FillEventSink {
+  std::vector<OrderId>* filled;
+
+  auto OnExecutionReport(const EventType& event_type,
+                         const ExecutionView& execution_view) -> void {
+    if (event_type == EventType::kOrderFilled) {
+      filled->push_back(execution_view.GetOrderId());
+    }
+  }
+
+  auto OnCancelReject(const EventType& /*unused*/,
+                      const OrderCancelReject& /*unused*/) -> void {}
+};
+
+class SyntheticInstrument {
+ private:
+  using BookType = MapListTraits::StaticBookType<FillEventSink>;
+
+ public:
+  explicit SyntheticInstrument(const InstrumentId& instrument_id)
+      : instrument_id_(instrument_id),
+        order_ids_(instrument_id),
+        book_(FillEventSink{&closed_}, instrument_id) {}
+
+  /**
+   * Encode the next request for this instrument into writer.
+   */
+  auto Next(std::mt19937& gen, FixedFrameWriter& writer,
+            const std::uint32_t& seq_no) -> void {
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::geometric_distribution<int> ticks(0.35);
+    std::geometric_distribution<std::size_t> age(0.05);
+
+    if (percent(gen) < 2) {
+      mid_ += (percent(gen) < 50 ? -kTick : kTick);
+    }
+
+    const auto roll = percent(gen);
+    if (live_.empty() || roll < kAddPercent) {
+      const auto side = percent(gen) < 50 ? SideCode::kBuy : SideCode::kSell;
+      const auto sign = side == SideCode::kBuy ? -1 : 1;
+      const auto distance =
+          percent(gen) < kCrossPercent ? -ticks(gen) : 1 + ticks(gen);
+
+      LimitOrder order;
+      order.SetOrderId(order_ids_.Next())
+          .SetSessionId(kSessionId)
+          .SetAccountId(kAccountId)
+          .SetInstrumentId(instrument_id_)
+          .SetClientOrderId(MakeClientOrderId(kClientOrderIdSize))
+          .SetOrderType(OrderTypeCode::kLimit)
+          .SetTimeInForce(TimeInForceCode::kDay)
+          .SetOrderPrice(mid_ + sign * distance * kTick)
+          .SetOrderQuantity(NextRandom(kMaxQty, kMinQty))
+          .SetSide(side);
+
+      writer
+          .Append<fixed::NewOrderSingle>(EventTypeCode::OrderPendingNew, seq_no,
+                                         seq_no)
+          .Encode(order);
+      live_.push_back(order);
+      book_.Add(order);
+    } else {
+      const auto index =
+          live_.size() - 1 - std::min(age(gen), live_.size() - 1);
+      auto& order = live_[index];
+
+      if (roll < kAddPercent + kModifyPercent) {
+        const auto sign = order.IsBuyOrder() ? -1 : 1;
+        const std::string orig_clordid = order.GetClientOrderId();
+        order.SetClientOrderId(MakeClientOrderId(kClientOrderIdSize))
+            .SetOrigClientOrderId(orig_clordid)
+            .SetOrderPrice(mid_ + sign * (1 + ticks(gen)) * kTick);
+
+        auto ocrr = OrderCancelReplaceRequest();
+        ocrr.SetOrderId(order.GetOrderId())
+            .SetSide(order.GetSide())
+            .SetOrderType(order.GetOrderType())
+            .SetOrderPrice(order.GetOrderPrice())
+            .SetOrderQuantity(order.GetOrderQuantity())
+            .SetSessionId(order.GetSessionId())
+            .SetAccountId(order.GetAccountId())
+            .SetInstrumentId(order.GetInstrumentId())
+            .SetClientOrderId(order.GetClientOrderId())
+            .SetOrigClientOrderId(order.GetOrigClientOrderId());
+
+        writer
+            .Append<fixed::OrderCancelReplaceRequest>(
+                EventTypeCode::OrderPendingModify, seq_no, seq_no)
+            .Encode(ocrr);
+        book_.Modify(ocrr);
+      } else {
+        const auto ocxl = CancelOrder(order);
+        writer
+            .Append<fixed::OrderCancelRequest>(
+                EventTypeCode::OrderPendingCancel, seq_no, seq_no)
+            .Encode(ocxl);
+        book_.Cancel(ocxl);
+        closed_.push_back(ocxl.GetOrderId());
+      }
+    }
+
+    // filled and cancelled orders take no further requests
+    for (const auto& order_id : closed_) {
+      const auto iter =
+          std::find_if(live_.begin(), live_.end(), [&](auto& order) {
+            return order.GetOrderId() == order_id;
+          });
+      if (iter != live_.end()) {
+        *iter = live_.back();
+        live_.pop_back();
+      }
+    }
+    closed_.clear();
+  }
+
+ private:
+  InstrumentId instrument_id_;
+  OrderIdSequence order_ids_;
+  Price mid_{kStartPrice};
+  std::vector<LimitOrder> live_;
+  std::vector<OrderId> closed_;
+  BookType book_;
+};
+
+auto RecordSyntheticFlow(const std::string& dir) -> void {
+  std::mt19937 gen(kSyntheticMessages);  // NOLINT
+  std::uniform_int_distribution<std::size_t> pick(0,
+                                                  kSyntheticInstruments - 1);
+
+  std::vector<std::unique_ptr<SyntheticInstrument>> instruments;
+  for (InstrumentId id = 1; id <= kSyntheticInstruments; ++id) {
+    instruments.push_back(std::make_unique<SyntheticInstrument>(id));
+  }
+
+  JournalWriter journal({dir});
+  FixedFrameWriter writer;
+
+  for (std::uint32_t seq_no = 1; seq_no <= kSyntheticMessages; ++seq_no) {
+    writer.Clear();
+    instruments[pick(gen)]->Next(gen, writer, seq_no);
+    writer.Finish(seq_no, seq_no);
+    journal.Append(0, writer.Data(), writer.Size());
+  }
+}
+
+auto main(int argc, char** argv) -> int {
+  benchmark::Initialize(&argc, argv);
+
+  std::string dir = argc > 1 ? argv[1] : "";
+  const bool synthetic = dir.empty();
+  if (synthetic) {
+    dir = (std::filesystem::temp_directory_path() /
+           ("orderbook_replay." + std::to_string(::getpid())))
+              .string();
+    RecordSyntheticFlow(dir);
+  }
+
+  const auto recording = Recording::Load(dir);
+  if (synthetic) {
+    std::filesystem::remove_all(dir);
+  }
+
+  benchmark::RegisterBenchmark("BM_Replay<MapListTraits>",
+                               BM_Replay<MapListTraits>, std::cref(recording))
+      ->Unit(benchmark::kMillisecond);
+  benchmark::RegisterBenchmark("BM_Replay<IntrusivePtrTraits>",
+                               BM_Replay<IntrusivePtrTraits>,
+                               std::cref(recording))
+      ->Unit(benchmark::kMillisecond);
+  benchmark::RegisterBenchmark("BM_Replay<IntrusiveListTraits>",
+                               BM_Replay<IntrusiveListTraits>,
+                               std::cref(recording))
+      ->Unit(benchmark::kMillisecond);
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -10,6 +10,7 @@
 
 #include "eventpp/eventdispatcher.h"
 #include "orderbook/book/book_concept.h"
+#include "orderbook/book/event_sink.h"
 #include "orderbook/book/limit_order_book.h"
 #include "orderbook/container/container_concept.h"
 #include "orderbook/container/intrusive_list_container.h"
@@ -86,6 +87,7 @@ template <> struct fmt::formatter<orderbook::serialize::EventTypeCode> : formatt
          case EventTypeCode::OrderCancelRejected: name = "OrderCancelRejected"; break;
          case EventTypeCode::OrderModified: name = "OrderModified"; break;
          case EventTypeCode::CancelOnDisconnect: name = "CancelOnDisconnect"; break;
+         case EventTypeCode::MultiMessage: name = "MultiMessage"; break;
     }
     return formatter<string_view>::format(name, ctx);
   }
@@ -107,9 +109,16 @@ struct MapListOrderBookTraits {
   using AskContainerType =
       orderbook::container::MapListContainer<PriceLevelKey, std::less<>>;
 
+  using EventSink = orderbook::book::EventDispatcherSink<EventDispatcher>;
+
   using BookType =
       orderbook::book::LimitOrderBook<BidContainerType, AskContainerType,
-                                      OrderType, EventDispatcher>;
+                                      OrderType, EventSink>;
+
+  template <typename StaticEventSink>
+  using StaticBookType =
+      orderbook::book::LimitOrderBook<BidContainerType, AskContainerType,
+                                      OrderType, StaticEventSink>;
 };
 
 template <std::size_t PoolSize = 16384>
@@ -130,9 +139,16 @@ struct IntrusivePtrOrderBookTraits {
       orderbook::container::IntrusivePtrContainer<PriceLevelKey, OrderType,
                                                   PoolType, std::less<>>;
 
+  using EventSink = orderbook::book::EventDispatcherSink<EventDispatcher>;
+
   using BookType =
       orderbook::book::LimitOrderBook<BidContainerType, AskContainerType,
-                                      OrderType, EventDispatcher>;
+                                      OrderType, EventSink>;
+
+  template <typename StaticEventSink>
+  using StaticBookType =
+      orderbook::book::LimitOrderBook<BidContainerType, AskContainerType,
+                                      OrderType, StaticEventSink>;
 };
 
 template <std::size_t PoolSize = 16384>
@@ -153,9 +169,16 @@ struct IntrusiveListOrderBookTraits {
       orderbook::container::IntrusiveListContainer<PriceLevelKey, OrderType,
                                                    PoolType, std::less<>>;
 
+  using EventSink = orderbook::book::EventDispatcherSink<EventDispatcher>;
+
   using BookType =
       orderbook::book::LimitOrderBook<BidContainerType, AskContainerType,
-                                      OrderType, EventDispatcher>;
+                                      OrderType, EventSink>;
+
+  template <typename StaticEventSink>
+  using StaticBookType =
+      orderbook::book::LimitOrderBook<BidContainerType, AskContainerType,
+                                      OrderType, StaticEventSink>;
 };
 
 }  // namespace orderbook
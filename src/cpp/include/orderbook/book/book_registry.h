@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "orderbook/data/data_types.h"
+
+namespace orderbook::book {
+
+/**
+ * The books of a shard, indexed by instrument id. Ids are split into a page
+ * and a slot: a lookup is a bounds check on the page table and two loads,
+ * with no hashing. Pages are only allocated for id ranges holding a listed
+ * instrument, so sparse ids stay cheap, and a listed book is only
+ * constructed on its first request, so the thousands of instruments which
+ * never trade cost a bit and a null pointer each.
+ */
+template <typename Book, std::size_t PageBits = 12>
+class BookRegistry {
+ private:
+  using InstrumentId = orderbook::data::InstrumentId;
+  using BookPtr = std::unique_ptr<Book>;
+
+  static constexpr std::size_t kPageSize = std::size_t{1} << PageBits;
+  static constexpr InstrumentId kSlotMask = kPageSize - 1;
+
+  struct Page {
+    std::array<BookPtr, kPageSize> books;
+    std::bitset<kPageSize> listed;
+  };
+
+ public:
+  using BookFactory = std::function<BookPtr(const InstrumentId&)>;
+
+  explicit BookRegistry(BookFactory factory) : factory_(std::move(factory)) {}
+
+  /**
+   * List an instrument, its book is created by the factory on first use.
+   */
+  auto Add(const InstrumentId& instrument_id) -> void {
+    const auto page = instrument_id >> PageBits;
+    if (page >= pages_.size()) {
+      pages_.resize(page + 1);
+    }
+    if (!pages_[page]) {
+      pages_[page] = std::make_unique<Page>();
+    }
+
+    auto& listed = pages_[page]->listed;
+    if (!listed.test(instrument_id & kSlotMask)) {
+      listed.set(instrument_id & kSlotMask);
+      ++size_;
+    }
+  }
+
+  /**
+   * The book of a listed instrument, constructing it if needed; nullptr
+   * for an instrument that is not listed.
+   */
+  auto Find(const InstrumentId& instrument_id) -> Book* {
+    const auto page = instrument_id >> PageBits;
+    if (page >= pages_.size() || !pages_[page]) [[unlikely]] {
+      return nullptr;
+    }
+
+    auto& book = pages_[page]->books[instrument_id & kSlotMask];
+    if (!book) [[unlikely]] {
+      if (!pages_[page]->listed.test(instrument_id & kSlotMask)) {
+        return nullptr;
+      }
+      book = factory_(instrument_id);
+      ++constructed_;
+    }
+    return book.get();
+  }
+
+  auto Contains(const InstrumentId& instrument_id) const -> bool {
+    const auto page = instrument_id >> PageBits;
+    return page < pages_.size() && pages_[page] &&
+           pages_[page]->listed.test(instrument_id & kSlotMask);
+  }
+
+  /**
+   * Apply fn to every constructed book. Books never used hold no orders,
+   * so they are skipped.
+   */
+  template <typename Fn>
+  auto ForEach(Fn&& fn) -> void {
+    for (auto& page : pages_) {
+      if (!page) {
+        continue;
+      }
+      for (auto& book : page->books) {
+        if (book) {
+          fn(*book);
+        }
+      }
+    }
+  }
+
+  /**
+   * The number of listed instruments, and of books constructed so far.
+   */
+  auto Size() const -> std::size_t { return size_; }
+  auto Constructed() const -> std::size_t { return constructed_; }
+
+ private:
+  BookFactory factory_;
+  std::vector<std::unique_ptr<Page>> pages_;
+  std::size_t size_{0};
+  std::size_t constructed_{0};
+};
+}  // namespace orderbook::book
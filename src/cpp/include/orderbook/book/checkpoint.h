@@ -0,0 +1,258 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "orderbook/book/limit_order_book.h"
+#include "orderbook/data/execution_report.h"
+#include "orderbook/serialize/orderbook_fixed.h"
+#include "orderbook/util/journal.h"
+
+/**
+ * Checkpoints of the books. A checkpoint holds every resting order of every
+ * book, along with each book's counters, as of a journal sequence number.
+ * Recovery loads the newest checkpoint and replays only the journal records
+ * after it.
+ *
+ * A checkpoint is one file, checkpoint.<journal sequence>, in the journal
+ * directory. It holds a header, then for each book its counters followed
+ * by its orders, stored as fixed layout execution reports in price and time
+ * priority. The file is written through a mapping under a temporary name,
+ * synced, and only then renamed, so any checkpoint found on disk is whole.
+ * Client order ids are stored whole: the gateway rejects any longer than
+ * the fixed layout's 31 characters, so no resting order holds one.
+ */
+
+namespace orderbook::book {
+
+struct CheckpointHeader {
+  static constexpr std::uint32_t kMagic = 0x4b435042;
+  static constexpr std::uint32_t kVersion = 1;
+
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint64_t journal_sequence;
+  std::uint64_t book_count;
+  std::uint64_t order_count;
+};
+
+struct CheckpointBook {
+  InstrumentId instrument_id;
+  BookCounters counters;
+  std::uint64_t order_count;
+};
+
+struct CheckpointOrder {
+  RoutingId routing_id;
+  std::uint32_t reserved;
+  orderbook::serialize::fixed::ExecutionReport order;
+};
+
+static_assert(sizeof(CheckpointHeader) % 8 == 0);
+static_assert(sizeof(CheckpointBook) % 8 == 0);
+static_assert(sizeof(CheckpointOrder) % 8 == 0);
+
+namespace internal {
+constexpr std::string_view kCheckpointPrefix = "checkpoint.";
+constexpr std::string_view kCheckpointTemporary = ".tmp";
+
+inline auto CheckpointPath(const std::string& dir,
+                           const std::uint64_t& journal_sequence)
+    -> std::string {
+  constexpr std::size_t kDigits = 20;
+  const auto number = std::to_string(journal_sequence);
+  return dir + "/" + std::string(kCheckpointPrefix) +
+         std::string(kDigits - std::min(kDigits, number.size()), '0') +
+         number;
+}
+
+inline auto CheckpointSize(const std::size_t& book_count,
+                           const std::size_t& order_count) -> std::size_t {
+  return sizeof(CheckpointHeader) + book_count * sizeof(CheckpointBook) +
+         order_count * sizeof(CheckpointOrder);
+}
+
+/**
+ * The complete checkpoints of dir, oldest first.
+ */
+inline auto CheckpointPaths(const std::string& dir)
+    -> std::vector<std::string> {
+  std::vector<std::string> paths;
+  if (!std::filesystem::is_directory(dir)) {
+    return paths;
+  }
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    const auto name = entry.path().filename().string();
+    if (entry.is_regular_file() && name.starts_with(kCheckpointPrefix) &&
+        !name.ends_with(kCheckpointTemporary)) {
+      paths.push_back(entry.path().string());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+}  // namespace internal
+
+/**
+ * Writes one checkpoint. The number of books and orders is fixed up front,
+ * the file is sized for exactly that many.
+ */
+class CheckpointWriter {
+ public:
+  CheckpointWriter(const std::string& dir,
+                   const std::uint64_t& journal_sequence,
+                   const std::size_t& book_count,
+                   const std::size_t& order_count)
+      : dir_(dir),
+        path_(internal::CheckpointPath(dir, journal_sequence)),
+        header_{CheckpointHeader::kMagic, CheckpointHeader::kVersion,
+                journal_sequence, book_count, order_count} {
+    const auto temporary = path_ + std::string(internal::kCheckpointTemporary);
+    std::filesystem::remove(temporary);
+    mapping_.Create(temporary,
+                    internal::CheckpointSize(book_count, order_count));
+  }
+
+  /**
+   * Save a book's counters and resting orders.
+   */
+  template <typename Book>
+  auto Add(Book& book) -> void {
+    auto* entry = Next<CheckpointBook>();
+    entry->instrument_id = book.GetInstrumentId();
+    entry->counters = book.GetCounters();
+    entry->order_count = book.OrderCount();
+
+    book.ForEachOrder([&](const auto& order) {
+      auto* saved = Next<CheckpointOrder>();
+      saved->routing_id = order.GetRoutingId();
+      saved->reserved = 0;
+      saved->order.Encode(order);
+    });
+  }
+
+  /**
+   * Sync the checkpoint and publish it under its final name. Checkpoints
+   * older than the one before it are removed, the previous one is kept in
+   * case this one turns out unreadable.
+   */
+  auto Commit() -> void {
+    if (offset_ != mapping_.Size()) {
+      throw std::runtime_error("checkpoint " + path_ +
+                               " does not match its book and order count");
+    }
+
+    std::memcpy(mapping_.Data(), &header_, sizeof(header_));
+    mapping_.Sync(0, mapping_.Size(), MS_SYNC);
+    mapping_.Unmap();
+    std::filesystem::rename(path_ + std::string(internal::kCheckpointTemporary),
+                            path_);
+
+    const auto paths = internal::CheckpointPaths(dir_);
+    for (std::size_t i = 0; i + 2 < paths.size(); ++i) {
+      std::filesystem::remove(paths[i]);
+    }
+  }
+
+ private:
+  template <typename Entry>
+  auto Next() -> Entry* {
+    if (offset_ + sizeof(Entry) > mapping_.Size()) {
+      throw std::length_error("checkpoint " + path_ +
+                              " holds more than its book and order count");
+    }
+    auto* entry = reinterpret_cast<Entry*>(mapping_.Data() + offset_);
+    offset_ += sizeof(Entry);
+    return entry;
+  }
+
+  std::string dir_;
+  std::string path_;
+  CheckpointHeader header_;
+  orderbook::util::internal::SegmentMapping mapping_;
+  std::size_t offset_{sizeof(CheckpointHeader)};
+};
+
+/**
+ * Reads a checkpoint back. Throws std::runtime_error for a file which is
+ * not a complete checkpoint.
+ */
+class CheckpointReader {
+ public:
+  explicit CheckpointReader(const std::string& path) : path_(path) {
+    mapping_.Open(path_);
+    if (mapping_.Size() < sizeof(header_)) {
+      throw std::runtime_error("checkpoint " + path_ + " is truncated");
+    }
+
+    std::memcpy(&header_, mapping_.Data(), sizeof(header_));
+    if (header_.magic != CheckpointHeader::kMagic ||
+        header_.version != CheckpointHeader::kVersion ||
+        mapping_.Size() != internal::CheckpointSize(header_.book_count,
+                                                    header_.order_count)) {
+      throw std::runtime_error("checkpoint " + path_ + " is not valid");
+    }
+  }
+
+  /**
+   * The newest checkpoint in dir, empty when there is none.
+   */
+  static auto Latest(const std::string& dir) -> std::string {
+    const auto paths = internal::CheckpointPaths(dir);
+    return paths.empty() ? std::string{} : paths.back();
+  }
+
+  auto Path() const -> const std::string& { return path_; }
+  auto JournalSequence() const -> std::uint64_t {
+    return header_.journal_sequence;
+  }
+  auto BookCount() const -> std::uint64_t { return header_.book_count; }
+  auto OrderCount() const -> std::uint64_t { return header_.order_count; }
+
+  /**
+   * Restore the counters and resting orders of every book for which
+   * book_of(instrument_id) returns a book; it returns nullptr for books
+   * owned elsewhere. Returns the number of orders restored.
+   */
+  template <typename BookOf>
+  auto Restore(BookOf&& book_of) const -> std::size_t {
+    std::size_t restored{0};
+    std::size_t offset = sizeof(CheckpointHeader);
+
+    for (std::uint64_t i = 0; i < header_.book_count; ++i) {
+      CheckpointBook entry{};
+      std::memcpy(&entry, mapping_.Data() + offset, sizeof(entry));
+      offset += sizeof(entry);
+      if (offset + entry.order_count * sizeof(CheckpointOrder) >
+          mapping_.Size()) {
+        throw std::runtime_error("checkpoint " + path_ + " is not valid");
+      }
+
+      if (auto* book = book_of(entry.instrument_id); book != nullptr) {
+        book->SetCounters(entry.counters);
+        for (std::uint64_t j = 0; j < entry.order_count; ++j) {
+          const auto* saved = reinterpret_cast<const CheckpointOrder*>(
+              mapping_.Data() + offset + j * sizeof(CheckpointOrder));
+          auto order = ExecutionReport(&saved->order);
+          order.SetRoutingId(saved->routing_id);
+          restored += book->Restore(order) ? 1 : 0;
+        }
+      }
+      offset += entry.order_count * sizeof(CheckpointOrder);
+    }
+
+    return restored;
+  }
+
+ private:
+  std::string path_;
+  CheckpointHeader header_{};
+  orderbook::util::internal::SegmentMapping mapping_;
+};
+}  // namespace orderbook::book
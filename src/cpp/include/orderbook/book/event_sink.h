@@ -0,0 +1,70 @@
+#pragma once
+
+#include <memory>
+
+#include "orderbook/data/empty.h"
+#include "orderbook/data/event_types.h"
+#include "orderbook/data/execution_report.h"
+#include "orderbook/data/execution_view.h"
+#include "orderbook/data/order_cancel_reject.h"
+
+namespace orderbook::book {
+
+// clang-format off
+/**
+ * An event sink receives every event a LimitOrderBook produces. Sinks are a
+ * template parameter of the book, so calls resolve (and inline) at compile
+ * time instead of going through a runtime dispatcher.
+ */
+template <typename SinkT>
+concept EventSinkConcept = requires(SinkT s,
+                                    orderbook::data::EventType et,
+                                    const orderbook::data::ExecutionView& ev,
+                                    orderbook::data::OrderCancelReject ocr) {
+  s.OnExecutionReport(et, ev);
+  s.OnCancelReject(et, std::move(ocr));
+};
+// clang-format on
+
+/**
+ * Adapts an eventpp::EventDispatcher to the EventSinkConcept, every event is
+ * stored into an EventData variant and dispatched by event type. Execution
+ * views are materialized into an ExecutionReport first. Implicitly
+ * constructible from the dispatcher so books can still be built directly
+ * from a std::shared_ptr<EventDispatcher>.
+ */
+template <typename EventDispatcher>
+class EventDispatcherSink {
+ private:
+  using EventType = orderbook::data::EventType;
+  using EventData = orderbook::data::EventData;
+  using ExecutionReport = orderbook::data::ExecutionReport;
+  using ExecutionView = orderbook::data::ExecutionView;
+  using OrderCancelReject = orderbook::data::OrderCancelReject;
+  using EmptyType = orderbook::data::Empty;
+
+ public:
+  EventDispatcherSink(std::shared_ptr<EventDispatcher> dispatcher)  // NOLINT
+      : dispatcher_(std::move(dispatcher)), data_{EmptyType()} {}
+
+  auto OnExecutionReport(const EventType& event_type,
+                         const ExecutionView& execution_view) -> void {
+    data_ = ExecutionReport(execution_view);
+    dispatcher_->dispatch(event_type, data_);
+  }
+
+  auto OnCancelReject(const EventType& event_type,
+                      OrderCancelReject&& order_cancel_reject) -> void {
+    data_ = std::move(order_cancel_reject);
+    dispatcher_->dispatch(event_type, data_);
+  }
+
+  auto GetDispatcher() const -> const std::shared_ptr<EventDispatcher>& {
+    return dispatcher_;
+  }
+
+ private:
+  std::shared_ptr<EventDispatcher> dispatcher_;
+  EventData data_;
+};
+}  // namespace orderbook::book
@@ -1,7 +1,8 @@
 #pragma once
 
+#include "orderbook/book/event_sink.h"
+#include "orderbook/book/order_id_sequence.h"
 #include "orderbook/data/data_types.h"
-#include "orderbook/data/empty.h"
 #include "orderbook/data/event_types.h"
 #include "orderbook/data/new_order_single.h"
 #include "orderbook/data/order_cancel_replace_request.h"
@@ -12,23 +13,42 @@ namespace orderbook::book {
 
 using namespace orderbook::data;
 
+/**
+ * A book's counters, saved by a checkpoint along with its resting orders so
+ * a restored book carries on with the same transaction, execution and
+ * order ids.
+ */
+struct BookCounters {
+  TransactionId tx_id{0};
+  ExecutionId exec_id{0};
+  OrderId order_sequence{0};
+};
+
+// clang-format off
 template <typename BidContainerType, typename AskContainerType,
-          typename OrderType, typename EventDispatcher>
-class LimitOrderBook {
+          typename OrderType, typename EventSink>
+
+  requires EventSinkConcept<EventSink>
+
+class LimitOrderBook {  // clang-format on
  private:
   using Order = OrderType;
-  using EmptyType = orderbook::data::Empty;
-
-  inline static OrderId order_id{0};
 
  public:
-  LimitOrderBook(std::shared_ptr<EventDispatcher> dispatcher)
-      : dispatcher_(std::move(dispatcher)), data_{EmptyType()} {}
+  /**
+   * The instrument id seeds the prefix of every order id this book hands
+   * out, keeping order ids unique across books without shared state.
+   */
+  LimitOrderBook(EventSink sink, const InstrumentId& instrument_id = 0)
+      : instrument_id_(instrument_id),
+        order_ids_(instrument_id),
+        sink_(std::move(sink)) {}
 
   /**
    * Attempt to add a new order to the order book.
    */
-  auto Add(const NewOrderSingle& add_request) -> void {
+  template <typename NewOrderData>
+  auto Add(const NewOrderData& add_request) -> void {
     DispatchOrderStatus(EventType::kOrderPendingNew, add_request);
 
     if (add_request.IsBuyOrder()) {
@@ -39,7 +59,7 @@ class LimitOrderBook {
         return;
       }
 
-      auto&& [added, order] = bids_.Add(add_request, ++order_id);
+      auto&& [added, order] = bids_.Add(add_request, order_ids_.Next());
 
       if (added) {
         // Order was accepted, and added to book
@@ -59,7 +79,7 @@ class LimitOrderBook {
         return;
       }
 
-      auto&& [added, order] = asks_.Add(add_request, ++order_id);
+      auto&& [added, order] = asks_.Add(add_request, order_ids_.Next());
 
       if (added) {
         // Order was accepted, and added to book
@@ -76,7 +96,8 @@ class LimitOrderBook {
   /**
    * Attempt to modify a resting order.
    */
-  auto Modify(const OrderCancelReplaceRequest& modify_request) -> void {
+  template <typename ModifyRequest>
+  auto Modify(const ModifyRequest& modify_request) -> void {
     if (modify_request.IsBuyOrder()) {
       auto&& [modified, modified_order] = bids_.Modify(modify_request);
 
@@ -103,7 +124,8 @@ class LimitOrderBook {
   /**
    * Try to cancel an order that we think is resting on the book.
    */
-  auto Cancel(const OrderCancelRequest& cancel_request) -> void {
+  template <typename CancelRequest>
+  auto Cancel(const CancelRequest& cancel_request) -> void {
     if (cancel_request.IsBuyOrder()) {
       auto&& [removed, removed_order] = bids_.Remove(cancel_request);
 
@@ -125,10 +147,15 @@ class LimitOrderBook {
     }
   }
 
+  /**
+   * Cancel every resting order of a session, as on its disconnect. Each
+   * order is reported cancelled, like a cancel request, so the session's
+   * gateway and the market data feeds see it leave the book.
+   */
   auto CancelAll(const SessionId& session_id) -> std::size_t {
-    std::size_t deleted_order_count =
-      bids_.CancelAll(session_id) + asks_.CancelAll(session_id);
-    return deleted_order_count;
+    auto cancel = [this](Order& order) { CancelOrder(order); };
+    return bids_.CancelAll(session_id, cancel) +
+           asks_.CancelAll(session_id, cancel);
   }
 
   auto Match(const SideCode aggressor) -> void {
@@ -195,6 +222,68 @@ class LimitOrderBook {
     asks_.Clear();
   }
 
+  auto GetInstrumentId() const -> InstrumentId { return instrument_id_; }
+
+  auto GetCounters() const -> BookCounters {
+    return {tx_id_, exec_id_, order_ids_.GetSequence()};
+  }
+
+  auto SetCounters(const BookCounters& counters) -> void {
+    tx_id_ = counters.tx_id;
+    exec_id_ = counters.exec_id;
+    order_ids_.SetSequence(counters.order_sequence);
+  }
+
+  auto OrderCount() const -> std::size_t {
+    return bids_.Count() + asks_.Count();
+  }
+
+  /**
+   * Apply fn to every resting order, the bids then the asks, each side in
+   * price and time priority.
+   */
+  template <typename Fn>
+  auto ForEachOrder(Fn&& fn) -> void {
+    bids_.ForEach(fn);
+    asks_.ForEach(fn);
+  }
+
+  /**
+   * Put a resting order saved by a checkpoint back on the book, keeping its
+   * order id, status and fills. Nothing is matched; orders restored in
+   * ForEachOrder order keep their time priority. Each is reported as a new
+   * order so market data rebuilds the book, without taking a transaction or
+   * execution id, the restored counters carry on unchanged. The caller
+   * keeps these reports from reaching clients, as replay does.
+   */
+  template <typename OrderData>
+  auto Restore(const OrderData& resting) -> bool {
+    auto restore = [&](auto& side) -> bool {
+      if (side.Available() == 0) {
+        spdlog::error("no room to restore order_id {}", resting.GetOrderId());
+        return false;
+      }
+
+      auto&& [added, order] = side.Add(resting, resting.GetOrderId());
+      if (!added) {
+        return false;
+      }
+
+      // the container hands back a copy or a reference depending on its
+      // layout, the fill state is applied to the order it actually holds
+      auto* held = side.Find(order.GetOrderId());
+      held->SetOrderStatus(resting.GetOrderStatus())
+          .SetLeavesQuantity(resting.GetLeavesQuantity())
+          .SetExecutedQuantity(resting.GetExecutedQuantity())
+          .SetExecutedValue(resting.GetExecutedValue())
+          .SetOrigClientOrderId(resting.GetOrigClientOrderId());
+      sink_.OnExecutionReport(EventType::kOrderNew, ExecutionView(0, 0, *held));
+      return true;
+    };
+
+    return resting.IsBuyOrder() ? restore(bids_) : restore(asks_);
+  }
+
  private:
   auto ExecuteOrder(Order& order, const Price& prc, const Quantity& qty)
       -> void {
@@ -230,8 +319,9 @@ class LimitOrderBook {
   template <typename CancelRequest>
   auto CancelRejectOrder(const CancelRequest& cancel_request,
                          const CxlRejResponseTo& cxl_rej_response_to) -> void {
-    data_ = OrderCancelReject(++tx_id_, cancel_request, cxl_rej_response_to);
-    dispatcher_->dispatch(EventType::kOrderCancelRejected, data_);
+    sink_.OnCancelReject(
+        EventType::kOrderCancelRejected,
+        OrderCancelReject(++tx_id_, cancel_request, cxl_rej_response_to));
   }
 
   /**
@@ -240,8 +330,8 @@ class LimitOrderBook {
   template <typename OrderData>
   auto DispatchOrderStatus(const EventType& event_type, const OrderData& order)
       -> void {
-    data_ = ExecutionReport(++tx_id_, ++exec_id_, order);
-    dispatcher_->dispatch(event_type, data_);
+    sink_.OnExecutionReport(event_type,
+                            ExecutionView(++tx_id_, ++exec_id_, order));
   }
 
   /**
@@ -249,15 +339,16 @@ class LimitOrderBook {
    */
   auto DispatchOrderExecution(const EventType& event_type, const Order& order)
       -> void {
-    data_ = ExecutionReport(++tx_id_, ++exec_id_, order);
-    dispatcher_->dispatch(event_type, data_);
+    sink_.OnExecutionReport(event_type,
+                            ExecutionView(++tx_id_, ++exec_id_, order));
   }
 
+  InstrumentId instrument_id_;
   TransactionId tx_id_{0};
   ExecutionId exec_id_{0};
+  OrderIdSequence order_ids_;
 
-  std::shared_ptr<EventDispatcher> dispatcher_;
-  EventData data_;
+  EventSink sink_;
 
   BidContainerType bids_;
   AskContainerType asks_;
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+
+#include "orderbook/data/data_types.h"
+
+namespace orderbook::book {
+
+/**
+ * Generates order ids for a single book. Each id packs the owning
+ * instrument (or shard) prefix into the upper kPrefixBits and a local,
+ * monotonically increasing sequence into the remaining bits, so ids are
+ * unique across books without any shared counter.
+ */
+class OrderIdSequence {
+ private:
+  using OrderId = orderbook::data::OrderId;
+  using InstrumentId = orderbook::data::InstrumentId;
+
+ public:
+  static constexpr std::uint32_t kPrefixBits = 24;
+  static constexpr std::uint32_t kSequenceBits = 64 - kPrefixBits;
+  static constexpr OrderId kSequenceMask = (OrderId{1} << kSequenceBits) - 1;
+  static constexpr OrderId kPrefixMask = (OrderId{1} << kPrefixBits) - 1;
+
+  explicit OrderIdSequence(const InstrumentId& prefix = 0)
+      : prefix_((static_cast<OrderId>(prefix) & kPrefixMask) << kSequenceBits) {
+  }
+
+  /**
+   * Returns the next order id. The local sequence starts at one, so a
+   * valid order id is never zero.
+   */
+  auto Next() -> OrderId {
+    sequence_ = (sequence_ + 1) & kSequenceMask;
+    return prefix_ | sequence_;
+  }
+
+  auto GetPrefix() const -> OrderId { return prefix_ >> kSequenceBits; }
+  auto GetSequence() const -> OrderId { return sequence_; }
+
+  /**
+   * Continue from a saved sequence, the next id follows it.
+   */
+  auto SetSequence(const OrderId& sequence) -> void {
+    sequence_ = sequence & kSequenceMask;
+  }
+
+  static auto PrefixOf(const OrderId& order_id) -> OrderId {
+    return order_id >> kSequenceBits;
+  }
+
+  static auto SequenceOf(const OrderId& order_id) -> OrderId {
+    return order_id & kSequenceMask;
+  }
+
+ private:
+  OrderId prefix_;
+  OrderId sequence_{0};
+};
+}  // namespace orderbook::book
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string_view>
+#include <unordered_map>
+
+#include "boost/functional/hash.hpp"
+#include "orderbook/data/data_types.h"
+
+namespace orderbook::container {
+
+/**
+ * Maps (session_id, client_order_id) onto the resting order id. The map owns
+ * its keys, but the hash and equality are transparent so lookups can be made
+ * with a std::string_view straight out of an inbound message buffer.
+ */
+struct ClientOrderIdKeyHash {
+  using is_transparent = void;
+
+  template <typename ClientOrderIdType>
+  auto operator()(const std::pair<orderbook::data::SessionId,
+                                  ClientOrderIdType>& key) const
+      -> std::size_t {
+    std::size_t seed = 0;
+    boost::hash_combine(seed, key.first);
+    boost::hash_combine(
+        seed, std::hash<std::string_view>{}(std::string_view(key.second)));
+    return seed;
+  }
+};
+
+struct ClientOrderIdKeyEqual {
+  using is_transparent = void;
+
+  template <typename LhsType, typename RhsType>
+  auto operator()(const std::pair<orderbook::data::SessionId, LhsType>& lhs,
+                  const std::pair<orderbook::data::SessionId, RhsType>& rhs)
+      const -> bool {
+    return lhs.first == rhs.first &&
+           std::string_view(lhs.second) == std::string_view(rhs.second);
+  }
+};
+
+using ClientOrderIdKey =
+    std::pair<orderbook::data::SessionId, orderbook::data::ClientOrderId>;
+using ClientOrderIdKeyView =
+    std::pair<orderbook::data::SessionId, std::string_view>;
+using ClientOrderIdMap =
+    std::unordered_map<ClientOrderIdKey, orderbook::data::OrderId,
+                       ClientOrderIdKeyHash, ClientOrderIdKeyEqual>;
+}  // namespace orderbook::container
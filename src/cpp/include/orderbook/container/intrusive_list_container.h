@@ -3,11 +3,12 @@
 #include <sstream>
 #include <unordered_set>
 
-#include "boost/functional/hash.hpp"
 #include "boost/intrusive/list.hpp"
+#include "orderbook/container/client_order_id_map.h"
 #include "orderbook/data/data_types.h"
 #include "orderbook/data/new_order_single.h"
 #include "orderbook/data/order_cancel_request.h"
+#include "orderbook/data/request_view.h"
 
 namespace orderbook::container {
 
@@ -23,20 +24,13 @@ class IntrusiveListContainer {
   using Iterator = typename List::iterator;
   using PriceLevelMap = std::map<Key, List, Compare>;
   using OrderIdMap = std::unordered_map<OrderId, Iterator>;
-  using ClientOrderIdKey = std::pair<SessionId, ClientOrderId>;
-  using ClientOrderIdMap = std::unordered_map<ClientOrderIdKey, OrderId,
-                                              boost::hash<ClientOrderIdKey>>;
-  using NewOrderSingle = orderbook::data::NewOrderSingle;
-  using OrderCancelRequest = orderbook::data::OrderCancelRequest;
-  using OrderCancelReplaceRequest = orderbook::data::OrderCancelReplaceRequest;
-
-  inline static Pool& pool = Pool::Instance();
+
   inline static Order invalid{};
   inline static ReturnPair kFalsePair = {false, std::ref(invalid)};
 
  public:
   static constexpr std::size_t GetPoolSize() { return Pool::kPoolSize; }
-  static std::size_t Available() { return pool.Available(); }
+  static std::size_t Available() { return Pool::Instance().Available(); }
 
   /**
    * Add the new order single to the container.
@@ -44,14 +38,15 @@ class IntrusiveListContainer {
    * Returns true if the order was successfully added,
    * false otherwise.
    */
-  auto Add(const NewOrderSingle& order_request, const OrderId& order_id)
+  template <typename NewOrderData>
+  auto Add(const NewOrderData& order_request, const OrderId& order_id)
       -> ReturnPair {
     // Create a new order
     auto& order = IntrusiveListContainer::MakeOrder(order_request, order_id);
 
     // Does our clord_id set contain the requested client_order_id key?
-    const ClientOrderIdKey& clord_id_key = {order_request.GetSessionId(),
-                                            order_request.GetClientOrderId()};
+    const ClientOrderIdKeyView clord_id_key = {
+        order_request.GetSessionId(), order_request.GetClientOrderId()};
 
     const auto& clord_id_map_iter = clord_id_map_.find(clord_id_key);
 
@@ -73,7 +68,8 @@ class IntrusiveListContainer {
     auto& list = price_level_map_[order.GetOrderPrice()];
     auto&& iter = list.insert(list.end(), order);
     order_id_map_.emplace(order_id, std::forward<Iterator>(iter));
-    clord_id_map_.emplace(clord_id_key, order_id);
+    clord_id_map_.emplace(
+        ClientOrderIdKey(clord_id_key.first, clord_id_key.second), order_id);
     ++size_;
 
     return {true, order};
@@ -85,7 +81,8 @@ class IntrusiveListContainer {
    * Returns std::pair[true, resting_order] if the order was found and
    * successfully modified, std::pair[false, empty_order] if not.
    */
-  auto Modify(const OrderCancelReplaceRequest& modify_request) -> ReturnPair {
+  template <typename ModifyRequest>
+  auto Modify(const ModifyRequest& modify_request) -> ReturnPair {
     // find the order by the order_id we assigned in MapListContainer::Add
     const auto& order_id_map_iter =
         order_id_map_.find(modify_request.GetOrderId());
@@ -180,16 +177,16 @@ class IntrusiveListContainer {
         order_id_map_.find(cancel_request.GetOrderId());
 
     // Get the client order id depending on the type of CancelRequest
-    std::string clord_id;
+    std::string_view clord_id;
 
-    if (std::is_same<CancelRequest, OrderCancelRequest>::value) {
+    if constexpr (orderbook::data::kIsCancelRequest<CancelRequest>) {
       clord_id = cancel_request.GetOrigClientOrderId();
     } else {
       clord_id = cancel_request.GetClientOrderId();
     }
 
-    const auto& clord_id_map_iter =
-        clord_id_map_.find({cancel_request.GetSessionId(), clord_id});
+    const auto& clord_id_map_iter = clord_id_map_.find(
+        ClientOrderIdKeyView{cancel_request.GetSessionId(), clord_id});
 
     // boolean helpers to ensure valid book state if we can't find the order
     const bool found_order_id_map = order_id_map_iter != order_id_map_.end();
@@ -201,8 +198,9 @@ class IntrusiveListContainer {
       auto& iter = order_id_map_iter->second;
       auto& order = *iter;
 
-      // find the list at this price level
-      auto& list = price_level_map_[cancel_request.GetOrderPrice()];
+      // find the list at the resting order's price level
+      const auto price = order.GetOrderPrice();
+      auto& list = price_level_map_[price];
 
       // remove the order from the list and our maps
       list.erase(iter);
@@ -214,10 +212,10 @@ class IntrusiveListContainer {
 
       // if our price level is now empty, remove it, too
       if (list.empty()) {
-        price_level_map_.erase(cancel_request.GetOrderPrice());
+        price_level_map_.erase(price);
       }
 
-      if (std::is_same<CancelRequest, OrderCancelRequest>::value) {
+      if constexpr (orderbook::data::kIsCancelRequest<CancelRequest>) {
         // Update the clord_id values in the order
         order.SetClientOrderId(cancel_request.GetClientOrderId());
         order.SetOrigClientOrderId(cancel_request.GetOrigClientOrderId());
@@ -250,39 +248,76 @@ class IntrusiveListContainer {
     return kFalsePair;
   }
 
-  auto CancelAll(const SessionId& session_id) -> std::size_t {
+  /**
+   * Remove every resting order of session_id, as cancel-on-disconnect
+   * does. Each order is handed to on_removed once it is out of the
+   * container, before it is released. Returns the number removed.
+   */
+  template <typename OnRemoved>
+  auto CancelAll(const SessionId& session_id, OnRemoved&& on_removed)
+      -> std::size_t {
     std::size_t order_count{0};
 
-    for (auto& [key, value] : price_level_map_) {
-      for (auto it = value.begin(); it != value.end();) {
+    for (auto level = price_level_map_.begin();
+         level != price_level_map_.end();) {
+      auto& list = level->second;
+      for (auto it = list.begin(); it != list.end();) {
         if (it->GetSessionId() == session_id) {
-          const auto& order_id_map_iter = order_id_map_.find(it->GetOrderId());
-          const auto& clord_id_map_iter =
-              clord_id_map_.find({it->GetSessionId(), it->GetClientOrderId()});
-          order_id_map_.erase(order_id_map_iter);
-          clord_id_map_.erase(clord_id_map_iter);
-          it = value.erase(it);
+          order_id_map_.erase(it->GetOrderId());
+          clord_id_map_.erase(clord_id_map_.find(ClientOrderIdKeyView{
+              it->GetSessionId(), it->GetClientOrderId()}));
+          auto& order = *it;
+          it = list.erase(it);
           --size_;
           ++order_count;
+          on_removed(order);
+          order.Release();
         } else {
           it = std::next(it);
         }
       }
 
-      if (value.empty()) {
-        price_level_map_.erase(key);
+      if (list.empty()) {
+        level = price_level_map_.erase(level);
+      } else {
+        level = std::next(level);
       }
     }
 
     return order_count;
   }
 
+  auto CancelAll(const SessionId& session_id) -> std::size_t {
+    return CancelAll(session_id, [](auto& /*unused*/) {});
+  }
+
   /**
    * Returns the first order in the list that is mapped to the first
    * key in the price_level_map.
    */
   auto Front() -> Order& { return price_level_map_.begin()->second.front(); }
 
+  /**
+   * The resting order with order_id, nullptr when there is none.
+   */
+  auto Find(const OrderId& order_id) -> Order* {
+    const auto& iter = order_id_map_.find(order_id);
+    return iter == order_id_map_.end() ? nullptr : &(*iter->second);
+  }
+
+  /**
+   * Apply fn to every resting order, best price level first and in time
+   * priority within each level.
+   */
+  template <typename Fn>
+  auto ForEach(Fn&& fn) -> void {
+    for (auto&& [key, list] : price_level_map_) {
+      for (auto&& order : list) {
+        fn(order);
+      }
+    }
+  }
+
   auto IsEmpty() -> bool { return size_ == 0; }
   auto Count() const -> std::size_t { return size_; }
   auto Clear() -> void {
@@ -318,9 +353,10 @@ class IntrusiveListContainer {
   /**
    * Initializes an Order from the pool with the new order single values.
    */
-  static auto MakeOrder(const NewOrderSingle& new_order_single,
+  template <typename NewOrderData>
+  static auto MakeOrder(const NewOrderData& new_order_single,
                         const OrderId& order_id) -> Order& {
-    auto& ordr = pool.Take();
+    auto& ordr = Pool::Instance().Take();
     ordr.SetOrderId(order_id)
         .SetRoutingId(new_order_single.GetRoutingId())
         .SetSessionId(new_order_single.GetSessionId())
@@ -348,16 +384,20 @@ class IntrusiveListContainer {
    * Takes the modify request and resting order and updates the necessary data
    * structures to reflect the new client order state.
    */
-  auto UpdateClientOrderId(const OrderCancelReplaceRequest& modify_request,
-                           Order& order) -> void {
+  template <typename ModifyRequest>
+  auto UpdateClientOrderId(const ModifyRequest& modify_request, Order& order)
+      -> void {
     // Erase the old key
-    clord_id_map_.erase(
-        {modify_request.GetSessionId(), modify_request.GetOrigClientOrderId()});
+    const auto& old_key_iter = clord_id_map_.find(ClientOrderIdKeyView{
+        modify_request.GetSessionId(), modify_request.GetOrigClientOrderId()});
+    if (old_key_iter != clord_id_map_.end()) {
+      clord_id_map_.erase(old_key_iter);
+    }
 
     // Add the new key
-    const ClientOrderIdKey& new_key = {modify_request.GetSessionId(),
-                                       modify_request.GetClientOrderId()};
-    clord_id_map_.emplace(new_key, modify_request.GetSessionId());
+    clord_id_map_.emplace(ClientOrderIdKey(modify_request.GetSessionId(),
+                                           modify_request.GetClientOrderId()),
+                          order.GetOrderId());
 
     // Update the order
     order.SetClientOrderId(modify_request.GetClientOrderId())
@@ -3,12 +3,13 @@
 #include <sstream>
 #include <unordered_set>
 
-#include "boost/functional/hash.hpp"
 #include "boost/intrusive_ptr.hpp"
+#include "orderbook/container/client_order_id_map.h"
 #include "orderbook/data/data_types.h"
 #include "orderbook/data/limit_order.h"
 #include "orderbook/data/new_order_single.h"
 #include "orderbook/data/order_cancel_request.h"
+#include "orderbook/data/request_view.h"
 
 namespace orderbook::container {
 
@@ -25,12 +26,6 @@ class MapListContainer {
   using Iterator = typename List::iterator;
   using PriceLevelMap = std::map<Key, List, Compare>;
   using OrderIdMap = std::unordered_map<OrderId, Iterator>;
-  using ClientOrderIdKey = std::pair<SessionId, ClientOrderId>;
-  using ClientOrderIdMap = std::unordered_map<ClientOrderIdKey, OrderId,
-                                              boost::hash<ClientOrderIdKey>>;
-  using NewOrderSingle = orderbook::data::NewOrderSingle;
-  using OrderCancelRequest = orderbook::data::OrderCancelRequest;
-  using OrderCancelReplaceRequest = orderbook::data::OrderCancelReplaceRequest;
 
   inline static LimitOrder invalid{};
   inline static ReturnPair kFalsePair = {false, invalid};
@@ -46,7 +41,8 @@ class MapListContainer {
    * Returns true if the order was successfully added,
    * false otherwise.
    */
-  auto Add(const NewOrderSingle& order_request, const OrderId& order_id)
+  template <typename NewOrderData>
+  auto Add(const NewOrderData& order_request, const OrderId& order_id)
       -> ReturnPair {
     // spdlog::info(
     //    "MapListContainer::Add request[ order_id {} ] -> [ sess: {}, clord_id:
@@ -61,8 +57,8 @@ class MapListContainer {
     auto order = MapListContainer::MakeOrder(order_request, order_id);
 
     // Does our clord_id set contain the requested client_order_id key?
-    const ClientOrderIdKey& clord_id_key = {order_request.GetSessionId(),
-                                            order_request.GetClientOrderId()};
+    const ClientOrderIdKeyView clord_id_key = {
+        order_request.GetSessionId(), order_request.GetClientOrderId()};
 
     const auto& clord_id_map_iter = clord_id_map_.find(clord_id_key);
 
@@ -80,7 +76,8 @@ class MapListContainer {
     auto& list = price_level_map_[order.GetOrderPrice()];
     auto&& iter = list.insert(list.end(), std::move(order));
     order_id_map_.emplace(order_id, std::forward<Iterator>(iter));
-    clord_id_map_.emplace(clord_id_key, order_id);
+    clord_id_map_.emplace(
+        ClientOrderIdKey(clord_id_key.first, clord_id_key.second), order_id);
     ++size_;
 
     // spdlog::info(
@@ -100,7 +97,8 @@ class MapListContainer {
    * Returns std::pair[true, resting_order] if the order was found and
    * successfully modified, std::pair[false, empty_order] if not.
    */
-  auto Modify(const OrderCancelReplaceRequest& modify_request) -> ReturnPair {
+  template <typename ModifyRequest>
+  auto Modify(const ModifyRequest& modify_request) -> ReturnPair {
     // spdlog::info(
     //    "MapListContainer::Modify request[ order_id {} ] -> [ sess: {}, "
     //    "clord_id: {}, orig_clord_id: {}, price: {}, quantity: {}]",
@@ -212,16 +210,16 @@ class MapListContainer {
         order_id_map_.find(cancel_request.GetOrderId());
 
     // Get the client order id depending on the type of CancelRequest
-    std::string clord_id;
+    std::string_view clord_id;
 
-    if (std::is_same<CancelRequest, OrderCancelRequest>::value) {
+    if constexpr (orderbook::data::kIsCancelRequest<CancelRequest>) {
       clord_id = cancel_request.GetOrigClientOrderId();
     } else {
       clord_id = cancel_request.GetClientOrderId();
     }
 
-    const auto& clord_id_map_iter =
-        clord_id_map_.find({cancel_request.GetSessionId(), clord_id});
+    const auto& clord_id_map_iter = clord_id_map_.find(
+        ClientOrderIdKeyView{cancel_request.GetSessionId(), clord_id});
 
     // boolean helpers to ensure valid book state if we can't find the order
     const bool found_order_id_map = order_id_map_iter != order_id_map_.end();
@@ -233,8 +231,9 @@ class MapListContainer {
       auto& iter = order_id_map_iter->second;
       auto& order = *iter;
 
-      // find the list at this price level
-      auto& list = price_level_map_[cancel_request.GetOrderPrice()];
+      // find the list at the resting order's price level
+      const auto price = order.GetOrderPrice();
+      auto& list = price_level_map_[price];
 
       // remove the order from the list and our maps
       list.erase(iter);
@@ -246,10 +245,10 @@ class MapListContainer {
 
       // if our price level is now empty, remove it, too
       if (list.empty()) {
-        price_level_map_.erase(cancel_request.GetOrderPrice());
+        price_level_map_.erase(price);
       }
 
-      if (std::is_same<CancelRequest, OrderCancelRequest>::value) {
+      if constexpr (orderbook::data::kIsCancelRequest<CancelRequest>) {
         // Update the clord_id values in the order
         order.SetClientOrderId(cancel_request.GetClientOrderId());
         order.SetOrigClientOrderId(cancel_request.GetOrigClientOrderId());
@@ -276,34 +275,48 @@ class MapListContainer {
     return kFalsePair;
   }
 
-  auto CancelAll(const SessionId& session_id) -> std::size_t {
+  /**
+   * Remove every resting order of session_id, as cancel-on-disconnect
+   * does. Each order is handed to on_removed once it is out of the
+   * container, before it is released. Returns the number removed.
+   */
+  template <typename OnRemoved>
+  auto CancelAll(const SessionId& session_id, OnRemoved&& on_removed)
+      -> std::size_t {
     std::size_t order_count{0};
 
-    for (auto& [key, value] : price_level_map_) {
-      for (auto it = value.begin(); it != value.end();) {
-        if ((*it).GetSessionId() == session_id) {
-          const auto& order_id_map_iter =
-              order_id_map_.find((*it).GetOrderId());
-          const auto& clord_id_map_iter = clord_id_map_.find(
-              {(*it).GetSessionId(), (*it).GetClientOrderId()});
-          order_id_map_.erase(order_id_map_iter);
-          clord_id_map_.erase(clord_id_map_iter);
-          it = value.erase(it);
+    for (auto level = price_level_map_.begin();
+         level != price_level_map_.end();) {
+      auto& list = level->second;
+      for (auto it = list.begin(); it != list.end();) {
+        if (it->GetSessionId() == session_id) {
+          order_id_map_.erase(it->GetOrderId());
+          clord_id_map_.erase(clord_id_map_.find(ClientOrderIdKeyView{
+              it->GetSessionId(), it->GetClientOrderId()}));
+          auto order = std::move(*it);
+          it = list.erase(it);
           --size_;
           ++order_count;
+          on_removed(order);
         } else {
           it = std::next(it);
         }
       }
 
-      if (value.empty()) {
-        price_level_map_.erase(key);
+      if (list.empty()) {
+        level = price_level_map_.erase(level);
+      } else {
+        level = std::next(level);
       }
     }
 
     return order_count;
   }
 
+  auto CancelAll(const SessionId& session_id) -> std::size_t {
+    return CancelAll(session_id, [](auto& /*unused*/) {});
+  }
+
   /**
    * Returns the first order in the list that is mapped to the first
    * key in the price_level_map.
@@ -312,6 +325,27 @@ class MapListContainer {
     return (price_level_map_.begin()->second.front());
   }
 
+  /**
+   * The resting order with order_id, nullptr when there is none.
+   */
+  auto Find(const OrderId& order_id) -> LimitOrder* {
+    const auto& iter = order_id_map_.find(order_id);
+    return iter == order_id_map_.end() ? nullptr : &(*iter->second);
+  }
+
+  /**
+   * Apply fn to every resting order, best price level first and in time
+   * priority within each level.
+   */
+  template <typename Fn>
+  auto ForEach(Fn&& fn) -> void {
+    for (auto&& [key, list] : price_level_map_) {
+      for (auto&& order : list) {
+        fn(order);
+      }
+    }
+  }
+
   auto IsEmpty() -> bool { return size_ == 0; }
   auto Count() const -> std::size_t { return size_; }
   auto Clear() -> void {
@@ -346,7 +380,8 @@ class MapListContainer {
    * Generates a new LimitOrder and initializes it with the new
    * order single values.
    */
-  static auto MakeOrder(const NewOrderSingle& new_order_single,
+  template <typename NewOrderData>
+  static auto MakeOrder(const NewOrderData& new_order_single,
                         const OrderId& order_id) -> LimitOrder {
     auto ordr = LimitOrder();
     ordr.SetOrderId(order_id)
@@ -376,16 +411,20 @@ class MapListContainer {
    * Takes the modify request and resting order and updates the necessary data
    * structures to reflect the new client order state.
    */
-  auto UpdateClientOrderId(const OrderCancelReplaceRequest& modify_request,
+  template <typename ModifyRequest>
+  auto UpdateClientOrderId(const ModifyRequest& modify_request,
                            LimitOrder& order) -> void {
     // Erase the old key
-    clord_id_map_.erase(
-        {modify_request.GetSessionId(), modify_request.GetOrigClientOrderId()});
+    const auto& old_key_iter = clord_id_map_.find(ClientOrderIdKeyView{
+        modify_request.GetSessionId(), modify_request.GetOrigClientOrderId()});
+    if (old_key_iter != clord_id_map_.end()) {
+      clord_id_map_.erase(old_key_iter);
+    }
 
     // Add the new key
-    const ClientOrderIdKey& new_key = {modify_request.GetSessionId(),
-                                       modify_request.GetClientOrderId()};
-    clord_id_map_.emplace(new_key, modify_request.GetSessionId());
+    clord_id_map_.emplace(ClientOrderIdKey(modify_request.GetSessionId(),
+                                           modify_request.GetClientOrderId()),
+                          order.GetOrderId());
 
     // Update the order
     order.SetClientOrderId(modify_request.GetClientOrderId())
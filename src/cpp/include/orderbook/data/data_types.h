@@ -1,8 +1,13 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <charconv>
 #include <cmath>
 #include <cstdint>
+#include <limits>
 #include <string>
+#include <string_view>
 
 #include "orderbook/serialize/orderbook_generated.h"
 #include "orderbook/util/time_util.h"
@@ -81,7 +86,7 @@ using ExecutedValue = std::int64_t;
 using Quantity = std::int32_t;
 using ExecutionId = std::uint32_t;
 using AccountId = std::uint32_t;
-using OrderId = std::uint32_t;
+using OrderId = std::uint64_t;
 using QuoteId = std::uint32_t;
 using RoutingId = std::uint32_t;
 using ClientOrderId = std::string;
@@ -91,7 +96,26 @@ using InstrumentId = std::uint64_t;
 using TransactionId = std::uint64_t;
 using Timestamp = orderbook::util::TimeUtil::Timestamp;
 
+/**
+ * Client order ids travel in fixed width fields between the gateway, the
+ * orderbook and its checkpoints. The gateway rejects longer ids rather than
+ * let them be cut short, where two ids sharing a prefix would collide.
+ */
+inline static constexpr std::size_t kMaxClientOrderIdLength = 31;
+
+template <typename Request>
+inline auto HasValidClientOrderIds(const Request& request) -> bool {
+  return request.GetClientOrderId().size() <= kMaxClientOrderIdLength &&
+         request.GetOrigClientOrderId().size() <= kMaxClientOrderIdLength;
+}
+
+/**
+ * Prices are fixed point, in millionths.
+ */
+inline static constexpr Price kPriceScale = 1000000;
+
 namespace internal {
+inline static constexpr int kPriceDecimals = 6;
 inline static constexpr int kDoubleToPriceMult = 1000000;
 inline static constexpr double kPriceToDoubleMult = 1.0 / kDoubleToPriceMult;
 }  // namespace internal
@@ -104,6 +128,93 @@ inline auto ToDouble(const Price& prc) -> double {
   return prc * internal::kPriceToDoubleMult;
 }
 
+/**
+ * Parse a decimal string, such as FIX's 123.456, into a Price with integer
+ * arithmetic only, exact for up to kPriceDecimals fraction digits. Further
+ * digits are dropped. False, leaving price untouched, unless str is an
+ * optional '-', digits, and an optional '.' with more digits, within the
+ * range of Price. The digits are parsed unsigned, so no second sign slips
+ * through.
+ */
+inline auto ToPrice(std::string_view str, Price& price) -> bool {
+  const bool negative = !str.empty() && str.front() == '-';
+  if (negative) {
+    str.remove_prefix(1);
+  }
+
+  const auto dot = str.find('.');
+  std::uint64_t units{0};
+  const auto* last = str.data() + std::min(dot, str.size());
+  const auto [ptr, ec] = std::from_chars(str.data(), last, units);
+  if (ec != std::errc{} || ptr != last || str.data() == last) {
+    return false;
+  }
+
+  Price fraction{0};
+  int digits{0};
+  if (dot != std::string_view::npos) {
+    for (const auto chr : str.substr(dot + 1)) {
+      if (chr < '0' || chr > '9') {
+        return false;
+      }
+      if (digits < internal::kPriceDecimals) {
+        fraction = fraction * 10 + (chr - '0');
+        ++digits;
+      }
+    }
+  }
+  for (; digits < internal::kPriceDecimals; ++digits) {
+    fraction *= 10;
+  }
+
+  const auto max_units = static_cast<std::uint64_t>(
+      (std::numeric_limits<Price>::max() - fraction) / kPriceScale);
+  if (units > max_units) {
+    return false;
+  }
+
+  const Price value = static_cast<Price>(units) * kPriceScale + fraction;
+  price = negative ? -value : value;
+  return true;
+}
+
+/**
+ * The decimal string of a price, the inverse of ToPrice: no exponent, and
+ * no trailing fraction zeros.
+ */
+inline auto ToDecimalString(const Price& price) -> std::string {
+  // sign, digits of Price max, and the decimal point
+  std::array<char, 24> buf{};
+  auto* pos = buf.data();
+
+  auto magnitude = static_cast<std::uint64_t>(price);
+  if (price < 0) {
+    *pos++ = '-';
+    magnitude = ~magnitude + 1;
+  }
+
+  auto* end = buf.data() + buf.size();
+  pos = std::to_chars(pos, end, magnitude / kPriceScale).ptr;
+
+  auto fraction = magnitude % kPriceScale;
+  if (fraction != 0) {
+    int decimals = internal::kPriceDecimals;
+    while (fraction % 10 == 0) {
+      fraction /= 10;
+      --decimals;
+    }
+
+    *pos++ = '.';
+    for (int i = decimals - 1; i >= 0; --i) {
+      pos[i] = static_cast<char>('0' + fraction % 10);
+      fraction /= 10;
+    }
+    pos += decimals;
+  }
+
+  return std::string(buf.data(), pos);
+}
+
 class BaseData {
  private:
   using TimeUtil = orderbook::util::TimeUtil;
@@ -284,8 +395,8 @@ class BaseData {
 
   auto GetClientOrderId() -> ClientOrderId { return client_order_id_; }
   auto& GetClientOrderId() const { return client_order_id_; }
-  auto SetClientOrderId(const ClientOrderId& client_order_id) -> BaseData& {
-    client_order_id_ = client_order_id;
+  auto SetClientOrderId(std::string_view client_order_id) -> BaseData& {
+    client_order_id_.assign(client_order_id);
     return *this;
   }
   auto ClearClientOrderId() -> BaseData& {
@@ -297,9 +408,9 @@ class BaseData {
     return orig_client_order_id_;
   }
   auto& GetOrigClientOrderId() const { return orig_client_order_id_; }
-  auto SetOrigClientOrderId(const OrigClientOrderId& orig_client_order_id)
+  auto SetOrigClientOrderId(std::string_view orig_client_order_id)
       -> BaseData& {
-    orig_client_order_id_ = orig_client_order_id;
+    orig_client_order_id_.assign(orig_client_order_id);
     return *this;
   }
   auto ClearOrigClientOrderId() -> BaseData& {
@@ -330,7 +441,7 @@ class BaseData {
   BaseData(const TransactionId& tx_id)
       : transaction_id_(tx_id),
         create_tm_(TimeUtil::EpochNanos()),
-        last_modify_tm_(TimeUtil::EpochNanos()),
+        last_modify_tm_(create_tm_),
         client_order_id_{},
         orig_client_order_id_{} {}
 
@@ -350,7 +461,7 @@ class BaseData {
            const OrigClientOrderId& orig_client_order_id)
       : transaction_id_(tx_id),
         create_tm_(TimeUtil::EpochNanos()),
-        last_modify_tm_(TimeUtil::EpochNanos()),
+        last_modify_tm_(create_tm_),
         routing_id_(routing_id),
         side_(side),
         order_status_(order_status),
@@ -382,7 +493,7 @@ class BaseData {
            const OrigClientOrderId& orig_client_order_id)
       : transaction_id_(tx_id),
         create_tm_(TimeUtil::EpochNanos()),
-        last_modify_tm_(TimeUtil::EpochNanos()),
+        last_modify_tm_(create_tm_),
         routing_id_(routing_id),
         order_status_(order_status),
         account_id_(account_id),
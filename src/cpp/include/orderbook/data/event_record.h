@@ -0,0 +1,224 @@
+#pragma once
+
+#include <type_traits>
+
+#include "orderbook/data/data_types.h"
+#include "orderbook/data/event_types.h"
+#include "orderbook/data/execution_view.h"
+#include "orderbook/data/fixed_codec.h"
+#include "orderbook/data/order_cancel_reject.h"
+#include "orderbook/util/fixed_string.h"
+
+/**
+ * A fixed layout copy of a single outbound event, written by the matching
+ * thread into a preallocated ring and serialized later by the publisher
+ * thread. Records are trivially copyable and never allocate; client order
+ * ids longer than kMaxClientOrderIdLength, which the gateway rejects, would
+ * be truncated.
+ *
+ * A kBatchEnd record carries no event, it marks the point at which the
+ * publisher should flush everything it has coalesced so far. The codec is
+ * set on events answering a request, to the codec the request arrived in.
+ */
+
+namespace orderbook::data {
+struct EventRecord {
+  enum class Kind : std::uint8_t {
+    kEmpty = 0,
+    kExecutionReport = 1,
+    kOrderCancelReject = 2,
+    kBatchEnd = 3
+  };
+
+  static constexpr std::size_t kMaxClientOrderIdLength =
+      orderbook::data::kMaxClientOrderIdLength;
+
+  using ClientOrderIdBuffer =
+      orderbook::util::FixedString<kMaxClientOrderIdLength>;
+
+  EventRecord() = default;
+
+  EventRecord(const EventType& type, const ExecutionView& view)
+      : last_price(view.GetLastPrice()),
+        order_price(view.GetOrderPrice()),
+        executed_value(view.GetExecutedValue()),
+        order_id(view.GetOrderId()),
+        instrument_id(view.GetInstrumentId()),
+        last_quantity(view.GetLastQuantity()),
+        order_quantity(view.GetOrderQuantity()),
+        leaves_quantity(view.GetLeavesQuantity()),
+        execution_id(view.GetExecutionId()),
+        account_id(view.GetAccountId()),
+        quote_id(view.GetQuoteId()),
+        session_id(view.GetSessionId()),
+        routing_id(view.GetRoutingId()),
+        kind(Kind::kExecutionReport),
+        event_type(type),
+        side(view.GetSide()),
+        order_status(view.GetOrderStatus()),
+        time_in_force(view.GetTimeInForce()),
+        order_type(view.GetOrderType()),
+        execution_type(view.GetExecutionType()),
+        client_order_id(view.GetClientOrderId()),
+        orig_client_order_id(view.GetOrigClientOrderId()) {}
+
+  EventRecord(const EventType& type, const OrderCancelReject& reject)
+      : order_id(reject.GetOrderId()),
+        account_id(reject.GetAccountId()),
+        session_id(reject.GetSessionId()),
+        routing_id(reject.GetRoutingId()),
+        kind(Kind::kOrderCancelReject),
+        event_type(type),
+        order_status(reject.GetOrderStatus()),
+        cxl_rej_response_to(reject.GetCxlRejResponseTo()),
+        client_order_id(reject.GetClientOrderId()),
+        orig_client_order_id(reject.GetOrigClientOrderId()) {}
+
+  static auto MakeBatchEnd() -> EventRecord {
+    EventRecord record;
+    record.kind = Kind::kBatchEnd;
+    return record;
+  }
+
+  auto IsBatchEnd() const -> bool { return kind == Kind::kBatchEnd; }
+
+  auto GetSerializedEventType() const -> orderbook::serialize::EventTypeCode {
+    return static_cast<orderbook::serialize::EventTypeCode>(event_type);
+  }
+
+  auto GetBodyType() const -> orderbook::serialize::Body {
+    using Body = orderbook::serialize::Body;
+
+    switch (kind) {
+      case Kind::kExecutionReport:
+        return Body::ExecutionReport;
+      case Kind::kOrderCancelReject:
+        return Body::OrderCancelReject;
+      case Kind::kEmpty:
+      case Kind::kBatchEnd:
+        break;
+    }
+    return Body::NONE;
+  }
+
+  /**
+   * Serialize the event body, returns a null offset for records which do
+   * not carry an event.
+   */
+  auto SerializeTo(flatbuffers::FlatBufferBuilder& builder) const
+      -> flatbuffers::Offset<void> {
+    namespace serialize = orderbook::serialize;
+
+    const auto clord_id = client_order_id.View();
+    const auto orig_clord_id = orig_client_order_id.View();
+
+    if (kind == Kind::kExecutionReport) {
+      return serialize::CreateExecutionReport(
+                 builder, static_cast<serialize::SideCode>(side),
+                 static_cast<serialize::OrderStatusCode>(order_status),
+                 static_cast<serialize::TimeInForceCode>(time_in_force),
+                 static_cast<serialize::OrderTypeCode>(order_type),
+                 static_cast<serialize::ExecutionTypeCode>(execution_type),
+                 last_price, last_quantity, order_price, order_quantity,
+                 leaves_quantity, executed_value, execution_id, account_id,
+                 order_id, quote_id, session_id, instrument_id,
+                 builder.CreateString(clord_id.data(), clord_id.size()),
+                 builder.CreateString(orig_clord_id.data(),
+                                      orig_clord_id.size()))
+          .Union();
+    }
+
+    if (kind == Kind::kOrderCancelReject) {
+      return serialize::CreateOrderCancelReject(
+                 builder, order_id,
+                 static_cast<serialize::OrderStatusCode>(order_status),
+                 static_cast<serialize::CxlRejResponseToCode>(
+                     cxl_rej_response_to),
+                 session_id, account_id,
+                 builder.CreateString(clord_id.data(), clord_id.size()),
+                 builder.CreateString(orig_clord_id.data(),
+                                      orig_clord_id.size()))
+          .Union();
+    }
+
+    return flatbuffers::Offset<void>{};
+  }
+
+  /**
+   * Append the event to a fixed layout frame, records which do not carry
+   * an event are skipped.
+   */
+  auto EncodeTo(FixedFrameWriter& writer, const std::uint32_t& seq_no,
+                const std::uint64_t& ts_nanos) const -> void {
+    namespace serialize = orderbook::serialize;
+    namespace fixed = orderbook::serialize::fixed;
+
+    if (kind == Kind::kExecutionReport) {
+      auto& body = writer.Append<fixed::ExecutionReport>(
+          GetSerializedEventType(), seq_no, ts_nanos);
+      body.mutate_side(static_cast<serialize::SideCode>(side));
+      body.mutate_order_status(
+          static_cast<serialize::OrderStatusCode>(order_status));
+      body.mutate_time_in_force(
+          static_cast<serialize::TimeInForceCode>(time_in_force));
+      body.mutate_order_type(static_cast<serialize::OrderTypeCode>(order_type));
+      body.mutate_execution_type(
+          static_cast<serialize::ExecutionTypeCode>(execution_type));
+      body.mutate_last_price(last_price);
+      body.mutate_last_quantity(last_quantity);
+      body.mutate_order_price(order_price);
+      body.mutate_order_quantity(order_quantity);
+      body.mutate_leaves_quantity(leaves_quantity);
+      body.mutate_executed_value(executed_value);
+      body.mutate_execution_id(execution_id);
+      body.mutate_account_id(account_id);
+      body.mutate_order_id(order_id);
+      body.mutate_quote_id(quote_id);
+      body.mutate_session_id(session_id);
+      body.mutate_instrument_id(instrument_id);
+      body.mutate_client_order_id(client_order_id.View());
+      body.mutate_orig_client_order_id(orig_client_order_id.View());
+    } else if (kind == Kind::kOrderCancelReject) {
+      auto& body = writer.Append<fixed::OrderCancelReject>(
+          GetSerializedEventType(), seq_no, ts_nanos);
+      body.mutate_order_id(order_id);
+      body.mutate_order_status(
+          static_cast<serialize::OrderStatusCode>(order_status));
+      body.mutate_cxl_rej_response_to(
+          static_cast<serialize::CxlRejResponseToCode>(cxl_rej_response_to));
+      body.mutate_session_id(session_id);
+      body.mutate_account_id(account_id);
+      body.mutate_client_order_id(client_order_id.View());
+      body.mutate_orig_client_order_id(orig_client_order_id.View());
+    }
+  }
+
+  Price last_price{0};
+  Price order_price{0};
+  ExecutedValue executed_value{0};
+  OrderId order_id{0};
+  InstrumentId instrument_id{0};
+  Quantity last_quantity{0};
+  Quantity order_quantity{0};
+  Quantity leaves_quantity{0};
+  ExecutionId execution_id{0};
+  AccountId account_id{0};
+  QuoteId quote_id{0};
+  SessionId session_id{0};
+  RoutingId routing_id{0};
+  Kind kind{Kind::kEmpty};
+  Codec codec{Codec::kUnknown};
+  EventType event_type{EventType::kUnknown};
+  Side side{Side::kUnknown};
+  OrderStatus order_status{OrderStatus::kUnknown};
+  TimeInForce time_in_force{TimeInForce::kUnknown};
+  OrderType order_type{OrderType::kUnknown};
+  ExecutionType execution_type{ExecutionType::kUnknown};
+  CxlRejResponseTo cxl_rej_response_to{CxlRejResponseTo::kUnknown};
+  ClientOrderIdBuffer client_order_id;
+  ClientOrderIdBuffer orig_client_order_id;
+};
+
+static_assert(std::is_trivially_copyable_v<EventRecord>,
+              "EventRecord must be trivially copyable");
+}  // namespace orderbook::data
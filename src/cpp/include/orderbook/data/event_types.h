@@ -25,7 +25,8 @@ enum class EventType : std::uint8_t {
   kOrderCompleted = 9,
   kOrderCancelRejected = 10,
   kOrderModified = 11,
-  kCancelOnDisconnect = 12
+  kCancelOnDisconnect = 12,
+  kMultiMessage = 13
 };
 
 using EventData =
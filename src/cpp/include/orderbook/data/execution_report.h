@@ -1,6 +1,7 @@
 #pragma once
 
 #include "orderbook/data/data_types.h"
+#include "orderbook/data/execution_view.h"
 
 /**
  * The Execution Report <8> message is used to:
@@ -29,10 +30,20 @@ struct ExecutionReport : BaseData {
                  order.GetExecutedQuantity(), order.GetExecutedValue(), exec_id,
                  order.GetAccountId(), order.GetOrderId(), order.GetQuoteId(),
                  order.GetSessionId(), order.GetInstrumentId(),
-                 order.GetClientOrderId(), order.GetOrigClientOrderId()) {}
+                 ClientOrderId(order.GetClientOrderId()),
+                 OrigClientOrderId(order.GetOrigClientOrderId())) {}
 
-  ExecutionReport(const orderbook::serialize::ExecutionReport* table)
-      : BaseData() {
+  /**
+   * Materialize an execution view into an owning execution report.
+   */
+  explicit ExecutionReport(const ExecutionView& view)
+      : ExecutionReport(view.GetTransactionId(), view.GetExecutionId(), view) {}
+
+  /**
+   * Copy from a received table, flatbuffer or fixed layout.
+   */
+  template <typename Table>
+  ExecutionReport(const Table* table) : BaseData() {
     SetSide(static_cast<SideCode>(table->side()));
     SetOrderStatus(static_cast<OrderStatusCode>(table->order_status()));
     SetTimeInForce(static_cast<TimeInForceCode>(table->time_in_force()));
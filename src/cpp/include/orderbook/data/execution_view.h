@@ -0,0 +1,148 @@
+#pragma once
+
+#include <string_view>
+
+#include "orderbook/data/data_types.h"
+
+/**
+ * A non-owning view of an execution event. Captures the order's (a resting
+ * order, or the inbound request for pending / rejected events) fields along
+ * with the event specific transaction and execution ids; client order ids
+ * are std::string_views into the order, so building a view never copies a
+ * string. Exposes the same getters as ExecutionReport, so serializers and
+ * FIX builders can read from either.
+ *
+ * A view is only valid for the duration of the event callback, use
+ * ExecutionReport(view) to keep a copy.
+ */
+
+namespace orderbook::data {
+class ExecutionView {
+ public:
+  template <typename OrderData>
+  ExecutionView(const TransactionId& tx_id, const ExecutionId& exec_id,
+                const OrderData& order)
+      : tx_id_(tx_id),
+        exec_id_(exec_id),
+        routing_id_(order.GetRoutingId()),
+        side_(order.GetSide()),
+        order_status_(order.GetOrderStatus()),
+        time_in_force_(order.GetTimeInForce()),
+        order_type_(order.GetOrderType()),
+        instrument_type_(order.GetInstrumentType()),
+        last_price_(order.GetLastPrice()),
+        order_price_(order.GetOrderPrice()),
+        last_quantity_(order.GetLastQuantity()),
+        order_quantity_(order.GetOrderQuantity()),
+        leaves_quantity_(order.GetLeavesQuantity()),
+        executed_quantity_(order.GetExecutedQuantity()),
+        executed_value_(order.GetExecutedValue()),
+        account_id_(order.GetAccountId()),
+        order_id_(order.GetOrderId()),
+        quote_id_(order.GetQuoteId()),
+        session_id_(order.GetSessionId()),
+        instrument_id_(order.GetInstrumentId()),
+        client_order_id_(order.GetClientOrderId()),
+        orig_client_order_id_(order.GetOrigClientOrderId()) {}
+
+  auto GetTransactionId() const -> TransactionId { return tx_id_; }
+  auto GetExecutionId() const -> ExecutionId { return exec_id_; }
+  auto GetLastPrice() const -> Price { return last_price_; }
+  auto GetLastQuantity() const -> Quantity { return last_quantity_; }
+  auto GetExecutionType() const -> ExecutionType { return ExecutionType::kNew; }
+  auto GetSerializedExecutionType() const {
+    return static_cast<orderbook::serialize::ExecutionTypeCode>(
+        GetExecutionType());
+  }
+
+  auto GetRoutingId() const -> RoutingId { return routing_id_; }
+  auto GetSide() const -> Side { return side_; }
+  auto GetSerializedSide() const {
+    return static_cast<orderbook::serialize::SideCode>(side_);
+  }
+  auto IsBuyOrder() const -> bool {
+    return side_ == SideCode::kBuy || side_ == SideCode::kBuyCover;
+  }
+  auto IsSellOrder() const -> bool {
+    return side_ == SideCode::kSell || side_ == SideCode::kSellShort;
+  }
+  auto GetOrderStatus() const -> OrderStatus { return order_status_; }
+  auto GetSerializedOrderStatus() const {
+    return static_cast<orderbook::serialize::OrderStatusCode>(order_status_);
+  }
+  auto GetTimeInForce() const -> TimeInForce { return time_in_force_; }
+  auto GetSerializedTimeInForce() const {
+    return static_cast<orderbook::serialize::TimeInForceCode>(time_in_force_);
+  }
+  auto GetOrderType() const -> OrderType { return order_type_; }
+  auto GetSerializedOrderType() const {
+    return static_cast<orderbook::serialize::OrderTypeCode>(order_type_);
+  }
+  auto GetInstrumentType() const -> InstrumentType { return instrument_type_; }
+  auto GetOrderPrice() const -> Price { return order_price_; }
+  auto GetOrderQuantity() const -> Quantity { return order_quantity_; }
+  auto GetLeavesQuantity() const -> Quantity { return leaves_quantity_; }
+  auto GetExecutedQuantity() const -> Quantity { return executed_quantity_; }
+  auto GetExecutedValue() const -> ExecutedValue { return executed_value_; }
+  auto GetAccountId() const -> AccountId { return account_id_; }
+  auto GetOrderId() const -> OrderId { return order_id_; }
+  auto GetQuoteId() const -> QuoteId { return quote_id_; }
+  auto GetSessionId() const -> SessionId { return session_id_; }
+  auto GetInstrumentId() const -> InstrumentId { return instrument_id_; }
+  auto GetClientOrderId() const -> std::string_view { return client_order_id_; }
+  auto GetOrigClientOrderId() const -> std::string_view {
+    return orig_client_order_id_;
+  }
+  auto HasOrigClientOrderId() const -> bool {
+    return !orig_client_order_id_.empty();
+  }
+
+  auto SerializeTo(flatbuffers::FlatBufferBuilder& builder) const
+      -> flatbuffers::Offset<orderbook::serialize::ExecutionReport> {
+    return orderbook::serialize::CreateExecutionReport(
+        builder, GetSerializedSide(), GetSerializedOrderStatus(),
+        GetSerializedTimeInForce(), GetSerializedOrderType(),
+        GetSerializedExecutionType(), GetLastPrice(), GetLastQuantity(),
+        GetOrderPrice(), GetOrderQuantity(), GetLeavesQuantity(),
+        GetExecutedValue(), GetExecutionId(), GetAccountId(), GetOrderId(),
+        GetQuoteId(), GetSessionId(), GetInstrumentId(),
+        builder.CreateString(client_order_id_.data(), client_order_id_.size()),
+        builder.CreateString(orig_client_order_id_.data(),
+                             orig_client_order_id_.size()));
+  }
+
+  auto GetAveragePrice() const -> Price {
+    const auto& executed_quantity = GetExecutedQuantity();
+
+    if (executed_quantity == 0) {
+      return 0;
+    }
+
+    return (GetExecutedValue() / executed_quantity);
+  }
+
+ private:
+  TransactionId tx_id_;
+  ExecutionId exec_id_;
+  RoutingId routing_id_;
+  Side side_;
+  OrderStatus order_status_;
+  TimeInForce time_in_force_;
+  OrderType order_type_;
+  InstrumentType instrument_type_;
+  Price last_price_;
+  Price order_price_;
+  Quantity last_quantity_;
+  Quantity order_quantity_;
+  Quantity leaves_quantity_;
+  Quantity executed_quantity_;
+  ExecutedValue executed_value_;
+  AccountId account_id_;
+  OrderId order_id_;
+  QuoteId quote_id_;
+  SessionId session_id_;
+  InstrumentId instrument_id_;
+  std::string_view client_order_id_;
+  std::string_view orig_client_order_id_;
+};
+}  // namespace orderbook::data
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "orderbook/serialize/orderbook_fixed.h"
+#include "spdlog/spdlog.h"
+
+/**
+ * The two wire encodings of the orderbook protocol. FlatBuffers is the
+ * default; the fixed layout codec, generated from the same schema, puts
+ * every field at a fixed offset in a packed little-endian struct, so a
+ * received frame is decoded by a single bounds check followed by pointer
+ * casts. Both carry the same messages and every frame tells which encoding
+ * it uses, so peers pick one per connection.
+ */
+
+namespace orderbook::data {
+
+enum class Codec : std::uint8_t { kUnknown = 0, kFlatBuffers = 1, kFixed = 2 };
+
+inline auto ToCodec(std::string_view name) -> Codec {
+  if (name == "fixed") {
+    return Codec::kFixed;
+  }
+  if (name != "flatbuffers") {
+    spdlog::warn("unknown codec {}, using flatbuffers", name);
+  }
+  return Codec::kFlatBuffers;
+}
+
+/**
+ * True when buf holds a fixed layout frame, false for a flatbuffer.
+ */
+inline auto IsFixedFrame(const void* buf, const std::size_t& size) -> bool {
+  std::uint32_t magic{0};
+  if (size < sizeof(magic)) {
+    return false;
+  }
+  std::memcpy(&magic, buf, sizeof(magic));
+  return magic == orderbook::serialize::fixed::kFrameMagic;
+}
+
+inline auto CodecOf(const void* buf, const std::size_t& size) -> Codec {
+  return IsFixedFrame(buf, size) ? Codec::kFixed : Codec::kFlatBuffers;
+}
+
+namespace internal {
+/**
+ * The length of the frame at pos if it is well formed and fits within
+ * available bytes, zero otherwise. A MultiMessage must hold nothing but
+ * well formed Messages, exactly filling its length, and no string field of
+ * a body may claim more than its capacity.
+ */
+inline auto FixedFrameLength(const std::uint8_t* pos,
+                             const std::size_t& available,
+                             const bool allow_multi) -> std::size_t {
+  namespace fixed = orderbook::serialize::fixed;
+  using EventTypeCode = orderbook::serialize::EventTypeCode;
+
+  static_assert(sizeof(fixed::Message) == sizeof(fixed::MultiMessage));
+
+  if (available < sizeof(fixed::Message)) {
+    return 0;
+  }
+
+  const auto* message = reinterpret_cast<const fixed::Message*>(pos);
+  const std::size_t length = message->length();
+  if (message->magic() != fixed::kFrameMagic || length > available) {
+    return 0;
+  }
+
+  if (message->header()->event_type() != EventTypeCode::MultiMessage) {
+    const auto body_size = fixed::BodySize(message->body_type());
+    return body_size != 0 && length >= sizeof(fixed::Message) + body_size &&
+                   message->header()->Verify() &&
+                   fixed::BodyVerify(message->body_type(), message + 1)
+               ? length
+               : 0;
+  }
+
+  if (!allow_multi) {
+    return 0;
+  }
+
+  const auto* multi = reinterpret_cast<const fixed::MultiMessage*>(pos);
+  std::size_t offset = sizeof(fixed::MultiMessage);
+  for (std::uint32_t i = 0; i < multi->messages().size(); ++i) {
+    const auto nested = FixedFrameLength(pos + offset, length - offset, false);
+    if (nested == 0) {
+      return 0;
+    }
+    offset += nested;
+  }
+  return offset == length ? length : 0;
+}
+}  // namespace internal
+
+/**
+ * The bounds check of a received fixed layout frame: its length matches
+ * the buffer, every body is of a known type and fits its frame, and every
+ * string length is within its field. Fields of a verified frame are read in
+ * place without further checks.
+ */
+inline auto VerifyFixedFrame(const void* buf, const std::size_t& size)
+    -> bool {
+  return internal::FixedFrameLength(static_cast<const std::uint8_t*>(buf),
+                                    size, true) == size;
+}
+
+/**
+ * Per codec message types and root access, for code handling both.
+ */
+template <Codec C>
+struct CodecTraits;
+
+template <>
+struct CodecTraits<Codec::kFlatBuffers> {
+  using Message = orderbook::serialize::Message;
+  using MultiMessage = orderbook::serialize::MultiMessage;
+
+  template <typename Root>
+  static auto GetRoot(const void* buf) -> const Root* {
+    return flatbuffers::GetRoot<Root>(buf);
+  }
+
+  static auto Messages(const MultiMessage* multi_msg) -> decltype(auto) {
+    return *multi_msg->messages();
+  }
+};
+
+template <>
+struct CodecTraits<Codec::kFixed> {
+  using Message = orderbook::serialize::fixed::Message;
+  using MultiMessage = orderbook::serialize::fixed::MultiMessage;
+
+  template <typename Root>
+  static auto GetRoot(const void* buf) -> const Root* {
+    return reinterpret_cast<const Root*>(buf);
+  }
+
+  static auto Messages(const MultiMessage* multi_msg) {
+    return multi_msg->messages();
+  }
+};
+
+/**
+ * Builds fixed layout frames into a reusable buffer: a single Message, or a
+ * MultiMessage once more than one message was appended. Room for the
+ * MultiMessage frame is reserved up front, so the encoded messages never
+ * move. Bodies are zero filled before they are handed out, padding and
+ * unset fields never carry stale bytes.
+ */
+class FixedFrameWriter {
+ private:
+  using EventTypeCode = orderbook::serialize::EventTypeCode;
+  using Message = orderbook::serialize::fixed::Message;
+  using MultiMessage = orderbook::serialize::fixed::MultiMessage;
+
+ public:
+  static constexpr std::size_t kDefaultCapacity = 2048;
+
+  explicit FixedFrameWriter(const std::size_t& capacity = kDefaultCapacity) {
+    buffer_.reserve(capacity);
+    Clear();
+  }
+
+  /**
+   * Append a message and return its body for the caller to fill in. The
+   * reference is only valid until the next Append.
+   */
+  template <typename Body>
+  auto Append(const EventTypeCode& event_type, const std::uint32_t& seq_no,
+              const std::uint64_t& ts_nanos) -> Body& {
+    namespace fixed = orderbook::serialize::fixed;
+
+    const auto offset = buffer_.size();
+    buffer_.resize(offset + sizeof(Message) + sizeof(Body));
+    last_offset_ = offset;
+
+    auto* message = reinterpret_cast<Message*>(buffer_.data() + offset);
+    message->Init(sizeof(Message) + sizeof(Body));
+    message->mutable_header()->mutate_ts_nanos(ts_nanos);
+    message->mutable_header()->mutate_seq_no(seq_no);
+    message->mutable_header()->mutate_event_type(event_type);
+    message->mutate_body_type(fixed::BodyTypeOf<Body>::value);
+
+    ++count_;
+    return *reinterpret_cast<Body*>(message + 1);
+  }
+
+  /**
+   * Drop the message of the last Append, e.g. when its body could not be
+   * encoded. Only valid once after each Append.
+   */
+  auto DropLast() -> void {
+    buffer_.resize(last_offset_);
+    --count_;
+  }
+
+  /**
+   * Complete the frame, wrapping the messages in a MultiMessage when there
+   * is more than one.
+   */
+  auto Finish(const std::uint32_t& seq_no, const std::uint64_t& ts_nanos)
+      -> void {
+    if (count_ == 1) {
+      offset_ = sizeof(MultiMessage);
+      return;
+    }
+
+    auto* multi_msg = reinterpret_cast<MultiMessage*>(buffer_.data());
+    multi_msg->Init(static_cast<std::uint32_t>(buffer_.size()));
+    multi_msg->mutable_header()->mutate_ts_nanos(ts_nanos);
+    multi_msg->mutable_header()->mutate_seq_no(seq_no);
+    multi_msg->mutable_header()->mutate_event_type(EventTypeCode::MultiMessage);
+    multi_msg->mutate_messages_count(static_cast<std::uint32_t>(count_));
+    offset_ = 0;
+  }
+
+  auto Clear() -> void {
+    buffer_.assign(sizeof(MultiMessage), 0);
+    count_ = 0;
+    offset_ = 0;
+  }
+
+  auto Data() const -> const std::uint8_t* { return buffer_.data() + offset_; }
+  auto Size() const -> std::size_t { return buffer_.size() - offset_; }
+  auto Count() const -> std::size_t { return count_; }
+  auto Empty() const -> bool { return count_ == 0; }
+
+ private:
+  std::vector<std::uint8_t> buffer_;
+  std::size_t count_{0};
+  std::size_t offset_{0};
+  std::size_t last_offset_{0};
+};
+}  // namespace orderbook::data
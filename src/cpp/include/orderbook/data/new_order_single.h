@@ -11,8 +11,11 @@ namespace orderbook::data {
 struct NewOrderSingle : BaseData {
   NewOrderSingle() : BaseData() {}
 
-  NewOrderSingle(const orderbook::serialize::NewOrderSingle* table)
-      : BaseData() {
+  /**
+   * Copy from a received table, flatbuffer or fixed layout.
+   */
+  template <typename Table>
+  NewOrderSingle(const Table* table) : BaseData() {
     SetSide(static_cast<SideCode>(table->side()));
     SetOrderStatus(static_cast<OrderStatusCode>(table->order_status()));
     SetTimeInForce(static_cast<TimeInForceCode>(table->time_in_force()));
@@ -3,6 +3,7 @@
 #include <array>
 #include <atomic>
 #include <iostream>
+#include <memory>
 #include <mutex>
 
 #include "boost/intrusive_ptr.hpp"
@@ -110,9 +111,14 @@ class IntrusivePool {  // clang-format on
   auto Depth() const -> Counter { return Capacity() - Available(); }
   auto MaxDepth() const -> Counter { return max_depth_; }
 
-  static auto& Instance() {
-    static IntrusivePool<T, PoolSize> instance;
-    return instance;
+  /**
+   * Each thread owns its own pool, which keeps Take / Offer free of
+   * cross-thread contention when books are sharded across threads. Orders
+   * must be released on the thread that took them.
+   */
+  static auto Instance() -> IntrusivePool& {
+    thread_local std::unique_ptr<IntrusivePool> instance{new IntrusivePool()};
+    return *instance;
   }
 
  private:
@@ -223,9 +229,15 @@ class IntrusiveListPool {  // clang-format on
   auto Depth() const -> Counter { return Capacity() - Available(); }
   auto MaxDepth() const -> Counter { return max_depth_; }
 
-  static auto& Instance() {
-    static IntrusiveListPool<T, PoolSize> instance;
-    return instance;
+  /**
+   * Each thread owns its own pool, which keeps Take / Offer free of
+   * cross-thread contention when books are sharded across threads. Orders
+   * must be released on the thread that took them.
+   */
+  static auto Instance() -> IntrusiveListPool& {
+    thread_local std::unique_ptr<IntrusiveListPool> instance{
+        new IntrusiveListPool()};
+    return *instance;
   }
 
  private:
@@ -21,8 +21,11 @@
 namespace orderbook::data {
 struct OrderCancelReject : public BaseData {
  public:
-  OrderCancelReject(const orderbook::serialize::OrderCancelReject* table)
-      : BaseData() {
+  /**
+   * Copy from a received table, flatbuffer or fixed layout.
+   */
+  template <typename Table>
+  OrderCancelReject(const Table* table) : BaseData() {
     SetOrderId(table->order_id());
     SetOrderStatus(static_cast<OrderStatusCode>(table->order_status()));
     SetClientOrderId(table->client_order_id()->str());
@@ -41,8 +44,8 @@ struct OrderCancelReject : public BaseData {
       : BaseData(tx_id, cancel_request.GetRoutingId(),
                  OrderStatus::kCancelRejected, cancel_request.GetAccountId(),
                  cancel_request.GetOrderId(), cancel_request.GetSessionId(),
-                 cancel_request.GetClientOrderId(),
-                 cancel_request.GetOrigClientOrderId()),
+                 ClientOrderId(cancel_request.GetClientOrderId()),
+                 OrigClientOrderId(cancel_request.GetOrigClientOrderId())),
         cxl_rej_response_to_(cxl_rej_response_to) {}
 
   auto SerializeTo(flatbuffers::FlatBufferBuilder& builder) const
@@ -35,9 +35,11 @@ namespace orderbook::data {
 struct OrderCancelReplaceRequest : BaseData {
   OrderCancelReplaceRequest() : BaseData() {}
 
-  OrderCancelReplaceRequest(
-      const orderbook::serialize::OrderCancelReplaceRequest* table)
-      : BaseData() {
+  /**
+   * Copy from a received table, flatbuffer or fixed layout.
+   */
+  template <typename Table>
+  OrderCancelReplaceRequest(const Table* table) : BaseData() {
     SetSide(static_cast<SideCode>(table->side()));
     SetOrderType(static_cast<OrderTypeCode>(table->order_type()));
     SetOrderPrice(table->order_price());
@@ -15,8 +15,11 @@ namespace orderbook::data {
 struct OrderCancelRequest : BaseData {
   OrderCancelRequest() : BaseData() {}
 
-  OrderCancelRequest(const orderbook::serialize::OrderCancelRequest* table)
-      : BaseData() {
+  /**
+   * Copy from a received table, flatbuffer or fixed layout.
+   */
+  template <typename Table>
+  OrderCancelRequest(const Table* table) : BaseData() {
     SetSide(static_cast<SideCode>(table->side()));
     SetOrderQuantity(table->order_quantity());
     SetOrderId(table->order_id());
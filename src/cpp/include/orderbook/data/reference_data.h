@@ -0,0 +1,325 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "orderbook/data/data_types.h"
+#include "orderbook/util/csv.h"
+#include "orderbook/util/fixed_string.h"
+#include "spdlog/spdlog.h"
+
+namespace orderbook::data {
+
+/**
+ * The static description of a listed instrument. Prices and quantities of
+ * orders in it must be multiples of the tick and lot sizes, and prices must
+ * lie within the price band.
+ */
+struct InstrumentRecord {
+  constexpr static std::size_t kSymbolSize = 15;
+
+  InstrumentId instrument_id{0};
+  orderbook::util::FixedString<kSymbolSize> symbol;
+  InstrumentType instrument_type{InstrumentType::kUnknown};
+  Quantity lot_size{1};
+  Price tick_size{1};
+  Price low_band{std::numeric_limits<Price>::min()};
+  Price high_band{std::numeric_limits<Price>::max()};
+
+  auto GetSymbol() const -> std::string_view { return symbol.View(); }
+
+  auto IsValidPrice(const Price& price) const -> bool {
+    return price % tick_size == 0 && price >= low_band && price <= high_band;
+  }
+
+  auto IsValidQuantity(const Quantity& quantity) const -> bool {
+    return quantity > 0 && quantity % lot_size == 0;
+  }
+};
+
+namespace internal {
+/**
+ * Minimal perfect hash over a fixed set of keys, built at startup with
+ * hash and displace: keys are grouped into buckets by a first hash, then
+ * each bucket, largest first, searches for the seed of a second hash that
+ * places all its keys into free slots. A lookup is two hashes and a seed
+ * load; any key maps somewhere, so callers compare the key stored in the
+ * slot.
+ */
+class PerfectHash {
+ private:
+  static constexpr std::size_t kKeysPerBucket = 4;
+  static constexpr std::uint32_t kMaxSeed = 1U << 20U;
+
+ public:
+  PerfectHash() = default;
+
+  /**
+   * Keys must be distinct, throws std::runtime_error if no seed places a
+   * bucket.
+   */
+  explicit PerfectHash(const std::vector<std::string_view>& keys)
+      : slots_(std::max<std::size_t>(keys.size() + keys.size() / 4, 1)),
+        seeds_(std::max<std::size_t>(keys.size() / kKeysPerBucket, 1), 0) {
+    std::vector<std::vector<std::string_view>> buckets(seeds_.size());
+    for (const auto& key : keys) {
+      buckets[Hash(key, 0) % buckets.size()].push_back(key);
+    }
+
+    std::vector<std::size_t> order(buckets.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+      order[i] = i;
+    }
+    std::sort(order.begin(), order.end(),
+              [&](const auto& lhs, const auto& rhs) {
+                return buckets[lhs].size() > buckets[rhs].size();
+              });
+
+    std::vector<bool> taken(slots_, false);
+    std::vector<std::size_t> placed;
+    for (const auto& bucket : order) {
+      if (buckets[bucket].empty()) {
+        break;
+      }
+
+      std::uint32_t seed{1};
+      for (; seed < kMaxSeed; ++seed) {
+        placed.clear();
+        for (const auto& key : buckets[bucket]) {
+          const auto slot = Hash(key, seed) % slots_;
+          if (taken[slot] || std::find(placed.begin(), placed.end(), slot) !=
+                                 placed.end()) {
+            break;
+          }
+          placed.push_back(slot);
+        }
+        if (placed.size() == buckets[bucket].size()) {
+          break;
+        }
+      }
+
+      if (seed == kMaxSeed) {
+        throw std::runtime_error("no perfect hash seed, duplicate keys?");
+      }
+      for (const auto& slot : placed) {
+        taken[slot] = true;
+      }
+      seeds_[bucket] = seed;
+    }
+  }
+
+  auto Index(std::string_view key) const -> std::size_t {
+    const auto seed = seeds_[Hash(key, 0) % seeds_.size()];
+    return Hash(key, seed) % slots_;
+  }
+
+  auto Slots() const -> std::size_t { return slots_; }
+
+ private:
+  /**
+   * FNV-1a, seeded through the offset basis, with a final avalanche so the
+   * low bits used for the modulo depend on every input byte.
+   */
+  static auto Hash(std::string_view key, const std::uint64_t& seed)
+      -> std::uint64_t {
+    constexpr std::uint64_t kOffsetBasis = 14695981039346656037ULL;
+    constexpr std::uint64_t kPrime = 1099511628211ULL;
+
+    std::uint64_t hash = kOffsetBasis ^ (seed * kPrime);
+    for (const auto chr : key) {
+      hash ^= static_cast<std::uint8_t>(chr);
+      hash *= kPrime;
+    }
+
+    hash ^= hash >> 33U;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33U;
+    return hash;
+  }
+
+  std::size_t slots_{1};
+  std::vector<std::uint32_t> seeds_{0};
+};
+}  // namespace internal
+
+/**
+ * The listed instruments, loaded once at startup and read only afterwards,
+ * so one instance can be shared by every thread. Instruments are found by
+ * id through a dense id-indexed table, and by symbol through a perfect
+ * hash. Both the gateway and the orderbook load the same file.
+ *
+ * The file is CSV, one instrument per line:
+ *
+ *   instrument_id,symbol,type,tick_size,lot_size[,low_band,high_band]
+ *
+ * type is one of equity, future, call or put; prices are decimals. Blank
+ * lines, # comments and a header line starting with instrument_id are
+ * skipped.
+ */
+class ReferenceData {
+ public:
+  /**
+   * Ids index a dense table, keep them below this bound.
+   */
+  constexpr static InstrumentId kMaxInstrumentId = 1U << 24U;
+
+  static auto Load(const std::string& path) -> ReferenceData {
+    std::ifstream input(path);
+    if (!input) {
+      throw std::runtime_error("cannot open reference data: " + path);
+    }
+
+    auto reference_data = Parse(input);
+    spdlog::info("loaded {} instruments from {}", reference_data.Size(), path);
+    return reference_data;
+  }
+
+  /**
+   * Throws std::runtime_error, naming the line, for a malformed file,
+   * duplicate ids or duplicate symbols.
+   */
+  static auto Parse(std::istream& input) -> ReferenceData {
+    std::vector<InstrumentRecord> records;
+    orderbook::util::ForEachCsvLine(
+        input, "instrument_id",
+        [&](std::string_view line, const std::size_t& line_no) {
+          InstrumentRecord record;
+          if (!ParseRecord(line, record)) {
+            throw std::runtime_error("bad reference data, line " +
+                                     std::to_string(line_no) + ": " +
+                                     std::string(line));
+          }
+          records.push_back(record);
+        });
+
+    return ReferenceData(std::move(records));
+  }
+
+  /**
+   * Equities 1..count, symbols are their ids, for running without a
+   * reference data file.
+   */
+  static auto Generate(const std::size_t& count) -> ReferenceData {
+    std::vector<InstrumentRecord> records(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      records[i].instrument_id = i + 1;
+      records[i].symbol.Assign(std::to_string(i + 1));
+      records[i].instrument_type = InstrumentType::kEquity;
+    }
+    return ReferenceData(std::move(records));
+  }
+
+  auto Find(const InstrumentId& instrument_id) const
+      -> const InstrumentRecord* {
+    if (instrument_id >= by_id_.size() || by_id_[instrument_id] == 0) {
+      return nullptr;
+    }
+    return &records_[by_id_[instrument_id] - 1];
+  }
+
+  auto Find(std::string_view symbol) const -> const InstrumentRecord* {
+    const auto index = by_symbol_[symbol_hash_.Index(symbol)];
+    if (index == 0 || records_[index - 1].GetSymbol() != symbol) {
+      return nullptr;
+    }
+    return &records_[index - 1];
+  }
+
+  auto Instruments() const -> const std::vector<InstrumentRecord>& {
+    return records_;
+  }
+
+  auto MaxInstrumentId() const -> InstrumentId {
+    return by_id_.empty() ? 0 : by_id_.size() - 1;
+  }
+
+  auto Size() const -> std::size_t { return records_.size(); }
+
+ private:
+  explicit ReferenceData(std::vector<InstrumentRecord> records)
+      : records_(std::move(records)) {
+    std::vector<std::string_view> symbols;
+    InstrumentId max_instrument_id{0};
+    for (const auto& record : records_) {
+      max_instrument_id = std::max(max_instrument_id, record.instrument_id);
+      symbols.push_back(record.GetSymbol());
+    }
+
+    // tables hold record index + 1, zero is unlisted
+    by_id_.assign(records_.empty() ? 0 : max_instrument_id + 1, 0);
+    for (std::uint32_t i = 0; i < records_.size(); ++i) {
+      auto& index = by_id_[records_[i].instrument_id];
+      if (index != 0) {
+        throw std::runtime_error("duplicate instrument id " +
+                                 std::to_string(records_[i].instrument_id));
+      }
+      index = i + 1;
+    }
+
+    std::sort(symbols.begin(), symbols.end());
+    const auto duplicate = std::adjacent_find(symbols.begin(), symbols.end());
+    if (duplicate != symbols.end()) {
+      throw std::runtime_error("duplicate symbol " + std::string(*duplicate));
+    }
+
+    symbol_hash_ = internal::PerfectHash(symbols);
+    by_symbol_.assign(symbol_hash_.Slots(), 0);
+    for (std::uint32_t i = 0; i < records_.size(); ++i) {
+      by_symbol_[symbol_hash_.Index(records_[i].GetSymbol())] = i + 1;
+    }
+  }
+
+  static auto ParseRecord(std::string_view line, InstrumentRecord& record)
+      -> bool {
+    using orderbook::util::ParseInteger;
+
+    const auto fields = orderbook::util::SplitCsv(line);
+    if (fields.size() != 5 && fields.size() != 7) {
+      return false;
+    }
+
+    const auto& symbol = fields[1];
+    if (symbol.empty() || symbol.size() > InstrumentRecord::kSymbolSize) {
+      return false;
+    }
+    record.symbol.Assign(symbol);
+
+    return ParseInteger(fields[0], record.instrument_id) &&
+           record.instrument_id != 0 &&
+           record.instrument_id < kMaxInstrumentId &&
+           ToInstrumentType(fields[2], record.instrument_type) &&
+           ToPrice(fields[3], record.tick_size) && record.tick_size > 0 &&
+           ParseInteger(fields[4], record.lot_size) && record.lot_size > 0 &&
+           (fields.size() == 5 || (ToPrice(fields[5], record.low_band) &&
+                                   ToPrice(fields[6], record.high_band) &&
+                                   record.low_band <= record.high_band));
+  }
+
+  static auto ToInstrumentType(std::string_view str, InstrumentType& type)
+      -> bool {
+    if (str == "equity") {
+      type = InstrumentType::kEquity;
+    } else if (str == "future") {
+      type = InstrumentType::kFuture;
+    } else if (str == "call") {
+      type = InstrumentType::kCall;
+    } else if (str == "put") {
+      type = InstrumentType::kPut;
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  std::vector<InstrumentRecord> records_;
+  std::vector<std::uint32_t> by_id_;
+  internal::PerfectHash symbol_hash_;
+  std::vector<std::uint32_t> by_symbol_{0};
+};
+}  // namespace orderbook::data
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <string_view>
+#include <type_traits>
+
+#include "orderbook/data/data_types.h"
+#include "orderbook/data/order_cancel_request.h"
+#include "orderbook/serialize/orderbook_fixed.h"
+
+/**
+ * A read-only view over an inbound request table, flatbuffer or fixed
+ * layout. Fields are read in place from the received message buffer and
+ * client order ids are exposed as std::string_view, so nothing is copied
+ * until an order actually rests on the book. Exposes the BaseData getters
+ * the books and containers use; fields the table does not carry read as
+ * zero / unknown.
+ *
+ * A view is only valid while the underlying message buffer is alive.
+ */
+
+namespace orderbook::data {
+template <typename Table>
+class RequestView {
+ private:
+  template <typename T>
+  static constexpr bool kHasOrderStatus =
+      requires(const T* t) { t->order_status(); };
+  template <typename T>
+  static constexpr bool kHasTimeInForce =
+      requires(const T* t) { t->time_in_force(); };
+  template <typename T>
+  static constexpr bool kHasOrderType =
+      requires(const T* t) { t->order_type(); };
+  template <typename T>
+  static constexpr bool kHasOrderPrice =
+      requires(const T* t) { t->order_price(); };
+  template <typename T>
+  static constexpr bool kHasOrderId =
+      requires(const T* t) { t->order_id(); };
+  template <typename T>
+  static constexpr bool kHasOrigClientOrderId =
+      requires(const T* t) { t->orig_client_order_id(); };
+
+ public:
+  RequestView(const Table* table, const RoutingId& routing_id)
+      : table_(table), routing_id_(routing_id) {}
+
+  auto GetRoutingId() const -> RoutingId { return routing_id_; }
+
+  auto GetSide() const -> Side { return static_cast<Side>(table_->side()); }
+  auto IsBuyOrder() const -> bool {
+    const auto side = GetSide();
+    return side == SideCode::kBuy || side == SideCode::kBuyCover;
+  }
+  auto IsSellOrder() const -> bool {
+    const auto side = GetSide();
+    return side == SideCode::kSell || side == SideCode::kSellShort;
+  }
+
+  auto GetOrderStatus() const -> OrderStatus {
+    if constexpr (kHasOrderStatus<Table>) {
+      return static_cast<OrderStatus>(table_->order_status());
+    }
+    return OrderStatus::kUnknown;
+  }
+
+  auto GetTimeInForce() const -> TimeInForce {
+    if constexpr (kHasTimeInForce<Table>) {
+      return static_cast<TimeInForce>(table_->time_in_force());
+    }
+    return TimeInForce::kUnknown;
+  }
+
+  auto GetOrderType() const -> OrderType {
+    if constexpr (kHasOrderType<Table>) {
+      return static_cast<OrderType>(table_->order_type());
+    }
+    return OrderType::kUnknown;
+  }
+
+  auto GetOrderPrice() const -> Price {
+    if constexpr (kHasOrderPrice<Table>) {
+      return table_->order_price();
+    }
+    return 0;
+  }
+
+  auto GetOrderId() const -> OrderId {
+    if constexpr (kHasOrderId<Table>) {
+      return table_->order_id();
+    }
+    return 0;
+  }
+
+  auto GetOrderQuantity() const -> Quantity { return table_->order_quantity(); }
+  auto GetAccountId() const -> AccountId { return table_->account_id(); }
+  auto GetSessionId() const -> SessionId { return table_->session_id(); }
+  auto GetInstrumentId() const -> InstrumentId {
+    return table_->instrument_id();
+  }
+
+  auto GetClientOrderId() const -> std::string_view {
+    return ToStringView(table_->client_order_id());
+  }
+  auto GetOrigClientOrderId() const -> std::string_view {
+    if constexpr (kHasOrigClientOrderId<Table>) {
+      return ToStringView(table_->orig_client_order_id());
+    }
+    return {};
+  }
+  auto HasOrigClientOrderId() const -> bool {
+    return !GetOrigClientOrderId().empty();
+  }
+
+  auto GetInstrumentType() const -> InstrumentType {
+    return InstrumentType::kUnknown;
+  }
+  auto GetLastPrice() const -> Price { return 0; }
+  auto GetLastQuantity() const -> Quantity { return 0; }
+  auto GetLeavesQuantity() const -> Quantity { return 0; }
+  auto GetExecutedQuantity() const -> Quantity { return 0; }
+  auto GetExecutedValue() const -> ExecutedValue { return 0; }
+  auto GetQuoteId() const -> QuoteId { return 0; }
+
+ private:
+  /**
+   * A flatbuffers::String, or a fixed layout table's FixedChars.
+   */
+  template <typename String>
+  static auto ToStringView(const String* str) -> std::string_view {
+    if (str == nullptr) {
+      return {};
+    }
+    return {str->data(), str->size()};
+  }
+
+  const Table* table_;
+  RoutingId routing_id_;
+};
+
+using NewOrderSingleView = RequestView<orderbook::serialize::NewOrderSingle>;
+using OrderCancelRequestView =
+    RequestView<orderbook::serialize::OrderCancelRequest>;
+using OrderCancelReplaceRequestView =
+    RequestView<orderbook::serialize::OrderCancelReplaceRequest>;
+
+using FixedNewOrderSingleView =
+    RequestView<orderbook::serialize::fixed::NewOrderSingle>;
+using FixedOrderCancelRequestView =
+    RequestView<orderbook::serialize::fixed::OrderCancelRequest>;
+using FixedOrderCancelReplaceRequestView =
+    RequestView<orderbook::serialize::fixed::OrderCancelReplaceRequest>;
+
+/**
+ * True for cancel requests, owned or viewed. Containers use it to tell a
+ * client cancel apart from removing a filled resting order.
+ */
+template <typename T>
+inline constexpr bool kIsCancelRequest =
+    std::is_same_v<T, OrderCancelRequest> ||
+    std::is_same_v<T, OrderCancelRequestView> ||
+    std::is_same_v<T, FixedOrderCancelRequestView>;
+}  // namespace orderbook::data
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "orderbook/data/data_types.h"
+
+/**
+ * Wire format shared by the market data feeds. Every feed message is a
+ * FeedHeader followed by header.count fixed size entries of the feed's
+ * entry type, in host byte order. Messages are published on the topic
+ * "<prefix>.<instrument_id>."; the trailing dot keeps a subscription to
+ * one instrument from matching others by prefix.
+ */
+
+namespace orderbook::feed {
+
+using orderbook::data::InstrumentId;
+using orderbook::data::OrderId;
+using orderbook::data::Price;
+using orderbook::data::Quantity;
+using orderbook::data::Side;
+
+using SequenceNumber = std::uint64_t;
+
+enum class FeedType : std::uint8_t {
+  kUnknown = 0,
+  kMarketByPrice = 1,
+  kMarketByOrder = 2,
+  kSnapshot = 3
+};
+
+enum class LevelAction : std::uint8_t { kNew = 0, kChange = 1, kDelete = 2 };
+
+enum class OrderAction : std::uint8_t {
+  kAdd = 0,
+  kModify = 1,
+  kDelete = 2,
+  kExecute = 3
+};
+
+struct FeedHeader {
+  InstrumentId instrument_id{0};
+  SequenceNumber seq_no{0};
+  orderbook::data::Timestamp timestamp{0};
+  std::uint16_t count{0};
+  FeedType feed_type{FeedType::kUnknown};
+  std::array<std::uint8_t, 5> reserved{};
+};
+
+/**
+ * A market by price level update. Quantity and order count are the level
+ * totals after the update, both zero for kDelete.
+ */
+struct LevelUpdate {
+  Price price{0};
+  Quantity quantity{0};
+  std::uint32_t order_count{0};
+  Side side{Side::kUnknown};
+  LevelAction action{LevelAction::kNew};
+  std::array<std::uint8_t, 6> reserved{};
+};
+
+/**
+ * A market by order update. Price and quantity are the order's resting
+ * price and leaves quantity after the update; for kExecute, price is the
+ * trade price and executed_quantity the quantity traded.
+ */
+struct OrderUpdate {
+  OrderId order_id{0};
+  Price price{0};
+  Quantity quantity{0};
+  Quantity executed_quantity{0};
+  Side side{Side::kUnknown};
+  OrderAction action{OrderAction::kAdd};
+  std::array<std::uint8_t, 6> reserved{};
+};
+
+static_assert(sizeof(FeedHeader) == 32, "unexpected FeedHeader layout");
+static_assert(sizeof(LevelUpdate) == 24, "unexpected LevelUpdate layout");
+static_assert(sizeof(OrderUpdate) == 32, "unexpected OrderUpdate layout");
+static_assert(std::is_trivially_copyable_v<FeedHeader>);
+static_assert(std::is_trivially_copyable_v<LevelUpdate>);
+static_assert(std::is_trivially_copyable_v<OrderUpdate>);
+
+inline auto IsBid(const Side& side) -> bool {
+  return side == Side::kBuy || side == Side::kBuyCover;
+}
+
+/**
+ * Builds "<prefix>.<instrument_id>." in place, without allocating.
+ */
+class FeedTopic {
+ public:
+  auto Make(std::string_view prefix, const InstrumentId& instrument_id)
+      -> std::string_view {
+    std::memcpy(buffer_.data(), prefix.data(), prefix.size());
+    char* pos = buffer_.data() + prefix.size();
+    *pos++ = '.';
+    pos = std::to_chars(pos, buffer_.data() + buffer_.size() - 1,
+                        instrument_id)
+              .ptr;
+    *pos++ = '.';
+    return {buffer_.data(), static_cast<std::size_t>(pos - buffer_.data())};
+  }
+
+ private:
+  static constexpr std::size_t kMaxTopicSize = 32;
+
+  std::array<char, kMaxTopicSize> buffer_{};
+};
+
+/**
+ * Serializes one feed message into a reusable buffer.
+ */
+class FeedMessageWriter {
+ public:
+  static constexpr std::size_t kMaxEntries = UINT16_MAX;
+
+  explicit FeedMessageWriter(const std::size_t& reserve_size = 4096) {
+    buffer_.reserve(reserve_size);
+  }
+
+  auto Begin(const FeedType& feed_type, const InstrumentId& instrument_id,
+             const orderbook::data::Timestamp& timestamp) -> void {
+    header_ = FeedHeader{};
+    header_.feed_type = feed_type;
+    header_.instrument_id = instrument_id;
+    header_.timestamp = timestamp;
+    buffer_.resize(sizeof(FeedHeader));
+  }
+
+  template <typename Entry>
+  auto Append(const Entry& entry) -> void {
+    static_assert(std::is_trivially_copyable_v<Entry>);
+    const auto offset = buffer_.size();
+    buffer_.resize(offset + sizeof(Entry));
+    std::memcpy(buffer_.data() + offset, &entry, sizeof(Entry));
+    ++header_.count;
+  }
+
+  /**
+   * Stamp the header, the message is then available through Data / Size.
+   */
+  auto Finish(const SequenceNumber& seq_no) -> void {
+    header_.seq_no = seq_no;
+    std::memcpy(buffer_.data(), &header_, sizeof(FeedHeader));
+  }
+
+  auto Count() const -> std::size_t { return header_.count; }
+  auto Full() const -> bool { return header_.count == kMaxEntries; }
+  auto Data() const -> const std::uint8_t* { return buffer_.data(); }
+  auto Size() const -> std::size_t { return buffer_.size(); }
+
+ private:
+  FeedHeader header_;
+  std::vector<std::uint8_t> buffer_;
+};
+
+// clang-format off
+/**
+ * Anything market data can be published through, e.g. the
+ * XPubSocketProvider.
+ */
+template <typename TransportT>
+concept FeedTransportConcept = requires(TransportT t,
+                                        std::string_view topic,
+                                        const void* data,
+                                        std::size_t size) {
+  t.Publish(topic, data, size);
+};
+// clang-format on
+}  // namespace orderbook::feed
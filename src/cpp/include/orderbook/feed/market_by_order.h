@@ -0,0 +1,150 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "orderbook/data/event_record.h"
+#include "orderbook/feed/feed_types.h"
+#include "orderbook/util/time_util.h"
+
+namespace orderbook::feed {
+
+/**
+ * Market by order (L3) feed: every add, modify, delete and execution of a
+ * resting order, in book event order. The updates of a batch are collected
+ * per instrument into preallocated message buffers and published at the
+ * batch end, one message per instrument, sequenced per instrument.
+ */
+template <typename Transport>
+  requires FeedTransportConcept<Transport>
+class MarketByOrder {
+ private:
+  using EventRecord = orderbook::data::EventRecord;
+  using EventType = orderbook::data::EventType;
+  using TimeUtil = orderbook::util::TimeUtil;
+
+  /**
+   * The message being built for one instrument. Messages and their
+   * buffers are reused across batches.
+   */
+  struct PendingMessage {
+    InstrumentId instrument_id{0};
+    FeedMessageWriter writer;
+  };
+
+ public:
+  static constexpr std::string_view kTopicPrefix = "L3";
+  static constexpr std::size_t kPendingReserve = 64;
+
+  explicit MarketByOrder(Transport& transport) : transport_(transport) {
+    pending_.reserve(kPendingReserve);
+  }
+
+  auto OnRecord(const EventRecord& record) -> void {
+    OrderUpdate update;
+    update.order_id = record.order_id;
+    update.side = record.side;
+    update.price = record.order_price;
+    update.quantity = record.leaves_quantity;
+
+    switch (record.event_type) {
+      case EventType::kOrderNew:
+        update.action = OrderAction::kAdd;
+        break;
+      case EventType::kOrderModified:
+        update.action = record.leaves_quantity > 0 ? OrderAction::kModify
+                                                   : OrderAction::kDelete;
+        break;
+      case EventType::kOrderCancelled:
+        update.action = OrderAction::kDelete;
+        update.quantity = 0;
+        break;
+      case EventType::kOrderPartiallyFilled:
+      case EventType::kOrderFilled:
+        update.action = OrderAction::kExecute;
+        update.price = record.last_price;
+        update.executed_quantity = record.last_quantity;
+        break;
+      default:
+        return;
+    }
+
+    Append(record.instrument_id, update);
+  }
+
+  /**
+   * Publish the updates collected since the last batch end.
+   */
+  auto OnBatchEnd() -> void {
+    for (std::size_t i = 0; i < pending_count_; ++i) {
+      Send(pending_[i]);
+    }
+    pending_count_ = 0;
+  }
+
+  auto GetSequence(const InstrumentId& instrument_id) const
+      -> SequenceNumber {
+    const auto iter = seq_nos_.find(instrument_id);
+    return iter == seq_nos_.end() ? 0 : iter->second;
+  }
+
+  auto MessageCount() const -> std::uint64_t { return message_count_; }
+  auto UpdateCount() const -> std::uint64_t { return update_count_; }
+
+ private:
+  auto Append(const InstrumentId& instrument_id, const OrderUpdate& update)
+      -> void {
+    auto& pending = PendingFor(instrument_id);
+    if (pending.writer.Full()) {
+      Send(pending);
+      pending.writer.Begin(FeedType::kMarketByOrder, instrument_id,
+                           TimeUtil::EpochNanos());
+    }
+    pending.writer.Append(update);
+  }
+
+  /**
+   * The message for instrument_id, started on its first update of the
+   * batch.
+   */
+  auto PendingFor(const InstrumentId& instrument_id) -> PendingMessage& {
+    for (std::size_t i = 0; i < pending_count_; ++i) {
+      if (pending_[i].instrument_id == instrument_id) {
+        return pending_[i];
+      }
+    }
+
+    if (pending_count_ == pending_.size()) {
+      pending_.emplace_back();
+    }
+
+    auto& pending = pending_[pending_count_++];
+    pending.instrument_id = instrument_id;
+    pending.writer.Begin(FeedType::kMarketByOrder, instrument_id,
+                         TimeUtil::EpochNanos());
+    return pending;
+  }
+
+  auto Send(PendingMessage& pending) -> void {
+    if (pending.writer.Count() == 0) {
+      return;
+    }
+
+    pending.writer.Finish(++seq_nos_[pending.instrument_id]);
+    transport_.Publish(topic_.Make(kTopicPrefix, pending.instrument_id),
+                       pending.writer.Data(), pending.writer.Size());
+
+    update_count_ += pending.writer.Count();
+    ++message_count_;
+  }
+
+  Transport& transport_;
+  std::vector<PendingMessage> pending_;
+  std::size_t pending_count_{0};
+  std::unordered_map<InstrumentId, SequenceNumber> seq_nos_;
+  FeedTopic topic_;
+
+  std::uint64_t message_count_{0};
+  std::uint64_t update_count_{0};
+};
+}  // namespace orderbook::feed
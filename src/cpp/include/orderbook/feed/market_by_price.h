@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "orderbook/feed/price_levels.h"
+#include "orderbook/util/time_util.h"
+
+namespace orderbook::feed {
+
+/**
+ * Incremental market by price (L2) feed. Book events update the level
+ * aggregates as they arrive; the levels they touch are only remembered,
+ * together with their state at the start of the batch. At every batch end
+ * each touched level is compared against that prior state and at most one
+ * update per level is published, so a level changed several times within a
+ * batch is conflated and a level created and removed within a batch is not
+ * published at all.
+ *
+ * One message per instrument and batch, sequenced per instrument.
+ */
+template <typename Transport>
+  requires FeedTransportConcept<Transport>
+class MarketByPrice {
+ private:
+  using EventRecord = orderbook::data::EventRecord;
+  using Level = PriceLevels::Level;
+  using TimeUtil = orderbook::util::TimeUtil;
+
+  /**
+   * A level touched during the current batch and its prior state.
+   */
+  struct TouchedLevel {
+    InstrumentId instrument_id;
+    Price price;
+    Side side;
+    Level prior;
+
+    auto Key() const { return std::tie(instrument_id, side, price); }
+  };
+
+  /**
+   * A touched level's identity, marked in O(1) when the level is first
+   * touched in a batch. Every Side resting on the bid (or the ask) is one
+   * side of the book.
+   */
+  struct LevelKey {
+    InstrumentId instrument_id;
+    Price price;
+    bool bid;
+
+    auto operator==(const LevelKey& rhs) const -> bool = default;
+  };
+
+  struct LevelKeyHash {
+    auto operator()(const LevelKey& key) const -> std::size_t {
+      const auto mixed = static_cast<std::uint64_t>(key.price) ^
+                         (key.instrument_id << 40U) ^
+                         static_cast<std::uint64_t>(key.bid) << 63U;
+      return std::hash<std::uint64_t>{}(mixed);
+    }
+  };
+
+ public:
+  static constexpr std::string_view kTopicPrefix = "L2";
+  static constexpr std::size_t kTouchedReserve = 1024;
+
+  explicit MarketByPrice(Transport& transport) : transport_(transport) {
+    touched_.reserve(kTouchedReserve);
+    touched_keys_.reserve(kTouchedReserve);
+  }
+
+  auto OnRecord(const EventRecord& record) -> void {
+    levels_.Apply(record, [&](const InstrumentId& instrument_id,
+                              const Side& side, const Price& price,
+                              const Level& prior) {
+      Touch(instrument_id, side, price, prior);
+    });
+  }
+
+  /**
+   * Publish the conflated updates for every level touched since the last
+   * batch end.
+   */
+  auto OnBatchEnd() -> void {
+    if (touched_.empty()) {
+      return;
+    }
+
+    std::sort(touched_.begin(), touched_.end(),
+              [](const auto& lhs, const auto& rhs) {
+                return lhs.Key() < rhs.Key();
+              });
+
+    const auto timestamp = TimeUtil::EpochNanos();
+    InstrumentId instrument_id{0};
+    bool open{false};
+    for (const auto& touched : touched_) {
+      if (!open || touched.instrument_id != instrument_id || writer_.Full()) {
+        if (open) {
+          Send(instrument_id);
+        }
+        open = true;
+        instrument_id = touched.instrument_id;
+        writer_.Begin(FeedType::kMarketByPrice, instrument_id, timestamp);
+      }
+
+      const auto current =
+          levels_.GetLevel(touched.instrument_id, touched.side, touched.price);
+      if (current == touched.prior) {
+        continue;
+      }
+
+      LevelUpdate update;
+      update.price = touched.price;
+      update.side = touched.side;
+      update.quantity = current.quantity;
+      update.order_count = current.order_count;
+      if (touched.prior.order_count == 0) {
+        update.action = LevelAction::kNew;
+      } else if (current.order_count == 0) {
+        update.action = LevelAction::kDelete;
+      } else {
+        update.action = LevelAction::kChange;
+      }
+      writer_.Append(update);
+    }
+
+    Send(instrument_id);
+    touched_.clear();
+    touched_keys_.clear();
+  }
+
+  /**
+   * The sequence number of the last message published for instrument_id.
+   */
+  auto GetSequence(const InstrumentId& instrument_id) const
+      -> SequenceNumber {
+    const auto iter = seq_nos_.find(instrument_id);
+    return iter == seq_nos_.end() ? 0 : iter->second;
+  }
+
+  /**
+   * True while the levels hold changes not yet published, i.e. in the
+   * middle of a batch.
+   */
+  auto HasPendingUpdates() const -> bool { return !touched_.empty(); }
+
+  auto GetLevels() const -> const PriceLevels& { return levels_; }
+  auto MessageCount() const -> std::uint64_t { return message_count_; }
+  auto UpdateCount() const -> std::uint64_t { return update_count_; }
+
+ private:
+  auto Touch(const InstrumentId& instrument_id, const Side& side,
+             const Price& price, const Level& prior) -> void {
+    if (touched_keys_.insert(LevelKey{instrument_id, price, IsBid(side)})
+            .second) {
+      touched_.push_back(TouchedLevel{instrument_id, price, side, prior});
+    }
+  }
+
+  auto Send(const InstrumentId& instrument_id) -> void {
+    if (writer_.Count() == 0) {
+      return;
+    }
+
+    writer_.Finish(++seq_nos_[instrument_id]);
+    transport_.Publish(topic_.Make(kTopicPrefix, instrument_id),
+                       writer_.Data(), writer_.Size());
+
+    update_count_ += writer_.Count();
+    ++message_count_;
+  }
+
+  Transport& transport_;
+  PriceLevels levels_;
+  std::vector<TouchedLevel> touched_;
+  std::unordered_set<LevelKey, LevelKeyHash> touched_keys_;
+  std::unordered_map<InstrumentId, SequenceNumber> seq_nos_;
+  FeedMessageWriter writer_;
+  FeedTopic topic_;
+
+  std::uint64_t message_count_{0};
+  std::uint64_t update_count_{0};
+};
+}  // namespace orderbook::feed
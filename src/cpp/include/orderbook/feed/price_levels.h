@@ -0,0 +1,174 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <unordered_map>
+
+#include "orderbook/data/event_record.h"
+#include "orderbook/feed/feed_types.h"
+
+namespace orderbook::feed {
+
+/**
+ * Aggregate quantity and order count per price level for every instrument
+ * of a shard, maintained incrementally from the shard's execution events.
+ * The price and leaves quantity of each resting order are tracked as well,
+ * since modify and cancel events do not carry the values they replace.
+ */
+class PriceLevels {
+ private:
+  using EventRecord = orderbook::data::EventRecord;
+  using EventType = orderbook::data::EventType;
+
+ public:
+  struct Level {
+    Quantity quantity{0};
+    std::uint32_t order_count{0};
+
+    auto operator==(const Level& rhs) const -> bool = default;
+  };
+
+  using BidLevels = std::map<Price, Level, std::greater<>>;
+  using AskLevels = std::map<Price, Level, std::less<>>;
+
+  struct Book {
+    BidLevels bids;
+    AskLevels asks;
+  };
+
+  using BookMap = std::unordered_map<InstrumentId, Book>;
+
+  /**
+   * Apply a single book event. on_change(instrument_id, side, price, level)
+   * is called with the prior state of each level, right before the event
+   * changes it.
+   */
+  template <typename ChangeCallback>
+  auto Apply(const EventRecord& record, ChangeCallback&& on_change) -> void {
+    switch (record.event_type) {
+      case EventType::kOrderNew: {
+        if (record.leaves_quantity <= 0) {
+          return;
+        }
+        const auto& [iter, added] = orders_.try_emplace(
+            record.order_id,
+            RestingOrder{record.instrument_id, record.order_price,
+                         record.leaves_quantity, record.side});
+        if (added) {
+          Update(iter->second, record.leaves_quantity, 1, on_change);
+        }
+        return;
+      }
+      case EventType::kOrderPartiallyFilled:
+      case EventType::kOrderFilled: {
+        auto iter = orders_.find(record.order_id);
+        if (iter == orders_.end()) {
+          return;
+        }
+        const bool filled = record.leaves_quantity <= 0;
+        Update(iter->second, -record.last_quantity, filled ? -1 : 0,
+               on_change);
+        if (filled) {
+          orders_.erase(iter);
+        } else {
+          iter->second.leaves = record.leaves_quantity;
+        }
+        return;
+      }
+      case EventType::kOrderCancelled: {
+        auto iter = orders_.find(record.order_id);
+        if (iter == orders_.end()) {
+          return;
+        }
+        Update(iter->second, -iter->second.leaves, -1, on_change);
+        orders_.erase(iter);
+        return;
+      }
+      case EventType::kOrderModified: {
+        auto iter = orders_.find(record.order_id);
+        if (iter == orders_.end()) {
+          return;
+        }
+        auto& order = iter->second;
+        Update(order, -order.leaves, -1, on_change);
+        if (record.leaves_quantity <= 0) {
+          orders_.erase(iter);
+          return;
+        }
+        order.price = record.order_price;
+        order.leaves = record.leaves_quantity;
+        Update(order, order.leaves, 1, on_change);
+        return;
+      }
+      default:
+        return;
+    }
+  }
+
+  auto Apply(const EventRecord& record) -> void {
+    Apply(record, [](auto&&...) {});
+  }
+
+  auto GetLevel(const InstrumentId& instrument_id, const Side& side,
+                const Price& price) const -> Level {
+    const auto* book = Find(instrument_id);
+    if (book == nullptr) {
+      return Level{};
+    }
+    return IsBid(side) ? Lookup(book->bids, price) : Lookup(book->asks, price);
+  }
+
+  auto Find(const InstrumentId& instrument_id) const -> const Book* {
+    const auto iter = books_.find(instrument_id);
+    return iter == books_.end() ? nullptr : &iter->second;
+  }
+
+  auto Books() const -> const BookMap& { return books_; }
+  auto OrderCount() const -> std::size_t { return orders_.size(); }
+
+ private:
+  struct RestingOrder {
+    InstrumentId instrument_id;
+    Price price;
+    Quantity leaves;
+    Side side;
+  };
+
+  template <typename ChangeCallback>
+  auto Update(const RestingOrder& order, const Quantity& quantity,
+              const std::int32_t& order_count, ChangeCallback& on_change)
+      -> void {
+    auto& book = books_[order.instrument_id];
+    if (IsBid(order.side)) {
+      UpdateLevel(book.bids, order, quantity, order_count, on_change);
+    } else {
+      UpdateLevel(book.asks, order, quantity, order_count, on_change);
+    }
+  }
+
+  template <typename Levels, typename ChangeCallback>
+  static auto UpdateLevel(Levels& levels, const RestingOrder& order,
+                          const Quantity& quantity,
+                          const std::int32_t& order_count,
+                          ChangeCallback& on_change) -> void {
+    auto [iter, added] = levels.try_emplace(order.price);
+    auto& level = iter->second;
+    on_change(order.instrument_id, order.side, order.price, level);
+
+    level.quantity += quantity;
+    level.order_count += order_count;
+    if (level.order_count == 0) {
+      levels.erase(iter);
+    }
+  }
+
+  template <typename Levels>
+  static auto Lookup(const Levels& levels, const Price& price) -> Level {
+    const auto iter = levels.find(price);
+    return iter == levels.end() ? Level{} : iter->second;
+  }
+
+  BookMap books_;
+  std::unordered_map<OrderId, RestingOrder> orders_;
+};
+}  // namespace orderbook::feed
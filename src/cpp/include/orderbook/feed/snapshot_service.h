@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <vector>
+
+#include "orderbook/feed/market_by_price.h"
+
+namespace orderbook::feed {
+
+struct SnapshotOptions {
+  static constexpr std::size_t kDefaultDepth = 10;
+  static constexpr std::chrono::milliseconds kDefaultInterval{1000};
+
+  std::size_t depth{kDefaultDepth};  // levels per side
+  std::chrono::milliseconds interval{kDefaultInterval};  // zero: on request
+};
+
+/**
+ * Book snapshots for market by price subscribers joining late or
+ * recovering from a gap. A snapshot holds the top depth levels of each
+ * side, best first, stamped with the L2 sequence number it corresponds to:
+ * the subscriber applies it, then only the incremental messages with a
+ * higher sequence number.
+ *
+ * Snapshots are built from the feed's own level aggregates, on the thread
+ * that publishes the feed, so matching is never paused. Every book is
+ * snapshotted once per interval, a bounded slice of books per Poll, and a
+ * single book can be requested out of cycle at any time.
+ */
+template <typename Transport>
+  requires FeedTransportConcept<Transport>
+class SnapshotService {
+ private:
+  using Feed = MarketByPrice<Transport>;
+  using Clock = std::chrono::steady_clock;
+  using TimeUtil = orderbook::util::TimeUtil;
+
+ public:
+  static constexpr std::string_view kTopicPrefix = "SNAP";
+  static constexpr std::string_view kAllTopic = "SNAP.";
+  static constexpr std::size_t kSliceSize = 16;
+
+  SnapshotService(Transport& transport, const Feed& feed,
+                  const SnapshotOptions& options = {})
+      : transport_(transport),
+        feed_(feed),
+        depth_(std::min(options.depth, FeedMessageWriter::kMaxEntries / 2)),
+        interval_(options.interval) {}
+
+  /**
+   * Snapshot instrument_id at the next Poll, ahead of the periodic cycle.
+   */
+  auto Request(const InstrumentId& instrument_id) -> void {
+    if (std::find(requests_.begin(), requests_.end(), instrument_id) ==
+        requests_.end()) {
+      requests_.push_back(instrument_id);
+    }
+  }
+
+  /**
+   * Start a full cycle at the next Poll.
+   */
+  auto RequestAll() -> void { request_all_ = true; }
+
+  /**
+   * Treat a subscription seen on the feed socket as a request: a
+   * subscription to "SNAP.<instrument_id>." requests that book, one
+   * matching every snapshot topic (e.g. "SNAP.") requests all of them.
+   */
+  auto OnSubscription(std::string_view topic) -> void {
+    if (kAllTopic.starts_with(topic)) {
+      RequestAll();
+      return;
+    }
+
+    if (!topic.starts_with(kAllTopic)) {
+      return;
+    }
+
+    InstrumentId instrument_id{0};
+    const char* first = topic.data() + kAllTopic.size();
+    const char* last = topic.data() + topic.size();
+    if (std::from_chars(first, last, instrument_id).ec == std::errc{}) {
+      Request(instrument_id);
+    }
+  }
+
+  /**
+   * Publish the requested snapshots and the next slice of the periodic
+   * cycle, returns the number of snapshots published. Must only be called
+   * between batches, while the feed has no pending updates.
+   */
+  auto Poll(const Clock::time_point& now) -> std::size_t {
+    std::size_t count = 0;
+    for (const auto& instrument_id : requests_) {
+      count += Publish(instrument_id);
+    }
+    requests_.clear();
+
+    if (cursor_ == cycle_.size() &&
+        (request_all_ || (interval_.count() > 0 && now >= next_cycle_))) {
+      StartCycle(now);
+    }
+
+    const auto end = std::min(cursor_ + kSliceSize, cycle_.size());
+    for (; cursor_ < end; ++cursor_) {
+      count += Publish(cycle_[cursor_]);
+    }
+
+    return count;
+  }
+
+  auto SnapshotCount() const -> std::uint64_t { return snapshot_count_; }
+
+ private:
+  auto StartCycle(const Clock::time_point& now) -> void {
+    cycle_.clear();
+    for (const auto& [instrument_id, book] : feed_.GetLevels().Books()) {
+      cycle_.push_back(instrument_id);
+    }
+    std::sort(cycle_.begin(), cycle_.end());
+
+    cursor_ = 0;
+    request_all_ = false;
+    next_cycle_ = now + interval_;
+  }
+
+  /**
+   * Books this feed has never seen belong to another shard (or have never
+   * traded), they are left to the feed that owns them.
+   */
+  auto Publish(const InstrumentId& instrument_id) -> std::size_t {
+    const auto* book = feed_.GetLevels().Find(instrument_id);
+    if (book == nullptr) {
+      return 0;
+    }
+
+    writer_.Begin(FeedType::kSnapshot, instrument_id, TimeUtil::EpochNanos());
+    AppendLevels(book->bids, Side::kBuy);
+    AppendLevels(book->asks, Side::kSell);
+    writer_.Finish(feed_.GetSequence(instrument_id));
+
+    transport_.Publish(topic_.Make(kTopicPrefix, instrument_id),
+                       writer_.Data(), writer_.Size());
+    ++snapshot_count_;
+    return 1;
+  }
+
+  template <typename Levels>
+  auto AppendLevels(const Levels& levels, const Side& side) -> void {
+    std::size_t depth = 0;
+    for (const auto& [price, level] : levels) {
+      if (depth++ == depth_) {
+        break;
+      }
+
+      LevelUpdate update;
+      update.price = price;
+      update.quantity = level.quantity;
+      update.order_count = level.order_count;
+      update.side = side;
+      update.action = LevelAction::kNew;
+      writer_.Append(update);
+    }
+  }
+
+  Transport& transport_;
+  const Feed& feed_;
+  std::size_t depth_;
+  std::chrono::milliseconds interval_;
+
+  std::vector<InstrumentId> requests_;
+  std::vector<InstrumentId> cycle_;
+  std::size_t cursor_{0};
+  bool request_all_{false};
+  Clock::time_point next_cycle_{};
+
+  FeedMessageWriter writer_;
+  FeedTopic topic_;
+  std::uint64_t snapshot_count_{0};
+};
+}  // namespace orderbook::feed
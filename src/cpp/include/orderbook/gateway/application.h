@@ -1,9 +1,17 @@
 #pragma once
 
+#include <mutex>
+#include <optional>
+
 #include "orderbook/application_traits.h"
+#include "orderbook/data/reference_data.h"
+#include "orderbook/gateway/fix_parser.h"
+#include "orderbook/gateway/risk_engine.h"
+#include "orderbook/gateway/throttle.h"
 #include "quickfix/Application.h"
 #include "quickfix/Message.h"
 #include "quickfix/Session.h"
+#include "quickfix/SessionSettings.h"
 #include "quickfix/fix42/ExecutionReport.h"
 #include "quickfix/fix42/MessageCracker.h"
 #include "quickfix/fix42/NewOrderSingle.h"
@@ -24,10 +32,37 @@ class GatewayApplication : public FIX::Application,
   using EventDispatcherPtr = std::shared_ptr<EventDispatcher>;
   using FixSessionIdMap = std::map<FIX::SessionID, SessionId>;
   using ClientSessionIdMap = std::map<SessionId, FIX::SessionID>;
+  using ReferenceDataPtr = std::shared_ptr<const ReferenceData>;
+  using RiskEnginePtr = std::shared_ptr<RiskEngine>;
+  using SessionThrottleMap = std::map<FIX::SessionID, ThrottleLimits>;
+  using TimeUtil = orderbook::util::TimeUtil;
 
  public:
-  GatewayApplication(EventDispatcherPtr dispatcher)
-      : dispatcher_(std::move(dispatcher)), data_{EmptyType()} {
+  /**
+   * Without a risk engine orders are forwarded unchecked.
+   */
+  GatewayApplication(EventDispatcherPtr dispatcher,
+                     ReferenceDataPtr reference_data,
+                     RiskEnginePtr risk_engine = nullptr)
+      : dispatcher_(std::move(dispatcher)),
+        reference_data_(std::move(reference_data)),
+        risk_engine_(std::move(risk_engine)),
+        data_{EmptyType()},
+        parser_(reference_data_.get()) {
+    // risk counters move before the client hears of the execution
+    if (risk_engine_ != nullptr) {
+      for (const auto& event_type :
+           {EventType::kOrderNew, EventType::kOrderPartiallyFilled,
+            EventType::kOrderFilled, EventType::kOrderModified,
+            EventType::kOrderCancelled, EventType::kOrderRejected}) {
+        dispatcher_->prependListener(
+            event_type, [this, event_type](const EventData& data) {
+              risk_engine_->OnExecutionReport(
+                  event_type, std::get<ExecutionReport>(data));
+            });
+      }
+    }
+
     dispatcher_->appendListener(
         EventType::kOrderNew, [&](const EventData& data) {
           auto& exec_rpt = std::get<ExecutionReport>(data);
@@ -151,29 +186,62 @@ class GatewayApplication : public FIX::Application,
         });
   }
 
+  /**
+   * Read the message rate limits from the gateway settings, in messages a
+   * second, unset or zero being unlimited. ThrottleRate and ThrottleBurst
+   * limit each session, set in [DEFAULT] or overridden in a [SESSION];
+   * AccountThrottleRate and AccountThrottleBurst in [DEFAULT] limit each
+   * account.
+   */
+  auto Configure(const FIX::SessionSettings& settings) -> void {
+    throttle_ = Throttle(ToThrottleLimits(settings.get(), "AccountThrottle"));
+    for (const auto& session_id : settings.getSessions()) {
+      session_throttles_[session_id] =
+          ToThrottleLimits(settings.get(session_id), "Throttle");
+    }
+  }
+
   auto onCreate(const FIX::SessionID& session_id) -> void override {
     spdlog::info("session created: {}", session_id.toString());
   }
 
   auto onLogon(const FIX::SessionID& session_id) -> void override {
-    fix_session_map_.emplace(session_id, ++next_session_id_);
-    client_session_map_.emplace(next_session_id_, session_id);
+    SessionId client_session_id{0};
+    {
+      std::lock_guard<std::mutex> lock(sessions_mutex_);
+      client_session_id = ++next_session_id_;
+      fix_session_map_.emplace(session_id, client_session_id);
+      client_session_map_.emplace(client_session_id, session_id);
+    }
+
+    const auto limits = session_throttles_.find(session_id);
+    if (limits != session_throttles_.end()) {
+      throttle_.AddSession(client_session_id, limits->second);
+    }
 
     spdlog::info("session logon: session {} -> id {}", session_id.toString(),
-                 fix_session_map_[session_id]);
+                 client_session_id);
   }
 
+  /**
+   * The session maps are only locked around the lookup and the erase: the
+   * cancel on disconnect can be answered synchronously, through SessionOf.
+   */
   auto onLogout(const FIX::SessionID& session_id) -> void override {
+    const auto client_session_id = Convert(session_id);
     spdlog::info("session logout: session {} -> id {}", session_id.toString(),
-                 fix_session_map_[session_id]);
+                 client_session_id);
 
     orderbook::data::OrderCancelRequest cancel;
-    cancel.SetSessionId(Convert(session_id));
+    cancel.SetSessionId(client_session_id);
 
     data_ = cancel;
     dispatcher_->dispatch(EventType::kCancelOnDisconnect, data_);
 
-    client_session_map_.erase(fix_session_map_.at(session_id));
+    throttle_.RemoveSession(client_session_id);
+
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    client_session_map_.erase(client_session_id);
     fix_session_map_.erase(session_id);
   }
 
@@ -192,12 +260,144 @@ class GatewayApplication : public FIX::Application,
       EXCEPT(FIX::FieldNotFound, FIX::IncorrectDataFormat,
              FIX::IncorrectTagValue, FIX::UnsupportedMessageType)
           -> void override {
-    crack(message, session_id);
+    if (!OnOrderEntry(message, session_id)) {
+      crack(message, session_id);
+    }
   }
 
  private:
-  auto GetSymbol(const InstrumentId& /*unused*/) -> FIX::Symbol {
-    return FIX::Symbol("AAPL");
+  auto GetSymbol(const InstrumentId& instrument_id) const -> FIX::Symbol {
+    const auto* record = reference_data_->Find(instrument_id);
+    return FIX::Symbol(record != nullptr ? std::string(record->GetSymbol())
+                                         : std::to_string(instrument_id));
+  }
+
+  /**
+   * SecurityID, or failing that the instrument listed under Symbol.
+   */
+  auto InstrumentOf(const FIX::Message& message) const -> InstrumentId {
+    if (message.isSetField(FIX::FIELD::SecurityID)) {
+      FIX::SecurityID security_id;
+      message.getField(security_id);
+      return Convert(security_id);
+    }
+
+    FIX::Symbol symbol;
+    message.getField(symbol);
+    const std::string_view symbol_view = symbol.getValue();
+    const auto* record = reference_data_->Find(symbol_view);
+    if (record == nullptr) {
+      throw FIX::IncorrectTagValue(symbol.getField());
+    }
+    return record->instrument_id;
+  }
+
+  /**
+   * The tag of the first field of request its instrument's reference data
+   * rejects, zero if none: the instrument must be listed, and orders must
+   * be on tick, in whole lots and within the price band.
+   */
+  template <typename Request>
+  auto InvalidField(const Request& request) const -> int {
+    const auto* record = reference_data_->Find(request.GetInstrumentId());
+    if (record == nullptr) {
+      return FIX::FIELD::SecurityID;
+    }
+
+    if constexpr (!std::is_same_v<Request,
+                                   orderbook::data::OrderCancelRequest>) {
+      if (!record->IsValidPrice(request.GetOrderPrice())) {
+        return FIX::FIELD::Price;
+      }
+      if (!record->IsValidQuantity(request.GetOrderQuantity())) {
+        return FIX::FIELD::OrderQty;
+      }
+    }
+    return 0;
+  }
+
+  template <typename Request>
+  auto Validate(const Request& request) const -> void {
+    const auto tag = InvalidField(request);
+    if (tag != 0) {
+      throw FIX::IncorrectTagValue(tag);
+    }
+  }
+
+  static auto ToThrottleLimits(const FIX::Dictionary& dictionary,
+                               const std::string& prefix) -> ThrottleLimits {
+    ThrottleLimits limits;
+    if (dictionary.has(prefix + "Rate")) {
+      limits.rate = dictionary.getInt(prefix + "Rate");
+    }
+    if (dictionary.has(prefix + "Burst")) {
+      limits.burst = dictionary.getInt(prefix + "Burst");
+    }
+    return limits;
+  }
+
+  /**
+   * Screen a request before it is forwarded, answering it with a reject if
+   * it fails: every request is throttled, client order ids must fit the
+   * orderbook's fixed width fields, and new orders and replaces then take
+   * the pre-trade risk check. Throttling first keeps shed messages from
+   * reserving risk.
+   */
+  template <typename Request>
+  auto Approve(const Request& request) -> bool {
+    const auto text = Screen(request);
+    if (text.empty()) [[likely]] {
+      return true;
+    }
+
+    spdlog::warn("reject: session {}, account {}, clord_id {}: {}",
+                 request.GetSessionId(), request.GetAccountId(),
+                 request.GetClientOrderId(), text);
+
+    if constexpr (std::is_same_v<Request, orderbook::data::NewOrderSingle>) {
+      ExecutionReport rejected(0, 0, request);
+      rejected.SetOrderStatus(OrderStatus::kRejected);
+      SendFixMessage(rejected, FIX::ExecType(FIX::ExecType_REJECTED), text);
+    } else if constexpr (std::is_same_v<
+                             Request,
+                             orderbook::data::OrderCancelReplaceRequest>) {
+      SendFixMessage(
+          OrderCancelReject(0, request,
+                            CxlRejResponseTo::kOrderCancelReplaceRequest),
+          text);
+    } else {
+      SendFixMessage(
+          OrderCancelReject(0, request, CxlRejResponseTo::kOrderCancelRequest),
+          text);
+    }
+    return false;
+  }
+
+  /**
+   * Why request is rejected, empty if it is not.
+   */
+  template <typename Request>
+  auto Screen(const Request& request) -> std::string_view {
+    if (!throttle_.TryAcquire(request.GetSessionId(), request.GetAccountId(),
+                              TimeUtil::MonotonicNanos())) {
+      return "throttled";
+    }
+
+    if (!HasValidClientOrderIds(request)) {
+      return "client order id too long";
+    }
+
+    // cancels only ever reduce risk
+    if constexpr (!std::is_same_v<Request,
+                                  orderbook::data::OrderCancelRequest>) {
+      if (risk_engine_ != nullptr) {
+        const auto result = risk_engine_->Check(request);
+        if (result != RiskEngine::Result::kAccepted) {
+          return RiskEngine::ToString(result);
+        }
+      }
+    }
+    return {};
   }
 
   auto Convert(const FIX::Side& side) const -> SideCode {
@@ -253,7 +453,8 @@ class GatewayApplication : public FIX::Application,
     }
   }
 
-  auto Convert(const FIX::SessionID& session_id) -> SessionId {
+  auto Convert(const FIX::SessionID& session_id) const -> SessionId {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
     return fix_session_map_.at(session_id);
   }
 
@@ -262,19 +463,78 @@ class GatewayApplication : public FIX::Application,
   }
 
   auto Convert(const FIX::OrderID& order_id) const -> OrderId {
-    return std::stoi(order_id.getValue());
+    return std::stoull(order_id.getValue());
   }
 
   auto Convert(const FIX::SecurityID& securityId) const -> InstrumentId {
     return std::stoi(securityId.getValue());
   }
 
+  /**
+   * Prices are read from the field's text, never through a double.
+   */
+  auto Convert(const FIX::Price& price) const -> Price {
+    Price prc{0};
+    if (!orderbook::data::ToPrice(price.getString(), prc)) {
+      throw FIX::IncorrectDataFormat(price.getField());
+    }
+    return prc;
+  }
+
+  /**
+   * The fast path for the order entry messages, D, F and G: FixParser
+   * reads the fields of interest straight from the message quickfix
+   * already parsed and fills the request directly, instead of cracking it
+   * into a typed message and converting fields one at a time. Anything the
+   * parser or the reference data checks do not accept falls back to crack,
+   * which rejects it; a request which is throttled or fails the risk check
+   * is answered here.
+   */
+  auto OnOrderEntry(const FIX::Message& message,
+                    const FIX::SessionID& session_id) -> bool {
+    const auto& msg_type = message.getHeader().getField(FIX::FIELD::MsgType);
+    if (msg_type != "D" && msg_type != "F" && msg_type != "G") {
+      return false;
+    }
+
+    if (!parser_.Parse(message.getHeader(), message)) {
+      return false;
+    }
+
+    switch (msg_type[0]) {
+      case 'D':
+        return Dispatch<orderbook::data::NewOrderSingle>(
+            EventType::kOrderPendingNew, session_id);
+      case 'G':
+        return Dispatch<orderbook::data::OrderCancelReplaceRequest>(
+            EventType::kOrderPendingModify, session_id);
+      default:
+        return Dispatch<orderbook::data::OrderCancelRequest>(
+            EventType::kOrderPendingCancel, session_id);
+    }
+  }
+
+  template <typename Request>
+  auto Dispatch(const EventType& event_type, const FIX::SessionID& session_id)
+      -> bool {
+    data_ = Request();
+    auto& request = std::get<Request>(data_);
+    if (!parser_.Fill(request) || InvalidField(request) != 0) {
+      return false;
+    }
+
+    request.SetSessionId(Convert(session_id));
+    if (Approve(request)) {
+      dispatcher_->dispatch(event_type, data_);
+    }
+    return true;
+  }
+
   auto onMessage(const FIX42::NewOrderSingle& message,
                  const FIX::SessionID& session_id) -> void override {
     spdlog::info("onMessage[{}] FIX42::NewOrderSingle: {}",
                  session_id.toString(), message.toString());
 
-    FIX::SecurityID security_id;
     FIX::Side side;
     FIX::OrdType ord_type;
     FIX::OrderQty order_qty;
@@ -288,20 +548,19 @@ class GatewayApplication : public FIX::Application,
       throw FIX::IncorrectTagValue(ord_type.getField());
     }
 
-    message.get(security_id);
     message.get(side);
     message.get(order_qty);
     message.get(price);
     message.get(clord_id);
     message.get(account_id);
 
-    const auto& prc = orderbook::data::ToPrice(price.getValue());
+    const auto& prc = Convert(price);
 
     orderbook::data::NewOrderSingle order;
     order.SetOrderPrice(prc)
         .SetOrderQuantity(order_qty.getValue())
         .SetSide(Convert(side))
-        .SetInstrumentId(Convert(security_id))
+        .SetInstrumentId(InstrumentOf(message))
         .SetSessionId(Convert(session_id))
         .SetAccountId(Convert(account_id))
         .SetClientOrderId(clord_id.getValue())
@@ -309,6 +568,10 @@ class GatewayApplication : public FIX::Application,
         .SetTimeInForce(TimeInForce::kDay)
         .SetOrderStatus(OrderStatus::kPendingNew);
 
+    Validate(order);
+    if (!Approve(order)) {
+      return;
+    }
     data_ = order;
     dispatcher_->dispatch(EventType::kOrderPendingNew, data_);
   }
@@ -321,7 +584,6 @@ class GatewayApplication : public FIX::Application,
     FIX::ClOrdID clord_id;
     FIX::Side side;
     FIX::Price price;
-    FIX::SecurityID security_id;
     FIX::OrderID order_id;
     FIX::Account account_id;
     FIX::OrderQty order_qty;
@@ -329,25 +591,28 @@ class GatewayApplication : public FIX::Application,
     message.get(orig_clord_id);
     message.get(clord_id);
     message.get(side);
-    message.get(security_id);
     message.get(order_id);
     message.get(account_id);
     message.get(order_qty);
     message.get(price);
 
-    const auto& prc = orderbook::data::ToPrice(price.getValue());
+    const auto& prc = Convert(price);
 
     orderbook::data::OrderCancelReplaceRequest modify;
     modify.SetOrderPrice(prc)
         .SetAccountId(Convert(account_id))
         .SetOrderQuantity(order_qty.getValue())
         .SetSide(Convert(side))
-        .SetInstrumentId(Convert(security_id))
+        .SetInstrumentId(InstrumentOf(message))
         .SetSessionId(Convert(session_id))
         .SetOrderId(Convert(order_id))
         .SetClientOrderId(clord_id.getValue())
         .SetOrigClientOrderId(orig_clord_id.getValue());
 
+    Validate(modify);
+    if (!Approve(modify)) {
+      return;
+    }
     data_ = modify;
     dispatcher_->dispatch(EventType::kOrderPendingModify, data_);
   }
@@ -359,7 +624,6 @@ class GatewayApplication : public FIX::Application,
     FIX::OrigClOrdID orig_clord_id;
     FIX::ClOrdID clord_id;
     FIX::Side side;
-    FIX::SecurityID security_id;
     FIX::OrderID order_id;
     FIX::Account account_id;
     FIX::OrderQty order_qty;
@@ -367,7 +631,6 @@ class GatewayApplication : public FIX::Application,
     message.get(orig_clord_id);
     message.get(clord_id);
     message.get(side);
-    message.get(security_id);
     message.get(order_id);
     message.get(account_id);
     message.get(order_qty);
@@ -376,21 +639,32 @@ class GatewayApplication : public FIX::Application,
     cancel.SetAccountId(Convert(account_id))
         .SetOrderQuantity(order_qty.getValue())
         .SetSide(Convert(side))
-        .SetInstrumentId(Convert(security_id))
+        .SetInstrumentId(InstrumentOf(message))
         .SetSessionId(Convert(session_id))
         .SetOrderId(Convert(order_id))
         .SetClientOrderId(clord_id.getValue())
         .SetOrigClientOrderId(orig_clord_id.getValue());
 
+    Validate(cancel);
+    if (!Approve(cancel)) {
+      return;
+    }
     data_ = cancel;
     dispatcher_->dispatch(EventType::kOrderPendingCancel, data_);
   }
 
-  auto SendFixMessage(const ExecutionReport& exec_rpt,
-                      const FIX::ExecType& exec_type) -> void {
-    const auto& px = orderbook::data::ToDouble(exec_rpt.GetOrderPrice());
-    const auto& avg_px = orderbook::data::ToDouble(exec_rpt.GetAveragePrice());
-    const auto& last_px = orderbook::data::ToDouble(exec_rpt.GetLastPrice());
+  /**
+   * Builds the FIX execution report from either an ExecutionReport or an
+   * ExecutionView, both expose the same getters.
+   */
+  template <typename ExecutionData>
+  auto SendFixMessage(const ExecutionData& exec_rpt,
+                      const FIX::ExecType& exec_type,
+                      std::string_view text = {}) -> void {
+    const auto session_id = SessionOf(exec_rpt.GetSessionId());
+    if (!session_id) {
+      return;
+    }
 
     FIX42::ExecutionReport executionReport = FIX42::ExecutionReport(
         FIX::OrderID(std::to_string(exec_rpt.GetOrderId())),
@@ -399,11 +673,20 @@ class GatewayApplication : public FIX::Application,
         Convert(exec_rpt.GetOrderStatus()),
         GetSymbol(exec_rpt.GetInstrumentId()), Convert(exec_rpt.GetSide()),
         FIX::LeavesQty(exec_rpt.GetLeavesQuantity()),
-        FIX::CumQty(exec_rpt.GetExecutedQuantity()), FIX::AvgPx(avg_px));
-
-    executionReport.set(FIX::Price(px));
-    executionReport.set(FIX::LastPx(last_px));
-    executionReport.set(FIX::ClOrdID(exec_rpt.GetClientOrderId()));
+        FIX::CumQty(exec_rpt.GetExecutedQuantity()), FIX::AvgPx(0));
+
+    // prices are written as exact decimals, never through a double
+    executionReport.setField(
+        FIX::FIELD::AvgPx,
+        orderbook::data::ToDecimalString(exec_rpt.GetAveragePrice()));
+    executionReport.setField(
+        FIX::FIELD::Price,
+        orderbook::data::ToDecimalString(exec_rpt.GetOrderPrice()));
+    executionReport.setField(
+        FIX::FIELD::LastPx,
+        orderbook::data::ToDecimalString(exec_rpt.GetLastPrice()));
+    executionReport.set(
+        FIX::ClOrdID(std::string(exec_rpt.GetClientOrderId())));
     executionReport.set(FIX::OrderQty(exec_rpt.GetOrderQuantity()));
     executionReport.set(FIX::LastShares(exec_rpt.GetLastQuantity()));
     executionReport.set(FIX::Account(std::to_string(exec_rpt.GetAccountId())));
@@ -412,31 +695,66 @@ class GatewayApplication : public FIX::Application,
     executionReport.set(FIX::IDSource(FIX::IDSource_EXCHANGE_SYMBOL));
 
     if (exec_rpt.HasOrigClientOrderId()) {
-      executionReport.set(FIX::OrigClOrdID(exec_rpt.GetOrigClientOrderId()));
+      executionReport.set(
+          FIX::OrigClOrdID(std::string(exec_rpt.GetOrigClientOrderId())));
+    }
+    if (!text.empty()) {
+      executionReport.set(FIX::Text(std::string(text)));
     }
 
-    const FIX::SessionID& session_id =
-        client_session_map_.at(exec_rpt.GetSessionId());
-    FIX::Session::sendToTarget(executionReport, session_id);
+    FIX::Session::sendToTarget(executionReport, *session_id);
   }
 
-  auto SendFixMessage(const OrderCancelReject& ord_cxl_rej) -> void {
+  auto SendFixMessage(const OrderCancelReject& ord_cxl_rej,
+                      std::string_view text = {}) -> void {
+    const auto session_id = SessionOf(ord_cxl_rej.GetSessionId());
+    if (!session_id) {
+      return;
+    }
+
     FIX42::OrderCancelReject orderCancelReject = FIX42::OrderCancelReject(
         FIX::OrderID(std::to_string(ord_cxl_rej.GetOrderId())),
         FIX::ClOrdID(ord_cxl_rej.GetClientOrderId()),
         FIX::OrigClOrdID(ord_cxl_rej.GetOrigClientOrderId()),
         Convert(ord_cxl_rej.GetOrderStatus()),
         Convert(ord_cxl_rej.GetCxlRejResponseTo()));
+    if (!text.empty()) {
+      orderCancelReject.set(FIX::Text(std::string(text)));
+    }
+
+    FIX::Session::sendToTarget(orderCancelReject, *session_id);
+  }
 
-    const FIX::SessionID& session_id =
-        client_session_map_.at(ord_cxl_rej.GetSessionId());
-    FIX::Session::sendToTarget(orderCancelReject, session_id);
+  /**
+   * The FIX session of a client session, empty once it has logged out: the
+   * orders cancelled on its disconnect are still reported, to the risk
+   * engine, but there is no one left to send them to. A copy, since the
+   * acceptor thread may erase the entry as soon as the lock is released.
+   */
+  auto SessionOf(const SessionId& session_id) const
+      -> std::optional<FIX::SessionID> {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    const auto it = client_session_map_.find(session_id);
+    if (it == client_session_map_.end()) {
+      return std::nullopt;
+    }
+    return it->second;
   }
 
+  /**
+   * Guards both session maps: logon and logout run on the acceptor thread,
+   * SessionOf on the receive thread of every engine.
+   */
+  mutable std::mutex sessions_mutex_;
   FixSessionIdMap fix_session_map_{};
   ClientSessionIdMap client_session_map_{};
   EventDispatcherPtr dispatcher_;
+  ReferenceDataPtr reference_data_;
+  RiskEnginePtr risk_engine_;
+  Throttle throttle_;
+  SessionThrottleMap session_throttles_{};
   EventData data_;
+  FixParser parser_;
   SessionId next_session_id_{0};
 };
 
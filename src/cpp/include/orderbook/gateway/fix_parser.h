@@ -0,0 +1,280 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "orderbook/data/new_order_single.h"
+#include "orderbook/data/order_cancel_replace_request.h"
+#include "orderbook/data/order_cancel_request.h"
+#include "orderbook/data/reference_data.h"
+#include "orderbook/util/csv.h"
+
+namespace orderbook::gateway {
+
+namespace internal {
+inline static constexpr char kSoh = '\x01';
+
+/**
+ * The first SOH in [pos, end), or end. Sixteen bytes are compared at a
+ * time with SSE2 where available.
+ */
+inline auto FindSoh(const char* pos, const char* end) -> const char* {
+#if defined(__SSE2__)
+  const auto soh = _mm_set1_epi8(kSoh);
+  while (end - pos >= 16) {
+    const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+    const auto mask = static_cast<unsigned int>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, soh)));
+    if (mask != 0) {
+      return pos + std::countr_zero(mask);
+    }
+    pos += 16;
+  }
+#endif
+  while (pos != end && *pos != kSoh) {
+    ++pos;
+  }
+  return pos;
+}
+
+/**
+ * FIX quantities are decimals, only whole quantities are accepted.
+ */
+inline auto ParseQuantity(std::string_view str,
+                          orderbook::data::Quantity& quantity) -> bool {
+  const auto dot = str.find('.');
+  if (dot != std::string_view::npos &&
+      str.find_first_not_of('0', dot + 1) != std::string_view::npos) {
+    return false;
+  }
+  return orderbook::util::ParseInteger(str.substr(0, dot), quantity);
+}
+}  // namespace internal
+
+/**
+ * Single pass parser for the FIX 4.2 order entry messages: NewOrderSingle
+ * (D), OrderCancelReplaceRequest (G) and OrderCancelRequest (F). Parse
+ * records where each field of interest sits in the raw buffer, or in a
+ * message quickfix already parsed, and the Fill overloads convert them
+ * straight into the orderbook requests, without any intermediate strings.
+ * The buffer or message must outlive the parser's use of it. Given
+ * reference data, an instrument may be given by Symbol instead of
+ * SecurityID.
+ *
+ * Framing, checksum and session level validation are left to quickfix, a
+ * message failing to parse or fill is handed back to it.
+ */
+class FixParser {
+ private:
+  using NewOrderSingle = orderbook::data::NewOrderSingle;
+  using OrderCancelRequest = orderbook::data::OrderCancelRequest;
+  using OrderCancelReplaceRequest = orderbook::data::OrderCancelReplaceRequest;
+  using Price = orderbook::data::Price;
+  using Quantity = orderbook::data::Quantity;
+  using Side = orderbook::data::Side;
+  using ReferenceData = orderbook::data::ReferenceData;
+
+  /**
+   * Every field of interest has a tag below kMaxTag, any other is skipped.
+   */
+  static constexpr int kMaxTag = 64;
+
+ public:
+  enum Tag : int {
+    kAccount = 1,
+    kClOrdId = 11,
+    kMsgType = 35,
+    kOrderId = 37,
+    kOrderQty = 38,
+    kOrdType = 40,
+    kOrigClOrdId = 41,
+    kPrice = 44,
+    kSecurityId = 48,
+    kSide = 54,
+    kSymbol = 55
+  };
+
+  explicit FixParser(const ReferenceData* reference_data = nullptr)
+      : reference_data_(reference_data) {}
+
+  /**
+   * Index every tag=value field of raw. False if it is not a sequence of
+   * SOH terminated fields.
+   */
+  auto Parse(std::string_view raw) -> bool {
+    present_ = 0;
+
+    const auto* pos = raw.data();
+    const auto* end = raw.data() + raw.size();
+    while (pos != end) {
+      int tag{0};
+      const auto [equals, ec] = std::from_chars(pos, end, tag);
+      if (ec != std::errc{} || equals == end || *equals != '=' || tag <= 0) {
+        return false;
+      }
+
+      const auto* value = equals + 1;
+      const auto* soh = internal::FindSoh(value, end);
+      if (soh == end) {
+        return false;
+      }
+
+      if (tag < kMaxTag) {
+        fields_[tag] = std::string_view(value, soh - value);
+        present_ |= std::uint64_t{1} << tag;
+      }
+      pos = soh + 1;
+    }
+
+    return Has(kMsgType);
+  }
+
+  /**
+   * Index the fields of interest of an already parsed message, given its
+   * header and body field maps: anything exposing quickfix's FieldMap
+   * isSetField and getFieldRef. The values are read in place, the message
+   * is never written back out as text.
+   */
+  template <typename Header, typename Body>
+  auto Parse(const Header& header, const Body& body) -> bool {
+    present_ = 0;
+
+    Load(header, kMsgType);
+    for (const auto tag :
+         {kAccount, kClOrdId, kOrderId, kOrderQty, kOrdType, kOrigClOrdId,
+          kPrice, kSecurityId, kSide, kSymbol}) {
+      Load(body, tag);
+    }
+
+    return Has(kMsgType);
+  }
+
+  auto Has(const int tag) const -> bool {
+    return tag < kMaxTag && (present_ & (std::uint64_t{1} << tag)) != 0;
+  }
+
+  auto Get(const int tag) const -> std::string_view {
+    return Has(tag) ? fields_[tag] : std::string_view{};
+  }
+
+  auto MsgType() const -> std::string_view { return Get(kMsgType); }
+
+  /**
+   * Fill a limit order from a parsed NewOrderSingle.
+   */
+  auto Fill(NewOrderSingle& order) const -> bool {
+    Price price{0};
+    if (MsgType() != "D" || Get(kOrdType) != "2" ||
+        !orderbook::data::ToPrice(Get(kPrice), price) || !Has(kClOrdId) ||
+        !FillCommon(order)) {
+      return false;
+    }
+
+    order.SetOrderPrice(price)
+        .SetClientOrderId(Get(kClOrdId))
+        .SetOrderType(orderbook::data::OrderType::kLimit)
+        .SetTimeInForce(orderbook::data::TimeInForce::kDay)
+        .SetOrderStatus(orderbook::data::OrderStatus::kPendingNew);
+    return true;
+  }
+
+  auto Fill(OrderCancelReplaceRequest& modify) const -> bool {
+    Price price{0};
+    if (MsgType() != "G" || !orderbook::data::ToPrice(Get(kPrice), price) ||
+        !FillCancel(modify)) {
+      return false;
+    }
+
+    modify.SetOrderPrice(price);
+    return true;
+  }
+
+  auto Fill(OrderCancelRequest& cancel) const -> bool {
+    return MsgType() == "F" && FillCancel(cancel);
+  }
+
+ private:
+  /**
+   * The side, quantity, account and instrument every request carries.
+   */
+  template <typename Request>
+  auto FillCommon(Request& request) const -> bool {
+    Side side{};
+    Quantity quantity{0};
+    orderbook::data::AccountId account_id{0};
+    orderbook::data::InstrumentId instrument_id{0};
+
+    if (!ToSide(Get(kSide), side) ||
+        !internal::ParseQuantity(Get(kOrderQty), quantity) ||
+        !orderbook::util::ParseInteger(Get(kAccount), account_id) ||
+        !ToInstrumentId(instrument_id)) {
+      return false;
+    }
+
+    request.SetSide(side)
+        .SetOrderQuantity(quantity)
+        .SetAccountId(account_id)
+        .SetInstrumentId(instrument_id);
+    return true;
+  }
+
+  template <typename Request>
+  auto FillCancel(Request& request) const -> bool {
+    orderbook::data::OrderId order_id{0};
+    if (!orderbook::util::ParseInteger(Get(kOrderId), order_id) ||
+        !Has(kClOrdId) || !Has(kOrigClOrdId) || !FillCommon(request)) {
+      return false;
+    }
+
+    request.SetOrderId(order_id)
+        .SetClientOrderId(Get(kClOrdId))
+        .SetOrigClientOrderId(Get(kOrigClOrdId));
+    return true;
+  }
+
+  template <typename FieldMap>
+  auto Load(const FieldMap& fields, const int tag) -> void {
+    if (fields.isSetField(tag)) {
+      fields_[tag] = fields.getFieldRef(tag).getString();
+      present_ |= std::uint64_t{1} << tag;
+    }
+  }
+
+  auto ToInstrumentId(orderbook::data::InstrumentId& instrument_id) const
+      -> bool {
+    if (Has(kSecurityId) || reference_data_ == nullptr) {
+      return orderbook::util::ParseInteger(Get(kSecurityId), instrument_id);
+    }
+
+    const auto* record = reference_data_->Find(Get(kSymbol));
+    if (record == nullptr) {
+      return false;
+    }
+    instrument_id = record->instrument_id;
+    return true;
+  }
+
+  static auto ToSide(std::string_view value, Side& side) -> bool {
+    if (value == "1") {
+      side = Side::kBuy;
+      return true;
+    }
+    if (value == "2") {
+      side = Side::kSell;
+      return true;
+    }
+    return false;
+  }
+
+  const ReferenceData* reference_data_;
+  std::array<std::string_view, kMaxTag> fields_{};
+  std::uint64_t present_{0};
+};
+}  // namespace orderbook::gateway
@@ -1,12 +1,28 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "orderbook/application_traits.h"
+#include "orderbook/data/fixed_codec.h"
+#include "orderbook/util/shm_socket_providers.h"
 #include "orderbook/util/socket_providers.h"
 
 namespace orderbook::gateway {
 
+/**
+ * Forwards order requests to the orderbook and dispatches its replies. The
+ * ClientSocket is the transport: zmq by default, or the shared memory
+ * ShmClientSocketProvider. Requests are encoded with the client's codec,
+ * the orderbook answers in the same encoding.
+ */
+template <typename ClientSocket = orderbook::util::ClientSocketProvider>
 class OrderbookClient {
  private:
   using TimeUtil = orderbook::util::TimeUtil;
@@ -16,105 +32,92 @@ class OrderbookClient {
   using EventCallback = orderbook::data::EventCallback;
   using EventDispatcher = eventpp::EventDispatcher<EventType, EventCallback>;
   using EventDispatcherPtr = std::shared_ptr<EventDispatcher>;
-  using ClientSocket = orderbook::util::ClientSocketProvider;
   using ExecutionReport = orderbook::data::ExecutionReport;
   using NewOrderSingle = orderbook::data::NewOrderSingle;
   using OrderCancelReject = orderbook::data::OrderCancelReject;
   using OrderCancelRequest = orderbook::data::OrderCancelRequest;
   using OrderCancelReplaceRequest = orderbook::data::OrderCancelReplaceRequest;
+  using Codec = orderbook::data::Codec;
+  using FixedFrameWriter = orderbook::data::FixedFrameWriter;
+
+  using MessageOffset = flatbuffers::Offset<orderbook::serialize::Message>;
 
   constexpr static std::size_t kBufferSize = 2048;
 
+  /**
+   * Requests from one sending thread not yet handed to the socket, built
+   * either into the flatbuffer builder or the fixed layout frame. The
+   * mutex is only contended by the deadline flusher.
+   */
+  struct OutboundBatch {
+    std::mutex mutex;
+    flatbuffers::FlatBufferBuilder builder{kBufferSize};
+    std::vector<MessageOffset> messages;
+    FixedFrameWriter frames{kBufferSize};
+    TimeUtil::Timestamp first_nanos{0};
+
+    auto Count() const -> std::size_t {
+      return messages.size() + frames.Count();
+    }
+  };
+
+  using OutboundBatchPtr = std::unique_ptr<OutboundBatch>;
+
  public:
-  OrderbookClient(EventDispatcherPtr dispatcher)
-      : dispatcher_(std::move(dispatcher)), data_{EmptyType()} {
+  /**
+   * With max_batch > 1 requests are coalesced into a MultiMessage, which is
+   * sent once max_batch requests are pending, once the oldest pending
+   * request is older than deadline, or on Close. The default sends every
+   * request as it arrives.
+   */
+  struct BatchOptions {
+    static constexpr std::chrono::microseconds kDefaultDeadline{100};
+
+    std::size_t max_batch{1};
+    std::chrono::microseconds deadline{kDefaultDeadline};
+  };
+
+  OrderbookClient(EventDispatcherPtr dispatcher,
+                  const BatchOptions& batch_options = {},
+                  const Codec& codec = Codec::kFlatBuffers)
+      : dispatcher_(std::move(dispatcher)),
+        data_{EmptyType()},
+        batch_options_(batch_options),
+        codec_(codec) {
+    namespace fixed = orderbook::serialize::fixed;
+
     /**
      * Create listeners which forward create, modify, and delete
-     * order requests to the orderbook.
+     * order requests to the orderbook. Listeners run on the FIX session
+     * threads, each of which builds into its own batch.
      */
     dispatcher_->appendListener(
         EventType::kOrderPendingNew, [&](const EventData& data) {
           spdlog::info("OrderbookClient EventType::kOrderPendingNew");
-
-          using namespace orderbook::serialize;
-
-          auto& order = std::get<NewOrderSingle>(data);
-
-          builder.Clear();
-          builder.Finish(CreateMessage(
-              builder,
-
-              CreateHeader(builder, TimeUtil::EpochNanos(), ++seq_no_,
-                           static_cast<orderbook::serialize::EventTypeCode>(
-                               EventType::kOrderPendingNew)),
-
-              Body::NewOrderSingle, order.SerializeTo(builder).Union()));
-
-          socket_.SendFlatBuffer(builder.GetBufferPointer(), builder.GetSize());
+          Send<fixed::NewOrderSingle>(EventType::kOrderPendingNew,
+                                      std::get<NewOrderSingle>(data));
         });
 
     dispatcher_->appendListener(
         EventType::kOrderPendingModify, [&](const EventData& data) {
           spdlog::info("OrderbookClient EventType::kOrderPendingModify");
-
-          using namespace orderbook::serialize;
-
-          auto& modify = std::get<OrderCancelReplaceRequest>(data);
-
-          builder.Clear();
-          builder.Finish(CreateMessage(
-              builder,
-
-              CreateHeader(builder, TimeUtil::EpochNanos(), ++seq_no_,
-                           static_cast<orderbook::serialize::EventTypeCode>(
-                               EventType::kOrderPendingModify)),
-
-              Body::OrderCancelReplaceRequest,
-              modify.SerializeTo(builder).Union()));
-
-          socket_.SendFlatBuffer(builder.GetBufferPointer(), builder.GetSize());
+          Send<fixed::OrderCancelReplaceRequest>(
+              EventType::kOrderPendingModify,
+              std::get<OrderCancelReplaceRequest>(data));
         });
 
     dispatcher_->appendListener(
         EventType::kOrderPendingCancel, [&](const EventData& data) {
           spdlog::info("OrderbookClient EventType::kOrderPendingCancel");
-
-          using namespace orderbook::serialize;
-
-          auto& cancel = std::get<OrderCancelRequest>(data);
-
-          builder.Clear();
-          builder.Finish(CreateMessage(
-              builder,
-
-              CreateHeader(builder, TimeUtil::EpochNanos(), ++seq_no_,
-                           static_cast<orderbook::serialize::EventTypeCode>(
-                               EventType::kOrderPendingCancel)),
-
-              Body::OrderCancelRequest, cancel.SerializeTo(builder).Union()));
-
-          socket_.SendFlatBuffer(builder.GetBufferPointer(), builder.GetSize());
+          Send<fixed::OrderCancelRequest>(EventType::kOrderPendingCancel,
+                                          std::get<OrderCancelRequest>(data));
         });
 
     dispatcher_->appendListener(
         EventType::kCancelOnDisconnect, [&](const EventData& data) {
           spdlog::info("OrderbookClient EventType::kCancelOnDisconnect");
-
-          using namespace orderbook::serialize;
-
-          auto& cancel = std::get<OrderCancelRequest>(data);
-
-          builder.Clear();
-          builder.Finish(CreateMessage(
-              builder,
-
-              CreateHeader(builder, TimeUtil::EpochNanos(), ++seq_no_,
-                           static_cast<orderbook::serialize::EventTypeCode>(
-                               EventType::kCancelOnDisconnect)),
-
-              Body::OrderCancelRequest, cancel.SerializeTo(builder).Union()));
-
-          socket_.SendFlatBuffer(builder.GetBufferPointer(), builder.GetSize());
+          Send<fixed::OrderCancelRequest>(EventType::kCancelOnDisconnect,
+                                          std::get<OrderCancelRequest>(data));
         });
   }
 
@@ -125,9 +128,16 @@ class OrderbookClient {
 
     socket_.Monitor(connected_event, ZMQ_EVENT_CONNECTED);
     socket_.Connect(addr);
+
+    if (batch_options_.max_batch > 1) {
+      flushing_ = true;
+      flush_thread_ = std::thread([&]() { FlushExpired(); });
+    }
   }
 
-  auto ProcessMessages() -> void {
+  auto ProcessMessages(const orderbook::util::ReceiveOptions& options = {})
+      -> void {
+    socket_.SetReceiveOptions(options);
     recv_thread_ = std::thread([&]() {
       socket_.ProcessMessages([&](zmq::message_t&& msg) {
         OnMessage(std::forward<zmq::message_t>(msg));
@@ -136,13 +146,230 @@ class OrderbookClient {
   }
 
   auto Close() -> void {
+    flushing_ = false;
+    if (flush_thread_.joinable()) {
+      flush_thread_.join();
+    }
+    FlushAll();
+
     socket_.Close();
     recv_thread_.join();
   }
 
  private:
+  /**
+   * Every client gets a distinct id for the life of the process, so a
+   * thread's batch is never found again by a later client, even one
+   * allocated at the address of a destroyed client.
+   */
+  static auto NextClientId() -> std::uint64_t {
+    static std::atomic<std::uint64_t> next_client_id{0};
+    return next_client_id.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+  /**
+   * The batch of the calling thread, created on first use. The batch is
+   * owned by the client, the thread only caches a pointer to it under the
+   * client's id.
+   */
+  auto LocalBatch() -> OutboundBatch& {
+    thread_local std::vector<std::pair<std::uint64_t, OutboundBatch*>>
+        local_batches;
+
+    for (auto& [client_id, batch] : local_batches) {
+      if (client_id == client_id_) {
+        return *batch;
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(batches_mutex_);
+    auto* batch =
+        batches_.emplace_back(std::make_unique<OutboundBatch>()).get();
+    local_batches.emplace_back(client_id_, batch);
+    return *batch;
+  }
+
+  /**
+   * Encode a request into the calling thread's batch. FixedTable is the
+   * request's fixed layout table, which also names its Body type. A request
+   * the fixed layout cannot hold, a client order id longer than its field,
+   * is never sent but rejected back to the gateway.
+   */
+  template <typename FixedTable, typename Request>
+  auto Send(const EventType& event_type, const Request& request) -> void {
+    if (!Encode<FixedTable>(event_type, request)) [[unlikely]] {
+      spdlog::warn("reject: session {}, clord_id {}: not encodable",
+                   request.GetSessionId(), request.GetClientOrderId());
+      Reject(request);
+    }
+  }
+
+  template <typename FixedTable, typename Request>
+  auto Encode(const EventType& event_type, const Request& request) -> bool {
+    using namespace orderbook::serialize;
+
+    auto& batch = LocalBatch();
+    std::lock_guard<std::mutex> lock(batch.mutex);
+
+    const auto now = TimeUtil::EpochNanos();
+    const auto event_type_code = static_cast<EventTypeCode>(event_type);
+    if (codec_ == Codec::kFixed) {
+      auto& table = batch.frames.template Append<FixedTable>(
+          event_type_code, ++seq_no_, now);
+      if (!table.Encode(request)) {
+        batch.frames.DropLast();
+        return false;
+      }
+    } else {
+      auto& builder = batch.builder;
+      batch.messages.push_back(CreateMessage(
+          builder, CreateHeader(builder, now, ++seq_no_, event_type_code),
+          fixed::BodyTypeOf<FixedTable>::value,
+          request.SerializeTo(builder).Union()));
+    }
+
+    if (batch.Count() == 1) {
+      batch.first_nanos = TimeUtil::MonotonicNanos();
+    }
+
+    if (batch.Count() >= batch_options_.max_batch) {
+      Flush(batch);
+    }
+    return true;
+  }
+
+  /**
+   * Answer a request as the orderbook answers one it refuses: a rejected
+   * execution report for a new order, a cancel reject otherwise.
+   */
+  template <typename Request>
+  auto Reject(const Request& request) -> void {
+    using CxlRejResponseTo = orderbook::data::CxlRejResponseTo;
+
+    EventData data{EmptyType()};
+    if constexpr (std::is_same_v<Request, NewOrderSingle>) {
+      ExecutionReport rejected(0, 0, request);
+      rejected.SetOrderStatus(orderbook::data::OrderStatus::kRejected);
+      data = rejected;
+      dispatcher_->dispatch(EventType::kOrderRejected, data);
+    } else {
+      data = OrderCancelReject(
+          0, request,
+          std::is_same_v<Request, OrderCancelReplaceRequest>
+              ? CxlRejResponseTo::kOrderCancelReplaceRequest
+              : CxlRejResponseTo::kOrderCancelRequest);
+      dispatcher_->dispatch(EventType::kOrderCancelRejected, data);
+    }
+  }
+
+  /**
+   * Send a batch as a single Message, or a MultiMessage when it holds more
+   * than one request. The caller holds the batch mutex.
+   */
+  auto Flush(OutboundBatch& batch) -> void {
+    using namespace orderbook::serialize;
+
+    if (batch.Count() == 0) {
+      return;
+    }
+
+    if (codec_ == Codec::kFixed) {
+      batch.frames.Finish(++seq_no_, TimeUtil::EpochNanos());
+      {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        socket_.SendFlatBuffer(batch.frames.Data(), batch.frames.Size());
+      }
+      batch.frames.Clear();
+      return;
+    }
+
+    auto& builder = batch.builder;
+    if (batch.messages.size() == 1) {
+      builder.Finish(batch.messages.front());
+    } else {
+      builder.Finish(CreateMultiMessage(
+          builder,
+          CreateHeader(builder, TimeUtil::EpochNanos(), ++seq_no_,
+                       EventTypeCode::MultiMessage),
+          builder.CreateVector(batch.messages)));
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(send_mutex_);
+      socket_.SendFlatBuffer(builder.GetBufferPointer(), builder.GetSize());
+    }
+
+    builder.Clear();
+    batch.messages.clear();
+  }
+
+  auto FlushAll() -> void {
+    std::lock_guard<std::mutex> lock(batches_mutex_);
+    for (auto& batch : batches_) {
+      std::lock_guard<std::mutex> batch_lock(batch->mutex);
+      Flush(*batch);
+    }
+  }
+
+  /**
+   * Deadline flusher, sends every batch whose oldest request has waited
+   * longer than the batch deadline.
+   */
+  auto FlushExpired() -> void {
+    const auto deadline = static_cast<TimeUtil::Timestamp>(
+        std::chrono::nanoseconds(batch_options_.deadline).count());
+
+    while (flushing_.load(std::memory_order_relaxed)) {
+      std::this_thread::sleep_for(batch_options_.deadline / 2);
+
+      const auto now = TimeUtil::MonotonicNanos();
+      std::lock_guard<std::mutex> lock(batches_mutex_);
+      for (auto& batch : batches_) {
+        std::lock_guard<std::mutex> batch_lock(batch->mutex);
+        if (batch->Count() > 0 && now - batch->first_nanos >= deadline) {
+          Flush(*batch);
+        }
+      }
+    }
+  }
+
   auto OnMessage(zmq::message_t&& msg) -> void {
-    const auto* flatc_msg = orderbook::serialize::GetMessage(msg.data());
+    if (!orderbook::data::IsFixedFrame(msg.data(), msg.size())) {
+      OnFrame<Codec::kFlatBuffers>(msg.data());
+    } else if (orderbook::data::VerifyFixedFrame(msg.data(), msg.size())) {
+      OnFrame<Codec::kFixed>(msg.data());
+    } else {
+      spdlog::warn("dropped malformed fixed layout frame, size {}",
+                   msg.size());
+    }
+  }
+
+  /**
+   * The orderbook coalesces every event for this client produced by one
+   * request into a MultiMessage. Both tables lead with the header, so the
+   * event_type is peeked through the Message accessor first.
+   */
+  template <Codec C>
+  auto OnFrame(const void* data) -> void {
+    using Traits = orderbook::data::CodecTraits<C>;
+
+    const auto* flatc_msg =
+        Traits::template GetRoot<typename Traits::Message>(data);
+    auto event_type = flatc_msg->header()->event_type();
+
+    if (event_type == orderbook::serialize::EventTypeCode::MultiMessage) {
+      const auto* multi_msg =
+          Traits::template GetRoot<typename Traits::MultiMessage>(data);
+      for (const auto* message : Traits::Messages(multi_msg)) {
+        OnMessage(message);
+      }
+    } else {
+      OnMessage(flatc_msg);
+    }
+  }
+
+  template <typename Message>
+  auto OnMessage(const Message* flatc_msg) -> void {
     auto event_type = flatc_msg->header()->event_type();
 
     if (event_type == orderbook::serialize::EventTypeCode::OrderPendingNew) {
@@ -204,12 +431,20 @@ class OrderbookClient {
     }
   }
 
+  const std::uint64_t client_id_{NextClientId()};
   EventDispatcherPtr dispatcher_;
   EventData data_;
   ClientSocket socket_;
   std::thread recv_thread_;
-  flatbuffers::FlatBufferBuilder builder{kBufferSize};
-  std::uint32_t seq_no_{0};
+
+  BatchOptions batch_options_;
+  Codec codec_;
+  std::mutex batches_mutex_;
+  std::vector<OutboundBatchPtr> batches_;
+  std::mutex send_mutex_;
+  std::atomic<std::uint32_t> seq_no_{0};
+  std::atomic<bool> flushing_{false};
+  std::thread flush_thread_;
 };
 
 }  // namespace orderbook::gateway
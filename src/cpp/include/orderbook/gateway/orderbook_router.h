@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "orderbook/gateway/orderbook_client.h"
+#include "orderbook/gateway/routing_table.h"
+
+namespace orderbook::gateway {
+
+/**
+ * Fans order requests out across several orderbook engines, each owning a
+ * slice of the instruments per the RoutingTable. Every engine has its own
+ * OrderbookClient, socket and receive thread behind a private dispatcher;
+ * the router listens for requests on the shared dispatcher and re-dispatches
+ * each to its engine. Replies from all engines are merged back onto the
+ * shared dispatcher one at a time, so the FIX application sees a single
+ * stream as with one engine. Cancel on disconnect goes to every engine.
+ */
+template <typename ClientSocket = orderbook::util::ClientSocketProvider>
+class OrderbookRouter {
+ private:
+  using EventType = orderbook::data::EventType;
+  using EventData = orderbook::data::EventData;
+  using EventCallback = orderbook::data::EventCallback;
+  using EventDispatcher = eventpp::EventDispatcher<EventType, EventCallback>;
+  using EventDispatcherPtr = std::shared_ptr<EventDispatcher>;
+  using NewOrderSingle = orderbook::data::NewOrderSingle;
+  using OrderCancelRequest = orderbook::data::OrderCancelRequest;
+  using OrderCancelReplaceRequest = orderbook::data::OrderCancelReplaceRequest;
+  using OrderbookClient = orderbook::gateway::OrderbookClient<ClientSocket>;
+  using Codec = orderbook::data::Codec;
+
+  static constexpr std::array kResponseTypes = {
+      EventType::kOrderNew,       EventType::kOrderPartiallyFilled,
+      EventType::kOrderFilled,    EventType::kOrderModified,
+      EventType::kOrderCancelled, EventType::kOrderRejected,
+      EventType::kOrderCancelRejected};
+
+  struct Engine {
+    Engine(const typename OrderbookClient::BatchOptions& batch_options,
+           const Codec& codec)
+        : dispatcher(std::make_shared<EventDispatcher>()),
+          client{dispatcher, batch_options, codec} {}
+
+    EventDispatcherPtr dispatcher;
+    OrderbookClient client;
+  };
+
+ public:
+  using BatchOptions = typename OrderbookClient::BatchOptions;
+
+  OrderbookRouter(EventDispatcherPtr dispatcher, RoutingTable routing_table,
+                  const BatchOptions& batch_options = {},
+                  const Codec& codec = Codec::kFlatBuffers)
+      : dispatcher_(std::move(dispatcher)),
+        routing_table_(std::move(routing_table)) {
+    for (std::size_t i = 0; i < routing_table_.Size(); ++i) {
+      engines_.push_back(std::make_unique<Engine>(batch_options, codec));
+
+      for (const auto& event_type : kResponseTypes) {
+        engines_.back()->dispatcher->appendListener(
+            event_type, [&, event_type](const EventData& data) {
+              std::lock_guard<std::mutex> lock(merge_mutex_);
+              dispatcher_->dispatch(event_type, data);
+            });
+      }
+    }
+
+    dispatcher_->appendListener(
+        EventType::kOrderPendingNew, [&](const EventData& data) {
+          Route(EventType::kOrderPendingNew,
+                std::get<NewOrderSingle>(data).GetInstrumentId(), data);
+        });
+
+    dispatcher_->appendListener(
+        EventType::kOrderPendingModify, [&](const EventData& data) {
+          Route(EventType::kOrderPendingModify,
+                std::get<OrderCancelReplaceRequest>(data).GetInstrumentId(),
+                data);
+        });
+
+    dispatcher_->appendListener(
+        EventType::kOrderPendingCancel, [&](const EventData& data) {
+          Route(EventType::kOrderPendingCancel,
+                std::get<OrderCancelRequest>(data).GetInstrumentId(), data);
+        });
+
+    dispatcher_->appendListener(
+        EventType::kCancelOnDisconnect, [&](const EventData& data) {
+          for (auto& engine : engines_) {
+            engine->dispatcher->dispatch(EventType::kCancelOnDisconnect, data);
+          }
+        });
+  }
+
+  auto Connect() -> void {
+    for (std::size_t i = 0; i < engines_.size(); ++i) {
+      spdlog::info("orderbook engine {}: {}", i,
+                   routing_table_.Addresses()[i]);
+      engines_[i]->client.Connect(routing_table_.Addresses()[i]);
+    }
+  }
+
+  auto ProcessMessages(const orderbook::util::ReceiveOptions& options = {})
+      -> void {
+    for (auto& engine : engines_) {
+      engine->client.ProcessMessages(options);
+    }
+  }
+
+  auto Close() -> void {
+    for (auto& engine : engines_) {
+      engine->client.Close();
+    }
+  }
+
+ private:
+  auto Route(const EventType& event_type,
+             const orderbook::data::InstrumentId& instrument_id,
+             const EventData& data) -> void {
+    const auto engine = routing_table_.EngineOf(instrument_id);
+    spdlog::debug("route instrument {} to engine {}", instrument_id, engine);
+    engines_[engine]->dispatcher->dispatch(event_type, data);
+  }
+
+  EventDispatcherPtr dispatcher_;
+  RoutingTable routing_table_;
+  std::vector<std::unique_ptr<Engine>> engines_;
+  std::mutex merge_mutex_;
+};
+}  // namespace orderbook::gateway
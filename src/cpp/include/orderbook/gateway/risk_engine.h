@@ -0,0 +1,474 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "orderbook/data/event_types.h"
+#include "orderbook/data/execution_report.h"
+#include "orderbook/data/new_order_single.h"
+#include "orderbook/data/order_cancel_replace_request.h"
+#include "orderbook/util/csv.h"
+#include "spdlog/spdlog.h"
+
+namespace orderbook::gateway {
+
+/**
+ * The pre-trade limits of an account. Notional is price times quantity, in
+ * Price units; position is net filled quantity, bought less sold.
+ */
+struct RiskLimits {
+  orderbook::data::Quantity max_order_quantity{
+      std::numeric_limits<orderbook::data::Quantity>::max()};
+  std::int64_t max_open_orders{std::numeric_limits<std::int64_t>::max()};
+  orderbook::data::ExecutedValue max_open_notional{
+      std::numeric_limits<orderbook::data::ExecutedValue>::max()};
+  std::int64_t max_position{std::numeric_limits<std::int64_t>::max()};
+};
+
+/**
+ * The limits file, CSV, one account per line:
+ *
+ *   account_id,max_order_quantity,max_open_orders,max_open_notional,
+ *   max_position
+ *
+ * An account_id of * gives the limits of every account without a line of
+ * its own; without one such accounts are rejected. Notionals are decimals.
+ * Blank lines, # comments and a header line starting with account_id are
+ * skipped.
+ */
+struct RiskConfig {
+  std::optional<RiskLimits> default_limits;
+  std::vector<std::pair<orderbook::data::AccountId, RiskLimits>> accounts;
+
+  static auto Load(const std::string& path) -> RiskConfig {
+    std::ifstream input(path);
+    if (!input) {
+      throw std::runtime_error("cannot open risk limits: " + path);
+    }
+
+    auto config = Parse(input);
+    spdlog::info("loaded risk limits of {} accounts from {}",
+                 config.accounts.size(), path);
+    return config;
+  }
+
+  /**
+   * Throws std::runtime_error, naming the line, for a malformed file.
+   */
+  static auto Parse(std::istream& input) -> RiskConfig {
+    RiskConfig config;
+    orderbook::util::ForEachCsvLine(
+        input, "account_id",
+        [&](std::string_view line, const std::size_t& line_no) {
+          if (!ParseLine(line, config)) {
+            throw std::runtime_error("bad risk limits, line " +
+                                     std::to_string(line_no) + ": " +
+                                     std::string(line));
+          }
+        });
+    return config;
+  }
+
+ private:
+  static auto ParseLine(std::string_view line, RiskConfig& config) -> bool {
+    using orderbook::util::ParseInteger;
+
+    const auto fields = orderbook::util::SplitCsv(line);
+    RiskLimits limits;
+    if (fields.size() != 5 ||
+        !ParseInteger(fields[1], limits.max_order_quantity) ||
+        !ParseInteger(fields[2], limits.max_open_orders) ||
+        !orderbook::data::ToPrice(fields[3], limits.max_open_notional) ||
+        !ParseInteger(fields[4], limits.max_position) ||
+        limits.max_order_quantity < 0 || limits.max_open_orders < 0 ||
+        limits.max_open_notional < 0 || limits.max_position < 0) {
+      return false;
+    }
+
+    if (fields[0] == "*") {
+      config.default_limits = limits;
+      return true;
+    }
+
+    orderbook::data::AccountId account_id{0};
+    if (!ParseInteger(fields[0], account_id)) {
+      return false;
+    }
+    config.accounts.emplace_back(account_id, limits);
+    return true;
+  }
+};
+
+/**
+ * Pre-trade risk for the gateway: per account open notional, open order
+ * count and net position, checked inline before a new order or a replace is
+ * sent to the orderbook. Accounts live in a flat array indexed by account
+ * id, one cache line each, holding the account's limits and its counters as
+ * atomics; a check is a handful of relaxed atomic operations on that one
+ * line, taking no lock, so the FIX session threads and the thread reading
+ * orderbook responses never wait on each other.
+ *
+ * A new order reserves its notional and an open order slot when it is
+ * accepted, backed out if it is rejected downstream. Execution reports then
+ * move the counters: fills release notional and move the position, and
+ * cancels and rejects release what the order still held. A replace is
+ * checked as if it swapped what the order holds for its new notional, and
+ * the difference is applied from the replace's execution report. Cancel on
+ * disconnect needs nothing of its own: the orderbook reports every order
+ * it removes as cancelled, including ones acknowledged after the session
+ * logged out.
+ *
+ * The per order bookkeeping behind the execution reports is only touched
+ * on the response path, under a mutex. A check reads what an order holds
+ * from a fixed table of seqlocked slots instead, see Held.
+ */
+class RiskEngine {
+ private:
+  using AccountId = orderbook::data::AccountId;
+  using ExecutedValue = orderbook::data::ExecutedValue;
+  using ExecutionReport = orderbook::data::ExecutionReport;
+  using EventType = orderbook::data::EventType;
+  using InstrumentId = orderbook::data::InstrumentId;
+  using OrderId = orderbook::data::OrderId;
+  using Price = orderbook::data::Price;
+  using Quantity = orderbook::data::Quantity;
+
+  struct alignas(64) Account {
+    RiskLimits limits;
+    bool enabled{false};
+    std::atomic<ExecutedValue> open_notional{0};
+    std::atomic<std::int64_t> open_orders{0};
+    std::atomic<std::int64_t> position{0};
+  };
+
+  struct OpenOrder {
+    ExecutedValue notional{0};
+  };
+
+  /**
+   * What one open order holds, readable without the orders mutex. The
+   * sequence is odd while the response path rewrites the slot.
+   */
+  struct OrderSlot {
+    std::atomic<std::uint32_t> seq{0};
+    std::atomic<InstrumentId> instrument_id{0};
+    std::atomic<OrderId> order_id{0};
+    std::atomic<ExecutedValue> held{0};
+  };
+
+  /**
+   * Order ids are only unique within an orderbook, and each instrument
+   * trades on one orderbook.
+   */
+  using OrderKey = std::pair<InstrumentId, OrderId>;
+
+  struct OrderKeyHash {
+    auto operator()(const OrderKey& key) const -> std::size_t {
+      return std::hash<OrderId>{}(key.second ^ (key.first << 40U));
+    }
+  };
+
+ public:
+  enum class Result : std::uint8_t {
+    kAccepted,
+    kUnknownAccount,
+    kOrderQuantity,
+    kOpenOrders,
+    kOpenNotional,
+    kPosition
+  };
+
+  /**
+   * Account ids index the flat array, keep them below this bound.
+   */
+  constexpr static AccountId kMaxAccountId = 1U << 16U;
+
+  /**
+   * Open orders share the held notional slots by key hash, a power of two.
+   */
+  constexpr static std::size_t kOrderSlots = 1U << 16U;
+
+  explicit RiskEngine(const RiskConfig& config)
+      : accounts_(std::make_unique<Account[]>(kMaxAccountId)),
+        order_slots_(std::make_unique<OrderSlot[]>(kOrderSlots)) {
+    if (config.default_limits.has_value()) {
+      for (AccountId id = 0; id < kMaxAccountId; ++id) {
+        accounts_[id].limits = *config.default_limits;
+        accounts_[id].enabled = true;
+      }
+    }
+
+    for (const auto& [account_id, limits] : config.accounts) {
+      if (account_id >= kMaxAccountId) {
+        throw std::runtime_error("risk limits account id out of range: " +
+                                 std::to_string(account_id));
+      }
+      accounts_[account_id].limits = limits;
+      accounts_[account_id].enabled = true;
+    }
+  }
+
+  /**
+   * Check a new order, reserving its notional and an open order slot if it
+   * is accepted.
+   */
+  auto Check(const orderbook::data::NewOrderSingle& order) -> Result {
+    auto* account = Find(order.GetAccountId());
+    if (account == nullptr) [[unlikely]] {
+      return Result::kUnknownAccount;
+    }
+
+    const auto& limits = account->limits;
+    const auto& quantity = order.GetOrderQuantity();
+    if (quantity > limits.max_order_quantity) {
+      return Result::kOrderQuantity;
+    }
+    if (!WithinPosition(*account, order.IsBuyOrder(), quantity)) {
+      return Result::kPosition;
+    }
+
+    if (account->open_orders.fetch_add(1, std::memory_order_relaxed) >=
+        limits.max_open_orders) {
+      account->open_orders.fetch_sub(1, std::memory_order_relaxed);
+      return Result::kOpenOrders;
+    }
+
+    const auto notional = Notional(order.GetOrderPrice(), quantity);
+    if (account->open_notional.fetch_add(notional,
+                                         std::memory_order_relaxed) >
+        limits.max_open_notional - notional) {
+      account->open_notional.fetch_sub(notional, std::memory_order_relaxed);
+      account->open_orders.fetch_sub(1, std::memory_order_relaxed);
+      return Result::kOpenNotional;
+    }
+
+    return Result::kAccepted;
+  }
+
+  /**
+   * Check a replace, reserving nothing. The order's new notional replaces
+   * what it holds now, or adds to the open notional when that is not known.
+   */
+  auto Check(const orderbook::data::OrderCancelReplaceRequest& modify)
+      -> Result {
+    const auto* account = Find(modify.GetAccountId());
+    if (account == nullptr) [[unlikely]] {
+      return Result::kUnknownAccount;
+    }
+
+    const auto& limits = account->limits;
+    const auto& quantity = modify.GetOrderQuantity();
+    if (quantity > limits.max_order_quantity) {
+      return Result::kOrderQuantity;
+    }
+    if (!WithinPosition(*account, modify.IsBuyOrder(), quantity)) {
+      return Result::kPosition;
+    }
+
+    const auto notional = Notional(modify.GetOrderPrice(), quantity);
+    const auto held = Held({modify.GetInstrumentId(), modify.GetOrderId()});
+    if (account->open_notional.load(std::memory_order_relaxed) - held >
+        limits.max_open_notional - notional) {
+      return Result::kOpenNotional;
+    }
+
+    return Result::kAccepted;
+  }
+
+  /**
+   * Apply an orderbook execution report to its account's counters.
+   */
+  auto OnExecutionReport(const EventType& event_type,
+                         const ExecutionReport& exec_rpt) -> void {
+    auto* account = Find(exec_rpt.GetAccountId());
+    if (account == nullptr) {
+      return;
+    }
+
+    const auto notional =
+        Notional(exec_rpt.GetOrderPrice(), exec_rpt.GetLeavesQuantity());
+
+    std::lock_guard<std::mutex> lock(orders_mutex_);
+    switch (event_type) {
+      case EventType::kOrderNew: {
+        // the reservation was for the full order quantity
+        account->open_notional.fetch_add(
+            notional - Notional(exec_rpt.GetOrderPrice(),
+                                exec_rpt.GetOrderQuantity()),
+            std::memory_order_relaxed);
+        open_orders_[KeyOf(exec_rpt)] = OpenOrder{notional};
+        Publish(KeyOf(exec_rpt), notional);
+        break;
+      }
+      case EventType::kOrderRejected:
+        account->open_notional.fetch_sub(
+            Notional(exec_rpt.GetOrderPrice(), exec_rpt.GetOrderQuantity()),
+            std::memory_order_relaxed);
+        account->open_orders.fetch_sub(1, std::memory_order_relaxed);
+        break;
+      case EventType::kOrderPartiallyFilled:
+      case EventType::kOrderFilled: {
+        const auto& last_quantity = exec_rpt.GetLastQuantity();
+        account->position.fetch_add(
+            exec_rpt.IsBuyOrder() ? last_quantity : -last_quantity,
+            std::memory_order_relaxed);
+        Update(*account, KeyOf(exec_rpt), notional,
+               event_type == EventType::kOrderFilled);
+        break;
+      }
+      case EventType::kOrderModified:
+        Update(*account, KeyOf(exec_rpt), notional, false);
+        break;
+      case EventType::kOrderCancelled:
+        Update(*account, KeyOf(exec_rpt), 0, true);
+        break;
+      default:
+        break;
+    }
+  }
+
+  auto OpenNotional(const AccountId& account_id) const -> ExecutedValue {
+    return accounts_[account_id].open_notional.load(std::memory_order_relaxed);
+  }
+
+  auto OpenOrders(const AccountId& account_id) const -> std::int64_t {
+    return accounts_[account_id].open_orders.load(std::memory_order_relaxed);
+  }
+
+  auto Position(const AccountId& account_id) const -> std::int64_t {
+    return accounts_[account_id].position.load(std::memory_order_relaxed);
+  }
+
+  static auto ToString(const Result& result) -> std::string_view {
+    switch (result) {
+      case Result::kAccepted:
+        return "accepted";
+      case Result::kUnknownAccount:
+        return "unknown account";
+      case Result::kOrderQuantity:
+        return "order quantity limit";
+      case Result::kOpenOrders:
+        return "open order limit";
+      case Result::kOpenNotional:
+        return "open notional limit";
+      case Result::kPosition:
+        return "position limit";
+      default:
+        return "unknown";
+    }
+  }
+
+ private:
+  auto Find(const AccountId& account_id) const -> Account* {
+    if (account_id >= kMaxAccountId || !accounts_[account_id].enabled) {
+      return nullptr;
+    }
+    return &accounts_[account_id];
+  }
+
+  /**
+   * The net position, were the order to fill in full.
+   */
+  static auto WithinPosition(const Account& account, const bool buy,
+                             const Quantity& quantity) -> bool {
+    const auto position = account.position.load(std::memory_order_relaxed);
+    const auto projected = buy ? position + quantity : position - quantity;
+    return projected <= account.limits.max_position &&
+           -projected <= account.limits.max_position;
+  }
+
+  static auto KeyOf(const ExecutionReport& exec_rpt) -> OrderKey {
+    return {exec_rpt.GetInstrumentId(), exec_rpt.GetOrderId()};
+  }
+
+  static auto Notional(const Price& price, const Quantity& quantity)
+      -> ExecutedValue {
+    return (price < 0 ? -price : price) * quantity;
+  }
+
+  auto SlotOf(const OrderKey& key) const -> OrderSlot& {
+    return order_slots_[OrderKeyHash{}(key) & (kOrderSlots - 1)];
+  }
+
+  /**
+   * The notional an open order holds, 0 if its slot has since been taken
+   * by another order or is being rewritten.
+   */
+  auto Held(const OrderKey& key) const -> ExecutedValue {
+    const auto& slot = SlotOf(key);
+    const auto seq = slot.seq.load(std::memory_order_acquire);
+    const auto instrument_id =
+        slot.instrument_id.load(std::memory_order_relaxed);
+    const auto order_id = slot.order_id.load(std::memory_order_relaxed);
+    const auto held = slot.held.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if ((seq & 1U) != 0 ||
+        slot.seq.load(std::memory_order_relaxed) != seq ||
+        OrderKey{instrument_id, order_id} != key) {
+      return 0;
+    }
+    return held;
+  }
+
+  /**
+   * Record what an open order holds in its slot, taking the slot over from
+   * any other order. The caller holds the orders mutex.
+   */
+  auto Publish(const OrderKey& key, const ExecutedValue& held) -> void {
+    auto& slot = SlotOf(key);
+    const auto seq = slot.seq.load(std::memory_order_relaxed);
+    slot.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.instrument_id.store(key.first, std::memory_order_relaxed);
+    slot.order_id.store(key.second, std::memory_order_relaxed);
+    slot.held.store(held, std::memory_order_relaxed);
+    slot.seq.store(seq + 2, std::memory_order_release);
+  }
+
+  /**
+   * Move an open order's held notional to notional, releasing the order
+   * once done. Orders the gateway did not see open are ignored.
+   */
+  auto Update(Account& account, const OrderKey& key,
+              const ExecutedValue& notional, const bool done) -> void {
+    const auto it = open_orders_.find(key);
+    if (it == open_orders_.end()) {
+      return;
+    }
+
+    account.open_notional.fetch_add(notional - it->second.notional,
+                                    std::memory_order_relaxed);
+    if (done) {
+      account.open_orders.fetch_sub(1, std::memory_order_relaxed);
+      open_orders_.erase(it);
+    } else {
+      it->second.notional = notional;
+    }
+
+    // a slot taken over by another order is left to that order
+    const auto& slot = SlotOf(key);
+    if (slot.instrument_id.load(std::memory_order_relaxed) == key.first &&
+        slot.order_id.load(std::memory_order_relaxed) == key.second) {
+      Publish(key, done ? 0 : notional);
+    }
+  }
+
+  std::unique_ptr<Account[]> accounts_;
+  std::unique_ptr<OrderSlot[]> order_slots_;
+  std::mutex orders_mutex_;
+  std::unordered_map<OrderKey, OpenOrder, OrderKeyHash> open_orders_;
+};
+}  // namespace orderbook::gateway
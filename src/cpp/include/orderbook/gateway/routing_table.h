@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "orderbook/data/data_types.h"
+
+namespace orderbook::gateway {
+
+/**
+ * Maps instruments to orderbook engines. Built from a comma separated
+ * spec, each entry is either
+ *
+ *   FIRST-LAST=ADDR  - the inclusive instrument range FIRST..LAST
+ *   ADDR             - a hashed engine
+ *
+ * An instrument inside a range goes to that range's engine, any other
+ * instrument is hashed across the hashed engines (or, when there are none,
+ * across every engine). An address listed more than once is one engine,
+ * so a single engine may own several ranges. A single address is the
+ * unsharded case.
+ */
+class RoutingTable {
+ private:
+  using InstrumentId = orderbook::data::InstrumentId;
+
+  struct Range {
+    InstrumentId first;
+    InstrumentId last;
+    std::size_t engine;
+  };
+
+ public:
+  /**
+   * Throws std::invalid_argument for a malformed spec or overlapping
+   * ranges.
+   */
+  static auto Parse(std::string_view spec) -> RoutingTable {
+    RoutingTable table;
+
+    for (;;) {
+      const auto comma = spec.find(',');
+      table.AddEntry(spec.substr(0, comma));
+      if (comma == std::string_view::npos) {
+        break;
+      }
+      spec.remove_prefix(comma + 1);
+    }
+
+    std::sort(table.ranges_.begin(), table.ranges_.end(),
+              [](const auto& lhs, const auto& rhs) {
+                return lhs.first < rhs.first;
+              });
+    for (std::size_t i = 1; i < table.ranges_.size(); ++i) {
+      if (table.ranges_[i].first <= table.ranges_[i - 1].last) {
+        throw std::invalid_argument("overlapping instrument ranges");
+      }
+    }
+
+    return table;
+  }
+
+  /**
+   * The index, into Addresses(), of the engine owning instrument_id.
+   */
+  auto EngineOf(const InstrumentId& instrument_id) const -> std::size_t {
+    const auto iter = std::upper_bound(
+        ranges_.begin(), ranges_.end(), instrument_id,
+        [](const auto& id, const auto& range) { return id < range.first; });
+    if (iter != ranges_.begin() && instrument_id <= std::prev(iter)->last) {
+      return std::prev(iter)->engine;
+    }
+
+    if (hashed_.empty()) {
+      return instrument_id % addrs_.size();
+    }
+    return hashed_[instrument_id % hashed_.size()];
+  }
+
+  auto Addresses() const -> const std::vector<std::string>& { return addrs_; }
+  auto Size() const -> std::size_t { return addrs_.size(); }
+
+ private:
+  RoutingTable() = default;
+
+  auto AddEntry(std::string_view entry) -> void {
+    const auto equals = entry.find('=');
+    if (equals == std::string_view::npos) {
+      const auto engine = EngineFor(entry);
+      if (std::find(hashed_.begin(), hashed_.end(), engine) == hashed_.end()) {
+        hashed_.push_back(engine);
+      }
+      return;
+    }
+
+    const auto range = entry.substr(0, equals);
+    const auto dash = range.find('-');
+    if (dash == std::string_view::npos) {
+      throw std::invalid_argument("bad instrument range: " +
+                                  std::string(entry));
+    }
+
+    const auto first = ToInstrumentId(range.substr(0, dash));
+    const auto last = ToInstrumentId(range.substr(dash + 1));
+    if (last < first) {
+      throw std::invalid_argument("empty instrument range: " +
+                                  std::string(entry));
+    }
+
+    ranges_.push_back(Range{first, last, EngineFor(entry.substr(equals + 1))});
+  }
+
+  auto EngineFor(std::string_view addr) -> std::size_t {
+    if (addr.empty()) {
+      throw std::invalid_argument("empty orderbook address");
+    }
+
+    const auto iter = std::find(addrs_.begin(), addrs_.end(), addr);
+    if (iter != addrs_.end()) {
+      return static_cast<std::size_t>(iter - addrs_.begin());
+    }
+
+    addrs_.emplace_back(addr);
+    return addrs_.size() - 1;
+  }
+
+  static auto ToInstrumentId(std::string_view str) -> InstrumentId {
+    InstrumentId instrument_id{0};
+    const auto* last = str.data() + str.size();
+    const auto [ptr, ec] = std::from_chars(str.data(), last, instrument_id);
+    if (ec != std::errc{} || ptr != last) {
+      throw std::invalid_argument("bad instrument id: " + std::string(str));
+    }
+    return instrument_id;
+  }
+
+  std::vector<std::string> addrs_;
+  std::vector<Range> ranges_;
+  std::vector<std::size_t> hashed_;
+};
+}  // namespace orderbook::gateway
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "orderbook/data/data_types.h"
+#include "orderbook/gateway/risk_engine.h"
+
+namespace orderbook::gateway {
+
+/**
+ * A message rate: rate messages a second on average, and up to burst at
+ * once, a burst of zero meaning a second's worth. A rate of zero is
+ * unlimited.
+ */
+struct ThrottleLimits {
+  std::uint32_t rate{0};
+  std::uint32_t burst{0};
+};
+
+/**
+ * A token bucket, kept in its virtual scheduling form: rather than a token
+ * count refilled from the clock, the bucket holds the time it would next
+ * be full were tokens not taken. A message is let through while that time
+ * is no more than burst - 1 intervals ahead of now, and pushes it one
+ * interval further. Integer nanoseconds throughout, two compares and an
+ * add per message, with no division.
+ */
+class TokenBucket {
+ private:
+  using Timestamp = orderbook::data::Timestamp;
+
+  static constexpr Timestamp kNanosPerSecond = 1000000000;
+
+ public:
+  TokenBucket() = default;
+
+  explicit TokenBucket(const ThrottleLimits& limits)
+      : interval_(limits.rate == 0 ? 0 : kNanosPerSecond / limits.rate),
+        tolerance_(interval_ * (BurstOf(limits) - 1)) {}
+
+  auto TryAcquire(const Timestamp& now) -> bool {
+    if (!CanAcquire(now)) {
+      return false;
+    }
+    Acquire(now);
+    return true;
+  }
+
+  /**
+   * True if a token could be taken now, taking nothing.
+   */
+  auto CanAcquire(const Timestamp& now) const -> bool {
+    return interval_ == 0 || std::max(full_, now) - now <= tolerance_;
+  }
+
+  auto Acquire(const Timestamp& now) -> void {
+    if (interval_ != 0) {
+      full_ = std::max(full_, now) + interval_;
+    }
+  }
+
+ private:
+  static auto BurstOf(const ThrottleLimits& limits) -> Timestamp {
+    return std::max(limits.burst == 0 ? limits.rate : limits.burst, 1U);
+  }
+
+  Timestamp interval_{0};
+  Timestamp tolerance_{0};
+  Timestamp full_{0};
+};
+
+/**
+ * The gateway's message rate limits, one token bucket per FIX session and
+ * one per account, so neither a flooding session nor an account spread
+ * over sessions can starve the others at the orderbook. A message must
+ * pass both, and takes a token from each only if it does. The account
+ * buckets are a flat array indexed by account id, bounded like the risk
+ * engine's accounts, so no client supplied id grows the table. Used from
+ * the FIX session thread only.
+ */
+class Throttle {
+ private:
+  using AccountId = orderbook::data::AccountId;
+  using SessionId = orderbook::data::SessionId;
+  using Timestamp = orderbook::data::Timestamp;
+
+ public:
+  Throttle() = default;
+
+  static constexpr AccountId kMaxAccountId = RiskEngine::kMaxAccountId;
+
+  explicit Throttle(const ThrottleLimits& account_limits)
+      : accounts_(account_limits.rate == 0 ? 0 : kMaxAccountId,
+                  TokenBucket(account_limits)) {}
+
+  auto AddSession(const SessionId& session_id, const ThrottleLimits& limits)
+      -> void {
+    sessions_.insert_or_assign(session_id, TokenBucket(limits));
+  }
+
+  auto RemoveSession(const SessionId& session_id) -> void {
+    sessions_.erase(session_id);
+  }
+
+  /**
+   * Take a token from the session's and the account's buckets, false,
+   * taking neither, if either is empty. Sessions not added are not
+   * limited; with account limits, accounts from kMaxAccountId up are
+   * refused.
+   */
+  auto TryAcquire(const SessionId& session_id, const AccountId& account_id,
+                  const Timestamp& now) -> bool {
+    TokenBucket* account{nullptr};
+    if (!accounts_.empty()) {
+      if (account_id >= accounts_.size()) {
+        return false;
+      }
+      account = &accounts_[account_id];
+      if (!account->CanAcquire(now)) {
+        return false;
+      }
+    }
+
+    const auto session = sessions_.find(session_id);
+    if (session != sessions_.end() && !session->second.TryAcquire(now)) {
+      return false;
+    }
+
+    if (account != nullptr) {
+      account->Acquire(now);
+    }
+    return true;
+  }
+
+ private:
+  std::unordered_map<SessionId, TokenBucket> sessions_;
+  std::vector<TokenBucket> accounts_;
+};
+}  // namespace orderbook::gateway
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "flatbuffers/flatbuffers.h"
+#include "orderbook/util/thread_util.h"
+
+namespace orderbook::util {
+
+/**
+ * A flatbuffers allocator over a fixed, preallocated arena. The builder
+ * writes back to front, so a message is built from the end of the arena
+ * towards its start. Buffers larger than the arena fall back to the heap.
+ */
+class ArenaAllocator : public flatbuffers::Allocator {
+ public:
+  ArenaAllocator(std::uint8_t* arena, const std::size_t& arena_size)
+      : arena_(arena), arena_size_(arena_size) {}
+
+  auto allocate(std::size_t size) -> std::uint8_t* override {
+    if (!arena_in_use_ && size <= arena_size_) {
+      arena_in_use_ = true;
+      return arena_;
+    }
+
+    ++heap_count_;
+    return new std::uint8_t[size];
+  }
+
+  auto deallocate(std::uint8_t* ptr, std::size_t /*size*/) -> void override {
+    if (ptr == arena_) {
+      arena_in_use_ = false;
+    } else {
+      delete[] ptr;
+    }
+  }
+
+  auto ArenaInUse() const -> bool { return arena_in_use_; }
+  auto HeapCount() const -> std::uint64_t { return heap_count_; }
+
+ private:
+  std::uint8_t* arena_;
+  std::size_t arena_size_;
+  bool arena_in_use_{false};
+  std::uint64_t heap_count_{0};
+};
+
+/**
+ * A fixed ring of flatbuffer builders, each building into its own
+ * preallocated arena. A finished buffer is handed to zmq as is and its
+ * builder stays in flight until zmq calls OnSent, which may happen on a
+ * zmq I/O thread. Acquire must only be called from a single thread; when
+ * the next builder is still in flight it spins until zmq releases it.
+ */
+template <std::size_t PoolSize, std::size_t BufferSize>
+class BuilderPool {
+ public:
+  class PooledBuilder {
+   public:
+    PooledBuilder()
+        : allocator_(arena_.data(), arena_.size()),
+          builder_(BufferSize, &allocator_) {}
+
+    PooledBuilder(const PooledBuilder&) = delete;
+    PooledBuilder(PooledBuilder&&) = delete;
+    auto operator=(const PooledBuilder&) -> PooledBuilder& = delete;
+    auto operator=(PooledBuilder&&) -> PooledBuilder& = delete;
+    ~PooledBuilder() = default;
+
+    auto Builder() -> flatbuffers::FlatBufferBuilder& { return builder_; }
+    auto Data() const -> std::uint8_t* { return builder_.GetBufferPointer(); }
+    auto Size() const -> std::size_t { return builder_.GetSize(); }
+    auto GetAllocator() const -> const ArenaAllocator& { return allocator_; }
+    auto InFlight() const -> bool {
+      return in_flight_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Return the builder to the pool without sending it.
+     */
+    auto Release() -> void {
+      in_flight_.store(false, std::memory_order_release);
+    }
+
+    /**
+     * zmq free callback, hint is the PooledBuilder that owns the data.
+     */
+    static auto OnSent(void* /*data*/, void* hint) -> void {
+      static_cast<PooledBuilder*>(hint)->Release();
+    }
+
+   private:
+    friend class BuilderPool;
+
+    alignas(64) std::array<std::uint8_t, BufferSize> arena_;
+    ArenaAllocator allocator_;
+    flatbuffers::FlatBufferBuilder builder_;
+    alignas(64) std::atomic<bool> in_flight_{false};
+  };
+
+  BuilderPool() : slots_(std::make_unique<Slots>()) {}
+
+  /**
+   * Take the next builder in the ring, cleared and ready to build into.
+   */
+  auto Acquire() -> PooledBuilder& {
+    auto& slot = (*slots_)[cursor_];
+    cursor_ = (cursor_ + 1) % PoolSize;
+
+    if (slot.InFlight()) {
+      ++exhausted_count_;
+      while (slot.InFlight()) {
+        ThreadUtil::Pause();
+      }
+    }
+
+    slot.builder_.Clear();
+    slot.in_flight_.store(true, std::memory_order_relaxed);
+    return slot;
+  }
+
+  auto ExhaustedCount() const -> std::uint64_t { return exhausted_count_; }
+
+  static constexpr auto Capacity() -> std::size_t { return PoolSize; }
+
+ private:
+  using Slots = std::array<PooledBuilder, PoolSize>;
+
+  std::unique_ptr<Slots> slots_;
+  std::size_t cursor_{0};
+  std::uint64_t exhausted_count_{0};
+};
+}  // namespace orderbook::util
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace orderbook::util {
+
+/**
+ * Parse the whole of str as a decimal integer. False, leaving value
+ * untouched, for an empty string or any trailing characters.
+ */
+template <typename Integer>
+inline auto ParseInteger(std::string_view str, Integer& value) -> bool {
+  Integer parsed{0};
+  const auto* last = str.data() + str.size();
+  const auto [ptr, ec] = std::from_chars(str.data(), last, parsed);
+  if (ec != std::errc{} || ptr != last || str.empty()) {
+    return false;
+  }
+  value = parsed;
+  return true;
+}
+
+/**
+ * The comma separated fields of a line, viewing into it. No quoting.
+ */
+inline auto SplitCsv(std::string_view line) -> std::vector<std::string_view> {
+  std::vector<std::string_view> fields;
+  while (true) {
+    const auto comma = line.find(',');
+    fields.push_back(line.substr(0, comma));
+    if (comma == std::string_view::npos) {
+      return fields;
+    }
+    line.remove_prefix(comma + 1);
+  }
+}
+
+/**
+ * Call on_line(line, line_no) for each data line of a CSV file. CRLF line
+ * ends are trimmed; blank lines, # comments and a header line starting
+ * with header are skipped.
+ */
+template <typename OnLine>
+inline auto ForEachCsvLine(std::istream& input, std::string_view header,
+                           OnLine&& on_line) -> void {
+  std::string line;
+  std::size_t line_no{0};
+  while (std::getline(input, line)) {
+    ++line_no;
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.empty() || line.front() == '#' || line.starts_with(header)) {
+      continue;
+    }
+    on_line(std::string_view(line), line_no);
+  }
+}
+}  // namespace orderbook::util
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace orderbook::util {
+
+/**
+ * Fixed capacity, trivially copyable string. Assigning a longer string
+ * truncates it to Capacity characters.
+ */
+template <std::size_t Capacity>
+class FixedString {
+ private:
+  static_assert(Capacity <= UINT8_MAX, "FixedString capacity exceeds 255");
+
+ public:
+  FixedString() = default;
+  FixedString(std::string_view str) { Assign(str); }  // NOLINT
+
+  auto Assign(std::string_view str) -> void {
+    length_ = static_cast<std::uint8_t>(std::min(str.size(), Capacity));
+    std::memcpy(data_.data(), str.data(), length_);
+  }
+
+  auto View() const -> std::string_view { return {data_.data(), length_}; }
+  auto Size() const -> std::size_t { return length_; }
+  auto Empty() const -> bool { return length_ == 0; }
+
+  static constexpr auto MaxSize() -> std::size_t { return Capacity; }
+
+ private:
+  std::uint8_t length_{0};
+  std::array<char, Capacity> data_;
+};
+}  // namespace orderbook::util
@@ -0,0 +1,431 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "spdlog/spdlog.h"
+
+/**
+ * Write-ahead journal of the orderbook's inbound messages. The journal is a
+ * directory of segment files, journal.00000000, journal.00000001 and so on,
+ * each preallocated to a fixed size and mapped into memory, so appending a
+ * message is a copy into the page cache and a message survives the process
+ * dying as soon as it is appended. Segments are flushed to disk with a
+ * batched asynchronous msync, and synchronously when a segment is full or
+ * the journal is closed.
+ *
+ * Each record is a 16 byte header, payload length, routing id and journal
+ * sequence number, followed by the message bytes as received, padded to 8
+ * bytes. The length is stored last, so a record torn by a crash reads as
+ * the end of the segment; the unused tail of a segment is zero and reads
+ * the same way.
+ */
+
+namespace orderbook::util {
+
+/**
+ * record - append every inbound message to the journal.
+ * recover - replay the journal to rebuild the books, then serve and append.
+ * replay  - replay the journal at full speed and exit, for benchmarking.
+ */
+enum class JournalMode : std::uint8_t { kRecord, kRecover, kReplay };
+
+inline auto ToJournalMode(std::string_view name) -> JournalMode {
+  if (name == "recover") {
+    return JournalMode::kRecover;
+  }
+  if (name == "replay") {
+    return JournalMode::kReplay;
+  }
+  if (name != "record") {
+    spdlog::warn("unknown journal mode {}, using record", name);
+  }
+  return JournalMode::kRecord;
+}
+
+struct JournalOptions {
+  static constexpr std::size_t kDefaultSegmentSize = 64UL << 20;
+  static constexpr std::size_t kDefaultSyncBytes = 1UL << 20;
+
+  std::string dir;  // no journal when empty
+  JournalMode mode{JournalMode::kRecord};
+  std::size_t segment_size{kDefaultSegmentSize};
+  std::size_t sync_bytes{kDefaultSyncBytes};  // written between msyncs
+  std::chrono::seconds checkpoint_interval{0};  // no checkpoints when zero
+};
+
+struct JournalRecordHeader {
+  std::uint32_t length;
+  std::uint32_t routing_id;
+  std::uint64_t sequence;
+};
+
+namespace internal {
+constexpr std::size_t kJournalAlignment = 8;
+
+constexpr auto JournalRecordSize(const std::size_t& length) -> std::size_t {
+  return (sizeof(JournalRecordHeader) + length + kJournalAlignment - 1) &
+         ~(kJournalAlignment - 1);
+}
+
+inline auto SegmentPath(const std::string& dir, const std::uint32_t& index)
+    -> std::string {
+  const auto number = std::to_string(index);
+  return dir + "/journal." +
+         std::string(8 - std::min<std::size_t>(8, number.size()), '0') +
+         number;
+}
+
+inline auto SegmentIndex(const std::string& path) -> std::uint32_t {
+  const auto name = std::filesystem::path(path).filename().string();
+  return static_cast<std::uint32_t>(
+      std::stoul(name.substr(name.find('.') + 1)));
+}
+
+/**
+ * The segment files of dir, in order.
+ */
+inline auto SegmentPaths(const std::string& dir) -> std::vector<std::string> {
+  std::vector<std::string> paths;
+  if (!std::filesystem::is_directory(dir)) {
+    return paths;
+  }
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    const auto name = entry.path().filename().string();
+    if (entry.is_regular_file() && name.starts_with("journal.")) {
+      paths.push_back(entry.path().string());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+/**
+ * Owns the mapping of one segment file.
+ */
+class SegmentMapping {
+ public:
+  SegmentMapping() = default;
+  SegmentMapping(const SegmentMapping&) = delete;
+  SegmentMapping(SegmentMapping&&) = delete;
+  auto operator=(const SegmentMapping&) -> SegmentMapping& = delete;
+  auto operator=(SegmentMapping&&) -> SegmentMapping& = delete;
+  ~SegmentMapping() { Unmap(); }
+
+  /**
+   * Create and preallocate a segment of size bytes, mapped for writing.
+   */
+  auto Create(const std::string& path, const std::size_t& size) -> void {
+    const int fd = ::open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+      throw std::runtime_error("open(" + path +
+                               ") failed: " + std::strerror(errno));
+    }
+
+    if (::posix_fallocate(fd, 0, static_cast<off_t>(size)) != 0) {
+      ::close(fd);
+      throw std::runtime_error("posix_fallocate(" + path + ") failed");
+    }
+
+    Map(fd, path, size, PROT_READ | PROT_WRITE);
+  }
+
+  /**
+   * Map an existing segment for reading.
+   */
+  auto Open(const std::string& path) -> void {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("open(" + path +
+                               ") failed: " + std::strerror(errno));
+    }
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw std::runtime_error("fstat(" + path +
+                               ") failed: " + std::strerror(errno));
+    }
+
+    Map(fd, path, static_cast<std::size_t>(st.st_size), PROT_READ);
+  }
+
+  /**
+   * Flush [offset, offset + length) to disk, rounded out to whole pages.
+   */
+  auto Sync(const std::size_t& offset, const std::size_t& length,
+            const int flags) -> void {
+    static const auto kPageSize =
+        static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+
+    const auto start = offset & ~(kPageSize - 1);
+    if (::msync(data_ + start, offset + length - start, flags) != 0) {
+      spdlog::error("msync failed: {}", std::strerror(errno));
+    }
+  }
+
+  auto Unmap() -> void {
+    if (data_ != nullptr) {
+      ::munmap(data_, size_);
+      data_ = nullptr;
+      size_ = 0;
+    }
+  }
+
+  auto Data() const -> std::uint8_t* { return data_; }
+  auto Size() const -> std::size_t { return size_; }
+
+ private:
+  auto Map(const int fd, const std::string& path, const std::size_t& size,
+           const int prot) -> void {
+    Unmap();
+    if (size == 0) {
+      ::close(fd);
+      return;
+    }
+
+    void* addr = ::mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+      throw std::runtime_error("mmap(" + path +
+                               ") failed: " + std::strerror(errno));
+    }
+
+    data_ = static_cast<std::uint8_t*>(addr);
+    size_ = size;
+  }
+
+  std::uint8_t* data_{nullptr};
+  std::size_t size_{0};
+};
+
+/**
+ * Hand every complete record of a mapped segment to callback, returns the
+ * sequence number of the last one, or last_sequence if there are none.
+ */
+template <typename Callback>
+auto ReadSegment(const SegmentMapping& segment, std::uint64_t last_sequence,
+                 Callback&& callback) -> std::uint64_t {
+  std::size_t offset = 0;
+  while (offset + sizeof(JournalRecordHeader) <= segment.Size()) {
+    JournalRecordHeader header{};
+    std::memcpy(&header, segment.Data() + offset, sizeof(header));
+    const auto record = JournalRecordSize(header.length);
+    if (header.length == 0 || offset + record > segment.Size()) {
+      break;
+    }
+
+    callback(header, segment.Data() + offset + sizeof(header));
+    last_sequence = header.sequence;
+    offset += record;
+  }
+  return last_sequence;
+}
+}  // namespace internal
+
+/**
+ * Appends records to the journal in dir. In record mode a new journal is
+ * started: whatever an earlier run left in dir, segments and checkpoints,
+ * is first moved into a fresh archive.<n> subdirectory, where recovery
+ * never looks. Otherwise the segments already there are kept, appending
+ * starts in a fresh segment after them and continues their sequence
+ * numbers. Not thread safe, the socket thread owns it.
+ */
+class JournalWriter {
+ public:
+  explicit JournalWriter(const JournalOptions& options) : options_(options) {
+    std::filesystem::create_directories(options_.dir);
+    if (options_.mode == JournalMode::kRecord) {
+      Archive();
+    }
+
+    // the newest segment holding a record has the last sequence number
+    const auto paths = internal::SegmentPaths(options_.dir);
+    for (auto path = paths.rbegin(); path != paths.rend() && sequence_ == 0;
+         ++path) {
+      internal::SegmentMapping segment;
+      segment.Open(*path);
+      sequence_ =
+          internal::ReadSegment(segment, 0, [](const auto&, const auto*) {});
+    }
+    if (!paths.empty()) {
+      segment_index_ = internal::SegmentIndex(paths.back()) + 1;
+    }
+
+    spdlog::info("journal {}: segment {}, sequence {}", options_.dir,
+                 segment_index_, sequence_);
+  }
+
+  JournalWriter(const JournalWriter&) = delete;
+  JournalWriter(JournalWriter&&) = delete;
+  auto operator=(const JournalWriter&) -> JournalWriter& = delete;
+  auto operator=(JournalWriter&&) -> JournalWriter& = delete;
+  ~JournalWriter() { CloseSegment(); }
+
+  /**
+   * Append a message, returns its sequence number. Throws
+   * std::length_error for a message larger than a segment.
+   */
+  auto Append(const std::uint32_t& routing_id, const void* data,
+              const std::size_t& length) -> std::uint64_t {
+    const auto record = internal::JournalRecordSize(length);
+    if (offset_ + record > segment_.Size()) [[unlikely]] {
+      if (record > options_.segment_size) {
+        throw std::length_error("journal record of " +
+                                std::to_string(length) +
+                                " bytes exceeds the segment size");
+      }
+      // segments are created on first use, restarts leave no empty ones
+      if (segment_.Data() != nullptr) {
+        CloseSegment();
+        ++segment_index_;
+      }
+      OpenSegment();
+    }
+
+    auto* pos = segment_.Data() + offset_;
+    auto* header = reinterpret_cast<JournalRecordHeader*>(pos);
+    header->routing_id = routing_id;
+    header->sequence = ++sequence_;
+    std::memcpy(pos + sizeof(JournalRecordHeader), data, length);
+
+    // the length goes last, a record torn by a crash is never read
+    std::atomic_ref<std::uint32_t>(header->length)
+        .store(static_cast<std::uint32_t>(length), std::memory_order_release);
+
+    offset_ += record;
+    return sequence_;
+  }
+
+  /**
+   * Called at batch ends: schedules write back of the pages written since
+   * the last sync once at least sync_bytes have accumulated.
+   */
+  auto Commit() -> void {
+    if (offset_ - synced_ >= options_.sync_bytes) {
+      segment_.Sync(synced_, offset_ - synced_, MS_ASYNC);
+      synced_ = offset_;
+    }
+  }
+
+  auto Sequence() const -> std::uint64_t { return sequence_; }
+
+ private:
+  /**
+   * Move every file of the journal directory into a new archive.<n>.
+   */
+  auto Archive() -> void {
+    namespace fs = std::filesystem;
+
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::directory_iterator(options_.dir)) {
+      if (entry.is_regular_file()) {
+        files.push_back(entry.path());
+      }
+    }
+    if (files.empty()) {
+      return;
+    }
+
+    std::uint32_t index{0};
+    while (fs::exists(ArchivePath(index))) {
+      ++index;
+    }
+    const auto archive = ArchivePath(index);
+    fs::create_directory(archive);
+    for (const auto& file : files) {
+      fs::rename(file, archive / file.filename());
+    }
+    spdlog::info("journal {}: archived {} files to {}", options_.dir,
+                 files.size(), archive.string());
+  }
+
+  auto ArchivePath(const std::uint32_t& index) const
+      -> std::filesystem::path {
+    return std::filesystem::path(options_.dir) /
+           ("archive." + std::to_string(index));
+  }
+
+  auto OpenSegment() -> void {
+    segment_.Create(internal::SegmentPath(options_.dir, segment_index_),
+                    options_.segment_size);
+    offset_ = 0;
+    synced_ = 0;
+  }
+
+  auto CloseSegment() -> void {
+    if (segment_.Data() != nullptr && offset_ > 0) {
+      segment_.Sync(0, offset_, MS_SYNC);
+    }
+    segment_.Unmap();
+  }
+
+  JournalOptions options_;
+  internal::SegmentMapping segment_;
+  std::uint32_t segment_index_{0};
+  std::uint64_t sequence_{0};
+  std::size_t offset_{0};
+  std::size_t synced_{0};
+};
+
+/**
+ * Reads a journal back in order.
+ */
+class JournalReader {
+ public:
+  /**
+   * Hand every record in dir to callback(routing_id, data, length), returns
+   * the number of records read. A gap in the sequence numbers, left by a
+   * segment lost or torn mid-file, is logged.
+   */
+  template <typename Callback>
+  static auto ForEach(const std::string& dir, Callback&& callback)
+      -> std::uint64_t {
+    return ForEach(dir, 0, std::forward<Callback>(callback));
+  }
+
+  /**
+   * As above, skipping the records up to and including sequence after, the
+   * ones a checkpoint already holds.
+   */
+  template <typename Callback>
+  static auto ForEach(const std::string& dir, const std::uint64_t& after,
+                      Callback&& callback) -> std::uint64_t {
+    std::uint64_t count{0};
+    std::uint64_t expected{after == 0 ? 0 : after + 1};
+    for (const auto& path : internal::SegmentPaths(dir)) {
+      internal::SegmentMapping segment;
+      segment.Open(path);
+      internal::ReadSegment(
+          segment, 0,
+          [&](const JournalRecordHeader& header, const std::uint8_t* data) {
+            if (header.sequence <= after) {
+              return;
+            }
+            if (expected != 0 && header.sequence != expected) {
+              spdlog::warn("journal gap: expected sequence {}, read {}",
+                           expected, header.sequence);
+            }
+            expected = header.sequence + 1;
+            callback(header.routing_id, data, std::size_t{header.length});
+            ++count;
+          });
+    }
+    return count;
+  }
+};
+}  // namespace orderbook::util
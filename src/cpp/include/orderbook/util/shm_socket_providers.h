@@ -0,0 +1,739 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <csignal>
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "orderbook/util/socket_providers.h"
+#include "orderbook/util/time_util.h"
+
+/**
+ * Shared memory transport between processes on the same host. A server
+ * binds a segment in /dev/shm holding a fixed number of channels, each a
+ * pair of single-producer / single-consumer byte rings (one per
+ * direction). A client claims a free channel on connect. The routing id
+ * the server sees is the channel index and the channel's generation, which
+ * is bumped each time the channel is reclaimed, so a routing id is never
+ * reused for a later client. The providers mirror the zmq
+ * ClientSocketProvider / ServerSocketProvider surface and are selected by
+ * the shm:// address scheme.
+ *
+ * A client that exits without calling Close is found by its process id
+ * going away and its channel is reclaimed like a closed one.
+ */
+
+namespace orderbook::util {
+
+constexpr std::string_view kShmScheme = "shm://";
+
+inline auto IsShmAddress(std::string_view addr) -> bool {
+  return addr.starts_with(kShmScheme);
+}
+
+/**
+ * Variable length records in a power of two byte buffer. Each record is a
+ * 4 byte length followed by the payload, padded to kAlignment. A record
+ * never wraps: when it does not fit before the end of the buffer a padding
+ * marker is written and the record starts again at offset zero.
+ */
+template <std::size_t RingSize>
+class ShmByteRing {
+ private:
+  static_assert((RingSize & (RingSize - 1)) == 0,
+                "ShmByteRing size must be a power of two");
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+                "ShmByteRing requires address-free atomics");
+
+  using Length = std::uint32_t;
+
+  static constexpr std::size_t kAlignment = 8;
+  static constexpr std::size_t kMask = RingSize - 1;
+  static constexpr Length kPadding = UINT32_MAX;
+
+ public:
+  static constexpr std::size_t kMaxMessageSize =
+      RingSize / 2 - sizeof(Length);
+
+  /**
+   * Copy size bytes into the ring, returns false if there is no room.
+   */
+  auto TryWrite(const void* buf, const std::size_t& size) -> bool {
+    if (size > kMaxMessageSize) {
+      return false;
+    }
+
+    const std::uint64_t tail = tail_.load(std::memory_order_relaxed);
+    const std::uint64_t head = head_.load(std::memory_order_acquire);
+    const std::size_t record = RecordSize(size);
+    const std::size_t offset = tail & kMask;
+    const std::size_t contiguous = RingSize - offset;
+    const std::size_t skip = record > contiguous ? contiguous : 0;
+
+    if (tail + skip + record - head > RingSize) {
+      return false;
+    }
+
+    if (skip > 0) {
+      WriteLength(offset, kPadding);
+    }
+
+    const std::size_t start = (tail + skip) & kMask;
+    WriteLength(start, static_cast<Length>(size));
+    std::memcpy(&data_[start + sizeof(Length)], buf, size);
+    tail_.store(tail + skip + record, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Hand the oldest record to callback(data, size) and release it once the
+   * callback returns, returns false if the ring is empty.
+   */
+  template <typename Callback>
+  auto TryRead(Callback&& callback) -> bool {
+    std::uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    std::size_t offset = head & kMask;
+    Length length = ReadLength(offset);
+    if (length == kPadding) {
+      head += RingSize - offset;
+      offset = 0;
+      length = ReadLength(offset);
+    }
+
+    callback(&data_[offset + sizeof(Length)], std::size_t{length});
+    head_.store(head + RecordSize(length), std::memory_order_release);
+    return true;
+  }
+
+  auto Empty() const -> bool {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Only safe while neither side is using the ring, see
+   * ShmServerSocketProvider::Reclaim.
+   */
+  auto Reset() -> void {
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(0, std::memory_order_release);
+  }
+
+ private:
+  static constexpr auto RecordSize(const std::size_t& size) -> std::size_t {
+    return (sizeof(Length) + size + kAlignment - 1) & ~(kAlignment - 1);
+  }
+
+  auto WriteLength(const std::size_t& offset, const Length length) -> void {
+    std::memcpy(&data_[offset], &length, sizeof(Length));
+  }
+
+  auto ReadLength(const std::size_t& offset) const -> Length {
+    Length length{0};
+    std::memcpy(&length, &data_[offset], sizeof(Length));
+    return length;
+  }
+
+  alignas(64) std::atomic<std::uint64_t> head_{0};
+  alignas(64) std::atomic<std::uint64_t> tail_{0};
+  alignas(64) std::array<std::uint8_t, RingSize> data_;
+};
+
+/**
+ * The layout of a transport segment. The server placement-constructs it
+ * and publishes kMagic last, clients wait for the magic before use.
+ */
+struct ShmSegment {
+  static constexpr std::uint64_t kMagic = 0x4f42534852494e47;  // OBSHRING
+  static constexpr std::size_t kRingSize = 1UL << 20;
+  static constexpr std::size_t kMaxClients = 8;
+
+  using Ring = ShmByteRing<kRingSize>;
+
+  enum class ChannelState : std::uint32_t {
+    kFree = 0,
+    kConnected = 1,
+    kClosed = 2
+  };
+
+  /**
+   * The writer counts are raised for the length of every send, the server
+   * resets a closed channel's rings only once both are back to zero. The
+   * generation is only changed by the server, owner is the process id of
+   * the client holding the channel.
+   */
+  struct Channel {
+    alignas(64) std::atomic<ChannelState> state{ChannelState::kFree};
+    std::atomic<std::uint32_t> generation{0};
+    std::atomic<pid_t> owner{0};
+    std::atomic<std::uint32_t> inbound_writers{0};
+    std::atomic<std::uint32_t> outbound_writers{0};
+    Ring inbound;   // client to server
+    Ring outbound;  // server to client
+  };
+
+  std::atomic<std::uint64_t> magic{0};
+  std::array<Channel, kMaxClients> channels;
+};
+
+/**
+ * Owns the mapping of a transport segment into this process.
+ */
+class ShmMapping {
+ public:
+  ShmMapping() = default;
+  ShmMapping(const ShmMapping&) = delete;
+  ShmMapping(ShmMapping&&) = delete;
+  auto operator=(const ShmMapping&) -> ShmMapping& = delete;
+  auto operator=(ShmMapping&&) -> ShmMapping& = delete;
+  ~ShmMapping() {
+    Unlink();
+    if (segment_ != nullptr) {
+      ::munmap(segment_, sizeof(ShmSegment));
+    }
+  }
+
+  auto Create(const std::string& name) -> ShmSegment* {
+    const int fd = ::shm_open(name.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0600);
+    if (fd < 0) {
+      throw std::runtime_error("shm_open(" + name +
+                               ") failed: " + std::strerror(errno));
+    }
+
+    if (::ftruncate(fd, sizeof(ShmSegment)) != 0) {
+      ::close(fd);
+      throw std::runtime_error("ftruncate(" + name +
+                               ") failed: " + std::strerror(errno));
+    }
+
+    auto* segment = new (Map(fd, name)) ShmSegment;
+    segment->magic.store(ShmSegment::kMagic, std::memory_order_release);
+
+    name_ = name;
+    owner_ = true;
+    return segment;
+  }
+
+  auto Open(const std::string& name) -> ShmSegment* {
+    const int fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0) {
+      throw std::runtime_error("shm_open(" + name +
+                               ") failed: " + std::strerror(errno));
+    }
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 ||
+        static_cast<std::size_t>(st.st_size) != sizeof(ShmSegment)) {
+      ::close(fd);
+      throw std::runtime_error("shm segment " + name + " has a bad size");
+    }
+
+    auto* segment = static_cast<ShmSegment*>(Map(fd, name));
+    while (segment->magic.load(std::memory_order_acquire) !=
+           ShmSegment::kMagic) {
+      std::this_thread::yield();
+    }
+    return segment;
+  }
+
+  /**
+   * Remove the segment name, existing mappings stay valid.
+   */
+  auto Unlink() -> void {
+    if (owner_) {
+      ::shm_unlink(name_.c_str());
+      owner_ = false;
+    }
+  }
+
+ private:
+  auto Map(const int fd, const std::string& name) -> void* {
+    void* addr = ::mmap(nullptr, sizeof(ShmSegment), PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+      throw std::runtime_error("mmap(" + name +
+                               ") failed: " + std::strerror(errno));
+    }
+
+    segment_ = addr;
+    return addr;
+  }
+
+  void* segment_{nullptr};
+  std::string name_;
+  bool owner_{false};
+};
+
+/**
+ * Shared state and helpers for both ends of the shm transport. There is
+ * nothing to block on, so kBlocking spins and then sleeps for kIdleSleep
+ * between empty polls.
+ */
+class ShmBaseProvider {
+ protected:
+  using Channel = ShmSegment::Channel;
+  using ChannelState = ShmSegment::ChannelState;
+  using Ring = ShmSegment::Ring;
+
+ public:
+  static constexpr zmq::send_flags kNone = zmq::send_flags::none;
+  static constexpr std::chrono::microseconds kIdleSleep{50};
+
+  auto SetReceiveOptions(const ReceiveOptions& options) -> void {
+    options_ = options;
+    options_.drain_limit = std::max<std::size_t>(options_.drain_limit, 1);
+  }
+
+  template <typename MonitorCallback>
+  auto Monitor(MonitorCallback&& callback,
+               const std::uint16_t event_type = ZMQ_EVENT_ALL) -> void {
+    dispatcher_.appendListener(event_type,
+                               std::forward<MonitorCallback>(callback));
+  }
+
+ protected:
+  ShmBaseProvider() : running_{true} {
+    std::signal(SIGTERM, internal::signal_handler);
+  }
+
+  static auto ToShmName(std::string_view addr) -> std::string {
+    addr.remove_prefix(kShmScheme.size());
+    return "/" + std::string(addr);
+  }
+
+  /**
+   * The low kIndexBits hold the channel index + 1, so a routing id is never
+   * zero, the rest the channel generation.
+   */
+  static constexpr std::uint32_t kIndexBits = 4;
+  static constexpr std::uint32_t kIndexMask = (1U << kIndexBits) - 1;
+  static constexpr std::uint32_t kGenerationMask = UINT32_MAX >> kIndexBits;
+  static_assert(ShmSegment::kMaxClients <= kIndexMask,
+                "ShmSegment::kMaxClients exceeds the routing id index bits");
+
+  static auto ToRoutingId(const std::size_t& index,
+                          const std::uint32_t& generation) -> std::uint32_t {
+    return (generation << kIndexBits) | static_cast<std::uint32_t>(index + 1);
+  }
+
+  auto Notify(const std::uint16_t event_type, const std::int32_t value)
+      -> void {
+    zmq_event_t event{};
+    event.event = event_type;
+    event.value = value;
+    dispatcher_.dispatch(event_type, event, addr_.c_str());
+    dispatcher_.dispatch(ZMQ_EVENT_ALL, event, addr_.c_str());
+  }
+
+  /**
+   * Write to one of channel's rings while it is connected in generation.
+   * With dontwait a full ring drops the message, like a zmq send at the
+   * high water mark; otherwise wait for the reader to make room, giving up
+   * if the channel is closed or reclaimed meanwhile.
+   *
+   * The writer count is raised before the state and generation are
+   * checked, and the server checks the count after it sees the channel
+   * closed and before it bumps the generation, all sequentially consistent:
+   * either the writer sees the new generation and backs out, or the server
+   * sees the writer and leaves the channel alone until it is done.
+   */
+  auto Write(Channel& channel, const std::uint32_t& generation, Ring& ring,
+             std::atomic<std::uint32_t>& writers, const void* buf,
+             const std::size_t& size, const zmq::send_flags flag)
+      -> zmq::send_result_t {
+    if (size > Ring::kMaxMessageSize) {
+      spdlog::error("shm message of {} bytes exceeds the ring limit", size);
+      return {};
+    }
+
+    zmq::send_result_t result{};
+    writers.fetch_add(1, std::memory_order_seq_cst);
+    while (channel.state.load(std::memory_order_seq_cst) ==
+               ChannelState::kConnected &&
+           channel.generation.load(std::memory_order_seq_cst) == generation) {
+      if (ring.TryWrite(buf, size)) {
+        result = size;
+        break;
+      }
+      if (flag == zmq::send_flags::dontwait ||
+          !running_.load(std::memory_order_relaxed)) {
+        break;
+      }
+      ThreadUtil::Pause();
+    }
+    writers.fetch_sub(1, std::memory_order_release);
+
+    return result;
+  }
+
+  /**
+   * Receive up to drain_limit messages from ring as zmq messages.
+   */
+  template <typename MessageCallback>
+  auto Drain(Ring& ring, const std::uint32_t& routing_id,
+             MessageCallback& callback) -> std::size_t {
+    std::size_t count = 0;
+    while (count < options_.drain_limit &&
+           ring.TryRead([&](const std::uint8_t* data, std::size_t size) {
+             zmq::message_t msg{data, size};
+             msg.set_routing_id(routing_id);
+             callback(std::move(msg));
+           })) {
+      ++count;
+    }
+    return count;
+  }
+
+  auto Idle(std::uint32_t& idle_count) const -> void {
+    if (options_.strategy == ReceiveStrategy::kBusySpin ||
+        ++idle_count < options_.spin_count) {
+      ThreadUtil::Pause();
+      return;
+    }
+
+    idle_count = 0;
+    if (options_.strategy == ReceiveStrategy::kSpinYield) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(kIdleSleep);
+    }
+  }
+
+  std::atomic<bool> running_;
+  ReceiveOptions options_;
+  std::string addr_;
+  ShmMapping mapping_;
+  ShmSegment* segment_{nullptr};
+  eventpp::EventDispatcher<std::uint16_t, void(const zmq_event_t&, const char*)>
+      dispatcher_;
+};
+
+class ShmServerSocketProvider : public ShmBaseProvider {
+ public:
+  ShmServerSocketProvider(const bool /*monitor_flag*/ = true) {
+    internal::shutdown_handler = [&](int /*unused*/) { Close(); };
+  }
+
+  ShmServerSocketProvider(const ShmServerSocketProvider&) = delete;
+  ShmServerSocketProvider(ShmServerSocketProvider&&) = delete;
+  auto operator=(const ShmServerSocketProvider&)
+      -> ShmServerSocketProvider& = delete;
+  auto operator=(ShmServerSocketProvider&&)
+      -> ShmServerSocketProvider& = delete;
+  ~ShmServerSocketProvider() { Close(); }
+
+  auto Bind(const std::string& addr) -> void {
+    spdlog::info("shm bind({})", addr);
+    addr_ = addr;
+    segment_ = mapping_.Create(ToShmName(addr));
+    Notify(ZMQ_EVENT_LISTENING, 0);
+  }
+
+  auto SendFlatBuffer(const std::uint8_t* buf, const std::size_t& size,
+                      const std::uint32_t& routing_id,
+                      const zmq::send_flags flag = zmq::send_flags::dontwait)
+      -> zmq::send_result_t {
+    auto* channel = ChannelOf(routing_id);
+    if (channel == nullptr) {
+      return {};
+    }
+
+    return Write(*channel, routing_id >> kIndexBits, channel->outbound,
+                 channel->outbound_writers, buf, size, flag);
+  }
+
+  /**
+   * The bytes are copied into the ring, so buf is released straight away.
+   */
+  auto SendFlatBuffer(std::uint8_t* buf, const std::size_t& size,
+                      const std::uint32_t& routing_id, zmq_free_fn* free_fn,
+                      void* hint,
+                      const zmq::send_flags flag = zmq::send_flags::dontwait)
+      -> zmq::send_result_t {
+    const auto result = SendFlatBuffer(buf, size, routing_id, flag);
+    free_fn(buf, hint);
+    return result;
+  }
+
+  template <typename MessageCallback>
+  auto ProcessMessages(MessageCallback&& callback) -> void {
+    ProcessMessages(std::forward<MessageCallback>(callback), []() {});
+  }
+
+  /**
+   * Poll the inbound ring of every connected channel, reclaiming channels
+   * whose client has closed or exited.
+   */
+  template <typename MessageCallback, typename BatchEndCallback>
+  auto ProcessMessages(MessageCallback&& callback,
+                       BatchEndCallback&& batch_end_callback) -> void {
+    if (!running_ || segment_ == nullptr) {
+      spdlog::warn("ProcessMessages: running == false");
+      return;
+    }
+
+    ThreadUtil::PinCurrentThread(options_.cpu);
+
+    std::uint32_t idle_count{0};
+    std::uint32_t poll_count{0};
+    auto next_owner_check = TimeUtil::MonotonicNanos();
+    while (running_.load(std::memory_order_relaxed)) {
+      if (++poll_count % kOwnerCheckPolls == 0 &&
+          TimeUtil::MonotonicNanos() >= next_owner_check) {
+        CloseExited();
+        next_owner_check = TimeUtil::MonotonicNanos() + kOwnerCheckNanos;
+      }
+
+      std::size_t count = 0;
+      for (std::size_t i = 0; i < ShmSegment::kMaxClients; ++i) {
+        auto& channel = segment_->channels[i];
+        const auto state = channel.state.load(std::memory_order_seq_cst);
+
+        if (state == ChannelState::kConnected) {
+          const auto routing_id = ToRoutingId(
+              i, channel.generation.load(std::memory_order_relaxed));
+          if (!connected_[i]) {
+            connected_[i] = true;
+            Notify(ZMQ_EVENT_ACCEPTED, static_cast<std::int32_t>(routing_id));
+          }
+          count += Drain(channel.inbound, routing_id, callback);
+        } else if (state == ChannelState::kClosed) {
+          Reclaim(i);
+        }
+      }
+
+      if (count > 0) {
+        batch_end_callback();
+        idle_count = 0;
+      } else {
+        Idle(idle_count);
+      }
+    }
+  }
+
+  auto Close() -> void {
+    running_ = false;
+    mapping_.Unlink();
+  }
+
+  constexpr auto SocketType() -> zmq::socket_type {
+    return zmq::socket_type::server;
+  }
+
+ private:
+  static constexpr std::uint32_t kOwnerCheckPolls = 64;
+  static constexpr TimeUtil::Timestamp kOwnerCheckNanos = 1'000'000'000;
+
+  /**
+   * The channel a routing id was handed out for, nullptr once that channel
+   * has been reclaimed.
+   */
+  auto ChannelOf(const std::uint32_t& routing_id) -> Channel* {
+    const auto index = routing_id & kIndexMask;
+    if (segment_ == nullptr || index == 0 || index > ShmSegment::kMaxClients) {
+      return nullptr;
+    }
+
+    auto& channel = segment_->channels[index - 1];
+    if (channel.generation.load(std::memory_order_acquire) !=
+        routing_id >> kIndexBits) {
+      return nullptr;
+    }
+    return &channel;
+  }
+
+  /**
+   * Close the channels of clients which exited without closing. A dead
+   * client sends nothing more, so its inbound writer count is dropped.
+   */
+  auto CloseExited() -> void {
+    for (auto& channel : segment_->channels) {
+      const pid_t owner = channel.owner.load(std::memory_order_acquire);
+      if (owner == 0 || ::kill(owner, 0) == 0 || errno != ESRCH) {
+        continue;
+      }
+
+      auto expected = ChannelState::kConnected;
+      if (channel.state.compare_exchange_strong(expected,
+                                                ChannelState::kClosed,
+                                                std::memory_order_seq_cst)) {
+        spdlog::warn("shm client {} exited without closing", owner);
+        channel.inbound_writers.store(0, std::memory_order_seq_cst);
+      }
+    }
+  }
+
+  /**
+   * Reset a closed channel and free it for the next client under a new
+   * generation. A send which began before the close may still be writing,
+   * on the publisher thread or in the client, the channel is then left
+   * closed for a later poll.
+   */
+  auto Reclaim(const std::size_t& index) -> void {
+    auto& channel = segment_->channels[index];
+    if (channel.inbound_writers.load(std::memory_order_seq_cst) != 0 ||
+        channel.outbound_writers.load(std::memory_order_seq_cst) != 0) {
+      return;
+    }
+
+    const auto generation = channel.generation.load(std::memory_order_relaxed);
+    channel.generation.store((generation + 1) & kGenerationMask,
+                             std::memory_order_seq_cst);
+    const auto routing_id = ToRoutingId(index, generation);
+    channel.inbound.Reset();
+    channel.outbound.Reset();
+    channel.owner.store(0, std::memory_order_relaxed);
+    channel.state.store(ChannelState::kFree, std::memory_order_release);
+
+    if (connected_[index]) {
+      connected_[index] = false;
+      Notify(ZMQ_EVENT_DISCONNECTED, static_cast<std::int32_t>(routing_id));
+    }
+  }
+
+  std::array<bool, ShmSegment::kMaxClients> connected_{};
+};
+
+class ShmClientSocketProvider : public ShmBaseProvider {
+ public:
+  ShmClientSocketProvider(const bool /*monitor_flag*/ = true) {
+    internal::shutdown_handler = [&](int /*unused*/) { Close(); };
+  }
+
+  ShmClientSocketProvider(const ShmClientSocketProvider&) = delete;
+  ShmClientSocketProvider(ShmClientSocketProvider&&) = delete;
+  auto operator=(const ShmClientSocketProvider&)
+      -> ShmClientSocketProvider& = delete;
+  auto operator=(ShmClientSocketProvider&&)
+      -> ShmClientSocketProvider& = delete;
+  ~ShmClientSocketProvider() { Close(); }
+
+  /**
+   * Map the server segment and claim a free channel.
+   */
+  auto Connect(const std::string& addr) -> void {
+    spdlog::info("shm connect({})", addr);
+    addr_ = addr;
+    segment_ = mapping_.Open(ToShmName(addr));
+
+    for (std::size_t i = 0; i < ShmSegment::kMaxClients; ++i) {
+      auto expected = ChannelState::kFree;
+      if (segment_->channels[i].state.compare_exchange_strong(
+              expected, ChannelState::kConnected,
+              std::memory_order_acq_rel)) {
+        auto& channel = segment_->channels[i];
+        generation_ = channel.generation.load(std::memory_order_acquire);
+        channel.owner.store(::getpid(), std::memory_order_release);
+        channel_ = &channel;
+        running_ = true;
+        Notify(ZMQ_EVENT_CONNECTED,
+               static_cast<std::int32_t>(ToRoutingId(i, generation_)));
+        return;
+      }
+    }
+
+    throw std::runtime_error("no free channel on " + addr);
+  }
+
+  auto SendMessage(const std::string& str, const zmq::send_flags flag = kNone)
+      -> zmq::send_result_t {
+    return SendFlatBuffer(reinterpret_cast<const std::uint8_t*>(str.data()),
+                          str.size(), flag);
+  }
+
+  auto SendFlatBuffer(const std::uint8_t* buf, const std::size_t size,
+                      const zmq::send_flags flag = zmq::send_flags::dontwait)
+      -> zmq::send_result_t {
+    auto* channel = channel_.load(std::memory_order_acquire);
+    if (channel == nullptr) {
+      return {};
+    }
+    return Write(*channel, generation_, channel->inbound,
+                 channel->inbound_writers, buf, size, flag);
+  }
+
+  template <typename MessageCallback>
+  auto ProcessMessages(MessageCallback&& callback) -> void {
+    ProcessMessages(std::forward<MessageCallback>(callback), []() {});
+  }
+
+  template <typename MessageCallback, typename BatchEndCallback>
+  auto ProcessMessages(MessageCallback&& callback,
+                       BatchEndCallback&& batch_end_callback) -> void {
+    auto* channel = channel_.load(std::memory_order_acquire);
+    if (!running_ || channel == nullptr) {
+      spdlog::warn("ProcessMessages: running == false");
+      return;
+    }
+
+    ThreadUtil::PinCurrentThread(options_.cpu);
+
+    receiving_ = true;
+    std::uint32_t idle_count{0};
+    while (running_.load(std::memory_order_relaxed)) {
+      if (Drain(channel->outbound, 0, callback) > 0) {
+        batch_end_callback();
+        idle_count = 0;
+      } else {
+        Idle(idle_count);
+      }
+    }
+
+    receiving_ = false;
+    Release();
+  }
+
+  /**
+   * Stop receiving and hand the channel back. While a receiving thread is
+   * still reading, it releases the channel itself on the way out.
+   */
+  auto Close() -> void {
+    running_ = false;
+    if (!receiving_) {
+      Release();
+    }
+  }
+
+  constexpr auto SocketType() -> zmq::socket_type {
+    return zmq::socket_type::client;
+  }
+
+ private:
+  /**
+   * Mark the channel closed, the server then resets and reclaims it once no
+   * send on it is in progress. Nothing is done if the server has already
+   * reclaimed it.
+   */
+  auto Release() -> void {
+    auto* channel = channel_.exchange(nullptr, std::memory_order_acq_rel);
+    auto expected = ChannelState::kConnected;
+    if (channel != nullptr &&
+        channel->generation.load(std::memory_order_acquire) == generation_) {
+      channel->state.compare_exchange_strong(expected, ChannelState::kClosed,
+                                             std::memory_order_seq_cst);
+    }
+  }
+
+  std::atomic<Channel*> channel_{nullptr};
+  std::uint32_t generation_{0};
+  std::atomic<bool> receiving_{false};
+};
+}  // namespace orderbook::util
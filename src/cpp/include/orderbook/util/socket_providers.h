@@ -2,10 +2,13 @@
 
 #define ZMQ_BUILD_DRAFT_API 1
 
+#include <algorithm>
 #include <csignal>
+#include <string_view>
 #include <thread>
 
 #include "eventpp/eventdispatcher.h"
+#include "orderbook/util/thread_util.h"
 #include "spdlog/spdlog.h"
 #include "zmq.hpp"
 
@@ -103,6 +106,37 @@ std::function<void(int)> shutdown_handler;
 void signal_handler(int signal) { shutdown_handler(signal); }
 }  // namespace internal
 
+/**
+ * How ProcessMessages waits for inbound messages.
+ *
+ * kBlocking  - block in the zmq poller, lowest cpu use.
+ * kBusySpin  - spin on a non-blocking recv, lowest latency, burns a core.
+ * kSpinYield - spin for spin_count empty polls, then yield the core.
+ */
+enum class ReceiveStrategy : std::uint8_t { kBlocking, kBusySpin, kSpinYield };
+
+inline auto ToReceiveStrategy(std::string_view name) -> ReceiveStrategy {
+  if (name == "spin") {
+    return ReceiveStrategy::kBusySpin;
+  }
+  if (name == "yield") {
+    return ReceiveStrategy::kSpinYield;
+  }
+  if (name != "block") {
+    spdlog::warn("unknown receive strategy {}, using block", name);
+  }
+  return ReceiveStrategy::kBlocking;
+}
+
+struct ReceiveOptions {
+  static constexpr std::uint32_t kDefaultSpinCount = 1000;
+
+  ReceiveStrategy strategy{ReceiveStrategy::kBlocking};
+  std::size_t drain_limit{1};  // messages received per wakeup
+  std::uint32_t spin_count{kDefaultSpinCount};
+  int cpu{ThreadUtil::kNoAffinity};  // pin the receiving thread
+};
+
 template <zmq::socket_type ZmqSocketType>
 struct BaseProvider {
  private:
@@ -112,27 +146,35 @@ struct BaseProvider {
   static constexpr zmq::send_flags kNone = zmq::send_flags::none;
   static constexpr std::chrono::milliseconds kPollTimeout{100};
 
+  auto SetReceiveOptions(const ReceiveOptions& options) -> void {
+    options_ = options;
+    options_.drain_limit = std::max<std::size_t>(options_.drain_limit, 1);
+  }
+
   template <typename MessageCallback>
   auto ProcessMessages(MessageCallback&& callback) -> void {
+    ProcessMessages(std::forward<MessageCallback>(callback), []() {});
+  }
+
+  /**
+   * Receive on the calling thread until Close. Every wakeup receives up to
+   * drain_limit messages, batch_end_callback is invoked after each wakeup
+   * that received at least one message.
+   */
+  template <typename MessageCallback, typename BatchEndCallback>
+  auto ProcessMessages(MessageCallback&& callback,
+                       BatchEndCallback&& batch_end_callback) -> void {
     if (!running_) {
       spdlog::warn("ProcessMessages: running == false");
       return;
     }
 
-    zmq::poller_t poller;
-    poller.add(socket_, zmq::event_flags::pollin);
-    EventVector events{poller.size()};
-
-    while (running_) {
-      const int num_events = poller.wait_all(events, kPollTimeout);
-      for (int i = 0; i < num_events; ++i) {
-        zmq::message_t msg;
-        auto res = events[i].socket.recv(msg, zmq::recv_flags::dontwait);
+    ThreadUtil::PinCurrentThread(options_.cpu);
 
-        if (res) {
-          callback(std::move(msg));
-        }
-      }
+    if (options_.strategy == ReceiveStrategy::kBlocking) {
+      PollMessages(callback, batch_end_callback);
+    } else {
+      SpinMessages(callback, batch_end_callback);
     }
   }
 
@@ -171,6 +213,57 @@ struct BaseProvider {
 
   ~BaseProvider() { Close(); }
 
+  template <typename MessageCallback, typename BatchEndCallback>
+  auto PollMessages(MessageCallback& callback,
+                    BatchEndCallback& batch_end_callback) -> void {
+    zmq::poller_t poller;
+    poller.add(socket_, zmq::event_flags::pollin);
+    EventVector events{poller.size()};
+
+    while (running_) {
+      const int num_events = poller.wait_all(events, kPollTimeout);
+      if (num_events > 0 && Drain(callback) > 0) {
+        batch_end_callback();
+      }
+    }
+  }
+
+  template <typename MessageCallback, typename BatchEndCallback>
+  auto SpinMessages(MessageCallback& callback,
+                    BatchEndCallback& batch_end_callback) -> void {
+    const bool yield = options_.strategy == ReceiveStrategy::kSpinYield;
+    std::uint32_t idle_count{0};
+
+    while (running_.load(std::memory_order_relaxed)) {
+      if (Drain(callback) > 0) {
+        batch_end_callback();
+        idle_count = 0;
+      } else if (yield && ++idle_count >= options_.spin_count) {
+        std::this_thread::yield();
+        idle_count = 0;
+      } else {
+        ThreadUtil::Pause();
+      }
+    }
+  }
+
+  /**
+   * Receive up to drain_limit messages without blocking.
+   */
+  template <typename MessageCallback>
+  auto Drain(MessageCallback& callback) -> std::size_t {
+    std::size_t count = 0;
+    while (count < options_.drain_limit) {
+      zmq::message_t msg;
+      if (!socket_.recv(msg, zmq::recv_flags::dontwait)) {
+        break;
+      }
+      ++count;
+      callback(std::move(msg));
+    }
+    return count;
+  }
+
   auto MonitorSockets() -> void {
     socket_monitor_.init(socket_, "inproc://monitor");
     while (running_) {
@@ -179,6 +272,7 @@ struct BaseProvider {
   }
 
   std::atomic<bool> running_;
+  ReceiveOptions options_;
   SocketMonitor socket_monitor_;
   zmq::context_t context_;
   zmq::socket_t socket_;
@@ -236,6 +330,30 @@ class ServerSocketProvider : public BaseProvider<zmq::socket_type::server> {
     msg.set_routing_id(routing_id);
     return socket_.send(msg, flag);
   }
+
+  /**
+   * Hand buf to zmq without copying it. zmq calls free_fn(buf, hint) once it
+   * is done with the bytes, possibly from one of its I/O threads, and also
+   * when the send fails.
+   */
+  auto SendFlatBuffer(std::uint8_t* buf, const std::size_t& size,
+                      const std::uint32_t& routing_id, zmq_free_fn* free_fn,
+                      void* hint,
+                      const zmq::send_flags flag = zmq::send_flags::dontwait)
+      -> zmq::send_result_t {
+    zmq::message_t msg{buf, size, free_fn, hint};
+    msg.set_routing_id(routing_id);
+    return socket_.send(msg, flag);
+  }
+
+  /**
+   * Send a fully formed message, the routing id must already be set.
+   */
+  auto Send(zmq::message_t& msg,
+            const zmq::send_flags flag = zmq::send_flags::dontwait)
+      -> zmq::send_result_t {
+    return socket_.send(msg, flag);
+  }
 };
 
 class RadioSocketProvider : public BaseProvider<zmq::socket_type::radio> {
@@ -305,6 +423,59 @@ class PubSocketProvider : public BaseProvider<zmq::socket_type::pub> {
   }
 };
 
+/**
+ * A publisher that also sees its subscribers' subscriptions. The socket is
+ * verbose, so a subscription to a topic somebody already follows is still
+ * delivered.
+ */
+class XPubSocketProvider : public BaseProvider<zmq::socket_type::xpub> {
+ public:
+  XPubSocketProvider(const bool monitor_flag = true)
+      : BaseProvider<zmq::socket_type::xpub>(monitor_flag) {
+    socket_.set(zmq::sockopt::xpub_verbose, 1);
+  }
+
+  auto Bind(const std::string& addr) -> void {
+    spdlog::info("socket_.bind({})", addr);
+    socket_.bind(addr);
+  }
+
+  /**
+   * Publish size bytes of data as a two part message, the topic frame
+   * subscribers filter on followed by the payload frame.
+   */
+  auto Publish(std::string_view topic, const void* data,
+               const std::size_t& size,
+               const zmq::send_flags flag = zmq::send_flags::dontwait)
+      -> zmq::send_result_t {
+    zmq::message_t topic_msg{topic.data(), topic.size()};
+    if (!socket_.send(topic_msg, flag | zmq::send_flags::sndmore)) {
+      return {};
+    }
+
+    zmq::message_t msg{data, size};
+    return socket_.send(msg, flag);
+  }
+
+  /**
+   * Receive every pending (un)subscription without blocking, calling
+   * callback(subscribe, topic) for each. Returns the number received.
+   */
+  template <typename SubscriptionCallback>
+  auto PollSubscriptions(SubscriptionCallback&& callback) -> std::size_t {
+    std::size_t count = 0;
+    zmq::message_t msg;
+    while (socket_.recv(msg, zmq::recv_flags::dontwait)) {
+      ++count;
+      if (msg.size() > 0) {
+        const auto* bytes = msg.data<char>();
+        callback(bytes[0] == 1, std::string_view(bytes + 1, msg.size() - 1));
+      }
+    }
+    return count;
+  }
+};
+
 class PullSocketProvider : public BaseProvider<zmq::socket_type::pull> {
  public:
   PullSocketProvider(const bool monitor_flag = true)
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace orderbook::util {
+
+/**
+ * Bounded, lock-free, single-producer / single-consumer ring buffer.
+ *
+ * Exactly one thread may call TryPush and exactly one (other) thread may
+ * call TryPop. The head and tail indices live on separate cache lines, and
+ * each side keeps a cached copy of the opposite index so the shared
+ * cache line is only read when the ring looks full (or empty).
+ */
+template <typename T, std::size_t RingSize>
+class SpscRing {
+ private:
+  static_assert(RingSize >= 2, "SpscRing capacity must be at least two");
+  static_assert((RingSize & (RingSize - 1)) == 0,
+                "SpscRing capacity must be a power of two");
+
+  using Buffer = std::array<T, RingSize>;
+  using Counter = std::size_t;
+  using AtomicCounter = std::atomic<Counter>;
+
+  static constexpr Counter kMask = RingSize - 1;
+  static constexpr std::size_t kCacheLineSize = 64;
+
+ public:
+  static constexpr std::size_t kCapacity = RingSize;
+
+  /**
+   * Attempt to move value into the ring, returns false if the ring is full.
+   */
+  auto TryPush(T&& value) -> bool {
+    const Counter tail = tail_.load(std::memory_order_relaxed);
+
+    if (tail - head_cache_ == RingSize) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ == RingSize) {
+        return false;
+      }
+    }
+
+    buf_[tail & kMask] = std::move(value);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Attempt to move the oldest value out of the ring, returns false if the
+   * ring is empty.
+   */
+  auto TryPop(T& value) -> bool {
+    const Counter head = head_.load(std::memory_order_relaxed);
+
+    if (head == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head == tail_cache_) {
+        return false;
+      }
+    }
+
+    value = std::move(buf_[head & kMask]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  constexpr auto Capacity() const -> std::size_t { return kCapacity; }
+  auto Size() const -> std::size_t {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_acquire);
+  }
+  auto Empty() const -> bool { return Size() == 0; }
+
+ private:
+  alignas(kCacheLineSize) AtomicCounter head_{0};
+  alignas(kCacheLineSize) Counter tail_cache_{0};
+  alignas(kCacheLineSize) AtomicCounter tail_{0};
+  alignas(kCacheLineSize) Counter head_cache_{0};
+  alignas(kCacheLineSize) Buffer buf_{};
+};
+}  // namespace orderbook::util
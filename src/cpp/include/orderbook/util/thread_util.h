@@ -0,0 +1,54 @@
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <thread>
+
+#include "spdlog/spdlog.h"
+
+namespace orderbook::util {
+
+struct ThreadUtil {
+  static constexpr int kNoAffinity = -1;
+
+  /**
+   * Pin the calling thread to the given cpu. A negative cpu leaves the
+   * thread affinity untouched.
+   */
+  static auto PinCurrentThread(const int cpu) -> bool {
+    if (cpu < 0) {
+      return false;
+    }
+
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+
+    const int rc =
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set);
+    if (rc != 0) {
+      spdlog::warn("pthread_setaffinity_np(cpu {}) failed: {}", cpu, rc);
+      return false;
+    }
+
+    return true;
+  }
+
+  static auto HardwareConcurrency() -> int {
+    const auto count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : static_cast<int>(count);
+  }
+
+  /**
+   * Cheap spin-wait hint for busy loops.
+   */
+  static auto Pause() -> void {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#else
+    std::this_thread::yield();
+#endif
+  }
+};
+}  // namespace orderbook::util
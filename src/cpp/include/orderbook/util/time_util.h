@@ -12,5 +12,14 @@ struct TimeUtil {
   static auto EpochNanos() -> Timestamp {
     return ClockType::now().time_since_epoch().count();
   }
+
+  /**
+   * Nanoseconds of a clock which never steps back, for measuring intervals.
+   */
+  static auto MonotonicNanos() -> Timestamp {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
 };
 }  // namespace orderbook::util
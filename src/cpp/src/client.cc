@@ -178,7 +178,7 @@ class FixClient : public FIX::Application, public FIX42::MessageCracker {
                               const std::uint32_t& instrument_id,
                               const std::uint32_t& account_id,
                               const FIX::Side& side,
-                              const std::uint32_t& order_id,
+                              const std::uint64_t& order_id,
                               const std::string& orig_clord_id) -> void {
     FIX42::OrderCancelReplaceRequest cancelReplaceRequest(
         FIX::OrigClOrdID(orig_clord_id),
@@ -203,7 +203,7 @@ class FixClient : public FIX::Application, public FIX42::MessageCracker {
                               const std::uint32_t& instrument_id,
                               const std::uint32_t& account_id,
                               const FIX::Side& side,
-                              const std::uint32_t& order_id,
+                              const std::uint64_t& order_id,
                               const std::string& orig_clord_id) -> void {
     FIX42::OrderCancelRequest orderCancelRequest(
         FIX::OrigClOrdID(orig_clord_id),
@@ -1,19 +1,29 @@
+#include <algorithm>
 #include <iostream>
 #include <string>
 
 #include "orderbook/data/event_types.h"
+#include "orderbook/data/reference_data.h"
 #include "orderbook/gateway/application.h"
-#include "orderbook/gateway/orderbook_client.h"
+#include "orderbook/gateway/orderbook_router.h"
+#include "orderbook/gateway/risk_engine.h"
+#include "orderbook/gateway/routing_table.h"
 #include "quickfix/FileLog.h"
 #include "quickfix/FileStore.h"
 #include "quickfix/SessionSettings.h"
 #include "quickfix/SocketAcceptor.h"
 #include "quickfix/config.h"
 
+template <typename ClientSocket>
 class FixGateway {
  private:
   using GatewayApplication = orderbook::gateway::GatewayApplication;
-  using OrderbookClient = orderbook::gateway::OrderbookClient;
+  using OrderbookRouter = orderbook::gateway::OrderbookRouter<ClientSocket>;
+  using RoutingTable = orderbook::gateway::RoutingTable;
+  using ReferenceData = orderbook::data::ReferenceData;
+  using RiskEngine = orderbook::gateway::RiskEngine;
+  using BatchOptions = typename OrderbookRouter::BatchOptions;
+  using Codec = orderbook::data::Codec;
   using EventType = orderbook::data::EventType;
   using EventData = orderbook::data::EventData;
   using EventCallback = orderbook::data::EventCallback;
@@ -21,11 +31,16 @@ class FixGateway {
   using EventDispatcherPtr = std::shared_ptr<EventDispatcher>;
 
  public:
-  FixGateway(std::string config)
+  FixGateway(std::string config, RoutingTable routing_table,
+             const BatchOptions& batch_options, const Codec& codec,
+             std::shared_ptr<const ReferenceData> reference_data,
+             std::shared_ptr<RiskEngine> risk_engine)
       : config_(std::move(config)),
         dispatcher_(std::make_shared<EventDispatcher>()),
-        application_{dispatcher_},
-        orderbook_client_{dispatcher_},
+        application_{dispatcher_, std::move(reference_data),
+                     std::move(risk_engine)},
+        orderbook_router_{dispatcher_, std::move(routing_table), batch_options,
+                          codec},
         acceptor_{nullptr} {}
 
   auto Initialize() -> void {
@@ -33,44 +48,109 @@ class FixGateway {
     FIX::FileStoreFactory store_factory(settings);
     FIX::ScreenLogFactory log_factory(settings);
 
+    application_.Configure(settings);
+
     acceptor_ = std::make_unique<FIX::SocketAcceptor>(
         application_, store_factory, settings, log_factory);
 
-    // TODO: orderbook configuration
-    orderbook_client_.Connect("tcp://127.0.0.1:5555");
+    orderbook_router_.Connect();
   }
 
   auto Start() -> void {
-    orderbook_client_.ProcessMessages();
+    orderbook_router_.ProcessMessages();
     acceptor_->block();
   }
 
   auto Stop() -> void {
     acceptor_->stop();
-    orderbook_client_.Close();
+    orderbook_router_.Close();
   }
 
  private:
   std::string config_;
   EventDispatcherPtr dispatcher_;
   GatewayApplication application_;
-  OrderbookClient orderbook_client_;
+  OrderbookRouter orderbook_router_;
   std::unique_ptr<FIX::Acceptor> acceptor_;
 };
 
+template <typename ClientSocket>
+auto RunGateway(const std::string& file,
+                orderbook::gateway::RoutingTable routing_table,
+                const std::size_t& max_batch,
+                const std::chrono::microseconds& deadline,
+                const orderbook::data::Codec& codec,
+                std::shared_ptr<const orderbook::data::ReferenceData>
+                    reference_data,
+                std::shared_ptr<orderbook::gateway::RiskEngine> risk_engine)
+    -> void {
+  typename orderbook::gateway::OrderbookRouter<ClientSocket>::BatchOptions
+      batch_options;
+  batch_options.max_batch = max_batch;
+  batch_options.deadline = deadline;
+
+  FixGateway<ClientSocket> gateway(file, std::move(routing_table),
+                                   batch_options, codec,
+                                   std::move(reference_data),
+                                   std::move(risk_engine));
+  gateway.Initialize();
+  gateway.Start();
+  gateway.Stop();
+}
+
 auto main(int argc, char** argv) -> int {
   if (argc < 2) {
-    std::cout << "usage: " << argv[0] << " FILE." << std::endl;
+    std::cout << "usage: " << argv[0]
+              << " FILE [ORDERBOOK_ROUTES] [BATCH_SIZE] [BATCH_DEADLINE_US]"
+                 " [flatbuffers|fixed] [INSTRUMENTS] [RISK_LIMITS]."
+              << std::endl;
     return 1;
   }
 
   std::string file = argv[1];
-  spdlog::info("gateway config file: {}", file);
+  std::string orderbook_routes = argc > 2 ? argv[2] : "tcp://127.0.0.1:5555";
+  std::size_t max_batch = argc > 3 ? std::stoul(argv[3]) : 1;
+  std::chrono::microseconds deadline{argc > 4 ? std::stol(argv[4]) : 100};
+  auto codec = argc > 5 ? orderbook::data::ToCodec(argv[5])
+                        : orderbook::data::Codec::kFlatBuffers;
+  // without a reference data file instruments 1..kInstrumentCount are
+  // listed, as in the orderbook
+  using ReferenceData = orderbook::data::ReferenceData;
+  constexpr std::size_t kInstrumentCount = 2048;
+  auto reference_data = std::make_shared<const ReferenceData>(
+      argc > 6 ? ReferenceData::Load(argv[6])
+               : ReferenceData::Generate(kInstrumentCount));
+  // without a risk limits file orders are forwarded unchecked
+  using RiskEngine = orderbook::gateway::RiskEngine;
+  using RiskConfig = orderbook::gateway::RiskConfig;
+  auto risk_engine =
+      argc > 7 ? std::make_shared<RiskEngine>(RiskConfig::Load(argv[7]))
+               : nullptr;
+  spdlog::info("gateway config file: {}, orderbook {}, batch {} / {}us", file,
+               orderbook_routes, max_batch, deadline.count());
 
-  FixGateway gateway(file);
-  gateway.Initialize();
-  gateway.Start();
-  gateway.Stop();
+  using RoutingTable = orderbook::gateway::RoutingTable;
+  auto routing_table = RoutingTable::Parse(orderbook_routes);
+  const auto& addrs = routing_table.Addresses();
+  const auto shm_count =
+      std::count_if(addrs.begin(), addrs.end(), [](const auto& addr) {
+        return orderbook::util::IsShmAddress(addr);
+      });
+
+  // shm:// connects to the orderbook over shared memory rather than zmq,
+  // all engines of a gateway share one transport
+  if (shm_count == static_cast<std::ptrdiff_t>(addrs.size())) {
+    RunGateway<orderbook::util::ShmClientSocketProvider>(
+        file, std::move(routing_table), max_batch, deadline, codec,
+        std::move(reference_data), std::move(risk_engine));
+  } else if (shm_count == 0) {
+    RunGateway<orderbook::util::ClientSocketProvider>(
+        file, std::move(routing_table), max_batch, deadline, codec,
+        std::move(reference_data), std::move(risk_engine));
+  } else {
+    spdlog::error("orderbook routes mix shm:// and zmq addresses");
+    return 1;
+  }
 
   return 0;
 }
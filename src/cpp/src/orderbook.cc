@@ -1,11 +1,361 @@
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include <iostream>
 #include <map>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "orderbook/application_traits.h"
+#include "orderbook/book/book_registry.h"
+#include "orderbook/book/checkpoint.h"
+#include "orderbook/data/event_record.h"
+#include "orderbook/data/fixed_codec.h"
+#include "orderbook/data/reference_data.h"
+#include "orderbook/data/request_view.h"
+#include "orderbook/feed/market_by_order.h"
+#include "orderbook/feed/market_by_price.h"
+#include "orderbook/feed/snapshot_service.h"
+#include "orderbook/util/builder_pool.h"
+#include "orderbook/util/journal.h"
+#include "orderbook/util/shm_socket_providers.h"
+#include "orderbook/util/spsc_ring.h"
+#include "orderbook/util/thread_util.h"
 
 using namespace orderbook::data;
 
+/**
+ * The preallocated ring a matching shard writes its event records into,
+ * along with the producer side backpressure counter.
+ */
+struct EventChannel {
+  constexpr static std::size_t kRingSize = 16384;
+
+  using EventRing = orderbook::util::SpscRing<EventRecord, kRingSize>;
+
+  EventRing ring;
+  alignas(64) std::atomic<std::uint64_t> full_count{0};
+};
+
+/**
+ * The instrument a request applies to, zero for requests that are not tied
+ * to a single instrument (cancel on disconnect). Message is either codec's.
+ */
+template <typename Message>
+auto InstrumentOf(const Message* flatc_msg) -> InstrumentId {
+  using EventTypeCode = orderbook::serialize::EventTypeCode;
+
+  switch (flatc_msg->header()->event_type()) {
+    case EventTypeCode::OrderPendingNew:
+      return flatc_msg->body_as_NewOrderSingle()->instrument_id();
+    case EventTypeCode::OrderPendingModify:
+      return flatc_msg->body_as_OrderCancelReplaceRequest()->instrument_id();
+    case EventTypeCode::OrderPendingCancel:
+      return flatc_msg->body_as_OrderCancelRequest()->instrument_id();
+    default:
+      return 0;
+  }
+}
+
+/**
+ * Order requests belong to the one shard their instrument routes to, any
+ * other message, such as cancel-on-disconnect, goes to every shard.
+ */
+template <typename Message>
+auto IsOrderRequest(const Message* flatc_msg) -> bool {
+  using EventTypeCode = orderbook::serialize::EventTypeCode;
+
+  switch (flatc_msg->header()->event_type()) {
+    case EventTypeCode::OrderPendingNew:
+    case EventTypeCode::OrderPendingModify:
+    case EventTypeCode::OrderPendingCancel:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/**
+ * Egress stage for a single shard. Consumes the shard's event records,
+ * coalesces them per routing id and, at every batch end, serializes and
+ * sends one frame per client: a MultiMessage, or a plain Message when the
+ * batch holds a single event, in the codec the client sends its requests
+ * in. When market data is enabled the same records
+ * drive the shard's L2 and L3 feeds, published at the same batch ends, and
+ * L2 snapshots are published between batches.
+ * Only ever touched by the publisher thread.
+ */
+template <typename ServerSocket>
+class EventPublisher {
+ private:
+  using SequenceNumber = std::uint32_t;
+  using TimeUtil = orderbook::util::TimeUtil;
+  using MessageOffset = flatbuffers::Offset<orderbook::serialize::Message>;
+  using Clock = std::chrono::steady_clock;
+  using FeedSocket = orderbook::util::XPubSocketProvider;
+  using MarketByPrice = orderbook::feed::MarketByPrice<FeedSocket>;
+  using MarketByOrder = orderbook::feed::MarketByOrder<FeedSocket>;
+  using SnapshotService = orderbook::feed::SnapshotService<FeedSocket>;
+  using SnapshotOptions = orderbook::feed::SnapshotOptions;
+
+ public:
+  constexpr static std::size_t kBufferSize = 2048;
+  constexpr static std::size_t kBuilderPoolSize = 1024;
+
+ private:
+  using BuilderPool =
+      orderbook::util::BuilderPool<kBuilderPoolSize, kBufferSize>;
+  using PooledBuilder = BuilderPool::PooledBuilder;
+
+  /**
+   * Every event for one routing id since the last batch end. The builder
+   * is taken from the pool when the batch starts and handed to zmq, without
+   * a copy, when it is flushed. Fixed layout batches are encoded straight
+   * into the batch's frame writer instead. The message vector and the frame
+   * writer are reused.
+   */
+  struct OutboundBatch {
+    RoutingId routing_id{0};
+    Codec codec{Codec::kFlatBuffers};
+    PooledBuilder* builder{nullptr};
+    std::vector<MessageOffset> messages;
+    FixedFrameWriter frames{kBufferSize};
+  };
+
+ public:
+  EventPublisher(const std::size_t& shard_id, EventChannel& channel,
+                 ServerSocket& socket)
+      : shard_id_(shard_id), channel_(channel), socket_(socket) {}
+
+  /**
+   * Publish the shard's market by price and market by order feeds, and its
+   * book snapshots, on feed_socket.
+   */
+  auto EnableMarketData(FeedSocket& feed_socket,
+                        const SnapshotOptions& snapshot_options) -> void {
+    market_by_price_ = std::make_unique<MarketByPrice>(feed_socket);
+    market_by_order_ = std::make_unique<MarketByOrder>(feed_socket);
+    snapshots_ = std::make_unique<SnapshotService>(
+        feed_socket, *market_by_price_, snapshot_options);
+  }
+
+  /**
+   * Snapshots are only taken between batches, when the level aggregates
+   * match the last published L2 sequence numbers.
+   */
+  auto PollSnapshots(const Clock::time_point& now) -> void {
+    if (snapshots_ && !market_by_price_->HasPendingUpdates()) {
+      snapshots_->Poll(now);
+    }
+  }
+
+  auto OnSubscription(std::string_view topic) -> void {
+    if (snapshots_) {
+      snapshots_->OnSubscription(topic);
+    }
+  }
+
+  /**
+   * Drain every record currently in the ring, returns the number of records
+   * consumed. Frames are only sent while send_flag is set, otherwise they
+   * are serialized and discarded.
+   */
+  auto Poll(const bool send_flag) -> std::size_t {
+    high_water_ = std::max(high_water_, channel_.ring.Size());
+
+    std::size_t count = 0;
+    while (channel_.ring.TryPop(record_)) {
+      ++count;
+      if (record_.IsBatchEnd()) {
+        Flush(send_flag);
+        if (market_by_price_) {
+          market_by_price_->OnBatchEnd();
+          market_by_order_->OnBatchEnd();
+        }
+      } else {
+        Serialize(record_);
+        if (market_by_price_) {
+          market_by_price_->OnRecord(record_);
+          market_by_order_->OnRecord(record_);
+        }
+      }
+    }
+
+    records_ += count;
+    return count;
+  }
+
+  auto LogMetrics() const -> void {
+    spdlog::info(
+        "publisher {}: records {}, frames {}, ring high water {}/{}, "
+        "producer ring full {}, builder pool exhausted {}",
+        shard_id_, records_, frames_, high_water_, channel_.ring.Capacity(),
+        channel_.full_count.load(std::memory_order_relaxed),
+        pool_.ExhaustedCount());
+
+    if (market_by_price_) {
+      spdlog::info(
+          "publisher {}: L2 messages {}, level updates {}, L3 messages {}, "
+          "order updates {}, snapshots {}",
+          shard_id_, market_by_price_->MessageCount(),
+          market_by_price_->UpdateCount(), market_by_order_->MessageCount(),
+          market_by_order_->UpdateCount(), snapshots_->SnapshotCount());
+    }
+  }
+
+ private:
+  /**
+   * The codec of the client record is sent to. Records answering a request
+   * carry the request's codec, which is remembered for the client's other
+   * events (fills against its resting orders); clients never seen default
+   * to flatbuffers.
+   */
+  auto CodecFor(const EventRecord& record) -> Codec {
+    if (record.codec != Codec::kUnknown) {
+      codecs_[record.routing_id] = record.codec;
+      return record.codec;
+    }
+
+    const auto iter = codecs_.find(record.routing_id);
+    return iter == codecs_.end() ? Codec::kFlatBuffers : iter->second;
+  }
+
+  /**
+   * Return the pending batch for the record's routing id, starting a new
+   * one if this is the first event for that client since the last flush.
+   */
+  auto BatchFor(const EventRecord& record) -> OutboundBatch& {
+    const auto codec = CodecFor(record);
+    for (std::size_t i = 0; i < batch_count_; ++i) {
+      if (batches_[i].routing_id == record.routing_id) {
+        return batches_[i];
+      }
+    }
+
+    if (batch_count_ == batches_.size()) {
+      batches_.emplace_back();
+    }
+
+    auto& batch = batches_[batch_count_++];
+    batch.routing_id = record.routing_id;
+    batch.codec = codec;
+    if (codec == Codec::kFlatBuffers) {
+      batch.builder = &pool_.Acquire();
+    }
+    return batch;
+  }
+
+  auto Serialize(const EventRecord& record) -> void {
+    using namespace orderbook::serialize;
+
+    auto& batch = BatchFor(record);
+    if (batch.codec == Codec::kFixed) {
+      record.EncodeTo(batch.frames, ++seq_no_, TimeUtil::EpochNanos());
+      return;
+    }
+
+    auto& builder = batch.builder->Builder();
+    batch.messages.push_back(CreateMessage(
+        builder,
+        CreateHeader(builder, TimeUtil::EpochNanos(), ++seq_no_,
+                     record.GetSerializedEventType()),
+        record.GetBodyType(), record.SerializeTo(builder)));
+  }
+
+  auto Flush(const bool send_flag) -> void {
+    using namespace orderbook::serialize;
+
+    for (std::size_t i = 0; i < batch_count_; ++i) {
+      auto& batch = batches_[i];
+      if (batch.codec == Codec::kFixed) {
+        Flush(batch, send_flag);
+        continue;
+      }
+
+      auto& builder = batch.builder->Builder();
+
+      if (batch.messages.size() == 1) {
+        builder.Finish(batch.messages.front());
+      } else {
+        builder.Finish(CreateMultiMessage(
+            builder,
+            CreateHeader(builder, TimeUtil::EpochNanos(), ++seq_no_,
+                         EventTypeCode::MultiMessage),
+            builder.CreateVector(batch.messages)));
+      }
+
+      if (send_flag) {
+        // zmq releases the builder back to the pool once the frame is sent
+        socket_.SendFlatBuffer(batch.builder->Data(), batch.builder->Size(),
+                               batch.routing_id, &PooledBuilder::OnSent,
+                               batch.builder);
+        ++frames_;
+      } else {
+        batch.builder->Release();
+      }
+
+      batch.builder = nullptr;
+      batch.messages.clear();
+    }
+
+    batch_count_ = 0;
+  }
+
+  /**
+   * Fixed layout frames are copied by the socket, the writer is reused.
+   */
+  auto Flush(OutboundBatch& batch, const bool send_flag) -> void {
+    if (batch.frames.Empty()) {
+      return;
+    }
+
+    batch.frames.Finish(++seq_no_, TimeUtil::EpochNanos());
+    if (send_flag) {
+      socket_.SendFlatBuffer(batch.frames.Data(), batch.frames.Size(),
+                             batch.routing_id);
+      ++frames_;
+    }
+    batch.frames.Clear();
+  }
+
+  std::size_t shard_id_;
+  EventChannel& channel_;
+  ServerSocket& socket_;
+
+  EventRecord record_;
+  SequenceNumber seq_no_{0};
+  BuilderPool pool_;
+  std::vector<OutboundBatch> batches_;
+  std::size_t batch_count_{0};
+  std::unordered_map<RoutingId, Codec> codecs_;
+  std::unique_ptr<MarketByPrice> market_by_price_;
+  std::unique_ptr<MarketByOrder> market_by_order_;
+  std::unique_ptr<SnapshotService> snapshots_;
+
+  std::uint64_t records_{0};
+  std::uint64_t frames_{0};
+  std::size_t high_water_{0};
+};
+
+/**
+ * Market data is published on addr, when set.
+ */
+struct MarketDataOptions {
+  std::string addr;
+  orderbook::feed::SnapshotOptions snapshot;
+};
+
+/**
+ * A matching shard owns a disjoint subset of the instrument books. Books
+ * publish straight into the shard through a static event sink, which copies
+ * each event into a fixed layout record on the shard's event ring; a batch
+ * end record follows every inbound message (or drained batch). Serializing
+ * and sending is left to the publisher thread. In sharded mode a shard runs
+ * on a dedicated (pinned) thread and receives inbound messages over a
+ * single-producer / single-consumer ring, in inline mode it is driven
+ * directly by the socket thread.
+ */
 // clang-format off
 template <typename OrderBookTraits>
 
@@ -16,100 +366,370 @@ template <typename OrderBookTraits>
       orderbook::container::ContainerConcept<typename OrderBookTraits::AskContainerType,
                                              typename OrderBookTraits::OrderType> )
 
-class OrderBook {  // clang-format on
+class MatchingShard {  // clang-format on
  private:
-  using RoutingId = std::uint32_t;
-  using SequenceNumber = std::uint32_t;
-  using TimeUtil = orderbook::util::TimeUtil;
-  using BookType = typename OrderBookTraits::BookType;
+  using ThreadUtil = orderbook::util::ThreadUtil;
+  using CheckpointReader = orderbook::book::CheckpointReader;
   using EventType = typename OrderBookTraits::EventType;
-  using EventData = typename OrderBookTraits::EventData;
-  using Order = typename OrderBookTraits::OrderType;
-  using BookMap = std::unordered_map<InstrumentId, BookType>;
-  using ServerSocket = orderbook::util::ServerSocketProvider;
-  using EventDispatcher = typename OrderBookTraits::EventDispatcher;
-  using EventDispatcherPtr = std::shared_ptr<EventDispatcher>;
+
+  /**
+   * Forwards book events to the owning shard, resolved at compile time.
+   */
+  struct ShardEventSink {
+    MatchingShard* shard;
+
+    auto OnExecutionReport(const EventType& event_type,
+                           const ExecutionView& execution_view) -> void {
+      shard->Emit(EventRecord(event_type, execution_view));
+    }
+
+    auto OnCancelReject(const EventType& event_type,
+                        const OrderCancelReject& order_cancel_reject) -> void {
+      shard->Emit(EventRecord(event_type, order_cancel_reject));
+    }
+  };
+
+  using BookType =
+      typename OrderBookTraits::template StaticBookType<ShardEventSink>;
+  using BookRegistry = orderbook::book::BookRegistry<BookType>;
 
  public:
-  constexpr static std::size_t kBufferSize = 2048;
-  constexpr static std::size_t kInstrumentCount = 2048;
+  constexpr static std::size_t kRingSize = 16384;
+  constexpr static std::size_t kDrainLimit = 64;
 
-  OrderBook(std::string addr)
-      : dispatcher_(std::make_shared<EventDispatcher>()),
-        addr_(std::move(addr)) {}
+  using MessageRing = orderbook::util::SpscRing<zmq::message_t, kRingSize>;
 
-  auto GenerateOrderBooks() -> void {
-    // Normally this would be driven by some rational symbology process.
-    std::size_t instrument_id = 1;
-    for (; instrument_id <= kInstrumentCount; ++instrument_id) {
-      book_map_.emplace(std::make_pair(instrument_id, BookType(dispatcher_)));
+  MatchingShard(const std::size_t& shard_id, const std::size_t& shard_count)
+      : shard_id_(shard_id),
+        shard_count_(shard_count),
+        books_([this](const InstrumentId& instrument_id) {
+          return std::make_unique<BookType>(ShardEventSink{this},
+                                            instrument_id);
+        }) {}
+
+  /**
+   * List a book, it is constructed on its first request.
+   */
+  auto AddBook(const InstrumentId& instrument_id) -> void {
+    books_.Add(instrument_id);
+  }
+
+  auto BookCount() const -> std::size_t { return books_.Size(); }
+
+  /**
+   * Decode and apply an inbound message to the books owned by this shard.
+   * Fixed layout frames are bounds checked first and dropped when
+   * malformed.
+   */
+  auto Process(const zmq::message_t& msg) -> void {
+    if (!IsFixedFrame(msg.data(), msg.size())) {
+      Process<Codec::kFlatBuffers>(msg);
+    } else if (VerifyFixedFrame(msg.data(), msg.size())) {
+      Process<Codec::kFixed>(msg);
+    } else {
+      spdlog::warn("dropped malformed fixed layout frame, size {}",
+                   msg.size());
     }
   }
 
-  auto RegisterListeners() -> void {
-    dispatcher_->appendListener(
-        EventType::kOrderPendingNew, [&](const EventData& data) {
-          spdlog::info("EventType::kOrderPendingNew");
+  /**
+   * A MultiMessage batch may span shards, only the requests for this
+   * shard's books are applied.
+   */
+  template <Codec C>
+  auto Process(const zmq::message_t& msg) -> void {
+    using Traits = CodecTraits<C>;
 
-          HandleExecutionReport(std::get<ExecutionReport>(data),
-                                EventType::kOrderPendingNew);
-        });
+    request_codec_ = C;
+    request_routing_id_ = msg.routing_id();
 
-    dispatcher_->appendListener(
-        EventType::kOrderNew, [&](const EventData& data) {
-          spdlog::info("EventType::kOrderNew");
+    const auto* flatc_msg =
+        Traits::template GetRoot<typename Traits::Message>(msg.data());
+    if (flatc_msg->header()->event_type() ==
+        orderbook::serialize::EventTypeCode::MultiMessage) {
+      const auto* multi_msg =
+          Traits::template GetRoot<typename Traits::MultiMessage>(msg.data());
+      for (const auto* message : Traits::Messages(multi_msg)) {
+        if (Owns(message)) {
+          Process(message, msg.routing_id());
+        }
+      }
+    } else {
+      Process(flatc_msg, msg.routing_id());
+    }
+  }
 
-          HandleExecutionReport(std::get<ExecutionReport>(data),
-                                EventType::kOrderNew);
-        });
+  /**
+   * Apply a single request. Requests are read in place from the message
+   * buffer.
+   */
+  template <typename Message>
+  auto Process(const Message* flatc_msg, const RoutingId& routing_id)
+      -> void {
+    auto event_type = flatc_msg->header()->event_type();
 
-    dispatcher_->appendListener(
-        EventType::kOrderPartiallyFilled, [&](const EventData& data) {
-          spdlog::info("EventType::kOrderPartiallyFilled");
+    auto book_of = [&](const auto& instrument_id) -> BookType* {
+      auto* book = books_.Find(instrument_id);
+      if (book == nullptr) {
+        spdlog::warn("received invalid instrument_id: {}", instrument_id);
+      }
+      return book;
+    };
 
-          HandleExecutionReport(std::get<ExecutionReport>(data),
-                                EventType::kOrderPartiallyFilled);
-        });
+    if (event_type == orderbook::serialize::EventTypeCode::OrderPendingNew) {
+      const auto* table = flatc_msg->body_as_NewOrderSingle();
+      const auto order = RequestView(table, routing_id);
+      if (auto* book = book_of(order.GetInstrumentId()); book != nullptr) {
+        book->Add(order);
+      } else {
+        // TODO: send reject
+      }
+    } else if (event_type ==
+               orderbook::serialize::EventTypeCode::OrderPendingModify) {
+      const auto* table = flatc_msg->body_as_OrderCancelReplaceRequest();
+      const auto modify = RequestView(table, routing_id);
+      if (auto* book = book_of(modify.GetInstrumentId()); book != nullptr) {
+        book->Modify(modify);
+      } else {
+        // TODO: send reject
+      }
+    } else if (event_type ==
+               orderbook::serialize::EventTypeCode::OrderPendingCancel) {
+      const auto* table = flatc_msg->body_as_OrderCancelRequest();
+      const auto cancel = RequestView(table, routing_id);
+      if (auto* book = book_of(cancel.GetInstrumentId()); book != nullptr) {
+        book->Cancel(cancel);
+      } else {
+        // TODO: send reject
+      }
+    } else if (event_type ==
+               orderbook::serialize::EventTypeCode::CancelOnDisconnect) {
+      const auto* table = flatc_msg->body_as_OrderCancelRequest();
+      const auto& session_id = table->session_id();
+      std::size_t deleted_order_count{0};
+      books_.ForEach([&](auto& book) {
+        deleted_order_count += book.CancelAll(session_id);
+      });
+      spdlog::info(
+          "CancelOnDisconnect for shard {}, session {}, removed {} orders",
+          shard_id_, session_id, deleted_order_count);
+    } else {
+      spdlog::warn("received unknown orderbook::serialize::EventTypeCode");
+      // TODO: Send Reject
+      return;
+    }
+  }
 
-    dispatcher_->appendListener(
-        EventType::kOrderFilled, [&](const EventData& data) {
-          spdlog::info("EventType::kOrderFilled");
+  /**
+   * Mark the end of a batch, the publisher flushes every event it has
+   * coalesced since the previous batch end.
+   */
+  auto Flush() -> void {
+    if (pending_) {
+      Emit(EventRecord::MakeBatchEnd());
+      pending_ = false;
+    }
+  }
 
-          HandleExecutionReport(std::get<ExecutionReport>(data),
-                                EventType::kOrderFilled);
-        });
+  /**
+   * Worker loop used in sharded mode. Restores the shard's books from
+   * checkpoint, when given, then drains up to kDrainLimit inbound messages,
+   * flushing their events once per drained batch. Runs until stopped, then
+   * releases every resting order back to this thread's object pool.
+   */
+  auto Run(const std::atomic<bool>& running, const int cpu,
+           const CheckpointReader* checkpoint) -> void {
+    ThreadUtil::PinCurrentThread(cpu);
+    if (checkpoint != nullptr) {
+      Restore(*checkpoint);
+    }
+    started_.store(true, std::memory_order_release);
+    spdlog::info("shard {} running on cpu {}, books {}", shard_id_, cpu,
+                 books_.Size());
 
-    dispatcher_->appendListener(
-        EventType::kOrderCancelled, [&](const EventData& data) {
-          spdlog::info("EventType::kOrderCancelled");
+    zmq::message_t msg;
+    while (running.load(std::memory_order_relaxed)) {
+      std::size_t drained = 0;
+      while (drained < kDrainLimit && inbound_.TryPop(msg)) {
+        Process(msg);
+        ++drained;
+      }
 
-          HandleExecutionReport(std::get<ExecutionReport>(data),
-                                EventType::kOrderCancelled);
-        });
+      if (drained == 0) {
+        std::this_thread::yield();
+      } else {
+        Flush();
+        processed_.fetch_add(drained, std::memory_order_release);
+      }
+    }
 
-    dispatcher_->appendListener(
-        EventType::kOrderRejected, [&](const EventData& data) {
-          spdlog::info("EventType::kOrderRejected");
+    books_.ForEach([](auto& book) { book.Reset(); });
+  }
 
-          HandleExecutionReport(std::get<ExecutionReport>(data),
-                                EventType::kOrderRejected);
+  /**
+   * Restore the checkpointed books this shard owns. Orders are taken from
+   * the calling thread's object pool, so a sharded shard restores on its
+   * own thread. Each restored order is published as new, one batch for the
+   * lot, while the orderbook is still replaying.
+   */
+  auto Restore(const CheckpointReader& checkpoint) -> void {
+    const auto orders =
+        checkpoint.Restore([this](const InstrumentId& instrument_id) {
+          return books_.Find(instrument_id);
         });
+    Flush();
+    spdlog::info("shard {} restored {} orders from {}", shard_id_, orders,
+                 checkpoint.Path());
+  }
 
-    dispatcher_->appendListener(
-        EventType::kOrderModified, [&](const EventData& data) {
-          spdlog::info("EventType::kOrderModified");
+  /**
+   * Apply fn to every book of the shard, while it is drained.
+   */
+  template <typename Fn>
+  auto ForEachBook(Fn&& fn) -> void {
+    books_.ForEach(fn);
+  }
 
-          HandleExecutionReport(std::get<ExecutionReport>(data),
-                                EventType::kOrderModified);
-        });
+  auto Inbound() -> MessageRing& { return inbound_; }
+  auto Events() -> EventChannel& { return events_; }
+  auto Started() const -> bool {
+    return started_.load(std::memory_order_acquire);
+  }
 
-    dispatcher_->appendListener(
-        EventType::kOrderCancelRejected, [&](const EventData& data) {
-          spdlog::info("EventType::kOrderCancelRejected");
+  /**
+   * Count a message pushed onto the inbound ring, socket thread only.
+   */
+  auto OnEnqueued() -> void { ++enqueued_; }
 
-          HandleOrderCancelReject(std::get<OrderCancelReject>(data),
-                                  EventType::kOrderCancelRejected);
-        });
+  /**
+   * True once every message enqueued has been processed and flushed, the
+   * books are left alone until the next one. Socket thread only.
+   */
+  auto Drained() const -> bool {
+    return processed_.load(std::memory_order_acquire) == enqueued_;
+  }
+
+  /**
+   * Drained, and the publisher has taken every event record.
+   */
+  auto Idle() const -> bool { return Drained() && events_.ring.Empty(); }
+
+ private:
+  /**
+   * Routed as in OrderBook::ShardOf, so a request for an invalid instrument
+   * is rejected by a single shard.
+   */
+  template <typename Message>
+  auto Owns(const Message* flatc_msg) const -> bool {
+    return !IsOrderRequest(flatc_msg) ||
+           InstrumentOf(flatc_msg) % shard_count_ == shard_id_;
+  }
+
+  /**
+   * Hand a record to the publisher, spinning while the event ring is full.
+   * Records for the requesting client are stamped with its codec.
+   */
+  auto Emit(EventRecord&& record) -> void {
+    if (record.routing_id == request_routing_id_) {
+      record.codec = request_codec_;
+    }
+
+    if (!events_.ring.TryPush(std::move(record))) {
+      events_.full_count.fetch_add(1, std::memory_order_relaxed);
+      do {
+        ThreadUtil::Pause();
+      } while (!events_.ring.TryPush(std::move(record)));
+    }
+
+    pending_ = true;
+  }
+
+  std::size_t shard_id_;
+  std::size_t shard_count_;
+  BookRegistry books_;
+  bool pending_{false};
+  Codec request_codec_{Codec::kFlatBuffers};
+  RoutingId request_routing_id_{0};
+
+  MessageRing inbound_;
+  EventChannel events_;
+  std::uint64_t enqueued_{0};
+  alignas(64) std::atomic<std::uint64_t> processed_{0};
+  std::atomic<bool> started_{false};
+};
+
+// clang-format off
+template <typename OrderBookTraits,
+          typename ServerSocket = orderbook::util::ServerSocketProvider>
+
+  requires
+    ( orderbook::book::BookConcept<typename OrderBookTraits::BookType> &&
+      orderbook::container::ContainerConcept<typename OrderBookTraits::BidContainerType,
+                                             typename OrderBookTraits::OrderType> &&
+      orderbook::container::ContainerConcept<typename OrderBookTraits::AskContainerType,
+                                             typename OrderBookTraits::OrderType> )
+
+class OrderBook {  // clang-format on
+ private:
+  using ThreadUtil = orderbook::util::ThreadUtil;
+  using ReceiveOptions = orderbook::util::ReceiveOptions;
+  using JournalOptions = orderbook::util::JournalOptions;
+  using JournalMode = orderbook::util::JournalMode;
+  using JournalWriter = orderbook::util::JournalWriter;
+  using JournalReader = orderbook::util::JournalReader;
+  using CheckpointReader = orderbook::book::CheckpointReader;
+  using CheckpointWriter = orderbook::book::CheckpointWriter;
+  using FeedSocket = orderbook::util::XPubSocketProvider;
+  using Shard = MatchingShard<OrderBookTraits>;
+  using ShardPtr = std::unique_ptr<Shard>;
+  using Publisher = EventPublisher<ServerSocket>;
+  using PublisherPtr = std::unique_ptr<Publisher>;
+  using Clock = std::chrono::steady_clock;
+
+ public:
+  constexpr static int kFirstShardCpu = 1;
+  constexpr static std::chrono::seconds kMetricsInterval{10};
+  constexpr static std::chrono::milliseconds kSubscriptionInterval{1};
+
+  /**
+   * A shard_count of zero runs every book inline on the socket thread,
+   * otherwise books are partitioned across shard_count worker threads.
+   * Either way events are serialized and sent by the publisher thread.
+   * receive_options control how the socket thread waits for requests.
+   * market_data, when its address is set, publishes the L2 and L3 feeds
+   * and book snapshots. A book is generated for every instrument listed in
+   * reference_data. journal, when its directory is set, journals every
+   * inbound message, and may first replay the journal, from its newest
+   * checkpoint when there is one. It also sets how often checkpoints are
+   * taken.
+   */
+  OrderBook(std::string addr, ReferenceData reference_data,
+            const std::size_t& shard_count = 0,
+            const ReceiveOptions& receive_options = {},
+            MarketDataOptions market_data = {}, JournalOptions journal = {})
+      : addr_(std::move(addr)),
+        reference_data_(std::move(reference_data)),
+        market_data_(std::move(market_data)),
+        journal_(std::move(journal)),
+        shard_count_(shard_count) {
+    socket_.SetReceiveOptions(receive_options);
+
+    const std::size_t count = std::max<std::size_t>(shard_count_, 1);
+    for (std::size_t i = 0; i < count; ++i) {
+      auto& shard = shards_.emplace_back(
+          std::make_unique<Shard>(i, count));
+      auto& publisher = publishers_.emplace_back(
+          std::make_unique<Publisher>(i, shard->Events(), socket_));
+      if (HasMarketData()) {
+        publisher->EnableMarketData(md_socket_, market_data_.snapshot);
+      }
+    }
+  }
+
+  auto GenerateOrderBooks() -> void {
+    for (const auto& instrument : reference_data_.Instruments()) {
+      ShardOf(instrument.instrument_id).AddBook(instrument.instrument_id);
+    }
   }
 
   auto Run() -> void {
@@ -118,147 +738,562 @@ class OrderBook {  // clang-format on
                    event.value);
     };
 
+    if (HasMarketData()) {
+      md_socket_.Bind(market_data_.addr);
+    }
+
+    // the checkpoint is only read while the shards start
+    const auto checkpoint = Recovering() ? OpenCheckpoint() : nullptr;
+    checkpoint_sequence_ = checkpoint ? checkpoint->JournalSequence() : 0;
+
+    // restored orders are published to market data only, like replay
+    running_ = true;
+    replaying_ = Recovering();
+    publisher_running_ = true;
+    publisher_thr_ = std::thread([&]() { Publish(); });
+    if (IsSharded()) {
+      StartShards(checkpoint.get());
+    } else if (checkpoint) {
+      shards_.front()->Restore(*checkpoint);
+    }
+
+    if (Recovering()) {
+      Replay(checkpoint_sequence_);
+      if (journal_.mode == JournalMode::kReplay) {
+        Stop();
+        return;
+      }
+    }
+    if (HasJournal()) {
+      journal_writer_ = std::make_unique<JournalWriter>(journal_);
+      next_checkpoint_ = Clock::now() + journal_.checkpoint_interval;
+    }
+
     spdlog::info("socket_.bind({})", addr_);
     socket_.Monitor(socket_event);
     socket_.Bind(addr_);
-    socket_.ProcessMessages([&](zmq::message_t&& msg) {
-      const auto* flatc_msg = orderbook::serialize::GetMessage(msg.data());
-      auto event_type = flatc_msg->header()->event_type();
-
-      auto is_valid_instrument = [&](auto& instrument_id) -> bool {
-        if (instrument_id > kInstrumentCount) {
-          spdlog::warn("received invalid instrument_id: {}", instrument_id);
-          return false;
-        }
 
-        return true;
-      };
-
-      if (event_type == orderbook::serialize::EventTypeCode::OrderPendingNew) {
-        const auto* table = flatc_msg->body_as_NewOrderSingle();
-        auto order = NewOrderSingle(table);
-        order.SetRoutingId(msg.routing_id());
-        const auto& instrument_id = order.GetInstrumentId();
-        if (is_valid_instrument(instrument_id)) {
-          book_map_.at(instrument_id).Add(order);
-        } else {
-          // TODO: send reject
-        }
-      } else if (event_type ==
-                 orderbook::serialize::EventTypeCode::OrderPendingModify) {
-        const auto* table = flatc_msg->body_as_OrderCancelReplaceRequest();
-        auto modify = OrderCancelReplaceRequest(table);
-        modify.SetRoutingId(msg.routing_id());
-        const auto& instrument_id = modify.GetInstrumentId();
-        if (is_valid_instrument(instrument_id)) {
-          book_map_.at(instrument_id).Modify(modify);
-        } else {
-          // TODO: send reject
-        }
-      } else if (event_type ==
-                 orderbook::serialize::EventTypeCode::OrderPendingCancel) {
-        const auto* table = flatc_msg->body_as_OrderCancelRequest();
-        auto cancel = OrderCancelRequest(table);
-        cancel.SetRoutingId(msg.routing_id());
-        const auto& instrument_id = cancel.GetInstrumentId();
-        if (is_valid_instrument(instrument_id)) {
-          book_map_.at(instrument_id).Cancel(cancel);
-        } else {
-          // TODO: send reject
-        }
-      } else if (event_type ==
-                 orderbook::serialize::EventTypeCode::CancelOnDisconnect) {
-        const auto* table = flatc_msg->body_as_OrderCancelRequest();
-        const auto& session_id = table->session_id();
-        std::size_t deleted_order_count{0};
-        for ([[maybe_unused]] auto& [key, book] : book_map_) {
-          spdlog::info("CancelOnDisconnect for key {}, session {}",
-                        key, session_id);
-          deleted_order_count += book.CancelAll(session_id);
-        }
-        spdlog::info("CancelOnDisconnect for session {}, removed {} orders",
-                      session_id, deleted_order_count);
-      } else {
-        spdlog::warn("received unknown orderbook::serialize::EventTypeCode");
-        // TODO: Send Reject
-        return;
-      }
-    });
+    if (IsSharded()) {
+      socket_.ProcessMessages([&](zmq::message_t&& msg) { Receive(msg); },
+                              [&]() { Commit(); });
+    } else {
+      auto& shard = *shards_.front();
+      socket_.ProcessMessages([&](zmq::message_t&& msg) { Receive(msg); },
+                              [&]() {
+                                shard.Flush();
+                                Commit();
+                              });
+    }
+
+    Stop();
   }
 
  private:
-  auto GetSerializedEventType(const EventType& event_type) const
-      -> orderbook::serialize::EventTypeCode {
-    return static_cast<orderbook::serialize::EventTypeCode>(event_type);
+  auto IsSharded() const -> bool { return shard_count_ > 0; }
+  auto HasMarketData() const -> bool { return !market_data_.addr.empty(); }
+  auto HasJournal() const -> bool { return !journal_.dir.empty(); }
+  auto Recovering() const -> bool {
+    return HasJournal() && journal_.mode != JournalMode::kRecord;
   }
 
-  auto SerializeExecutionReport(flatbuffers::FlatBufferBuilder& builder,
-                                const EventType& event_type,
-                                const ExecutionReport& execution_report)
-      -> void {
-    using namespace orderbook::serialize;
+  auto ShardOf(const InstrumentId& instrument_id) -> Shard& {
+    return *shards_[instrument_id % shards_.size()];
+  }
 
-    builder.Clear();
-    builder.Finish(CreateMessage(
-        builder_,
-        CreateHeader(builder, TimeUtil::EpochNanos(), ++seq_no_,
-                     GetSerializedEventType(event_type)),
-        Body::ExecutionReport, execution_report.SerializeTo(builder).Union()));
+  /**
+   * Start a worker for each shard, returns once every shard has restored
+   * its books from checkpoint, when given, and is taking messages.
+   */
+  auto StartShards(const CheckpointReader* checkpoint) -> void {
+    const int cpu_count = ThreadUtil::HardwareConcurrency();
+    for (std::size_t i = 0; i < shards_.size(); ++i) {
+      const int cpu = static_cast<int>((kFirstShardCpu + i) % cpu_count);
+      workers_.emplace_back([this, i, cpu, checkpoint]() {
+        shards_[i]->Run(running_, cpu, checkpoint);
+      });
+    }
+
+    while (!std::all_of(shards_.begin(), shards_.end(),
+                        [](const auto& shard) { return shard->Started(); })) {
+      std::this_thread::yield();
+    }
   }
 
-  auto SerializeOrderCancelReject(flatbuffers::FlatBufferBuilder& builder,
-                                  const EventType& event_type,
-                                  const OrderCancelReject& order_cancel_reject)
-      -> void {
-    using namespace orderbook::serialize;
+  /**
+   * Journal an inbound message, then route it to its shards or, inline,
+   * process it. Malformed messages are journaled too, replay drops them
+   * again.
+   */
+  auto Receive(zmq::message_t& msg) -> void {
+    if (journal_writer_) {
+      journal_writer_->Append(msg.routing_id(), msg.data(), msg.size());
+    }
+
+    if (IsSharded()) {
+      Route(msg);
+    } else {
+      shards_.front()->Process(msg);
+    }
+  }
+
+  auto Commit() -> void {
+    if (journal_writer_) {
+      journal_writer_->Commit();
+      MaybeCheckpoint();
+    }
+  }
+
+  /**
+   * The newest checkpoint in the journal directory, nullptr if there is
+   * none or it cannot be read, in which case the whole journal is replayed.
+   */
+  auto OpenCheckpoint() const -> std::unique_ptr<CheckpointReader> {
+    const auto path = CheckpointReader::Latest(journal_.dir);
+    if (path.empty()) {
+      return nullptr;
+    }
+
+    try {
+      auto checkpoint = std::make_unique<CheckpointReader>(path);
+      spdlog::info("checkpoint {}: journal sequence {}, books {}, orders {}",
+                   path, checkpoint->JournalSequence(),
+                   checkpoint->BookCount(), checkpoint->OrderCount());
+      return checkpoint;
+    } catch (const std::exception& e) {
+      spdlog::error("ignoring checkpoint: {}", e.what());
+      return nullptr;
+    }
+  }
+
+  /**
+   * At a batch end: collect a finished checkpoint, and take the next one
+   * once the interval has passed and there is anything new to save.
+   */
+  auto MaybeCheckpoint() -> void {
+    if (checkpoint_pid_ > 0 && !ReapCheckpoint(WNOHANG)) {
+      return;
+    }
+    if (journal_.checkpoint_interval.count() == 0 ||
+        Clock::now() < next_checkpoint_) {
+      return;
+    }
+
+    next_checkpoint_ = Clock::now() + journal_.checkpoint_interval;
+    if (journal_writer_->Sequence() != checkpoint_sequence_) {
+      Checkpoint(journal_writer_->Sequence());
+    }
+  }
+
+  /**
+   * Waits for the shards to apply every message routed so far, so the
+   * books match the journal at sequence, then forks. The child writes the
+   * checkpoint from its copy-on-write image of the books while matching
+   * carries on in the parent; matching only pauses for the shards to
+   * drain their inbound rings and for the fork itself, which copies the
+   * page tables.
+   */
+  auto Checkpoint(const std::uint64_t& sequence) -> void {
+    const auto start = Clock::now();
+    while (!std::all_of(shards_.begin(), shards_.end(),
+                        [](const auto& shard) { return shard->Drained(); })) {
+      ThreadUtil::Pause();
+    }
+
+    const pid_t pid = ::fork();
+    if (pid == 0) {
+      // the child is left with this thread only, it never returns into
+      // the orderbook or runs its destructors
+      ::_exit(WriteCheckpoint(sequence) ? 0 : 1);
+    }
+
+    const auto paused = std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - start);
+    if (pid < 0) {
+      spdlog::error("checkpoint fork failed: {}", std::strerror(errno));
+      return;
+    }
+
+    checkpoint_pid_ = pid;
+    checkpoint_pending_ = sequence;
+    spdlog::info("checkpoint at journal sequence {} forked as pid {}, "
+                 "matching paused {}us",
+                 sequence, pid, paused.count());
+  }
+
+  /**
+   * Runs in the checkpoint child. Errors go straight to stderr, the
+   * logger's lock may have been held by another thread at the fork.
+   */
+  auto WriteCheckpoint(const std::uint64_t& sequence) -> bool {
+    try {
+      std::size_t book_count{0};
+      std::size_t order_count{0};
+      for (auto& shard : shards_) {
+        shard->ForEachBook([&](auto& book) {
+          ++book_count;
+          order_count += book.OrderCount();
+        });
+      }
+
+      CheckpointWriter writer(journal_.dir, sequence, book_count, order_count);
+      for (auto& shard : shards_) {
+        shard->ForEachBook([&](auto& book) { writer.Add(book); });
+      }
+      writer.Commit();
+      return true;
+    } catch (const std::exception& e) {
+      const std::string_view what = e.what();
+      [[maybe_unused]] const auto written =
+          ::write(STDERR_FILENO, what.data(), what.size());
+      return false;
+    }
+  }
+
+  /**
+   * Collect the checkpoint child, options as for waitpid. Returns true once
+   * it has exited.
+   */
+  auto ReapCheckpoint(const int options) -> bool {
+    int status{0};
+    const pid_t pid = ::waitpid(checkpoint_pid_, &status, options);
+    if (pid == 0) {
+      return false;
+    }
+
+    if (pid == checkpoint_pid_ && WIFEXITED(status) &&
+        WEXITSTATUS(status) == 0) {
+      checkpoint_sequence_ = checkpoint_pending_;
+      spdlog::info("checkpoint at journal sequence {} written",
+                   checkpoint_sequence_);
+    } else {
+      spdlog::error("checkpoint at journal sequence {} failed",
+                    checkpoint_pending_);
+    }
+    checkpoint_pid_ = -1;
+    return true;
+  }
+
+  /**
+   * Feed the journal records after sequence after, those the restored
+   * checkpoint does not hold, back through Receive, as fast as the shards
+   * take them, each message its own batch. The books end up as they were
+   * when the journal was written, apart from timestamps. The events are
+   * published to market data but never sent to clients, whose routing ids
+   * are stale; replay only ends once the publisher has taken every event
+   * record, so no replayed event is sent once serving starts.
+   */
+  auto Replay(const std::uint64_t& after) -> void {
+    replaying_ = true;
+    const auto start = Clock::now();
+
+    const auto count = JournalReader::ForEach(
+        journal_.dir, after,
+        [&](const std::uint32_t& routing_id, const std::uint8_t* data,
+            const std::size_t& size) {
+          zmq::message_t msg(data, size);
+          msg.set_routing_id(routing_id);
+          Receive(msg);
+          if (!IsSharded()) {
+            shards_.front()->Flush();
+          }
+        });
+
+    while (!std::all_of(shards_.begin(), shards_.end(),
+                        [](const auto& shard) { return shard->Idle(); })) {
+      std::this_thread::yield();
+    }
+    replaying_ = false;
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - start);
+    spdlog::info("replayed {} messages from {} after sequence {} in {}us, "
+                 "{:.0f} messages/s",
+                 count, journal_.dir, after, elapsed.count(),
+                 count * 1e6 / std::max<std::int64_t>(elapsed.count(), 1));
+  }
+
+  /**
+   * The socket is already closed once ProcessMessages returns, so the
+   * publisher keeps draining (and discarding) event records until every
+   * worker has exited, which guarantees no worker is left spinning on a
+   * full ring.
+   */
+  auto Stop() -> void {
+    if (checkpoint_pid_ > 0) {
+      ReapCheckpoint(0);
+    }
+
+    running_ = false;
+    for (auto& worker : workers_) {
+      if (worker.joinable()) {
+        worker.join();
+      }
+    }
+
+    publisher_running_ = false;
+    if (publisher_thr_.joinable()) {
+      publisher_thr_.join();
+    }
+  }
 
-    builder.Clear();
-    builder.Finish(
-        CreateMessage(builder_,
-                      CreateHeader(builder, TimeUtil::EpochNanos(), ++seq_no_,
-                                   GetSerializedEventType(event_type)),
-                      Body::OrderCancelReject,
-                      order_cancel_reject.SerializeTo(builder).Union()));
+  /**
+   * Ingress: malformed fixed layout frames are dropped before they reach a
+   * shard.
+   */
+  auto Route(zmq::message_t& msg) -> void {
+    if (!IsFixedFrame(msg.data(), msg.size())) {
+      Route<Codec::kFlatBuffers>(msg);
+    } else if (VerifyFixedFrame(msg.data(), msg.size())) {
+      Route<Codec::kFixed>(msg);
+    } else {
+      spdlog::warn("dropped malformed fixed layout frame, size {}",
+                   msg.size());
+    }
   }
 
-  auto HandleExecutionReport(const ExecutionReport& execution_report,
-                             const EventType& event_type) -> void {
-    SerializeExecutionReport(builder_, event_type, execution_report);
+  /**
+   * Peek at the header and body to find the instrument, then hand the
+   * message to the owning shard. Cancel-on-disconnect is copied to every
+   * shard.
+   */
+  template <Codec C>
+  auto Route(zmq::message_t& msg) -> void {
+    using EventTypeCode = orderbook::serialize::EventTypeCode;
+    using Traits = CodecTraits<C>;
 
-    socket_.SendFlatBuffer(builder_.GetBufferPointer(), builder_.GetSize(),
-                           execution_report.GetRoutingId());
+    const auto* flatc_msg =
+        Traits::template GetRoot<typename Traits::Message>(msg.data());
+    const auto event_type = flatc_msg->header()->event_type();
+
+    if (event_type == EventTypeCode::OrderPendingNew) {
+      Enqueue(ShardOf(flatc_msg->body_as_NewOrderSingle()->instrument_id()),
+              msg);
+    } else if (event_type == EventTypeCode::OrderPendingModify) {
+      Enqueue(ShardOf(flatc_msg->body_as_OrderCancelReplaceRequest()
+                          ->instrument_id()),
+              msg);
+    } else if (event_type == EventTypeCode::OrderPendingCancel) {
+      Enqueue(ShardOf(flatc_msg->body_as_OrderCancelRequest()->instrument_id()),
+              msg);
+    } else if (event_type == EventTypeCode::CancelOnDisconnect) {
+      for (auto& shard : shards_) {
+        zmq::message_t copy;
+        copy.copy(msg);
+        Enqueue(*shard, copy);
+      }
+    } else if (event_type == EventTypeCode::MultiMessage) {
+      RouteBatch<C>(msg);
+    } else {
+      spdlog::warn("received unknown orderbook::serialize::EventTypeCode");
+    }
   }
 
-  auto HandleOrderCancelReject(const OrderCancelReject& order_cancel_reject,
-                               const EventType& event_type) -> void {
-    SerializeOrderCancelReject(builder_, event_type, order_cancel_reject);
+  /**
+   * A client batch goes to every shard owning at least one of its requests,
+   * each shard skips the requests for books it does not own.
+   */
+  template <Codec C>
+  auto RouteBatch(zmq::message_t& msg) -> void {
+    using Traits = CodecTraits<C>;
+
+    const auto* multi_msg =
+        Traits::template GetRoot<typename Traits::MultiMessage>(msg.data());
+
+    batch_targets_.assign(shards_.size(), false);
+    for (const auto* message : Traits::Messages(multi_msg)) {
+      if (!IsOrderRequest(message)) {
+        batch_targets_.assign(shards_.size(), true);
+        break;
+      }
+      batch_targets_[InstrumentOf(message) % shards_.size()] = true;
+    }
+
+    for (std::size_t i = 0; i < shards_.size(); ++i) {
+      if (batch_targets_[i]) {
+        zmq::message_t copy;
+        copy.copy(msg);
+        Enqueue(*shards_[i], copy);
+      }
+    }
+  }
 
-    socket_.SendFlatBuffer(builder_.GetBufferPointer(), builder_.GetSize(),
-                           order_cancel_reject.GetRoutingId());
+  auto Enqueue(Shard& shard, zmq::message_t& msg) -> void {
+    while (!shard.Inbound().TryPush(std::move(msg))) {
+      ThreadUtil::Pause();
+    }
+    shard.OnEnqueued();
+  }
+
+  /**
+   * Publisher thread: drain the event ring of every shard, serializing and
+   * sending the coalesced frames, publish market data snapshots as they
+   * come due or are requested, and periodically log the backpressure
+   * metrics of each ring.
+   */
+  auto Publish() -> void {
+    auto next_report = Clock::now() + kMetricsInterval;
+    auto next_subscription = Clock::now();
+
+    while (publisher_running_.load(std::memory_order_relaxed)) {
+      const bool send_flag = running_.load(std::memory_order_relaxed) &&
+                             !replaying_.load(std::memory_order_acquire);
+
+      std::size_t count = 0;
+      for (auto& publisher : publishers_) {
+        count += publisher->Poll(send_flag);
+      }
+
+      const auto now = Clock::now();
+      if (HasMarketData()) {
+        if (now >= next_subscription) {
+          PollSubscriptions();
+          next_subscription = now + kSubscriptionInterval;
+        }
+        for (auto& publisher : publishers_) {
+          publisher->PollSnapshots(now);
+        }
+      }
+
+      if (count == 0) {
+        std::this_thread::yield();
+      }
+
+      if (now >= next_report) {
+        LogMetrics();
+        next_report += kMetricsInterval;
+      }
+    }
+
+    LogMetrics();
+  }
+
+  /**
+   * A subscriber subscribing to a snapshot topic requests the snapshot, the
+   * shard that owns the book answers it.
+   */
+  auto PollSubscriptions() -> void {
+    md_socket_.PollSubscriptions(
+        [&](const bool subscribe, std::string_view topic) {
+          if (!subscribe) {
+            return;
+          }
+          for (auto& publisher : publishers_) {
+            publisher->OnSubscription(topic);
+          }
+        });
+  }
+
+  auto LogMetrics() const -> void {
+    for (const auto& publisher : publishers_) {
+      publisher->LogMetrics();
+    }
   }
 
-  EventDispatcherPtr dispatcher_;
   std::string addr_;
+  ReferenceData reference_data_;
+  MarketDataOptions market_data_;
+  JournalOptions journal_;
+  std::unique_ptr<JournalWriter> journal_writer_;
+  pid_t checkpoint_pid_{-1};
+  std::uint64_t checkpoint_sequence_{0};
+  std::uint64_t checkpoint_pending_{0};
+  Clock::time_point next_checkpoint_{};
+  std::size_t shard_count_;
+  // declared ahead of socket_, which must be the last provider constructed
+  // so the SIGTERM handler closes the request socket
+  FeedSocket md_socket_{false};
   ServerSocket socket_;
-  BookMap book_map_;
+  std::vector<ShardPtr> shards_;
+  std::vector<PublisherPtr> publishers_;
+  std::vector<bool> batch_targets_;
 
-  SequenceNumber seq_no_{0};
-  flatbuffers::FlatBufferBuilder builder_{kBufferSize};
+  std::atomic<bool> running_{false};
+  std::atomic<bool> publisher_running_{false};
+  std::atomic<bool> replaying_{false};
+  std::vector<std::thread> workers_;
+  std::thread publisher_thr_;
 };
 
+/**
+ * The transport is chosen by the address scheme: shm:// binds a shared
+ * memory segment, anything else is handed to zmq.
+ */
+template <typename ServerSocket>
+auto RunOrderBook(const std::string& addr, ReferenceData reference_data,
+                  const std::size_t& shard_count,
+                  const orderbook::util::ReceiveOptions& receive_options,
+                  const MarketDataOptions& market_data,
+                  const orderbook::util::JournalOptions& journal) -> void {
+  OrderBook<typename orderbook::IntrusivePtrOrderBookTraits<>, ServerSocket>
+      book(addr, std::move(reference_data), shard_count, receive_options,
+           market_data, journal);
+  // OrderBook<typename orderbook::IntrusiveListOrderBookTraits<>> book(addr);
+  book.GenerateOrderBooks();
+  book.Run();
+}
+
 auto main(int argc, char** argv) -> int {
   if (argc < 2) {
-    std::cout << "usage: " << argv[0] << " ADDR." << std::endl;
+    std::cout << "usage: " << argv[0]
+              << " ADDR [SHARDS] [block|spin|yield] [DRAIN] [CPU] [MD_ADDR]"
+                 " [SNAPSHOT_MS] [SNAPSHOT_DEPTH] [INSTRUMENTS] [JOURNAL_DIR]"
+                 " [record|recover|replay] [CHECKPOINT_SECS]."
+              << std::endl;
     return 1;
   }
 
   std::string addr(argv[1]);
+  std::size_t shard_count = argc > 2 ? std::stoul(argv[2]) : 0;
 
-  OrderBook<typename orderbook::IntrusivePtrOrderBookTraits<>> book(addr);
-  // OrderBook<typename orderbook::IntrusiveListOrderBookTraits<>> book(addr);
-  book.GenerateOrderBooks();
-  book.RegisterListeners();
-  book.Run();
+  orderbook::util::ReceiveOptions receive_options;
+  if (argc > 3) {
+    receive_options.strategy = orderbook::util::ToReceiveStrategy(argv[3]);
+  }
+  if (argc > 4) {
+    receive_options.drain_limit = std::stoul(argv[4]);
+  }
+  if (argc > 5) {
+    receive_options.cpu = std::stoi(argv[5]);
+  }
+
+  MarketDataOptions market_data;
+  if (argc > 6) {
+    market_data.addr = argv[6];
+  }
+  if (argc > 7) {
+    market_data.snapshot.interval =
+        std::chrono::milliseconds(std::stoul(argv[7]));
+  }
+  if (argc > 8) {
+    market_data.snapshot.depth = std::stoul(argv[8]);
+  }
+
+  // without a reference data file instruments 1..kInstrumentCount are
+  // listed
+  constexpr std::size_t kInstrumentCount = 2048;
+  auto reference_data = argc > 9 ? ReferenceData::Load(argv[9])
+                                 : ReferenceData::Generate(kInstrumentCount);
+
+  orderbook::util::JournalOptions journal;
+  if (argc > 10) {
+    journal.dir = argv[10];
+  }
+  if (argc > 11) {
+    journal.mode = orderbook::util::ToJournalMode(argv[11]);
+  }
+  if (argc > 12) {
+    journal.checkpoint_interval = std::chrono::seconds(std::stoul(argv[12]));
+  }
+
+  if (orderbook::util::IsShmAddress(addr)) {
+    RunOrderBook<orderbook::util::ShmServerSocketProvider>(
+        addr, std::move(reference_data), shard_count, receive_options,
+        market_data, journal);
+  } else {
+    RunOrderBook<orderbook::util::ServerSocketProvider>(
+        addr, std::move(reference_data), shard_count, receive_options,
+        market_data, journal);
+  }
 
   return 0;
 }
@@ -0,0 +1,478 @@
+#!/usr/bin/env python3
+"""Generate the fixed layout codec from the flatbuffer schema.
+
+Reads the tables, unions and enums of a .fbs file and writes
+<schema>_fixed.h next to flatc's <schema>_generated.h: one packed little-endian struct per table, with every
+field at a fixed offset and strings as fixed width character fields.
+Accessors carry the flatbuffer field names, so code written against the
+flatc generated tables compiles against these unchanged.
+
+Tables holding a union or a vector of tables are frames, they start with a
+magic number and their total length and are followed by their payload: the
+union member, or the vector's frames one after another.
+
+usage: fixed_codec_gen.py SCHEMA OUTPUT_DIR
+"""
+
+import os
+import re
+import sys
+
+STRING_CAPACITY = 31
+
+SCALARS = {
+    "bool": ("bool", 1),
+    "byte": ("std::int8_t", 1),
+    "ubyte": ("std::uint8_t", 1),
+    "int8": ("std::int8_t", 1),
+    "uint8": ("std::uint8_t", 1),
+    "short": ("std::int16_t", 2),
+    "ushort": ("std::uint16_t", 2),
+    "int16": ("std::int16_t", 2),
+    "uint16": ("std::uint16_t", 2),
+    "int": ("std::int32_t", 4),
+    "uint": ("std::uint32_t", 4),
+    "int32": ("std::int32_t", 4),
+    "uint32": ("std::uint32_t", 4),
+    "long": ("std::int64_t", 8),
+    "ulong": ("std::uint64_t", 8),
+    "int64": ("std::int64_t", 8),
+    "uint64": ("std::uint64_t", 8),
+    "float": ("float", 4),
+    "double": ("double", 8),
+}
+
+
+def strip_comments(text):
+    return re.sub(r"//[^\n]*", "", text)
+
+
+def parse(text):
+    text = strip_comments(text)
+    schema = {"namespace": "", "enums": {}, "unions": {}, "tables": []}
+
+    match = re.search(r"namespace\s+([\w.]+)\s*;", text)
+    if match:
+        schema["namespace"] = match.group(1).replace(".", "::")
+
+    for name, base in re.findall(r"enum\s+(\w+)\s*:\s*(\w+)\s*\{", text):
+        schema["enums"][name] = SCALARS[base]
+
+    for name, body in re.findall(r"union\s+(\w+)\s*\{([^}]*)\}", text):
+        members = [m.strip() for m in body.split(",") if m.strip()]
+        schema["unions"][name] = members
+
+    for name, body in re.findall(r"table\s+(\w+)\s*\{([^}]*)\}", text):
+        fields = []
+        for field, kind in re.findall(r"(\w+)\s*:\s*([\w\[\]]+)[^;]*;", body):
+            fields.append((field, kind))
+        schema["tables"].append((name, fields))
+
+    return schema
+
+
+def camel(name):
+    return "".join(part.capitalize() for part in name.split("_"))
+
+
+class Field:
+    def __init__(self, name, kind, cpp, size, align):
+        self.name = name
+        self.kind = kind  # scalar, enum, string, table, union, vector
+        self.cpp = cpp
+        self.size = size
+        self.align = align
+
+
+class Generator:
+    def __init__(self, schema, stem):
+        self.schema = schema
+        self.stem = stem
+        self.serialize = schema["namespace"]
+        self.sizes = {}
+        self.frames = set()
+        for name, fields in schema["tables"]:
+            for _, kind in fields:
+                if kind in schema["unions"] or kind.startswith("["):
+                    self.frames.add(name)
+
+    def layout(self, table, fields):
+        layout = []
+        for name, kind in fields:
+            if kind in SCALARS:
+                cpp, size = SCALARS[kind]
+                layout.append(Field(name, "scalar", cpp, size, size))
+            elif kind in self.schema["enums"]:
+                _, size = self.schema["enums"][kind]
+                cpp = f"{self.serialize}::{kind}"
+                layout.append(Field(name, "enum", cpp, size, size))
+            elif kind == "string":
+                layout.append(
+                    Field(name, "string", "FixedChars", STRING_CAPACITY + 1, 1)
+                )
+            elif kind in self.schema["unions"]:
+                cpp = f"{self.serialize}::{kind}"
+                layout.append(Field(name, "union", cpp, 1, 1))
+            elif kind.startswith("["):
+                element = kind[1:-1]
+                if element not in self.frames:
+                    raise ValueError(f"{table}.{name}: vectors of frames only")
+                layout.append(Field(name, "vector", element, 4, 4))
+            elif kind in self.sizes:
+                layout.append(Field(name, "table", kind, self.sizes[kind], 8))
+            else:
+                raise ValueError(f"{table}.{name}: unsupported type {kind}")
+
+        trailing = [f for f in layout if f.kind in ("union", "vector")]
+        if len(trailing) > 1:
+            raise ValueError(f"{table}: more than one union or vector field")
+
+        # Widest first keeps every field at its natural alignment.
+        layout.sort(key=lambda f: -f.align)
+        size = sum(f.size for f in layout)
+        if table in self.frames:
+            size += 8
+        return layout, size, (8 - size % 8) % 8
+
+    def generate(self):
+        out = []
+        emit = out.append
+        emit(
+            HEADER.format(
+                serialize=self.serialize,
+                stem=self.stem,
+                capacity=STRING_CAPACITY,
+            )
+        )
+
+        for table, fields in self.schema["tables"]:
+            if table in self.frames:
+                continue
+            layout, size, padding = self.layout(table, fields)
+            self.sizes[table] = size + padding
+            self.table(emit, table, layout, padding, frame=False)
+
+        for table, fields in self.schema["tables"]:
+            if table not in self.frames:
+                continue
+            layout, size, padding = self.layout(table, fields)
+            self.sizes[table] = size + padding
+            self.table(emit, table, layout, padding, frame=True)
+
+        emit("#pragma pack(pop)\n")
+        for table, _ in self.schema["tables"]:
+            emit(
+                f"static_assert(sizeof({table}) == {self.sizes[table]});\n"
+                f"static_assert(std::is_trivially_copyable_v<{table}>);\n"
+            )
+
+        for union, members in self.schema["unions"].items():
+            self.union(emit, union, members)
+
+        emit(FOOTER.format(serialize=self.serialize))
+        return "".join(out)
+
+    def table(self, emit, table, layout, padding, frame):
+        emit(f"\nstruct {table} {{\n public:\n")
+        if frame:
+            emit(
+                "  auto magic() const -> std::uint32_t { return magic_; }\n"
+                "  auto length() const -> std::uint32_t { return length_; }\n"
+            )
+
+        for f in layout:
+            if f.kind in ("scalar", "enum"):
+                emit(
+                    f"  auto {f.name}() const -> {f.cpp} "
+                    f"{{ return {f.name}_; }}\n"
+                )
+            elif f.kind in ("string", "table"):
+                emit(
+                    f"  auto {f.name}() const -> const {f.cpp}* "
+                    f"{{ return &{f.name}_; }}\n"
+                )
+            elif f.kind == "union":
+                emit(
+                    f"  auto {f.name}_type() const -> {f.cpp} "
+                    f"{{ return {f.name}_type_; }}\n"
+                )
+                for member in self.schema["unions"][f.cpp.split("::")[-1]]:
+                    emit(
+                        f"  auto {f.name}_as_{member}() const "
+                        f"-> const {member}* {{\n"
+                        f"    return {f.name}_type_ == {f.cpp}::{member}\n"
+                        f"               ? reinterpret_cast<const {member}*>"
+                        f"(this + 1)\n"
+                        f"               : nullptr;\n"
+                        f"  }}\n"
+                    )
+            elif f.kind == "vector":
+                emit(
+                    f"  auto {f.name}() const -> FrameRange<{f.cpp}> {{\n"
+                    f"    return {{reinterpret_cast<const std::uint8_t*>"
+                    f"(this + 1), {f.name}_count_}};\n"
+                    f"  }}\n"
+                )
+
+        emit("\n")
+        if frame:
+            emit(
+                "  auto mutate_length(std::uint32_t value) -> void "
+                "{ length_ = value; }\n"
+            )
+        for f in layout:
+            if f.kind in ("scalar", "enum"):
+                emit(
+                    f"  auto mutate_{f.name}({f.cpp} value) -> void "
+                    f"{{ {f.name}_ = value; }}\n"
+                )
+            elif f.kind == "string":
+                emit(
+                    f"  auto mutate_{f.name}(std::string_view value) -> bool "
+                    f"{{\n    return {f.name}_.Assign(value);\n  }}\n"
+                )
+            elif f.kind == "table":
+                emit(
+                    f"  auto mutable_{f.name}() -> {f.cpp}* "
+                    f"{{ return &{f.name}_; }}\n"
+                )
+            elif f.kind == "union":
+                emit(
+                    f"  auto mutate_{f.name}_type({f.cpp} value) -> void "
+                    f"{{ {f.name}_type_ = value; }}\n"
+                )
+            elif f.kind == "vector":
+                emit(
+                    f"  auto mutate_{f.name}_count(std::uint32_t value) "
+                    f"-> void {{ {f.name}_count_ = value; }}\n"
+                )
+
+        if frame:
+            emit(
+                "  auto Init(std::uint32_t length) -> void {\n"
+                "    magic_ = kFrameMagic;\n"
+                "    length_ = length;\n"
+                "  }\n"
+            )
+        else:
+            self.verify(emit, layout)
+            self.encode(emit, layout)
+
+        emit("\n private:\n")
+        if frame:
+            emit("  std::uint32_t magic_;\n  std::uint32_t length_;\n")
+        for f in layout:
+            if f.kind == "union":
+                emit(f"  {f.cpp} {f.name}_type_;\n")
+            elif f.kind == "vector":
+                emit(f"  std::uint32_t {f.name}_count_;\n")
+            else:
+                emit(f"  {f.cpp} {f.name}_;\n")
+        if padding:
+            emit(f"  std::uint8_t reserved_[{padding}];\n")
+        emit("};\n")
+
+    def verify(self, emit, layout):
+        checks = [
+            f"{f.name}_.Verify()"
+            for f in layout
+            if f.kind in ("string", "table")
+        ]
+        joined = " && ".join(checks) or "true"
+        emit(
+            "\n  /**\n"
+            "   * True if every string field holds no more than its capacity.\n"
+            "   */\n"
+            "  auto Verify() const -> bool {\n"
+            f"    return {joined};\n"
+            "  }\n"
+        )
+
+    def encode(self, emit, layout):
+        emit(
+            "\n  /**\n"
+            "   * Copy every field from a data object exposing the matching\n"
+            "   * Get<Field> getters. False if a string does not fit its\n"
+            "   * field, the table must then not be sent.\n"
+            "   */\n"
+            "  template <typename Data>\n"
+            "  auto Encode(const Data& data) -> bool {\n"
+        )
+        strings = []
+        for f in layout:
+            getter = f"data.Get{camel(f.name)}()"
+            if f.kind == "scalar":
+                emit(f"    {f.name}_ = {getter};\n")
+            elif f.kind == "enum":
+                emit(f"    {f.name}_ = static_cast<{f.cpp}>({getter});\n")
+            elif f.kind == "string":
+                strings.append(f"{f.name}_.Assign({getter})")
+        joined = " &&\n           ".join(strings) or "true"
+        emit(f"    return {joined};\n")
+        emit("  }\n")
+
+    def union(self, emit, union, members):
+        emit(
+            f"\n/**\n * The encoded size of each {union} member.\n */\n"
+            f"inline constexpr auto {union}Size(const {self.serialize}::"
+            f"{union}& type)\n    -> std::size_t {{\n"
+            f"  switch (type) {{\n"
+        )
+        for member in members:
+            emit(
+                f"    case {self.serialize}::{union}::{member}:\n"
+                f"      return sizeof({member});\n"
+            )
+        emit(
+            f"    case {self.serialize}::{union}::NONE:\n"
+            f"      break;\n"
+            f"  }}\n  return 0;\n}}\n"
+        )
+        signature = f"inline auto {union}Verify("
+        emit(
+            f"\n/**\n * Verify the {union} member of the given type at body.\n"
+            f" * Only valid once {union}Size fits the frame.\n */\n"
+            f"{signature}const {self.serialize}::{union}& type,\n"
+            f"{' ' * len(signature)}const void* body) -> bool {{\n"
+            f"  switch (type) {{\n"
+        )
+        for member in members:
+            emit(
+                f"    case {self.serialize}::{union}::{member}:\n"
+                f"      return static_cast<const {member}*>(body)->Verify();\n"
+            )
+        emit(
+            f"    case {self.serialize}::{union}::NONE:\n"
+            f"      break;\n"
+            f"  }}\n  return false;\n}}\n"
+            f"\ntemplate <typename T>\nstruct {union}TypeOf;\n"
+        )
+        for member in members:
+            emit(
+                f"template <>\nstruct {union}TypeOf<{member}> {{\n"
+                f"  static constexpr auto value = {self.serialize}::"
+                f"{union}::{member};\n}};\n"
+            )
+
+
+HEADER = """\
+// automatically generated by fixed_codec_gen.py, do not modify
+
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "orderbook/serialize/{stem}_generated.h"
+
+namespace {serialize}::fixed {{
+
+static_assert(std::endian::native == std::endian::little,
+              "the fixed layout codec is little-endian only");
+
+/**
+ * Leads every frame. Never a valid flatbuffer root offset, so the first
+ * four bytes of a buffer tell the two encodings apart.
+ */
+inline constexpr std::uint32_t kFrameMagic = 0xFEEDC0DE;
+
+/**
+ * A length prefixed, zero padded, fixed width string field. A longer value
+ * is refused rather than truncated, and a received length beyond the
+ * capacity fails Verify.
+ */
+struct FixedChars {{
+  static constexpr std::size_t kCapacity = {capacity};
+
+  auto data() const -> const char* {{ return chars_; }}
+  auto size() const -> std::size_t {{ return length_; }}
+  auto str() const -> std::string {{ return {{chars_, length_}}; }}
+  auto string_view() const -> std::string_view {{ return {{chars_, length_}}; }}
+
+  auto Verify() const -> bool {{ return length_ <= kCapacity; }}
+
+  auto Assign(std::string_view value) -> bool {{
+    if (value.size() > kCapacity) {{
+      return false;
+    }}
+    length_ = static_cast<std::uint8_t>(value.size());
+    std::memcpy(chars_, value.data(), length_);
+    std::memset(chars_ + length_, 0, kCapacity - length_);
+    return true;
+  }}
+
+ private:
+  std::uint8_t length_;
+  char chars_[kCapacity];
+}};
+
+/**
+ * The frames following a vector holding table, walked by their lengths.
+ * Only valid over a buffer that passed VerifyFrame.
+ */
+template <typename Frame>
+class FrameRange {{
+ public:
+  class Iterator {{
+   public:
+    Iterator(const std::uint8_t* pos, std::uint32_t index)
+        : pos_(pos), index_(index) {{}}
+
+    auto operator*() const -> const Frame* {{
+      return reinterpret_cast<const Frame*>(pos_);
+    }}
+    auto operator++() -> Iterator& {{
+      pos_ += reinterpret_cast<const Frame*>(pos_)->length();
+      ++index_;
+      return *this;
+    }}
+    auto operator!=(const Iterator& other) const -> bool {{
+      return index_ != other.index_;
+    }}
+
+   private:
+    const std::uint8_t* pos_;
+    std::uint32_t index_;
+  }};
+
+  FrameRange(const std::uint8_t* first, std::uint32_t count)
+      : first_(first), count_(count) {{}}
+
+  auto begin() const -> Iterator {{ return {{first_, 0}}; }}
+  auto end() const -> Iterator {{ return {{nullptr, count_}}; }}
+  auto size() const -> std::uint32_t {{ return count_; }}
+
+ private:
+  const std::uint8_t* first_;
+  std::uint32_t count_;
+}};
+
+#pragma pack(push, 1)
+"""
+
+FOOTER = """
+}}  // namespace {serialize}::fixed
+"""
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__.splitlines()[-1])
+
+    with open(sys.argv[1]) as schema_file:
+        schema = parse(schema_file.read())
+
+    stem = os.path.splitext(os.path.basename(sys.argv[1]))[0]
+    code = Generator(schema, stem).generate()
+
+    os.makedirs(sys.argv[2], exist_ok=True)
+    with open(os.path.join(sys.argv[2], f"{stem}_fixed.h"), "w") as out:
+        out.write(code)
+
+
+if __name__ == "__main__":
+    main()
@@ -1,5 +1,12 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
+
 #include "gtest/gtest.h"
 #include "orderbook/application_traits.h"
+#include "orderbook/book/book_registry.h"
+#include "orderbook/book/checkpoint.h"
 
 using namespace orderbook::data;
 
@@ -20,6 +27,20 @@ class OrderBookFixture : public ::testing::Test {  // clang-format on
 
   static constexpr auto kClientOrderIdSize = 8;
 
+  struct RecordingEventSink {
+    std::vector<EventType>* events;
+
+    auto OnExecutionReport(const EventType& event_type,
+                           const ExecutionView& /*unused*/) -> void {
+      events->push_back(event_type);
+    }
+
+    auto OnCancelReject(const EventType& event_type,
+                        const OrderCancelReject& /*unused*/) -> void {
+      events->push_back(event_type);
+    }
+  };
+
   static auto MakeClientOrderId(const std::size_t& length) -> std::string {
     static std::size_t clord_id{0};
     const auto& id = std::to_string(++clord_id);
@@ -374,6 +395,246 @@ class OrderBookFixture : public ::testing::Test {  // clang-format on
     book.Cancel(cancel_sell_order);
     ASSERT_TRUE(cancel_reject_happened == 1);  // NOLINT
   }
+
+  static auto OrderIdTest() -> void {
+    using OrderIdSequence = orderbook::book::OrderIdSequence;
+
+    EventDispatcherPtr dispatcher = std::make_shared<EventDispatcher>();
+    OrderBook book_one{dispatcher, 1};
+    OrderBook book_two{dispatcher, 2};  // NOLINT
+
+    std::vector<OrderId> order_ids;
+
+    dispatcher->appendListener(EventType::kOrderNew,
+                               [&](const EventData& data) {
+                                 auto& exec = std::get<ExecutionReport>(data);
+                                 order_ids.push_back(exec.GetOrderId());
+                               });
+
+    book_one.Add(MakeNewOrderSingle(21, 10, SideCode::kBuy));  // NOLINT
+    book_two.Add(MakeNewOrderSingle(21, 10, SideCode::kBuy));  // NOLINT
+    book_one.Add(MakeNewOrderSingle(22, 10, SideCode::kBuy));  // NOLINT
+    book_two.Add(MakeNewOrderSingle(22, 10, SideCode::kBuy));  // NOLINT
+
+    ASSERT_TRUE(order_ids.size() == 4);  // NOLINT
+
+    // Both books start their local sequence at one, the prefix keeps the
+    // resulting order ids distinct.
+    ASSERT_TRUE(OrderIdSequence::PrefixOf(order_ids[0]) == 1);    // NOLINT
+    ASSERT_TRUE(OrderIdSequence::SequenceOf(order_ids[0]) == 1);  // NOLINT
+    ASSERT_TRUE(OrderIdSequence::PrefixOf(order_ids[1]) == 2);    // NOLINT
+    ASSERT_TRUE(OrderIdSequence::SequenceOf(order_ids[1]) == 1);  // NOLINT
+    ASSERT_TRUE(OrderIdSequence::PrefixOf(order_ids[2]) == 1);    // NOLINT
+    ASSERT_TRUE(OrderIdSequence::SequenceOf(order_ids[2]) == 2);  // NOLINT
+    ASSERT_TRUE(OrderIdSequence::PrefixOf(order_ids[3]) == 2);    // NOLINT
+    ASSERT_TRUE(OrderIdSequence::SequenceOf(order_ids[3]) == 2);  // NOLINT
+    ASSERT_TRUE(order_ids[0] != order_ids[1]);
+    ASSERT_TRUE(order_ids[2] != order_ids[3]);
+
+    book_one.Reset();
+    book_two.Reset();
+  }
+
+  static auto StaticSinkTest() -> void {
+    using StaticOrderBook =
+        typename Traits::template StaticBookType<RecordingEventSink>;
+
+    std::vector<EventType> events;
+    StaticOrderBook book{RecordingEventSink{&events}};
+
+    const auto& buy_order =
+        MakeNewOrderSingle(21, 10, SideCode::kBuy);  // NOLINT
+    book.Add(buy_order);
+
+    const auto& sell_order =
+        MakeNewOrderSingle(21, 10, SideCode::kSell);  // NOLINT
+    book.Add(sell_order);
+
+    book.Cancel(MakeCancel(sell_order, 0));
+
+    const std::vector<EventType> expected = {
+        EventType::kOrderPendingNew, EventType::kOrderNew,
+        EventType::kOrderPendingNew, EventType::kOrderNew,
+        EventType::kOrderFilled,     EventType::kOrderFilled,
+        EventType::kOrderCancelRejected};
+
+    ASSERT_TRUE(book.Empty());
+    ASSERT_TRUE(events == expected);
+  }
+
+  static auto CancelAllTest() -> void {
+    using StaticOrderBook =
+        typename Traits::template StaticBookType<RecordingEventSink>;
+
+    std::vector<EventType> events;
+    StaticOrderBook book{RecordingEventSink{&events}, 1};
+    book.Add(MakeNewOrderSingle(20, 10, SideCode::kBuy));   // NOLINT
+    book.Add(MakeNewOrderSingle(21, 10, SideCode::kBuy));   // NOLINT
+    book.Add(MakeNewOrderSingle(23, 10, SideCode::kSell));  // NOLINT
+
+    auto other = MakeNewOrderSingle(21, 5, SideCode::kBuy);  // NOLINT
+    other.SetSessionId(1);
+    book.Add(other);
+    ASSERT_TRUE(book.OrderCount() == 4);
+
+    // every order of the session is reported cancelled, the rest stay
+    events.clear();
+    ASSERT_TRUE(book.CancelAll(0) == 3);
+    const std::vector<EventType> cancelled(3, EventType::kOrderCancelled);
+    ASSERT_TRUE(events == cancelled);
+    ASSERT_TRUE(book.OrderCount() == 1);
+
+    std::vector<SessionId> sessions;
+    book.ForEachOrder(
+        [&](const auto& order) { sessions.push_back(order.GetSessionId()); });
+    ASSERT_TRUE(sessions == std::vector<SessionId>{1});
+
+    events.clear();
+    ASSERT_TRUE(book.CancelAll(0) == 0);
+    ASSERT_TRUE(events.empty());
+
+    book.Reset();
+  }
+
+  static auto BookRegistryTest() -> void {
+    using StaticOrderBook =
+        typename Traits::template StaticBookType<RecordingEventSink>;
+    using Registry = orderbook::book::BookRegistry<StaticOrderBook, 4>;
+
+    std::vector<EventType> events;
+    Registry registry([&](const InstrumentId& instrument_id) {
+      return std::make_unique<StaticOrderBook>(RecordingEventSink{&events},
+                                               instrument_id);
+    });
+
+    // ids spanning several pages, with an unallocated page between them
+    for (const InstrumentId id : {1, 2, 15, 16, 100}) {  // NOLINT
+      registry.Add(id);
+    }
+    registry.Add(2);
+    ASSERT_TRUE(registry.Size() == 5);  // NOLINT
+    ASSERT_TRUE(registry.Constructed() == 0);
+
+    ASSERT_TRUE(registry.Contains(15));  // NOLINT
+    ASSERT_FALSE(registry.Contains(3));
+    ASSERT_FALSE(registry.Contains(50));    // NOLINT
+    ASSERT_FALSE(registry.Contains(1000));  // NOLINT
+    ASSERT_TRUE(registry.Find(3) == nullptr);
+    ASSERT_TRUE(registry.Find(50) == nullptr);    // NOLINT
+    ASSERT_TRUE(registry.Find(1000) == nullptr);  // NOLINT
+
+    // books are constructed on first use, once
+    auto* book = registry.Find(100);  // NOLINT
+    ASSERT_TRUE(book != nullptr);
+    ASSERT_TRUE(registry.Find(100) == book);  // NOLINT
+    ASSERT_TRUE(registry.Constructed() == 1);
+
+    book->Add(MakeNewOrderSingle(21, 10, SideCode::kBuy));  // NOLINT
+    ASSERT_FALSE(book->Empty());
+
+    std::size_t visited{0};
+    registry.ForEach([&](auto& each) {
+      ++visited;
+      each.Reset();
+    });
+    ASSERT_TRUE(visited == 1);
+    ASSERT_TRUE(book->Empty());
+  }
+
+  static auto CheckpointTest() -> void {
+    using StaticOrderBook =
+        typename Traits::template StaticBookType<RecordingEventSink>;
+    using orderbook::book::CheckpointReader;
+    using orderbook::book::CheckpointWriter;
+
+    const auto dir = (std::filesystem::temp_directory_path() /
+                      ("orderbook_checkpoint_" + std::to_string(::getpid())))
+                         .string();
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    std::vector<EventType> events;
+    StaticOrderBook book{RecordingEventSink{&events}, 1};
+    book.Add(MakeNewOrderSingle(20, 10, SideCode::kBuy));   // NOLINT
+    book.Add(MakeNewOrderSingle(21, 10, SideCode::kBuy));   // NOLINT
+    book.Add(MakeNewOrderSingle(21, 30, SideCode::kBuy));   // NOLINT
+    book.Add(MakeNewOrderSingle(21, 4, SideCode::kSell));   // NOLINT
+    book.Add(MakeNewOrderSingle(23, 15, SideCode::kSell));  // NOLINT
+    ASSERT_TRUE(book.OrderCount() == 4);                    // NOLINT
+
+    {
+      CheckpointWriter writer(dir, 42, 1, book.OrderCount());  // NOLINT
+      writer.Add(book);
+      writer.Commit();
+    }
+
+    const CheckpointReader checkpoint(CheckpointReader::Latest(dir));
+    ASSERT_TRUE(checkpoint.JournalSequence() == 42);  // NOLINT
+    ASSERT_TRUE(checkpoint.BookCount() == 1);
+    ASSERT_TRUE(checkpoint.OrderCount() == 4);  // NOLINT
+
+    // restoring reports each order as new, for market data, and only
+    // restores into the books handed out
+    StaticOrderBook restored{RecordingEventSink{&events}, 1};
+    const auto event_count = events.size();
+    ASSERT_TRUE(checkpoint.Restore([&](const InstrumentId& instrument_id) {
+      return instrument_id == 1 ? &restored : nullptr;
+    }) == 4);  // NOLINT
+    ASSERT_TRUE(events.size() == event_count + 4);
+    ASSERT_TRUE(std::all_of(events.begin() + event_count, events.end(),
+                            [](const EventType& event_type) {
+                              return event_type == EventType::kOrderNew;
+                            }));
+
+    // the same orders in the same priority, partial fill included
+    auto snapshot = [](StaticOrderBook& each) {
+      std::vector<ExecutionReport> orders;
+      each.ForEachOrder(
+          [&](const auto& order) { orders.emplace_back(0, 0, order); });
+      return orders;
+    };
+    const auto expected = snapshot(book);
+    const auto actual = snapshot(restored);
+    ASSERT_TRUE(actual.size() == expected.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+      ASSERT_TRUE(actual[i].GetOrderId() == expected[i].GetOrderId());
+      ASSERT_TRUE(actual[i].GetOrderPrice() == expected[i].GetOrderPrice());
+      ASSERT_TRUE(actual[i].GetLeavesQuantity() ==
+                  expected[i].GetLeavesQuantity());
+      ASSERT_TRUE(actual[i].GetExecutedQuantity() ==
+                  expected[i].GetExecutedQuantity());
+      ASSERT_TRUE(actual[i].GetOrderStatus() == expected[i].GetOrderStatus());
+      ASSERT_TRUE(actual[i].GetClientOrderId() ==
+                  expected[i].GetClientOrderId());
+    }
+    ASSERT_TRUE(expected[0].GetOrderStatus() ==
+                OrderStatusCode::kPartiallyFilled);
+
+    // the counters carry on where they were
+    const auto order = MakeNewOrderSingle(19, 10, SideCode::kBuy);  // NOLINT
+    book.Add(order);
+    restored.Add(order);
+    ASSERT_TRUE(restored.GetCounters().tx_id == book.GetCounters().tx_id);
+    ASSERT_TRUE(restored.GetCounters().exec_id == book.GetCounters().exec_id);
+    ASSERT_TRUE(restored.GetCounters().order_sequence ==
+                book.GetCounters().order_sequence);
+    ASSERT_TRUE(snapshot(restored).back().GetOrderId() ==
+                snapshot(book).back().GetOrderId());
+
+    // the newest checkpoint and the one before it are kept
+    for (const std::uint64_t sequence : {43, 44}) {  // NOLINT
+      CheckpointWriter writer(dir, sequence, 1, book.OrderCount());
+      writer.Add(book);
+      writer.Commit();
+    }
+    ASSERT_TRUE(orderbook::book::internal::CheckpointPaths(dir).size() == 2);
+    ASSERT_TRUE(CheckpointReader(CheckpointReader::Latest(dir))
+                    .JournalSequence() == 44);  // NOLINT
+
+    book.Reset();
+    restored.Reset();
+    std::filesystem::remove_all(dir);
+  }
 };
 
 // orderbook::container::MapListContainer tests
@@ -399,6 +660,24 @@ TEST_F(MapListContainerFixture, partial_execute_test) {  // NOLINT
 
 TEST_F(MapListContainerFixture, cancel_test) { CancelTest(); }  // NOLINT
 
+TEST_F(MapListContainerFixture, order_id_test) { OrderIdTest(); }  // NOLINT
+
+TEST_F(MapListContainerFixture, static_sink_test) {  // NOLINT
+  StaticSinkTest();
+}
+
+TEST_F(MapListContainerFixture, cancel_all_test) {  // NOLINT
+  CancelAllTest();
+}
+
+TEST_F(MapListContainerFixture, book_registry_test) {  // NOLINT
+  BookRegistryTest();
+}
+
+TEST_F(MapListContainerFixture, checkpoint_test) {  // NOLINT
+  CheckpointTest();
+}
+
 // orderbook::container::IntrusivePtrContainer tests
 using IntrusivePtrOrderBookFixture =
     OrderBookFixture<orderbook::IntrusivePtrOrderBookTraits<>>;
@@ -422,6 +701,26 @@ TEST_F(IntrusivePtrOrderBookFixture, partial_execute_test) {  // NOLINT
 
 TEST_F(IntrusivePtrOrderBookFixture, cancel_test) { CancelTest(); }  // NOLINT
 
+TEST_F(IntrusivePtrOrderBookFixture, order_id_test) {  // NOLINT
+  OrderIdTest();
+}
+
+TEST_F(IntrusivePtrOrderBookFixture, static_sink_test) {  // NOLINT
+  StaticSinkTest();
+}
+
+TEST_F(IntrusivePtrOrderBookFixture, cancel_all_test) {  // NOLINT
+  CancelAllTest();
+}
+
+TEST_F(IntrusivePtrOrderBookFixture, book_registry_test) {  // NOLINT
+  BookRegistryTest();
+}
+
+TEST_F(IntrusivePtrOrderBookFixture, checkpoint_test) {  // NOLINT
+  CheckpointTest();
+}
+
 // orderbook::container::IntrusiveListContainer tests
 using IntrusiveListContainerFixture =
     OrderBookFixture<orderbook::IntrusiveListOrderBookTraits<>>;
@@ -444,3 +743,23 @@ TEST_F(IntrusiveListContainerFixture, partial_execute_test) {  // NOLINT
 }
 
 TEST_F(IntrusiveListContainerFixture, cancel_test) { CancelTest(); }  // NOLINT
+
+TEST_F(IntrusiveListContainerFixture, order_id_test) {  // NOLINT
+  OrderIdTest();
+}
+
+TEST_F(IntrusiveListContainerFixture, static_sink_test) {  // NOLINT
+  StaticSinkTest();
+}
+
+TEST_F(IntrusiveListContainerFixture, cancel_all_test) {  // NOLINT
+  CancelAllTest();
+}
+
+TEST_F(IntrusiveListContainerFixture, book_registry_test) {  // NOLINT
+  BookRegistryTest();
+}
+
+TEST_F(IntrusiveListContainerFixture, checkpoint_test) {  // NOLINT
+  CheckpointTest();
+}
@@ -1,5 +1,11 @@
+#include <sstream>
+
 #include "gtest/gtest.h"
 #include "orderbook/application_traits.h"
+#include "orderbook/data/event_record.h"
+#include "orderbook/data/fixed_codec.h"
+#include "orderbook/data/reference_data.h"
+#include "orderbook/data/request_view.h"
 
 using namespace orderbook::data;
 
@@ -42,9 +48,428 @@ class OrderDataFixture : public ::testing::Test {
     // orderbook::data::internal::kPriceToDoubleMult); spdlog::info("{}",
     // convert_prc);
   }
+
+  static auto DecimalConversionTest() -> void {
+    Price prc{0};
+    ASSERT_TRUE(orderbook::data::ToPrice("123.456", prc));
+    ASSERT_TRUE(prc == 123456000);  // NOLINT
+    ASSERT_TRUE(orderbook::data::ToPrice("100", prc));
+    ASSERT_TRUE(prc == 100000000);  // NOLINT
+    ASSERT_TRUE(orderbook::data::ToPrice("0.0000019", prc));
+    ASSERT_TRUE(prc == 1);
+    ASSERT_TRUE(orderbook::data::ToPrice("-1.5", prc));
+    ASSERT_TRUE(prc == -1500000);  // NOLINT
+
+    // malformed or out of range, price is untouched
+    for (const auto* str :
+         {"", "-", ".5", "1.5x", "1e5", "+1", " 1", "--5", "-+5", "+-5",
+          "--5.5", "-.5", "9223372036854.775808", "-9223372036854.775809",
+          "-9999999999999999", "--9999999999999999",
+          "18446744073709551616"}) {
+      ASSERT_FALSE(orderbook::data::ToPrice(str, prc));
+      ASSERT_TRUE(prc == -1500000);  // NOLINT
+    }
+
+    ASSERT_TRUE(orderbook::data::ToDecimalString(123456000) == "123.456");
+    ASSERT_TRUE(orderbook::data::ToDecimalString(100000000) == "100");
+    ASSERT_TRUE(orderbook::data::ToDecimalString(1) == "0.000001");
+    ASSERT_TRUE(orderbook::data::ToDecimalString(0) == "0");
+    ASSERT_TRUE(orderbook::data::ToDecimalString(-1500000) == "-1.5");
+    ASSERT_TRUE(orderbook::data::ToDecimalString(
+                    std::numeric_limits<Price>::min()) ==
+                "-9223372036854.775808");
+
+    // every price round trips exactly
+    for (Price p = -2000000; p <= 2000000; p += 7) {  // NOLINT
+      ASSERT_TRUE(orderbook::data::ToPrice(orderbook::data::ToDecimalString(p),
+                                           prc));
+      ASSERT_TRUE(prc == p);
+    }
+  }
+
+  static auto ReferenceDataTest() -> void {
+    std::istringstream input(
+        "# comment\n"
+        "instrument_id,symbol,type,tick_size,lot_size,low_band,high_band\n"
+        "1,AAPL,equity,0.01,1,1.00,1000.00\r\n"
+        "\n"
+        "100,ESZ6,future,0.25,5\n");
+    const auto reference_data = ReferenceData::Parse(input);
+    ASSERT_TRUE(reference_data.Size() == 2);
+    ASSERT_TRUE(reference_data.MaxInstrumentId() == 100);  // NOLINT
+
+    const auto* aapl = reference_data.Find("AAPL");
+    ASSERT_TRUE(aapl != nullptr);
+    ASSERT_TRUE(aapl == reference_data.Find(InstrumentId{1}));
+    ASSERT_TRUE(aapl->instrument_type == InstrumentType::kEquity);
+    ASSERT_TRUE(aapl->IsValidPrice(150010000));    // NOLINT
+    ASSERT_FALSE(aapl->IsValidPrice(150015000));   // NOLINT
+    ASSERT_FALSE(aapl->IsValidPrice(1001000000));  // NOLINT
+
+    const auto* esz6 = reference_data.Find(InstrumentId{100});  // NOLINT
+    ASSERT_TRUE(esz6 != nullptr);
+    ASSERT_TRUE(esz6->GetSymbol() == "ESZ6");
+    ASSERT_TRUE(esz6->IsValidQuantity(10));  // NOLINT
+    ASSERT_FALSE(esz6->IsValidQuantity(7));  // NOLINT
+    ASSERT_TRUE(esz6->IsValidPrice(-250000));  // NOLINT
+
+    ASSERT_TRUE(reference_data.Find(InstrumentId{0}) == nullptr);
+    ASSERT_TRUE(reference_data.Find(InstrumentId{2}) == nullptr);
+    ASSERT_TRUE(reference_data.Find(InstrumentId{1000}) == nullptr);  // NOLINT
+    ASSERT_TRUE(reference_data.Find("MSFT") == nullptr);
+    ASSERT_TRUE(reference_data.Find("") == nullptr);
+
+    for (const auto* bad :
+         {"1,AAPL,equity,0.01\n", "0,AAPL,equity,0.01,1\n",
+          "1,AAPL,bond,0.01,1\n", "1,AAPL,equity,0,1\n",
+          "1,AAPL,equity,0.01,1,10,1\n", "1,AAPLAAPLAAPLAAPL,equity,0.01,1\n",
+          "1,AAPL,equity,0.01,1\n2,AAPL,equity,0.01,1\n",
+          "1,AAPL,equity,0.01,1\n1,MSFT,equity,0.01,1\n"}) {
+      std::istringstream bad_input(bad);
+      ASSERT_THROW(ReferenceData::Parse(bad_input), std::runtime_error);
+    }
+
+    // every symbol of a large listing is found through the perfect hash
+    constexpr std::size_t kCount = 100000;
+    const auto generated = ReferenceData::Generate(kCount);
+    ASSERT_TRUE(generated.Size() == kCount);
+    for (const auto& record : generated.Instruments()) {
+      ASSERT_TRUE(generated.Find(record.GetSymbol()) == &record);
+    }
+    ASSERT_TRUE(generated.Find("0") == nullptr);
+    ASSERT_TRUE(generated.Find(std::to_string(kCount + 1)) == nullptr);
+  }
+
+  static auto ExecutionViewTest() -> void {
+    LimitOrder order;
+    order.SetOrderId(42)  // NOLINT
+        .SetSide(SideCode::kSell)
+        .SetOrderPrice(1000)     // NOLINT
+        .SetOrderQuantity(10)    // NOLINT
+        .SetLeavesQuantity(4)    // NOLINT
+        .SetExecutedQuantity(6)  // NOLINT
+        .SetExecutedValue(6000)  // NOLINT
+        .SetLastPrice(1000)      // NOLINT
+        .SetLastQuantity(6)      // NOLINT
+        .SetClientOrderId("00000001");
+
+    const LimitOrder& resting_order = order;
+    const auto view = ExecutionView(7, 9, resting_order);  // NOLINT
+
+    // Client order ids are not copied, the view points at the order.
+    ASSERT_TRUE(view.GetClientOrderId().data() ==
+                resting_order.GetClientOrderId().data());
+    ASSERT_TRUE(view.GetTransactionId() == 7);    // NOLINT
+    ASSERT_TRUE(view.GetExecutionId() == 9);      // NOLINT
+    ASSERT_TRUE(view.GetOrderId() == 42);         // NOLINT
+    ASSERT_TRUE(view.GetLastQuantity() == 6);     // NOLINT
+    ASSERT_TRUE(view.GetAveragePrice() == 1000);  // NOLINT
+
+    const auto report = ExecutionReport(view);
+    ASSERT_TRUE(report.GetTransactionId() == view.GetTransactionId());
+    ASSERT_TRUE(report.GetExecutionId() == view.GetExecutionId());
+    ASSERT_TRUE(report.GetOrderId() == view.GetOrderId());
+    ASSERT_TRUE(report.GetSide() == view.GetSide());
+    ASSERT_TRUE(report.GetLeavesQuantity() == view.GetLeavesQuantity());
+    ASSERT_TRUE(report.GetExecutedValue() == view.GetExecutedValue());
+    ASSERT_TRUE(report.GetClientOrderId() == view.GetClientOrderId());
+  }
+
+  static auto EventRecordTest() -> void {
+    LimitOrder order;
+    order.SetOrderId(42)  // NOLINT
+        .SetRoutingId(3)  // NOLINT
+        .SetSide(SideCode::kBuy)
+        .SetOrderPrice(1000)    // NOLINT
+        .SetOrderQuantity(10)   // NOLINT
+        .SetLeavesQuantity(10)  // NOLINT
+        .SetClientOrderId("00000001");
+
+    const LimitOrder& resting_order = order;
+    const auto view = ExecutionView(7, 9, resting_order);  // NOLINT
+    const auto record = EventRecord(EventType::kOrderNew, view);
+
+    ASSERT_TRUE(record.kind == EventRecord::Kind::kExecutionReport);
+    ASSERT_TRUE(record.event_type == EventType::kOrderNew);
+    ASSERT_TRUE(record.routing_id == 3);      // NOLINT
+    ASSERT_TRUE(record.order_id == 42);       // NOLINT
+    ASSERT_TRUE(record.execution_id == 9);    // NOLINT
+    ASSERT_TRUE(record.order_price == 1000);  // NOLINT
+    ASSERT_TRUE(record.side == SideCode::kBuy);
+    ASSERT_TRUE(record.client_order_id.View() == "00000001");
+    ASSERT_TRUE(record.orig_client_order_id.Empty());
+    ASSERT_TRUE(record.GetBodyType() ==
+                orderbook::serialize::Body::ExecutionReport);
+    ASSERT_FALSE(record.IsBatchEnd());
+
+    // Client order ids beyond the fixed capacity are truncated.
+    const std::string long_id(EventRecord::kMaxClientOrderIdLength + 8, 'x');
+    order.SetClientOrderId(long_id);
+    const auto truncated = EventRecord(
+        EventType::kOrderNew, ExecutionView(7, 9, resting_order));  // NOLINT
+    ASSERT_TRUE(truncated.client_order_id.Size() ==
+                EventRecord::kMaxClientOrderIdLength);
+
+    const auto batch_end = EventRecord::MakeBatchEnd();
+    ASSERT_TRUE(batch_end.IsBatchEnd());
+    ASSERT_TRUE(batch_end.GetBodyType() == orderbook::serialize::Body::NONE);
+  }
+
+  static auto ClientOrderIdTest() -> void {
+    // Ids up to the fixed width are accepted and carried in full.
+    const std::string longest(kMaxClientOrderIdLength, 'x');
+    NewOrderSingle order;
+    order.SetClientOrderId(longest);
+    ASSERT_TRUE(HasValidClientOrderIds(order));
+
+    LimitOrder resting_order;
+    resting_order.SetClientOrderId(longest);
+    const auto record = EventRecord(
+        EventType::kOrderNew, ExecutionView(1, 1, resting_order));
+    ASSERT_TRUE(record.client_order_id.View() == longest);
+
+    // A 36 character UUID is rejected, as either the id or the original.
+    const std::string uuid = "0f8fad5b-d9cb-469f-a165-70867728950e";
+    order.SetClientOrderId(uuid);
+    ASSERT_FALSE(HasValidClientOrderIds(order));
+
+    OrderCancelReplaceRequest modify;
+    modify.SetClientOrderId(longest).SetOrigClientOrderId(uuid);
+    ASSERT_FALSE(HasValidClientOrderIds(modify));
+    modify.SetOrigClientOrderId(longest);
+    ASSERT_TRUE(HasValidClientOrderIds(modify));
+  }
+
+  static auto RequestViewTest() -> void {
+    auto nos = NewOrderSingle();
+    nos.SetSide(SideCode::kSellShort)
+        .SetOrderType(OrderTypeCode::kLimit)
+        .SetTimeInForce(TimeInForceCode::kDay)
+        .SetOrderPrice(1000)    // NOLINT
+        .SetOrderQuantity(10)   // NOLINT
+        .SetAccountId(5)        // NOLINT
+        .SetSessionId(6)        // NOLINT
+        .SetInstrumentId(7)     // NOLINT
+        .SetClientOrderId("00000001");
+
+    flatbuffers::FlatBufferBuilder builder;
+    builder.Finish(nos.SerializeTo(builder));
+    const auto* table =
+        flatbuffers::GetRoot<orderbook::serialize::NewOrderSingle>(
+            builder.GetBufferPointer());
+
+    const auto view = NewOrderSingleView(table, 3);  // NOLINT
+    ASSERT_TRUE(view.GetRoutingId() == 3);           // NOLINT
+    ASSERT_TRUE(view.IsSellOrder());
+    ASSERT_FALSE(view.IsBuyOrder());
+    ASSERT_TRUE(view.GetOrderType() == OrderTypeCode::kLimit);
+    ASSERT_TRUE(view.GetTimeInForce() == TimeInForceCode::kDay);
+    ASSERT_TRUE(view.GetOrderPrice() == 1000);    // NOLINT
+    ASSERT_TRUE(view.GetOrderQuantity() == 10);   // NOLINT
+    ASSERT_TRUE(view.GetSessionId() == 6);        // NOLINT
+    ASSERT_TRUE(view.GetInstrumentId() == 7);     // NOLINT
+    ASSERT_TRUE(view.GetClientOrderId() == "00000001");
+    ASSERT_FALSE(view.HasOrigClientOrderId());
+
+    // The client order id is read in place from the message buffer.
+    ASSERT_TRUE(view.GetClientOrderId().data() ==
+                table->client_order_id()->c_str());
+  }
+
+  static auto FixedCodecTest() -> void {
+    namespace fixed = orderbook::serialize::fixed;
+    using EventTypeCode = orderbook::serialize::EventTypeCode;
+
+    auto nos = NewOrderSingle();
+    nos.SetSide(SideCode::kBuy)
+        .SetOrderType(OrderTypeCode::kLimit)
+        .SetTimeInForce(TimeInForceCode::kGtc)
+        .SetOrderPrice(1000)    // NOLINT
+        .SetOrderQuantity(10)   // NOLINT
+        .SetAccountId(5)        // NOLINT
+        .SetSessionId(6)        // NOLINT
+        .SetInstrumentId(7)     // NOLINT
+        .SetClientOrderId("00000001");
+
+    FixedFrameWriter writer;
+    writer.Append<fixed::NewOrderSingle>(EventTypeCode::OrderPendingNew, 1, 2)
+        .Encode(nos);
+    writer.Finish(3, 4);  // NOLINT
+
+    // A single request is sent as a plain Message.
+    ASSERT_TRUE(writer.Size() ==
+                sizeof(fixed::Message) + sizeof(fixed::NewOrderSingle));
+    ASSERT_TRUE(IsFixedFrame(writer.Data(), writer.Size()));
+    ASSERT_TRUE(VerifyFixedFrame(writer.Data(), writer.Size()));
+
+    const auto* message =
+        reinterpret_cast<const fixed::Message*>(writer.Data());
+    ASSERT_TRUE(message->header()->event_type() ==
+                EventTypeCode::OrderPendingNew);
+    ASSERT_TRUE(message->header()->seq_no() == 1);
+    ASSERT_TRUE(message->body_as_OrderCancelRequest() == nullptr);
+
+    const auto* table = message->body_as_NewOrderSingle();
+    ASSERT_TRUE(table != nullptr);
+
+    const auto view = FixedNewOrderSingleView(table, 3);  // NOLINT
+    ASSERT_TRUE(view.IsBuyOrder());
+    ASSERT_TRUE(view.GetOrderType() == OrderTypeCode::kLimit);
+    ASSERT_TRUE(view.GetTimeInForce() == TimeInForceCode::kGtc);
+    ASSERT_TRUE(view.GetOrderPrice() == 1000);    // NOLINT
+    ASSERT_TRUE(view.GetOrderQuantity() == 10);   // NOLINT
+    ASSERT_TRUE(view.GetAccountId() == 5);        // NOLINT
+    ASSERT_TRUE(view.GetInstrumentId() == 7);     // NOLINT
+    ASSERT_TRUE(view.GetClientOrderId() == "00000001");
+    ASSERT_TRUE(view.GetClientOrderId().data() ==
+                table->client_order_id()->data());
+
+    // A second message turns the frame into a MultiMessage.
+    auto cancel = OrderCancelRequest();
+    cancel.SetInstrumentId(8);  // NOLINT
+    cancel.SetClientOrderId(std::string(fixed::FixedChars::kCapacity, 'x'));
+    writer.Clear();
+    writer.Append<fixed::NewOrderSingle>(EventTypeCode::OrderPendingNew, 1, 2)
+        .Encode(nos);
+    writer
+        .Append<fixed::OrderCancelRequest>(EventTypeCode::OrderPendingCancel,
+                                           3, 4)  // NOLINT
+        .Encode(cancel);
+    writer.Finish(5, 6);  // NOLINT
+    ASSERT_TRUE(VerifyFixedFrame(writer.Data(), writer.Size()));
+
+    const auto* multi_msg =
+        reinterpret_cast<const fixed::MultiMessage*>(writer.Data());
+    ASSERT_TRUE(multi_msg->header()->event_type() ==
+                EventTypeCode::MultiMessage);
+    ASSERT_TRUE(multi_msg->messages().size() == 2);
+
+    std::vector<InstrumentId> instruments;
+    for (const auto* nested : multi_msg->messages()) {
+      instruments.push_back(
+          nested->body_type() == orderbook::serialize::Body::NewOrderSingle
+              ? nested->body_as_NewOrderSingle()->instrument_id()
+              : nested->body_as_OrderCancelRequest()->instrument_id());
+    }
+    ASSERT_TRUE(instruments == std::vector<InstrumentId>({7, 8}));  // NOLINT
+
+    // Client order ids fill the fixed width, longer ones are refused.
+    const auto cancel_view = FixedOrderCancelRequestView(
+        (*++multi_msg->messages().begin())->body_as_OrderCancelRequest(), 3);
+    ASSERT_TRUE(cancel_view.GetClientOrderId() == cancel.GetClientOrderId());
+    ASSERT_TRUE(kIsCancelRequest<FixedOrderCancelRequestView>);
+
+    cancel.SetClientOrderId(std::string(fixed::FixedChars::kCapacity + 1, 'x'));
+    writer.Clear();
+    writer.Append<fixed::NewOrderSingle>(EventTypeCode::OrderPendingNew, 1, 2)
+        .Encode(nos);
+    ASSERT_FALSE(writer
+                     .Append<fixed::OrderCancelRequest>(
+                         EventTypeCode::OrderPendingCancel, 3, 4)  // NOLINT
+                     .Encode(cancel));
+    writer.DropLast();
+    writer.Finish(5, 6);  // NOLINT
+    ASSERT_TRUE(writer.Count() == 1);
+    ASSERT_TRUE(VerifyFixedFrame(writer.Data(), writer.Size()));
+    ASSERT_TRUE(writer.Size() ==
+                sizeof(fixed::Message) + sizeof(fixed::NewOrderSingle));
+  }
+
+  static auto FixedCodecBoundsTest() -> void {
+    namespace fixed = orderbook::serialize::fixed;
+    using EventTypeCode = orderbook::serialize::EventTypeCode;
+
+    EventRecord record;
+    record.kind = EventRecord::Kind::kExecutionReport;
+    record.event_type = EventType::kOrderPartiallyFilled;
+    record.order_id = 9;          // NOLINT
+    record.order_quantity = 10;   // NOLINT
+    record.leaves_quantity = 4;   // NOLINT
+
+    FixedFrameWriter writer;
+    record.EncodeTo(writer, 1, 2);
+    record.EncodeTo(writer, 3, 4);  // NOLINT
+    writer.Finish(5, 6);            // NOLINT
+
+    std::vector<std::uint8_t> frame(writer.Data(),
+                                    writer.Data() + writer.Size());
+    ASSERT_TRUE(VerifyFixedFrame(frame.data(), frame.size()));
+
+    const auto* multi_msg =
+        reinterpret_cast<const fixed::MultiMessage*>(frame.data());
+    const auto* message = *multi_msg->messages().begin();
+    ASSERT_TRUE(message->header()->event_type() ==
+                EventTypeCode::OrderPartiallyFilled);
+
+    const auto exec_rpt = ExecutionReport(message->body_as_ExecutionReport());
+    ASSERT_TRUE(exec_rpt.GetOrderId() == 9);            // NOLINT
+    ASSERT_TRUE(exec_rpt.GetExecutedQuantity() == 6);   // NOLINT
+
+    // Truncated buffers and lengths which overrun the buffer are rejected.
+    ASSERT_FALSE(VerifyFixedFrame(frame.data(), frame.size() - 1));
+    ASSERT_FALSE(VerifyFixedFrame(frame.data(), sizeof(fixed::Message) - 1));
+
+    auto* nested = reinterpret_cast<fixed::Message*>(
+        frame.data() + sizeof(fixed::MultiMessage));
+    nested->mutate_length(nested->length() + 8);  // NOLINT
+    ASSERT_FALSE(VerifyFixedFrame(frame.data(), frame.size()));
+    nested->mutate_length(nested->length() - 8);  // NOLINT
+
+    // So are unknown bodies, and bodies too large for their frame.
+    nested->mutate_body_type(orderbook::serialize::Body::NONE);
+    ASSERT_FALSE(VerifyFixedFrame(frame.data(), frame.size()));
+    nested->mutate_body_type(orderbook::serialize::Body::ExecutionReport);
+    ASSERT_TRUE(VerifyFixedFrame(frame.data(), frame.size()));
+
+    // And string lengths beyond their field.
+    const auto* body = nested->body_as_ExecutionReport();
+    auto* length = const_cast<std::uint8_t*>(  // NOLINT
+        reinterpret_cast<const std::uint8_t*>(body->client_order_id()));
+    *length = 255;  // NOLINT
+    ASSERT_FALSE(VerifyFixedFrame(frame.data(), frame.size()));
+    *length = fixed::FixedChars::kCapacity;
+    ASSERT_TRUE(VerifyFixedFrame(frame.data(), frame.size()));
+    *length = 0;
+
+    auto* single = reinterpret_cast<fixed::Message*>(
+        frame.data() + sizeof(fixed::MultiMessage) + nested->length());
+    const auto short_length =
+        sizeof(fixed::Message) + sizeof(fixed::NewOrderSingle);
+    single->mutate_length(short_length);
+    ASSERT_FALSE(VerifyFixedFrame(single, short_length));
+
+    // A flatbuffer never reads as a fixed layout frame.
+    flatbuffers::FlatBufferBuilder builder;
+    builder.Finish(NewOrderSingle().SerializeTo(builder));
+    ASSERT_FALSE(IsFixedFrame(builder.GetBufferPointer(), builder.GetSize()));
+  }
 };
 
 TEST_F(OrderDataFixture, greater_than_test) { GreaterThanTest(); }  // NOLINT
 TEST_F(OrderDataFixture, double_conversion_test) {                  // NOLINT
   DoubleConversionTest();
 }
+TEST_F(OrderDataFixture, decimal_conversion_test) {  // NOLINT
+  DecimalConversionTest();
+}
+TEST_F(OrderDataFixture, reference_data_test) {  // NOLINT
+  ReferenceDataTest();
+}
+TEST_F(OrderDataFixture, execution_view_test) {  // NOLINT
+  ExecutionViewTest();
+}
+TEST_F(OrderDataFixture, event_record_test) {  // NOLINT
+  EventRecordTest();
+}
+TEST_F(OrderDataFixture, client_order_id_test) {  // NOLINT
+  ClientOrderIdTest();
+}
+TEST_F(OrderDataFixture, request_view_test) {  // NOLINT
+  RequestViewTest();
+}
+TEST_F(OrderDataFixture, fixed_codec_test) {  // NOLINT
+  FixedCodecTest();
+}
+TEST_F(OrderDataFixture, fixed_codec_bounds_test) {  // NOLINT
+  FixedCodecBoundsTest();
+}
@@ -0,0 +1,487 @@
+#include "gtest/gtest.h"
+#include "orderbook/application_traits.h"
+#include "orderbook/feed/market_by_order.h"
+#include "orderbook/feed/market_by_price.h"
+#include "orderbook/feed/snapshot_service.h"
+
+using namespace orderbook::data;
+using namespace orderbook::feed;
+
+class FeedFixture : public ::testing::Test {
+ private:
+  using Price = orderbook::data::Price;
+  using Quantity = orderbook::data::Quantity;
+  using Side = orderbook::data::Side;
+
+  struct RecordingEventSink {
+    std::vector<EventRecord>* records;
+
+    auto OnExecutionReport(const EventType& event_type,
+                           const ExecutionView& execution_view) -> void {
+      records->emplace_back(event_type, execution_view);
+    }
+
+    auto OnCancelReject(const EventType& event_type,
+                        const OrderCancelReject& order_cancel_reject) -> void {
+      records->emplace_back(event_type, order_cancel_reject);
+    }
+  };
+
+  using Book = orderbook::MapListOrderBookTraits::StaticBookType<
+      RecordingEventSink>;
+
+  struct Published {
+    std::string topic;
+    FeedHeader header;
+    std::vector<LevelUpdate> updates;
+    std::vector<OrderUpdate> orders;
+  };
+
+  struct CapturingTransport {
+    std::vector<Published> messages;
+
+    auto Publish(std::string_view topic, const void* data,
+                 const std::size_t& size) -> void {
+      Published published;
+      published.topic = topic;
+      const auto* bytes = static_cast<const std::uint8_t*>(data);
+      std::memcpy(&published.header, bytes, sizeof(FeedHeader));
+      if (published.header.feed_type == FeedType::kMarketByOrder) {
+        published.orders.resize(published.header.count);
+        std::memcpy(published.orders.data(), bytes + sizeof(FeedHeader),
+                    size - sizeof(FeedHeader));
+      } else {
+        published.updates.resize(published.header.count);
+        std::memcpy(published.updates.data(), bytes + sizeof(FeedHeader),
+                    size - sizeof(FeedHeader));
+      }
+      messages.push_back(std::move(published));
+    }
+  };
+
+  static auto MakeNewOrderSingle(const InstrumentId& instrument_id,
+                                 const Price& price, const Quantity& quantity,
+                                 const Side& side) -> NewOrderSingle {
+    static std::size_t clord_id{0};
+    NewOrderSingle nos;
+    nos.SetRoutingId(0);
+    nos.SetSessionId(0);
+    nos.SetAccountId(0);
+    nos.SetInstrumentId(instrument_id);
+    nos.SetClientOrderId(std::to_string(++clord_id));
+    nos.SetOrderType(OrderTypeCode::kLimit);
+    nos.SetTimeInForce(TimeInForceCode::kDay);
+    nos.SetOrderPrice(price);
+    nos.SetOrderQuantity(quantity);
+    nos.SetSide(side);
+    return nos;
+  }
+
+  static auto MakeCancel(const NewOrderSingle& order, const OrderId& id)
+      -> OrderCancelRequest {
+    OrderCancelRequest request;
+    request.SetOrderId(id);
+    request.SetRoutingId(order.GetRoutingId());
+    request.SetSessionId(order.GetSessionId());
+    request.SetAccountId(order.GetAccountId());
+    request.SetInstrumentId(order.GetInstrumentId());
+    request.SetSide(order.GetSide());
+    request.SetOrderPrice(order.GetOrderPrice());
+    request.SetOrderQuantity(order.GetOrderQuantity());
+    request.SetOrigClientOrderId(order.GetClientOrderId());
+    request.SetClientOrderId(order.GetClientOrderId() + "c");
+    return request;
+  }
+
+  static auto MakeModify(const NewOrderSingle& order, const OrderId& id,
+                         const Price& price, const Quantity& quantity)
+      -> OrderCancelReplaceRequest {
+    OrderCancelReplaceRequest request;
+    request.SetOrderId(id);
+    request.SetRoutingId(order.GetRoutingId());
+    request.SetSessionId(order.GetSessionId());
+    request.SetAccountId(order.GetAccountId());
+    request.SetInstrumentId(order.GetInstrumentId());
+    request.SetSide(order.GetSide());
+    request.SetOrderPrice(price);
+    request.SetOrderQuantity(quantity);
+    request.SetOrigClientOrderId(order.GetClientOrderId());
+    request.SetClientOrderId(order.GetClientOrderId() + "m");
+    return request;
+  }
+
+  /**
+   * The order id assigned by the most recent kOrderNew event.
+   */
+  static auto LastOrderId(const std::vector<EventRecord>& records)
+      -> OrderId {
+    for (auto iter = records.rbegin(); iter != records.rend(); ++iter) {
+      if (iter->event_type == EventType::kOrderNew) {
+        return iter->order_id;
+      }
+    }
+    return 0;
+  }
+
+  /**
+   * Feed every record to the publisher as a single batch.
+   */
+  template <typename Feed>
+  static auto EndBatch(Feed& feed, std::vector<EventRecord>& records)
+      -> void {
+    for (const auto& record : records) {
+      feed.OnRecord(record);
+    }
+    feed.OnBatchEnd();
+    records.clear();
+  }
+
+ public:
+  static auto PriceLevelsTest() -> void {
+    std::vector<EventRecord> records;
+    Book book{RecordingEventSink{&records}, 1};
+
+    const auto bid_one = MakeNewOrderSingle(1, 100, 10, SideCode::kBuy);
+    book.Add(bid_one);
+    const auto bid_one_id = LastOrderId(records);
+    book.Add(MakeNewOrderSingle(1, 100, 5, SideCode::kBuy));   // NOLINT
+    book.Add(MakeNewOrderSingle(1, 99, 7, SideCode::kBuy));    // NOLINT
+    book.Add(MakeNewOrderSingle(1, 105, 3, SideCode::kSell));  // NOLINT
+
+    PriceLevels levels;
+    for (const auto& record : records) {
+      levels.Apply(record);
+    }
+    records.clear();
+
+    using Level = PriceLevels::Level;
+    ASSERT_EQ(levels.OrderCount(), 4);
+    ASSERT_EQ(levels.GetLevel(1, SideCode::kBuy, 100), (Level{15, 2}));
+    ASSERT_EQ(levels.GetLevel(1, SideCode::kBuy, 99), (Level{7, 1}));
+    ASSERT_EQ(levels.GetLevel(1, SideCode::kSell, 105), (Level{3, 1}));
+    ASSERT_EQ(levels.GetLevel(1, SideCode::kSell, 100), Level{});
+    ASSERT_EQ(levels.GetLevel(2, SideCode::kBuy, 100), Level{});
+
+    const auto* level_book = levels.Find(1);
+    ASSERT_TRUE(level_book != nullptr);
+    ASSERT_EQ(level_book->bids.begin()->first, 100);
+    ASSERT_EQ(level_book->asks.begin()->first, 105);
+
+    // sell 12 at 100 fills the first bid and 2 of the second
+    book.Add(MakeNewOrderSingle(1, 100, 12, SideCode::kSell));  // NOLINT
+    for (const auto& record : records) {
+      levels.Apply(record);
+    }
+    records.clear();
+
+    ASSERT_EQ(levels.GetLevel(1, SideCode::kBuy, 100), (Level{3, 1}));
+    ASSERT_EQ(levels.GetLevel(1, SideCode::kSell, 100), Level{});
+    ASSERT_EQ(levels.OrderCount(), 3);
+
+    // cancelling an order that already filled changes nothing
+    book.Cancel(MakeCancel(bid_one, bid_one_id));
+    for (const auto& record : records) {
+      levels.Apply(record);
+    }
+    records.clear();
+
+    ASSERT_EQ(levels.GetLevel(1, SideCode::kBuy, 100), (Level{3, 1}));
+    ASSERT_EQ(levels.OrderCount(), 3);
+  }
+
+  static auto MarketByPriceTest() -> void {
+    std::vector<EventRecord> records;
+    Book book{RecordingEventSink{&records}, 1};
+    CapturingTransport transport;
+    MarketByPrice<CapturingTransport> feed{transport};
+
+    // two bids at one level and an ask, conflated into two updates
+    book.Add(MakeNewOrderSingle(1, 100, 10, SideCode::kBuy));  // NOLINT
+    book.Add(MakeNewOrderSingle(1, 100, 5, SideCode::kBuy));   // NOLINT
+    const auto ask = MakeNewOrderSingle(1, 105, 7, SideCode::kSell);
+    book.Add(ask);
+    const auto ask_id = LastOrderId(records);
+    EndBatch(feed, records);
+
+    ASSERT_EQ(transport.messages.size(), 1);
+    {
+      const auto& message = transport.messages.back();
+      ASSERT_EQ(message.topic, "L2.1.");
+      ASSERT_EQ(message.header.instrument_id, 1);
+      ASSERT_EQ(message.header.seq_no, 1);
+      ASSERT_EQ(message.header.feed_type, FeedType::kMarketByPrice);
+      ASSERT_EQ(message.updates.size(), 2);
+
+      const auto& bid = message.updates[0];
+      ASSERT_EQ(bid.side, SideCode::kBuy);
+      ASSERT_EQ(bid.price, 100);
+      ASSERT_EQ(bid.quantity, 15);
+      ASSERT_EQ(bid.order_count, 2);
+      ASSERT_EQ(bid.action, LevelAction::kNew);
+
+      const auto& offer = message.updates[1];
+      ASSERT_EQ(offer.side, SideCode::kSell);
+      ASSERT_EQ(offer.price, 105);
+      ASSERT_EQ(offer.quantity, 7);
+      ASSERT_EQ(offer.action, LevelAction::kNew);
+    }
+
+    // the aggressor is added and filled within the batch, only the resting
+    // level it traded against changes
+    book.Add(MakeNewOrderSingle(1, 100, 12, SideCode::kSell));  // NOLINT
+    EndBatch(feed, records);
+
+    ASSERT_EQ(transport.messages.size(), 2);
+    {
+      const auto& message = transport.messages.back();
+      ASSERT_EQ(message.header.seq_no, 2);
+      ASSERT_EQ(message.updates.size(), 1);
+      ASSERT_EQ(message.updates[0].price, 100);
+      ASSERT_EQ(message.updates[0].quantity, 3);
+      ASSERT_EQ(message.updates[0].order_count, 1);
+      ASSERT_EQ(message.updates[0].action, LevelAction::kChange);
+    }
+
+    // an order added and cancelled within one batch publishes nothing
+    const auto fleeting = MakeNewOrderSingle(1, 110, 1, SideCode::kSell);
+    book.Add(fleeting);
+    book.Cancel(MakeCancel(fleeting, LastOrderId(records)));
+    EndBatch(feed, records);
+    ASSERT_EQ(transport.messages.size(), 2);
+    ASSERT_EQ(feed.GetSequence(1), 2);
+
+    // moving the ask deletes one level and creates another
+    book.Modify(MakeModify(ask, ask_id, 106, 4));  // NOLINT
+    EndBatch(feed, records);
+
+    ASSERT_EQ(transport.messages.size(), 3);
+    {
+      const auto& message = transport.messages.back();
+      ASSERT_EQ(message.header.seq_no, 3);
+      ASSERT_EQ(message.updates.size(), 2);
+      ASSERT_EQ(message.updates[0].price, 105);
+      ASSERT_EQ(message.updates[0].quantity, 0);
+      ASSERT_EQ(message.updates[0].action, LevelAction::kDelete);
+      ASSERT_EQ(message.updates[1].price, 106);
+      ASSERT_EQ(message.updates[1].quantity, 4);
+      ASSERT_EQ(message.updates[1].action, LevelAction::kNew);
+    }
+
+    ASSERT_EQ(feed.MessageCount(), 3);
+    ASSERT_EQ(feed.UpdateCount(), 5);
+  }
+
+  static auto MarketByPriceInstrumentTest() -> void {
+    std::vector<EventRecord> records;
+    Book book_one{RecordingEventSink{&records}, 1};
+    Book book_two{RecordingEventSink{&records}, 2};
+    CapturingTransport transport;
+    MarketByPrice<CapturingTransport> feed{transport};
+
+    book_two.Add(MakeNewOrderSingle(2, 50, 1, SideCode::kBuy));   // NOLINT
+    book_one.Add(MakeNewOrderSingle(1, 100, 1, SideCode::kBuy));  // NOLINT
+    EndBatch(feed, records);
+
+    book_two.Add(MakeNewOrderSingle(2, 50, 1, SideCode::kBuy));  // NOLINT
+    EndBatch(feed, records);
+
+    ASSERT_EQ(transport.messages.size(), 3);
+    ASSERT_EQ(transport.messages[0].topic, "L2.1.");
+    ASSERT_EQ(transport.messages[0].header.seq_no, 1);
+    ASSERT_EQ(transport.messages[1].topic, "L2.2.");
+    ASSERT_EQ(transport.messages[1].header.seq_no, 1);
+    ASSERT_EQ(transport.messages[2].topic, "L2.2.");
+    ASSERT_EQ(transport.messages[2].header.seq_no, 2);
+    ASSERT_EQ(transport.messages[2].updates[0].quantity, 2);
+    ASSERT_EQ(transport.messages[2].updates[0].action, LevelAction::kChange);
+    ASSERT_EQ(feed.GetSequence(1), 1);
+    ASSERT_EQ(feed.GetSequence(2), 2);
+    ASSERT_EQ(feed.GetSequence(3), 0);
+  }
+
+  static auto MarketByOrderTest() -> void {
+    std::vector<EventRecord> records;
+    Book book_one{RecordingEventSink{&records}, 1};
+    Book book_two{RecordingEventSink{&records}, 2};
+    CapturingTransport transport;
+    MarketByOrder<CapturingTransport> feed{transport};
+
+    const auto bid = MakeNewOrderSingle(1, 100, 10, SideCode::kBuy);
+    book_one.Add(bid);
+    const auto bid_id = LastOrderId(records);
+    book_two.Add(MakeNewOrderSingle(2, 50, 1, SideCode::kSell));  // NOLINT
+    EndBatch(feed, records);
+
+    ASSERT_EQ(transport.messages.size(), 2);
+    {
+      const auto& message = transport.messages[0];
+      ASSERT_EQ(message.topic, "L3.1.");
+      ASSERT_EQ(message.header.feed_type, FeedType::kMarketByOrder);
+      ASSERT_EQ(message.header.seq_no, 1);
+      ASSERT_EQ(message.orders.size(), 1);
+      ASSERT_EQ(message.orders[0].order_id, bid_id);
+      ASSERT_EQ(message.orders[0].action, OrderAction::kAdd);
+      ASSERT_EQ(message.orders[0].side, SideCode::kBuy);
+      ASSERT_EQ(message.orders[0].price, 100);
+      ASSERT_EQ(message.orders[0].quantity, 10);
+      ASSERT_EQ(transport.messages[1].topic, "L3.2.");
+      ASSERT_EQ(transport.messages[1].header.seq_no, 1);
+    }
+
+    // the aggressor is added, then both sides execute
+    book_one.Add(MakeNewOrderSingle(1, 99, 4, SideCode::kSell));  // NOLINT
+    const auto ask_id = LastOrderId(records);
+    EndBatch(feed, records);
+
+    ASSERT_EQ(transport.messages.size(), 3);
+    {
+      const auto& message = transport.messages.back();
+      ASSERT_EQ(message.header.seq_no, 2);
+      ASSERT_EQ(message.orders.size(), 3);
+      ASSERT_EQ(message.orders[0].order_id, ask_id);
+      ASSERT_EQ(message.orders[0].action, OrderAction::kAdd);
+
+      std::size_t executions{0};
+      for (const auto& order : message.orders) {
+        if (order.action != OrderAction::kExecute) {
+          continue;
+        }
+        ++executions;
+        ASSERT_EQ(order.price, 100);
+        ASSERT_EQ(order.executed_quantity, 4);
+        ASSERT_EQ(order.quantity, order.order_id == bid_id ? 6 : 0);
+      }
+      ASSERT_EQ(executions, 2);
+    }
+
+    const auto modify = MakeModify(bid, bid_id, 101, 10);  // NOLINT
+    book_one.Modify(modify);
+
+    auto modified = bid;
+    modified.SetOrderPrice(modify.GetOrderPrice());
+    modified.SetClientOrderId(modify.GetClientOrderId());
+    book_one.Cancel(MakeCancel(modified, bid_id));
+    EndBatch(feed, records);
+
+    ASSERT_EQ(transport.messages.size(), 4);
+    {
+      const auto& message = transport.messages.back();
+      ASSERT_EQ(message.header.seq_no, 3);
+      ASSERT_EQ(message.orders.size(), 2);
+      ASSERT_EQ(message.orders[0].action, OrderAction::kModify);
+      ASSERT_EQ(message.orders[0].price, 101);
+      ASSERT_EQ(message.orders[0].quantity, 6);
+      ASSERT_EQ(message.orders[1].action, OrderAction::kDelete);
+      ASSERT_EQ(message.orders[1].quantity, 0);
+    }
+
+    // batches without order updates publish nothing
+    EndBatch(feed, records);
+    ASSERT_EQ(transport.messages.size(), 4);
+    ASSERT_EQ(feed.GetSequence(1), 3);
+    ASSERT_EQ(feed.GetSequence(2), 1);
+    ASSERT_EQ(feed.UpdateCount(), 7);
+  }
+
+  static auto SnapshotRequestTest() -> void {
+    using Snapshots = SnapshotService<CapturingTransport>;
+
+    std::vector<EventRecord> records;
+    Book book{RecordingEventSink{&records}, 1};
+    CapturingTransport transport;
+    MarketByPrice<CapturingTransport> feed{transport};
+    Snapshots snapshots{transport, feed,
+                        SnapshotOptions{2, std::chrono::milliseconds(0)}};
+
+    book.Add(MakeNewOrderSingle(1, 100, 10, SideCode::kBuy));  // NOLINT
+    book.Add(MakeNewOrderSingle(1, 98, 1, SideCode::kBuy));    // NOLINT
+    book.Add(MakeNewOrderSingle(1, 99, 5, SideCode::kBuy));    // NOLINT
+    book.Add(MakeNewOrderSingle(1, 105, 3, SideCode::kSell));  // NOLINT
+    EndBatch(feed, records);
+    ASSERT_FALSE(feed.HasPendingUpdates());
+    transport.messages.clear();
+
+    const auto now = std::chrono::steady_clock::now();
+    ASSERT_EQ(snapshots.Poll(now), 0);
+
+    // only snapshot topics of books this feed knows are answered
+    snapshots.OnSubscription("L2.1.");
+    snapshots.OnSubscription("SNAP.7.");
+    snapshots.OnSubscription("SNAP.1.");
+    snapshots.OnSubscription("SNAP.1.");
+    ASSERT_EQ(snapshots.Poll(now), 1);
+    ASSERT_EQ(transport.messages.size(), 1);
+    {
+      const auto& message = transport.messages.back();
+      ASSERT_EQ(message.topic, "SNAP.1.");
+      ASSERT_EQ(message.header.feed_type, FeedType::kSnapshot);
+      ASSERT_EQ(message.header.seq_no, 1);
+      ASSERT_EQ(message.updates.size(), 3);
+      ASSERT_EQ(message.updates[0].side, SideCode::kBuy);
+      ASSERT_EQ(message.updates[0].price, 100);
+      ASSERT_EQ(message.updates[0].quantity, 10);
+      ASSERT_EQ(message.updates[1].price, 99);
+      ASSERT_EQ(message.updates[2].side, SideCode::kSell);
+      ASSERT_EQ(message.updates[2].price, 105);
+      ASSERT_EQ(message.updates[2].order_count, 1);
+    }
+
+    // a snapshot taken after the next batch carries its sequence number
+    book.Add(MakeNewOrderSingle(1, 100, 2, SideCode::kBuy));  // NOLINT
+    for (const auto& record : records) {
+      feed.OnRecord(record);
+    }
+    ASSERT_TRUE(feed.HasPendingUpdates());
+    feed.OnBatchEnd();
+    records.clear();
+
+    snapshots.OnSubscription("SNAP.");
+    ASSERT_EQ(snapshots.Poll(now), 1);
+    {
+      const auto& message = transport.messages.back();
+      ASSERT_EQ(message.header.seq_no, 2);
+      ASSERT_EQ(message.updates[0].quantity, 12);
+      ASSERT_EQ(message.updates[0].order_count, 2);
+    }
+    ASSERT_EQ(snapshots.Poll(now), 0);
+    ASSERT_EQ(snapshots.SnapshotCount(), 2);
+  }
+
+  static auto SnapshotCycleTest() -> void {
+    using Snapshots = SnapshotService<CapturingTransport>;
+    constexpr std::size_t kInstrumentCount = Snapshots::kSliceSize + 4;
+    constexpr std::chrono::milliseconds kInterval{10};
+
+    std::vector<EventRecord> records;
+    Book book{RecordingEventSink{&records}, 1};
+    CapturingTransport transport;
+    MarketByPrice<CapturingTransport> feed{transport};
+    Snapshots snapshots{transport, feed, SnapshotOptions{5, kInterval}};
+
+    for (InstrumentId id = 1; id <= kInstrumentCount; ++id) {
+      book.Add(MakeNewOrderSingle(id, 100, 1, SideCode::kBuy));  // NOLINT
+    }
+    EndBatch(feed, records);
+    transport.messages.clear();
+
+    // a cycle is published in slices, then waits for the interval
+    const auto now = std::chrono::steady_clock::now();
+    ASSERT_EQ(snapshots.Poll(now), Snapshots::kSliceSize);
+    ASSERT_EQ(snapshots.Poll(now), 4);
+    ASSERT_EQ(snapshots.Poll(now), 0);
+    ASSERT_EQ(transport.messages.front().topic, "SNAP.1.");
+    ASSERT_EQ(transport.messages.back().topic, "SNAP.20.");
+
+    ASSERT_EQ(snapshots.Poll(now + kInterval), Snapshots::kSliceSize);
+    ASSERT_EQ(transport.messages.size(), kInstrumentCount + 16);
+  }
+};
+
+TEST_F(FeedFixture, price_levels_test) { PriceLevelsTest(); }  // NOLINT
+TEST_F(FeedFixture, market_by_price_test) { MarketByPriceTest(); }  // NOLINT
+TEST_F(FeedFixture, market_by_price_instrument_test) {  // NOLINT
+  MarketByPriceInstrumentTest();
+}
+TEST_F(FeedFixture, market_by_order_test) { MarketByOrderTest(); }  // NOLINT
+TEST_F(FeedFixture, snapshot_request_test) { SnapshotRequestTest(); }  // NOLINT
+TEST_F(FeedFixture, snapshot_cycle_test) { SnapshotCycleTest(); }  // NOLINT
@@ -0,0 +1,540 @@
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "orderbook/gateway/fix_parser.h"
+#include "orderbook/gateway/risk_engine.h"
+#include "orderbook/gateway/routing_table.h"
+#include "orderbook/gateway/throttle.h"
+
+class GatewayFixture : public ::testing::Test {
+ private:
+  using RoutingTable = orderbook::gateway::RoutingTable;
+  using FixParser = orderbook::gateway::FixParser;
+  using Throttle = orderbook::gateway::Throttle;
+  using ThrottleLimits = orderbook::gateway::ThrottleLimits;
+  using TokenBucket = orderbook::gateway::TokenBucket;
+  using RiskConfig = orderbook::gateway::RiskConfig;
+  using RiskEngine = orderbook::gateway::RiskEngine;
+  using Result = RiskEngine::Result;
+  using EventType = orderbook::data::EventType;
+  using ExecutionReport = orderbook::data::ExecutionReport;
+  using Side = orderbook::data::Side;
+
+  /**
+   * A FIX message from "tag=value|" pairs, | standing in for SOH.
+   */
+  static auto ToFix(std::string str) -> std::string {
+    std::replace(str.begin(), str.end(), '|', '\x01');
+    return str;
+  }
+
+  /**
+   * The part of a quickfix FieldMap the parser reads.
+   */
+  struct FieldMap {
+    struct Field {
+      std::string value;
+      auto getString() const -> const std::string& { return value; }
+    };
+
+    std::map<int, Field> fields;
+
+    auto isSetField(int tag) const -> bool { return fields.contains(tag); }
+    auto getFieldRef(int tag) const -> const Field& { return fields.at(tag); }
+  };
+
+  static auto MakeOrder(const orderbook::data::AccountId& account_id,
+                        const Side& side, const orderbook::data::Price& price,
+                        const orderbook::data::Quantity& quantity)
+      -> orderbook::data::NewOrderSingle {
+    orderbook::data::NewOrderSingle order;
+    order.SetAccountId(account_id)
+        .SetSide(side)
+        .SetOrderPrice(price * orderbook::data::kPriceScale)
+        .SetOrderQuantity(quantity)
+        .SetInstrumentId(7)  // NOLINT
+        .SetSessionId(1);
+    return order;
+  }
+
+  /**
+   * The orderbook's report of order_id, as the order now stands.
+   */
+  static auto MakeReport(const orderbook::data::NewOrderSingle& order,
+                         const orderbook::data::OrderId& order_id,
+                         const orderbook::data::Quantity& last_quantity,
+                         const orderbook::data::Quantity& leaves_quantity)
+      -> ExecutionReport {
+    ExecutionReport exec_rpt(0, 0, order);
+    exec_rpt.SetOrderId(order_id);
+    exec_rpt.SetLastQuantity(last_quantity);
+    exec_rpt.SetLeavesQuantity(leaves_quantity);
+    return exec_rpt;
+  }
+
+ public:
+  static auto SingleEngineTest() -> void {
+    auto table = RoutingTable::Parse("tcp://127.0.0.1:5555");
+    ASSERT_TRUE(table.Size() == 1);
+    ASSERT_TRUE(table.Addresses()[0] == "tcp://127.0.0.1:5555");
+
+    for (orderbook::data::InstrumentId id = 0; id < 100; ++id) {  // NOLINT
+      ASSERT_TRUE(table.EngineOf(id) == 0);
+    }
+  }
+
+  static auto RangeTest() -> void {
+    auto table = RoutingTable::Parse(
+        "1-99=tcp://a:5555,100-199=tcp://b:5555,300-399=tcp://a:5555");
+
+    // one engine may own several ranges
+    ASSERT_TRUE(table.Size() == 2);
+    ASSERT_TRUE(table.EngineOf(1) == 0);
+    ASSERT_TRUE(table.EngineOf(99) == 0);  // NOLINT
+    ASSERT_TRUE(table.EngineOf(100) == 1);  // NOLINT
+    ASSERT_TRUE(table.EngineOf(199) == 1);  // NOLINT
+    ASSERT_TRUE(table.EngineOf(350) == 0);  // NOLINT
+
+    // unranged instruments hash across every engine
+    ASSERT_TRUE(table.EngineOf(250) == 0);  // NOLINT
+    ASSERT_TRUE(table.EngineOf(251) == 1);  // NOLINT
+  }
+
+  static auto HashTest() -> void {
+    auto table = RoutingTable::Parse(
+        "1-9=tcp://a:5555,tcp://b:5555,tcp://c:5555,tcp://b:5555");
+
+    ASSERT_TRUE(table.Size() == 3);
+    ASSERT_TRUE(table.EngineOf(5) == 0);  // NOLINT
+
+    // unranged instruments hash across the hashed engines only
+    for (orderbook::data::InstrumentId id = 10; id < 100; ++id) {  // NOLINT
+      ASSERT_TRUE(table.EngineOf(id) == 1 + id % 2);
+    }
+  }
+
+  static auto ParseErrorTest() -> void {
+    ASSERT_THROW(RoutingTable::Parse(""), std::invalid_argument);
+    ASSERT_THROW(RoutingTable::Parse("tcp://a:5555,"), std::invalid_argument);
+    ASSERT_THROW(RoutingTable::Parse("1=tcp://a:5555"), std::invalid_argument);
+    ASSERT_THROW(RoutingTable::Parse("x-9=tcp://a:5555"),
+                 std::invalid_argument);
+    ASSERT_THROW(RoutingTable::Parse("9-1=tcp://a:5555"),
+                 std::invalid_argument);
+    ASSERT_THROW(RoutingTable::Parse("1-9="), std::invalid_argument);
+    ASSERT_THROW(RoutingTable::Parse("1-9=tcp://a:5555,5-20=tcp://b:5555"),
+                 std::invalid_argument);
+  }
+
+  static auto FindSohTest() -> void {
+    using orderbook::gateway::internal::FindSoh;
+
+    // every position, within and past the SIMD stride
+    for (std::size_t len = 0; len < 40; ++len) {  // NOLINT
+      for (std::size_t soh = 0; soh <= len; ++soh) {
+        std::string str(len, 'x');
+        if (soh < len) {
+          str[soh] = '\x01';
+        }
+        const auto* end = str.data() + str.size();
+        ASSERT_TRUE(FindSoh(str.data(), end) == str.data() + soh);
+      }
+    }
+  }
+
+  static auto NewOrderSingleTest() -> void {
+    const auto raw = ToFix(
+        "8=FIX.4.2|9=100|35=D|34=2|49=CLIENT|56=GATEWAY|1=1001|"
+        "11=clordid-1|21=1|38=100|40=2|44=123.456|48=7|54=2|55=AAPL|"
+        "10=123|");
+
+    FixParser parser;
+    ASSERT_TRUE(parser.Parse(raw));
+    ASSERT_TRUE(parser.MsgType() == "D");
+
+    orderbook::data::NewOrderSingle order;
+    ASSERT_TRUE(parser.Fill(order));
+    ASSERT_TRUE(order.GetOrderPrice() == 123456000);  // NOLINT
+    ASSERT_TRUE(order.GetOrderQuantity() == 100);     // NOLINT
+    ASSERT_TRUE(order.GetSide() == orderbook::data::Side::kSell);
+    ASSERT_TRUE(order.GetInstrumentId() == 7);  // NOLINT
+    ASSERT_TRUE(order.GetAccountId() == 1001);  // NOLINT
+    ASSERT_TRUE(order.GetClientOrderId() == "clordid-1");
+    ASSERT_TRUE(order.GetOrderType() == orderbook::data::OrderType::kLimit);
+
+    // a request of another type is not filled from it
+    orderbook::data::OrderCancelRequest cancel;
+    ASSERT_FALSE(parser.Fill(cancel));
+
+    // market orders are left to quickfix
+    const auto market = ToFix("35=D|1=1|11=a|38=1|40=1|48=7|54=1|");
+    ASSERT_TRUE(parser.Parse(market));
+    ASSERT_FALSE(parser.Fill(order));
+  }
+
+  static auto CancelReplaceTest() -> void {
+    const auto replace =
+        ToFix("35=G|1=1001|11=clordid-2|37=42|38=50.000|41=clordid-1|"
+              "44=99.5|48=7|54=1|");
+
+    FixParser parser;
+    ASSERT_TRUE(parser.Parse(replace));
+
+    orderbook::data::OrderCancelReplaceRequest modify;
+    ASSERT_TRUE(parser.Fill(modify));
+    ASSERT_TRUE(modify.GetOrderId() == 42);           // NOLINT
+    ASSERT_TRUE(modify.GetOrderQuantity() == 50);     // NOLINT
+    ASSERT_TRUE(modify.GetOrderPrice() == 99500000);  // NOLINT
+    ASSERT_TRUE(modify.GetClientOrderId() == "clordid-2");
+    ASSERT_TRUE(modify.GetOrigClientOrderId() == "clordid-1");
+
+    const auto cancel_raw = ToFix(
+        "35=F|1=1001|11=clordid-3|37=42|38=50|41=clordid-2|48=7|54=1|");
+    ASSERT_TRUE(parser.Parse(cancel_raw));
+
+    orderbook::data::OrderCancelRequest cancel;
+    ASSERT_TRUE(parser.Fill(cancel));
+    ASSERT_TRUE(cancel.GetOrderId() == 42);  // NOLINT
+    ASSERT_TRUE(cancel.GetSide() == orderbook::data::Side::kBuy);
+    ASSERT_TRUE(cancel.GetOrigClientOrderId() == "clordid-2");
+
+    // missing OrderID, fractional quantity
+    const auto no_order_id = ToFix("35=F|1=1|11=b|38=5|41=a|48=7|54=1|");
+    ASSERT_TRUE(parser.Parse(no_order_id));
+    ASSERT_FALSE(parser.Fill(cancel));
+
+    const auto fractional = ToFix("35=F|1=1|11=b|37=1|38=5.5|41=a|48=7|54=1|");
+    ASSERT_TRUE(parser.Parse(fractional));
+    ASSERT_FALSE(parser.Fill(cancel));
+  }
+
+  static auto SymbolTest() -> void {
+    std::istringstream input("7,AAPL,equity,0.01,1\n");
+    const auto reference_data = orderbook::data::ReferenceData::Parse(input);
+
+    // Symbol resolves the instrument when SecurityID is absent
+    const auto raw = ToFix("35=D|1=1|11=a|38=1|40=2|44=1.5|54=1|55=AAPL|");
+    FixParser parser(&reference_data);
+    ASSERT_TRUE(parser.Parse(raw));
+
+    orderbook::data::NewOrderSingle order;
+    ASSERT_TRUE(parser.Fill(order));
+    ASSERT_TRUE(order.GetInstrumentId() == 7);  // NOLINT
+
+    const auto unknown = ToFix("35=D|1=1|11=a|38=1|40=2|44=1.5|54=1|55=IBM|");
+    ASSERT_TRUE(parser.Parse(unknown));
+    ASSERT_FALSE(parser.Fill(order));
+
+    // without reference data only SecurityID is read
+    FixParser plain;
+    ASSERT_TRUE(plain.Parse(raw));
+    ASSERT_FALSE(plain.Fill(order));
+  }
+
+  static auto FieldMapTest() -> void {
+    const FieldMap header{{{35, {"D"}}, {49, {"CLIENT"}}}};  // NOLINT
+    FieldMap body{{{1, {"1001"}},                           // NOLINT
+                   {11, {"clordid-1"}},                     // NOLINT
+                   {38, {"100"}},                           // NOLINT
+                   {40, {"2"}},                             // NOLINT
+                   {44, {"123.456"}},                       // NOLINT
+                   {48, {"7"}},                             // NOLINT
+                   {54, {"2"}}}};                           // NOLINT
+
+    // fields are read in place from an already parsed message
+    FixParser parser;
+    ASSERT_TRUE(parser.Parse(header, body));
+    ASSERT_TRUE(parser.MsgType() == "D");
+    ASSERT_TRUE(parser.Get(11).data() == body.fields.at(11).value.data());
+
+    orderbook::data::NewOrderSingle order;
+    ASSERT_TRUE(parser.Fill(order));
+    ASSERT_TRUE(order.GetOrderPrice() == 123456000);  // NOLINT
+    ASSERT_TRUE(order.GetOrderQuantity() == 100);     // NOLINT
+    ASSERT_TRUE(order.GetInstrumentId() == 7);        // NOLINT
+    ASSERT_TRUE(order.GetClientOrderId() == "clordid-1");
+
+    // fields absent from this message do not linger from the last one
+    body.fields.erase(44);  // NOLINT
+    ASSERT_TRUE(parser.Parse(header, body));
+    ASSERT_FALSE(parser.Has(44));  // NOLINT
+    ASSERT_FALSE(parser.Fill(order));
+
+    ASSERT_FALSE(parser.Parse(FieldMap{}, body));
+  }
+
+  static auto MalformedTest() -> void {
+    FixParser parser;
+    ASSERT_FALSE(parser.Parse(ToFix("35=D|38=100")));
+    ASSERT_FALSE(parser.Parse(ToFix("35=D|x=1|")));
+    ASSERT_FALSE(parser.Parse(ToFix("35D|")));
+    ASSERT_FALSE(parser.Parse(ToFix("38=100|")));
+    ASSERT_TRUE(parser.Parse(ToFix("35=D|9999=ignored|")));
+  }
+
+  static auto RiskConfigTest() -> void {
+    std::istringstream input(
+        "# limits\r\n"
+        "account_id,max_order_quantity,max_open_orders,max_open_notional,"
+        "max_position\n"
+        "\n"
+        "*,100,2,1000,500\n"
+        "1001,10,1,99.5,5\n");
+    const auto config = RiskConfig::Parse(input);
+    ASSERT_TRUE(config.default_limits.has_value());
+    ASSERT_TRUE(config.default_limits->max_open_orders == 2);
+    ASSERT_TRUE(config.accounts.size() == 1);
+    ASSERT_TRUE(config.accounts[0].first == 1001);  // NOLINT
+    ASSERT_TRUE(config.accounts[0].second.max_open_notional ==
+                99500000);  // NOLINT
+
+    std::istringstream short_line("1,10,1,100\n");
+    ASSERT_THROW(RiskConfig::Parse(short_line), std::runtime_error);
+    std::istringstream negative("1,10,-1,100,5\n");
+    ASSERT_THROW(RiskConfig::Parse(negative), std::runtime_error);
+    std::istringstream bad_account("x,10,1,100,5\n");
+    ASSERT_THROW(RiskConfig::Parse(bad_account), std::runtime_error);
+
+    std::istringstream out_of_range("65536,10,1,100,5\n");
+    ASSERT_THROW(RiskEngine(RiskConfig::Parse(out_of_range)),
+                 std::runtime_error);
+  }
+
+  static auto RiskLimitTest() -> void {
+    std::istringstream input("1,100,2,1000,150\n");
+    RiskEngine risk(RiskConfig::Parse(input));
+
+    // accounts without limits are rejected
+    ASSERT_TRUE(risk.Check(MakeOrder(2, Side::kBuy, 1, 1)) ==
+                Result::kUnknownAccount);
+
+    ASSERT_TRUE(risk.Check(MakeOrder(1, Side::kBuy, 1, 101)) ==  // NOLINT
+                Result::kOrderQuantity);
+
+    // 10 x 60 then 10 x 40 reach the notional limit exactly
+    const auto first = MakeOrder(1, Side::kBuy, 10, 60);  // NOLINT
+    ASSERT_TRUE(risk.Check(first) == Result::kAccepted);
+    ASSERT_TRUE(risk.Check(MakeOrder(1, Side::kSell, 10, 41)) ==  // NOLINT
+                Result::kOpenNotional);
+    ASSERT_TRUE(risk.Check(MakeOrder(1, Side::kSell, 10, 40)) ==  // NOLINT
+                Result::kAccepted);
+    ASSERT_TRUE(risk.OpenNotional(1) == 1000 * orderbook::data::kPriceScale);
+    ASSERT_TRUE(risk.OpenOrders(1) == 2);
+
+    // the third order breaches the open order limit, and nothing is held
+    ASSERT_TRUE(risk.Check(MakeOrder(1, Side::kBuy, 1, 1)) ==
+                Result::kOpenOrders);
+    ASSERT_TRUE(risk.OpenOrders(1) == 2);
+    ASSERT_TRUE(risk.OpenNotional(1) == 1000 * orderbook::data::kPriceScale);
+
+    // a replace of an order not known to hold anything adds its full
+    // notional, and holds nothing
+    orderbook::data::OrderCancelReplaceRequest modify;
+    modify.SetAccountId(1).SetSide(Side::kBuy).SetOrderQuantity(1);
+    modify.SetOrderPrice(orderbook::data::kPriceScale);
+    ASSERT_TRUE(risk.Check(modify) == Result::kOpenNotional);
+    modify.SetOrderPrice(0);
+    ASSERT_TRUE(risk.Check(modify) == Result::kAccepted);
+    modify.SetOrderQuantity(151);  // NOLINT
+    ASSERT_TRUE(risk.Check(modify) == Result::kOrderQuantity);
+
+    // once acknowledged the order's held notional is swapped for the new
+    // one, so an account at its limit can still shrink the order
+    risk.OnExecutionReport(EventType::kOrderNew,
+                           MakeReport(first, 1, 0, 60));  // NOLINT
+    modify.SetOrderId(1).SetInstrumentId(7);              // NOLINT
+    modify.SetOrderPrice(10 * orderbook::data::kPriceScale);  // NOLINT
+    modify.SetOrderQuantity(50);                              // NOLINT
+    ASSERT_TRUE(risk.Check(modify) == Result::kAccepted);
+    modify.SetOrderQuantity(60);  // NOLINT
+    ASSERT_TRUE(risk.Check(modify) == Result::kAccepted);
+    modify.SetOrderQuantity(61);  // NOLINT
+    ASSERT_TRUE(risk.Check(modify) == Result::kOpenNotional);
+
+    // a cancelled order holds nothing to swap
+    risk.OnExecutionReport(EventType::kOrderCancelled,
+                           MakeReport(first, 1, 0, 0));
+    modify.SetOrderQuantity(50);  // NOLINT
+    ASSERT_TRUE(risk.Check(modify) == Result::kAccepted);
+    modify.SetOrderQuantity(61);  // NOLINT
+    ASSERT_TRUE(risk.Check(modify) == Result::kOpenNotional);
+  }
+
+  static auto RiskExecutionTest() -> void {
+    std::istringstream input("*,100,10,100000,15\n");
+    RiskEngine risk(RiskConfig::Parse(input));
+    constexpr auto kScale = orderbook::data::kPriceScale;
+
+    // new, acknowledged, then filled in two parts
+    const auto buy = MakeOrder(1, Side::kBuy, 10, 10);  // NOLINT
+    ASSERT_TRUE(risk.Check(buy) == Result::kAccepted);
+    risk.OnExecutionReport(EventType::kOrderNew, MakeReport(buy, 1, 0, 10));
+    ASSERT_TRUE(risk.OpenNotional(1) == 100 * kScale);
+    risk.OnExecutionReport(EventType::kOrderPartiallyFilled,
+                           MakeReport(buy, 1, 4, 6));
+    ASSERT_TRUE(risk.OpenNotional(1) == 60 * kScale);
+    ASSERT_TRUE(risk.Position(1) == 4);
+    risk.OnExecutionReport(EventType::kOrderFilled, MakeReport(buy, 1, 6, 0));
+    ASSERT_TRUE(risk.OpenNotional(1) == 0);
+    ASSERT_TRUE(risk.OpenOrders(1) == 0);
+    ASSERT_TRUE(risk.Position(1) == 10);
+
+    // a buy to cover fills long like a buy
+    const auto cover = MakeOrder(1, Side::kBuyCover, 1, 2);  // NOLINT
+    ASSERT_TRUE(risk.Check(cover) == Result::kAccepted);
+    risk.OnExecutionReport(EventType::kOrderNew, MakeReport(cover, 5, 0, 2));
+    risk.OnExecutionReport(EventType::kOrderFilled,
+                           MakeReport(cover, 5, 2, 0));  // NOLINT
+    ASSERT_TRUE(risk.Position(1) == 12);                 // NOLINT
+    ASSERT_TRUE(risk.Check(MakeOrder(1, Side::kBuyCover, 1, 4)) ==
+                Result::kPosition);
+
+    // the filled position bounds further buying, not selling
+    ASSERT_TRUE(risk.Check(MakeOrder(1, Side::kBuy, 1, 4)) ==
+                Result::kPosition);
+    ASSERT_TRUE(risk.Check(MakeOrder(1, Side::kSell, 1, 27)) ==  // NOLINT
+                Result::kAccepted);
+    risk.OnExecutionReport(
+        EventType::kOrderRejected,
+        MakeReport(MakeOrder(1, Side::kSell, 1, 27), 0, 0, 0));  // NOLINT
+    ASSERT_TRUE(risk.OpenNotional(1) == 0);
+    ASSERT_TRUE(risk.OpenOrders(1) == 0);
+
+    // replaced, then cancelled
+    const auto sell = MakeOrder(1, Side::kSell, 20, 5);  // NOLINT
+    ASSERT_TRUE(risk.Check(sell) == Result::kAccepted);
+    risk.OnExecutionReport(EventType::kOrderNew, MakeReport(sell, 2, 0, 5));
+    auto replaced = MakeReport(sell, 2, 0, 3);
+    replaced.SetOrderPrice(30 * kScale);  // NOLINT
+    risk.OnExecutionReport(EventType::kOrderModified, replaced);
+    ASSERT_TRUE(risk.OpenNotional(1) == 90 * kScale);
+    risk.OnExecutionReport(EventType::kOrderCancelled,
+                           MakeReport(sell, 2, 0, 0));
+    ASSERT_TRUE(risk.OpenNotional(1) == 0);
+    ASSERT_TRUE(risk.OpenOrders(1) == 0);
+
+    // cancel on disconnect releases through the orderbook's cancel reports,
+    // an order acknowledged after the logout included
+    const auto rest = MakeOrder(1, Side::kSell, 10, 10);  // NOLINT
+    ASSERT_TRUE(risk.Check(rest) == Result::kAccepted);
+    auto other = MakeOrder(1, Side::kSell, 1, 1);
+    other.SetSessionId(2);
+    ASSERT_TRUE(risk.Check(other) == Result::kAccepted);
+    risk.OnExecutionReport(EventType::kOrderNew, MakeReport(other, 4, 0, 1));
+    risk.OnExecutionReport(EventType::kOrderNew, MakeReport(rest, 3, 0, 10));
+    risk.OnExecutionReport(EventType::kOrderCancelled,
+                           MakeReport(rest, 3, 0, 0));
+    ASSERT_TRUE(risk.OpenNotional(1) == kScale);
+    ASSERT_TRUE(risk.OpenOrders(1) == 1);
+
+    // a repeated report releases nothing twice
+    risk.OnExecutionReport(EventType::kOrderCancelled,
+                           MakeReport(rest, 3, 0, 0));
+    ASSERT_TRUE(risk.OpenNotional(1) == kScale);
+    ASSERT_TRUE(risk.OpenOrders(1) == 1);
+  }
+
+  static auto TokenBucketTest() -> void {
+    constexpr std::uint64_t kMillis = 1000000;
+    constexpr std::uint64_t kStart = 5000 * kMillis;
+
+    // 100 a second, 10 at once
+    TokenBucket bucket(ThrottleLimits{100, 10});  // NOLINT
+    for (int i = 0; i < 10; ++i) {                // NOLINT
+      ASSERT_TRUE(bucket.TryAcquire(kStart));
+    }
+    ASSERT_FALSE(bucket.TryAcquire(kStart));
+
+    // a token every 10ms
+    ASSERT_FALSE(bucket.TryAcquire(kStart + 9 * kMillis));
+    ASSERT_TRUE(bucket.TryAcquire(kStart + 10 * kMillis));
+    ASSERT_FALSE(bucket.TryAcquire(kStart + 10 * kMillis));
+
+    // idle time refills up to the burst, no further
+    const auto later = kStart + 1000 * kMillis;
+    for (int i = 0; i < 10; ++i) {  // NOLINT
+      ASSERT_TRUE(bucket.TryAcquire(later));
+    }
+    ASSERT_FALSE(bucket.TryAcquire(later));
+
+    // the burst defaults to a second's worth, a zero rate is unlimited
+    TokenBucket second(ThrottleLimits{5, 0});  // NOLINT
+    for (int i = 0; i < 5; ++i) {              // NOLINT
+      ASSERT_TRUE(second.TryAcquire(kStart));
+    }
+    ASSERT_FALSE(second.TryAcquire(kStart));
+
+    TokenBucket unlimited;
+    for (int i = 0; i < 1000; ++i) {  // NOLINT
+      ASSERT_TRUE(unlimited.TryAcquire(kStart));
+    }
+  }
+
+  static auto ThrottleTest() -> void {
+    constexpr std::uint64_t kNow = 1000000000;
+
+    Throttle throttle(ThrottleLimits{1, 3});
+    throttle.AddSession(1, ThrottleLimits{1, 2});
+
+    // session 1 runs out first, then account 7 over sessions 2 and 3
+    ASSERT_TRUE(throttle.TryAcquire(1, 7, kNow));  // NOLINT
+    ASSERT_TRUE(throttle.TryAcquire(1, 8, kNow));  // NOLINT
+    ASSERT_FALSE(throttle.TryAcquire(1, 9, kNow));  // NOLINT
+    ASSERT_TRUE(throttle.TryAcquire(2, 7, kNow));  // NOLINT
+    ASSERT_TRUE(throttle.TryAcquire(3, 7, kNow));  // NOLINT
+    ASSERT_FALSE(throttle.TryAcquire(3, 7, kNow));  // NOLINT
+
+    // a message the account refuses takes nothing from the session
+    throttle.AddSession(4, ThrottleLimits{1, 1});   // NOLINT
+    ASSERT_FALSE(throttle.TryAcquire(4, 7, kNow));  // NOLINT
+    ASSERT_TRUE(throttle.TryAcquire(4, 8, kNow));   // NOLINT
+    ASSERT_FALSE(throttle.TryAcquire(4, 8, kNow));  // NOLINT
+
+    // accounts beyond the table are refused rather than added
+    ASSERT_FALSE(throttle.TryAcquire(2, Throttle::kMaxAccountId, kNow));
+
+    // a removed session is no longer limited
+    throttle.RemoveSession(1);
+    ASSERT_TRUE(throttle.TryAcquire(1, 9, kNow));  // NOLINT
+  }
+};
+
+TEST_F(GatewayFixture, single_engine_test) { SingleEngineTest(); }  // NOLINT
+
+TEST_F(GatewayFixture, range_test) { RangeTest(); }  // NOLINT
+
+TEST_F(GatewayFixture, hash_test) { HashTest(); }  // NOLINT
+
+TEST_F(GatewayFixture, parse_error_test) { ParseErrorTest(); }  // NOLINT
+
+TEST_F(GatewayFixture, find_soh_test) { FindSohTest(); }  // NOLINT
+
+TEST_F(GatewayFixture, new_order_single_test) {  // NOLINT
+  NewOrderSingleTest();
+}
+
+TEST_F(GatewayFixture, cancel_replace_test) {  // NOLINT
+  CancelReplaceTest();
+}
+
+TEST_F(GatewayFixture, symbol_test) { SymbolTest(); }  // NOLINT
+
+TEST_F(GatewayFixture, field_map_test) { FieldMapTest(); }  // NOLINT
+
+TEST_F(GatewayFixture, malformed_test) { MalformedTest(); }  // NOLINT
+
+TEST_F(GatewayFixture, risk_config_test) { RiskConfigTest(); }  // NOLINT
+
+TEST_F(GatewayFixture, risk_limit_test) { RiskLimitTest(); }  // NOLINT
+
+TEST_F(GatewayFixture, risk_execution_test) {  // NOLINT
+  RiskExecutionTest();
+}
+
+TEST_F(GatewayFixture, token_bucket_test) { TokenBucketTest(); }  // NOLINT
+
+TEST_F(GatewayFixture, throttle_test) { ThrottleTest(); }  // NOLINT
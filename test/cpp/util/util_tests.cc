@@ -0,0 +1,428 @@
+#include <sys/wait.h>
+
+#include <atomic>
+#include <filesystem>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "orderbook/util/builder_pool.h"
+#include "orderbook/util/csv.h"
+#include "orderbook/util/journal.h"
+#include "orderbook/util/shm_socket_providers.h"
+#include "orderbook/util/spsc_ring.h"
+
+class UtilFixture : public ::testing::Test {
+ private:
+ public:
+  static auto SpscRingTest() -> void {
+    orderbook::util::SpscRing<int, 4> ring;  // NOLINT
+    ASSERT_TRUE(ring.Empty());
+    ASSERT_TRUE(ring.Capacity() == 4);  // NOLINT
+
+    for (int i = 0; i < 4; ++i) {  // NOLINT
+      ASSERT_TRUE(ring.TryPush(int{i}));
+    }
+
+    // ring is full
+    ASSERT_FALSE(ring.TryPush(4));  // NOLINT
+    ASSERT_TRUE(ring.Size() == 4);  // NOLINT
+
+    int value{-1};
+    for (int i = 0; i < 4; ++i) {  // NOLINT
+      ASSERT_TRUE(ring.TryPop(value));
+      ASSERT_TRUE(value == i);
+    }
+
+    ASSERT_FALSE(ring.TryPop(value));
+    ASSERT_TRUE(ring.Empty());
+  }
+
+  static auto SpscRingThreadTest() -> void {
+    constexpr int kCount = 1000000;
+    orderbook::util::SpscRing<int, 1024> ring;  // NOLINT
+
+    std::thread producer([&]() {
+      for (int i = 0; i < kCount; ++i) {
+        while (!ring.TryPush(int{i})) {
+          std::this_thread::yield();
+        }
+      }
+    });
+
+    int expected{0};
+    int value{0};
+    bool in_order{true};
+    while (expected < kCount) {
+      if (ring.TryPop(value)) {
+        in_order = in_order && (value == expected);
+        ++expected;
+      }
+    }
+
+    producer.join();
+    ASSERT_TRUE(in_order);
+    ASSERT_TRUE(ring.Empty());
+  }
+
+  static auto ArenaAllocatorTest() -> void {
+    std::array<std::uint8_t, 64> arena{};  // NOLINT
+    orderbook::util::ArenaAllocator allocator(arena.data(), arena.size());
+
+    // The first allocation that fits is served from the arena.
+    auto* first = allocator.allocate(64);  // NOLINT
+    ASSERT_TRUE(first == arena.data());
+    ASSERT_TRUE(allocator.ArenaInUse());
+
+    // The arena is taken, or the buffer is too large: use the heap.
+    auto* second = allocator.allocate(16);  // NOLINT
+    ASSERT_TRUE(second != arena.data());
+    ASSERT_TRUE(allocator.HeapCount() == 1);
+    allocator.deallocate(second, 16);  // NOLINT
+
+    allocator.deallocate(first, 64);  // NOLINT
+    ASSERT_FALSE(allocator.ArenaInUse());
+
+    auto* large = allocator.allocate(128);  // NOLINT
+    ASSERT_TRUE(large != arena.data());
+    ASSERT_TRUE(allocator.HeapCount() == 2);
+    allocator.deallocate(large, 128);  // NOLINT
+  }
+
+  static auto BuilderPoolTest() -> void {
+    using BuilderPool = orderbook::util::BuilderPool<2, 256>;  // NOLINT
+    using PooledBuilder = BuilderPool::PooledBuilder;
+
+    BuilderPool pool;
+    auto& first = pool.Acquire();
+    auto& second = pool.Acquire();
+    ASSERT_TRUE(&first != &second);
+    ASSERT_TRUE(first.InFlight());
+    ASSERT_TRUE(second.InFlight());
+
+    // Released by the zmq free callback, or directly when not sent.
+    PooledBuilder::OnSent(first.Data(), &first);
+    second.Release();
+    ASSERT_FALSE(first.InFlight());
+    ASSERT_FALSE(second.InFlight());
+
+    // The ring wraps around to the first builder.
+    ASSERT_TRUE(&pool.Acquire() == &first);
+    ASSERT_TRUE(pool.ExhaustedCount() == 0);
+
+    // The next builder is still in flight until another thread sends it.
+    auto& reused = pool.Acquire();
+    ASSERT_TRUE(&reused == &second);
+    std::thread sender([&]() { first.Release(); });
+    ASSERT_TRUE(&pool.Acquire() == &first);
+    sender.join();
+  }
+
+  static auto ShmByteRingTest() -> void {
+    using Ring = orderbook::util::ShmByteRing<64>;  // NOLINT
+
+    auto ring = std::make_unique<Ring>();
+    ASSERT_TRUE(ring->Empty());
+
+    const std::string message(20, 'a');  // NOLINT
+    std::string received;
+    auto read = [&](const std::uint8_t* data, std::size_t size) {
+      received.assign(reinterpret_cast<const char*>(data), size);
+    };
+
+    // Two 24 byte records fit, a third does not.
+    ASSERT_TRUE(ring->TryWrite(message.data(), message.size()));
+    ASSERT_TRUE(ring->TryWrite(message.data(), message.size()));
+    ASSERT_FALSE(ring->TryWrite(message.data(), message.size()));
+
+    // Free the first record; the next one does not fit in the 16 bytes
+    // left at the end of the buffer and wraps to the start.
+    ASSERT_TRUE(ring->TryRead(read));
+    ASSERT_TRUE(received == message);
+    const std::string wrapped(17, 'w');  // NOLINT
+    ASSERT_TRUE(ring->TryWrite(wrapped.data(), wrapped.size()));
+
+    ASSERT_TRUE(ring->TryRead(read));
+    ASSERT_TRUE(received == message);
+    ASSERT_TRUE(ring->TryRead(read));
+    ASSERT_TRUE(received == wrapped);
+    ASSERT_FALSE(ring->TryRead(read));
+    ASSERT_TRUE(ring->Empty());
+
+    // Larger than half the ring is never accepted.
+    const std::string large(Ring::kMaxMessageSize + 1, 'b');
+    ASSERT_FALSE(ring->TryWrite(large.data(), large.size()));
+  }
+
+  static auto ShmSocketTest() -> void {
+    orderbook::util::ShmServerSocketProvider server;
+    orderbook::util::ShmClientSocketProvider client;
+    server.Bind("shm://orderbook_util_test");
+    client.Connect("shm://orderbook_util_test");
+
+    std::uint32_t routing_id{0};
+    std::string request;
+    std::thread server_thr([&]() {
+      server.ProcessMessages([&](zmq::message_t&& msg) {
+        routing_id = msg.routing_id();
+        request.assign(static_cast<const char*>(msg.data()), msg.size());
+        server.Close();
+      });
+    });
+
+    const std::string ping = "ping";
+    ASSERT_TRUE(client.SendMessage(ping).has_value());
+    server_thr.join();
+    ASSERT_TRUE(request == ping);
+    ASSERT_TRUE(routing_id == 1);
+
+    std::string reply;
+    std::thread client_thr([&]() {
+      client.ProcessMessages([&](zmq::message_t&& msg) {
+        reply.assign(static_cast<const char*>(msg.data()), msg.size());
+        client.Close();
+      });
+    });
+
+    const std::string pong = "pong";
+    ASSERT_TRUE(server
+                    .SendFlatBuffer(
+                        reinterpret_cast<const std::uint8_t*>(pong.data()),
+                        pong.size(), routing_id)
+                    .has_value());
+    client_thr.join();
+    ASSERT_TRUE(reply == pong);
+
+    // once the client has closed its channel nothing more is written to it
+    ASSERT_FALSE(server
+                     .SendFlatBuffer(
+                         reinterpret_cast<const std::uint8_t*>(pong.data()),
+                         pong.size(), routing_id)
+                     .has_value());
+  }
+
+  static auto ShmReconnectTest() -> void {
+    orderbook::util::ShmServerSocketProvider server;
+    std::atomic<int> accepts{0};
+    std::atomic<int> disconnects{0};
+    server.Monitor(
+        [&](const zmq_event_t& /*event*/, const char* /*addr*/) {
+          ++accepts;
+        },
+        ZMQ_EVENT_ACCEPTED);
+    server.Monitor(
+        [&](const zmq_event_t& /*event*/, const char* /*addr*/) {
+          ++disconnects;
+        },
+        ZMQ_EVENT_DISCONNECTED);
+    server.Bind("shm://orderbook_reconnect_test");
+    std::thread server_thr([&]() { server.ProcessMessages([](auto&&) {}); });
+
+    const auto connect = [](auto& client) {
+      std::int32_t routing_id{0};
+      client.Monitor(
+          [&](const zmq_event_t& event, const char* /*addr*/) {
+            routing_id = event.value;
+          },
+          ZMQ_EVENT_CONNECTED);
+      client.Connect("shm://orderbook_reconnect_test");
+      return static_cast<std::uint32_t>(routing_id);
+    };
+    const auto wait_for = [](const std::atomic<int>& events, const int count) {
+      for (int i = 0; i < 5000 && events < count; ++i) {  // NOLINT
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      return events == count;
+    };
+    const std::string pong = "pong";
+    const auto send = [&](const std::uint32_t& routing_id) {
+      return server
+          .SendFlatBuffer(reinterpret_cast<const std::uint8_t*>(pong.data()),
+                          pong.size(), routing_id)
+          .has_value();
+    };
+
+    std::uint32_t first_id{0};
+    {
+      orderbook::util::ShmClientSocketProvider client;
+      first_id = connect(client);
+      ASSERT_TRUE(wait_for(accepts, 1));
+      ASSERT_TRUE(send(first_id));
+      client.Close();
+    }
+    ASSERT_TRUE(wait_for(disconnects, 1));
+
+    // the same channel under a new generation, the old id reaches nobody
+    orderbook::util::ShmClientSocketProvider client;
+    const auto second_id = connect(client);
+    ASSERT_TRUE(second_id != first_id);
+    ASSERT_FALSE(send(first_id));
+    ASSERT_TRUE(send(second_id));
+
+    // a client killed without closing has its channel reclaimed
+    ASSERT_TRUE(wait_for(accepts, 2));
+    const pid_t child = ::fork();
+    if (child == 0) {
+      orderbook::util::ShmClientSocketProvider orphan;
+      orphan.Connect("shm://orderbook_reconnect_test");
+      ::pause();
+      ::_exit(0);
+    }
+    ASSERT_TRUE(child > 0);
+    ASSERT_TRUE(wait_for(accepts, 3));
+    ::kill(child, SIGKILL);
+    ::waitpid(child, nullptr, 0);
+    ASSERT_TRUE(wait_for(disconnects, 2));
+    ASSERT_TRUE(send(second_id));
+
+    server.Close();
+    server_thr.join();
+  }
+
+  static auto CsvTest() -> void {
+    std::istringstream input(
+        "# comment\r\n"
+        "id,name\n"
+        "\n"
+        "7,a,\r\n"
+        "-8\n");
+
+    std::vector<std::pair<std::size_t, std::string>> lines;
+    orderbook::util::ForEachCsvLine(
+        input, "id", [&](std::string_view line, const std::size_t& line_no) {
+          lines.emplace_back(line_no, line);
+        });
+
+    // comments, blank lines and the header are skipped, CRs trimmed
+    ASSERT_TRUE(lines.size() == 2);
+    ASSERT_TRUE(lines[0].first == 4);  // NOLINT
+    ASSERT_TRUE(lines[1].first == 5);  // NOLINT
+    ASSERT_TRUE(lines[1].second == "-8");
+
+    const auto fields = orderbook::util::SplitCsv(lines[0].second);
+    ASSERT_TRUE(fields.size() == 3);
+    ASSERT_TRUE(fields[0] == "7");
+    ASSERT_TRUE(fields[1] == "a");
+    ASSERT_TRUE(fields[2].empty());
+
+    int value{0};
+    ASSERT_TRUE(orderbook::util::ParseInteger("-8", value));
+    ASSERT_TRUE(value == -8);  // NOLINT
+    for (const auto* str : {"", "7a", " 7", "+7", "99999999999"}) {
+      ASSERT_FALSE(orderbook::util::ParseInteger(str, value));
+      ASSERT_TRUE(value == -8);  // NOLINT
+    }
+
+    unsigned int count{0};
+    ASSERT_FALSE(orderbook::util::ParseInteger("-8", count));
+  }
+
+  static auto JournalTest() -> void {
+    using orderbook::util::JournalReader;
+    using orderbook::util::JournalWriter;
+
+    const auto dir = (std::filesystem::temp_directory_path() /
+                      ("orderbook_journal_" + std::to_string(::getpid())))
+                         .string();
+    std::filesystem::remove_all(dir);
+
+    orderbook::util::JournalOptions options;
+    options.dir = dir;
+    options.segment_size = 256;  // NOLINT
+    options.sync_bytes = 64;     // NOLINT
+
+    std::vector<std::string> messages;
+    for (int i = 0; i < 20; ++i) {  // NOLINT
+      messages.push_back("message-" + std::string(i, 'x'));
+    }
+
+    {
+      JournalWriter writer(options);
+      for (std::size_t i = 0; i < messages.size(); ++i) {
+        ASSERT_TRUE(writer.Append(i, messages[i].data(),
+                                  messages[i].size()) == i + 1);
+        writer.Commit();
+      }
+
+      // a record larger than a segment is refused
+      const std::string large(256, 'l');  // NOLINT
+      ASSERT_THROW(writer.Append(0, large.data(), large.size()),
+                   std::length_error);
+    }
+
+    // small segments, the records rolled over several
+    const auto segments = orderbook::util::internal::SegmentPaths(dir).size();
+    ASSERT_TRUE(segments > 1);
+
+    std::size_t count{0};
+    bool in_order{true};
+    auto read = [&](const std::uint32_t& routing_id,
+                    const std::uint8_t* data, const std::size_t& length) {
+      const std::string message(reinterpret_cast<const char*>(data), length);
+      if (count < messages.size()) {
+        in_order = in_order && routing_id == count &&
+                   message == messages[count];
+      }
+      ++count;
+    };
+    ASSERT_TRUE(JournalReader::ForEach(dir, read) == messages.size());
+    ASSERT_TRUE(in_order);
+
+    // reopening to recover appends to a new segment, continuing the
+    // sequence
+    options.mode = orderbook::util::JournalMode::kRecover;
+    {
+      JournalWriter writer(options);
+      ASSERT_TRUE(writer.Sequence() == messages.size());
+      ASSERT_TRUE(orderbook::util::internal::SegmentPaths(dir).size() ==
+                  segments);
+      const std::string last = "last";
+      ASSERT_TRUE(writer.Append(7, last.data(), last.size()) ==  // NOLINT
+                  messages.size() + 1);
+    }
+
+    count = 0;
+    ASSERT_TRUE(JournalReader::ForEach(dir, read) == messages.size() + 1);
+    ASSERT_TRUE(orderbook::util::internal::SegmentPaths(dir).size() ==
+                segments + 1);
+
+    // recording again archives the old journal and starts a new one
+    options.mode = orderbook::util::JournalMode::kRecord;
+    for (std::uint32_t run = 0; run < 2; ++run) {
+      JournalWriter writer(options);
+      ASSERT_TRUE(writer.Sequence() == 0);
+      ASSERT_TRUE(orderbook::util::internal::SegmentPaths(dir).empty());
+      ASSERT_TRUE(writer.Append(1, messages[0].data(), messages[0].size()) ==
+                  1);
+    }
+
+    count = 0;
+    ASSERT_TRUE(JournalReader::ForEach(dir, read) == 1);
+    ASSERT_TRUE(orderbook::util::internal::SegmentPaths(dir + "/archive.0")
+                    .size() == segments + 1);
+    ASSERT_TRUE(
+        orderbook::util::internal::SegmentPaths(dir + "/archive.1").size() ==
+        1);
+
+    std::filesystem::remove_all(dir);
+  }
+};
+
+TEST_F(UtilFixture, spsc_ring_test) { SpscRingTest(); }  // NOLINT
+
+TEST_F(UtilFixture, spsc_ring_thread_test) { SpscRingThreadTest(); }  // NOLINT
+
+TEST_F(UtilFixture, arena_allocator_test) { ArenaAllocatorTest(); }  // NOLINT
+
+TEST_F(UtilFixture, builder_pool_test) { BuilderPoolTest(); }  // NOLINT
+
+TEST_F(UtilFixture, shm_byte_ring_test) { ShmByteRingTest(); }  // NOLINT
+
+TEST_F(UtilFixture, shm_socket_test) { ShmSocketTest(); }  // NOLINT
+
+TEST_F(UtilFixture, shm_reconnect_test) { ShmReconnectTest(); }  // NOLINT
+
+TEST_F(UtilFixture, csv_test) { CsvTest(); }  // NOLINT
+
+TEST_F(UtilFixture, journal_test) { JournalTest(); }  // NOLINT